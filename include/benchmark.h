@@ -0,0 +1,91 @@
+/**
+ * @file benchmark.h
+ * @brief Repeatable flythrough that measures frame times along a scripted path.
+ *
+ * A path file moves the submarine along a Catmull-Rom spline through
+ * timed points and turns the camera around it, so every run draws the
+ * same frames. The simulation is stepped once per frame on the render
+ * thread and the random numbers of the scene are seeded from the file.
+ * After a number of warm-up frames, which hold the first point, the
+ * CPU time of every frame and of every render pass is measured until
+ * the path ends. The percentiles are then printed and written to a
+ * JSON file, so runs of different builds can be compared.
+ *
+ * A path file holds one directive per line, # starts a comment:
+ *
+ *     seed <n>                       seed of the random numbers, 1 by default
+ *     warmup <frames>                unmeasured frames before the path starts
+ *     point <s> <x> <y> <z> <theta> <phi>
+ *
+ * Each point gives the time in seconds, the submarine position and the
+ * camera angles around the submarine in degrees. Points must be listed
+ * in increasing time.
+ */
+
+
+#pragma once
+
+
+#define BENCHMARK_MAX_POINTS     64                // points of a path at most
+#define BENCHMARK_DEFAULT_SEED   1                 // seed rand() starts with when never seeded
+#define BENCHMARK_DEFAULT_WARMUP 60                // warm-up frames of files without a warmup line
+#define BENCHMARK_JSON_FILE      "benchmark.json"  // results file without --benchmark-json
+
+
+/**
+ * @brief Loads a path file and seeds the random numbers of the scene.
+ *
+ * Must be called before the renderer is initialized, which places
+ * the boids.
+ *
+ * @param file_path Path of the file.
+ * @return int Returns 1 if the path was loaded, 0 otherwise.
+ */
+int benchmark_load(const char* file_path);
+
+/**
+ * @brief Checks if a path was loaded.
+ *
+ * @return int Returns 1 while a benchmark runs, 0 otherwise.
+ */
+int benchmark_active(void);
+
+/**
+ * @brief Returns the number of frames of the benchmark, warm-up included.
+ *
+ * @return int Number of frames.
+ */
+int benchmark_frame_count(void);
+
+/**
+ * @brief Moves the submarine and the camera angles to a step of the path.
+ *
+ * Called by the simulation with its state locked, before the
+ * submarine and camera are updated.
+ *
+ * @param step Simulation step, counted from 1.
+ */
+void benchmark_drive(unsigned step);
+
+/**
+ * @brief Records the CPU time of a finished frame.
+ *
+ * The render pass times are taken from the OpenGL call trace of the
+ * frame, so this must be called after it was drawn.
+ *
+ * @param frame_ms Time of the frame in milliseconds.
+ * @return int Returns 1 once the last frame was recorded, 0 otherwise.
+ */
+int benchmark_end_frame(double frame_ms);
+
+/**
+ * @brief Prints the measured frame times and writes them to a JSON file.
+ *
+ * @param json_path Path of the JSON file, replaced if it exists.
+ */
+void benchmark_report(const char* json_path);
+
+/**
+ * @brief Frees the path and the measured times.
+ */
+void benchmark_clean_up(void);
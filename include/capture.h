@@ -0,0 +1,95 @@
+/**
+ * @file capture.h
+ * @brief Records the drawn frames to image sequences without stalling.
+ *
+ * Every frame is read back into one of a ring of pixel buffer objects.
+ * A buffer is only mapped when the ring comes back around to it, frames
+ * later, when the transfer finished long ago and mapping does not wait
+ * for the GPU. The pixels are copied into a job and handed to a pool of
+ * worker threads, which encode PNG files or raw YUV 4:2:0 frames. When
+ * all jobs are busy, frames are dropped instead of blocking the
+ * renderer. Without pixel buffer objects frames are read synchronously.
+ */
+
+
+#pragma once
+
+
+#define CAPTURE_BUFFER_COUNT     3                   // pixel buffers in the ring, frames between a read and its mapping
+#define CAPTURE_JOB_COUNT        8                   // frames queued or being encoded at most
+#define CAPTURE_WORKER_COUNT     2                   // encoding threads
+#define CAPTURE_PNG_FILE_FORMAT  "capture_%06d.png"  // file name of PNG frames, by capture frame number
+#define CAPTURE_YUV_FILE_FORMAT  "capture_%06d.yuv"  // file name of raw I420 frames, by capture frame number
+
+
+/**
+ * @brief Selects how captured frames are written.
+ */
+typedef enum {
+    CAPTURE_FORMAT_PNG,   // one PNG file per frame
+    CAPTURE_FORMAT_YUV,   // one raw planar BT.601 YUV 4:2:0 (I420) file per frame
+    CAPTURE_FORMAT_COUNT  // number of capture formats
+} capture_format;
+
+/**
+ * @brief Counters of the current or last capture.
+ */
+typedef struct {
+    int    frames_read;        // frames read back from the framebuffer
+    int    frames_written;     // frames encoded and written by the workers
+    int    frames_dropped;     // frames skipped because every job was busy
+    double last_overhead_ms;   // render thread time spent on the last frame
+    double total_overhead_ms;  // render thread time spent on all frames
+    double total_encode_ms;    // worker time spent encoding and writing all frames
+} capture_stats;
+
+
+/**
+ * @brief Starts capturing every drawn frame.
+ *
+ * Must be called with a current context.
+ *
+ * @param format How the frames are written.
+ * @return int Returns 1 if capturing, 0 if the workers could not be started.
+ */
+int capture_start(capture_format format);
+
+/**
+ * @brief Writes the frames still in flight and stops capturing.
+ *
+ * Waits for the workers, then prints the capture statistics.
+ */
+void capture_stop(void);
+
+/**
+ * @brief Checks if frames are being captured.
+ *
+ * @return int Returns 1 while capturing, 0 otherwise.
+ */
+int capture_active(void);
+
+/**
+ * @brief Reads back the frame just drawn into the current framebuffer.
+ *
+ * Must be called after drawing and before the buffers are swapped.
+ * Does nothing while not capturing.
+ *
+ * @param width  Width of the framebuffer in pixels.
+ * @param height Height of the framebuffer in pixels.
+ */
+void capture_frame(int width, int height);
+
+/**
+ * @brief Copies the counters of the current or last capture.
+ *
+ * @param stats Output counters.
+ */
+void capture_get_stats(capture_stats* stats);
+
+/**
+ * @brief Returns a readable name of a capture format.
+ *
+ * @param format The capture format.
+ * @return const char* Name of the format, e.g. "png".
+ */
+const char* capture_format_name(capture_format format);
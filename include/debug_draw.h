@@ -0,0 +1,151 @@
+/**
+ * @file debug_draw.h
+ * @brief Collects debug lines, boxes and spheres of a frame into one batch.
+ *
+ * Anything the render thread records while a frame is being built is
+ * added to a vertex batch as colored, unlit lines. The renderer hands
+ * the batch to the backend as one line draw per weight, so any amount of
+ * debug geometry costs at most DEBUG_DRAW_WEIGHT_COUNT draw calls.
+ * Spheres are drawn as their three great circles about the axes.
+ *
+ * Builds that define DEBUG_DRAW as 0 compile the calls out without
+ * evaluating their arguments. While debug_draw_on is 0 every call
+ * returns at once and the frame has no debug draws.
+ */
+
+
+#pragma once
+
+
+#include "geometry.h"
+#include "lighting.h"
+
+#include <GL/freeglut.h>
+
+
+#ifndef DEBUG_DRAW
+#define DEBUG_DRAW 1  // defined as 0 by release builds that compile debug drawing out
+#endif
+
+#define DEBUG_DRAW_CAPACITY        2048  // vertices of each weight per frame, further lines are dropped
+#define DEBUG_DRAW_CIRCLE_SEGMENTS   24  // lines per great circle of a sphere
+#define DEBUG_DRAW_THIN_WIDTH      1.0f  // width of thin lines in pixels
+#define DEBUG_DRAW_BOLD_WIDTH      5.0f  // width of bold lines in pixels
+
+
+/**
+ * @brief Line width a debug primitive is drawn with.
+ */
+typedef enum {
+    DEBUG_DRAW_THIN,         // DEBUG_DRAW_THIN_WIDTH
+    DEBUG_DRAW_BOLD,         // DEBUG_DRAW_BOLD_WIDTH
+    DEBUG_DRAW_WEIGHT_COUNT  // number of weights
+} debug_draw_weight;
+
+/**
+ * @brief A vertex of a debug line, in world space.
+ */
+typedef struct {
+    point_3d position;  // end point of the line
+    GLubyte  color[4];  // unlit color { r, g, b, a }
+} debug_vertex;
+
+/**
+ * @brief Debug lines recorded for one frame.
+ *
+ * The lines of weight w are the vertex pairs from
+ * w * DEBUG_DRAW_CAPACITY up to w * DEBUG_DRAW_CAPACITY + counts[w].
+ */
+typedef struct {
+    debug_vertex vertices[DEBUG_DRAW_WEIGHT_COUNT * DEBUG_DRAW_CAPACITY];  // line vertex pairs of all weights
+    int          counts[DEBUG_DRAW_WEIGHT_COUNT];                          // used vertices of each weight
+    int          dropped;                                                  // lines dropped over capacity this frame
+} debug_draw_batch;
+
+
+#if DEBUG_DRAW
+
+extern int debug_draw_on;  // 1 indicates debug geometry recorded and drawn, 0 skipped.
+
+
+/**
+ * @brief Empties the batch for a new frame.
+ */
+void debug_draw_begin_frame(void);
+
+/**
+ * @brief Adds a line.
+ *
+ * @param weight     Width of the line.
+ * @param start      Start point.
+ * @param end        End point.
+ * @param line_color Color of the line, unlit.
+ */
+void debug_draw_line(
+          debug_draw_weight weight,
+    const point_3d          start,
+    const point_3d          end,
+    const color             line_color
+);
+
+/**
+ * @brief Adds the twelve edges of an axis-aligned box.
+ *
+ * @param weight     Width of the lines.
+ * @param minimum    Corner with the smallest coordinates.
+ * @param maximum    Corner with the largest coordinates.
+ * @param line_color Color of the lines, unlit.
+ */
+void debug_draw_box(
+          debug_draw_weight weight,
+    const point_3d          minimum,
+    const point_3d          maximum,
+    const color             line_color
+);
+
+/**
+ * @brief Adds a sphere as its great circles about the x, y and z axes.
+ *
+ * @param weight     Width of the lines.
+ * @param center     Center of the sphere.
+ * @param radius     Radius of the sphere.
+ * @param line_color Color of the lines, unlit.
+ */
+void debug_draw_sphere(
+          debug_draw_weight weight,
+    const point_3d          center,
+          GLfloat           radius,
+    const color             line_color
+);
+
+/**
+ * @brief Returns the lines recorded since the frame began.
+ *
+ * @return const debug_draw_batch* The batch, valid until the next frame begins.
+ */
+const debug_draw_batch* debug_draw_get_batch(void);
+
+/**
+ * @brief Returns the line width of a weight.
+ *
+ * @param weight The weight.
+ * @return GLfloat Width in pixels.
+ */
+GLfloat debug_draw_weight_width(debug_draw_weight weight);
+
+#else
+
+#define debug_draw_on 0  // debug geometry is never recorded
+
+// The arguments only appear in sizeof, so they are never evaluated but still count as used.
+#define debug_draw_begin_frame()                              ((void)0)
+#define debug_draw_line(weight, start, end, line_color)       \
+    ((void)sizeof(weight), (void)sizeof(start), (void)sizeof(end), (void)sizeof(line_color))
+#define debug_draw_box(weight, minimum, maximum, line_color)  \
+    ((void)sizeof(weight), (void)sizeof(minimum), (void)sizeof(maximum), (void)sizeof(line_color))
+#define debug_draw_sphere(weight, center, radius, line_color) \
+    ((void)sizeof(weight), (void)sizeof(center), (void)sizeof(radius), (void)sizeof(line_color))
+#define debug_draw_get_batch()                                ((const debug_draw_batch*)0)
+#define debug_draw_weight_width(weight)                       DEBUG_DRAW_THIN_WIDTH
+
+#endif
@@ -0,0 +1,114 @@
+/**
+ * @file dynamic_resolution.h
+ * @brief Scales the rendered resolution to hold a frame time budget.
+ *
+ * While enabled, the scene is drawn into the lower left part of an
+ * offscreen color and depth target the size of the window and stretched
+ * over the window with a bilinear blit. A controller measures the cost
+ * of every frame, including the work OpenGL finishes after the draw
+ * calls returned, and adjusts the scale between 50% and 100% of the
+ * window width and height so the cost stays within the target. At full
+ * scale the scene is drawn straight into the window without the blit.
+ */
+
+
+#pragma once
+
+
+#include <GL/freeglut.h>
+
+
+#define DYNAMIC_RESOLUTION_MIN_SCALE         0.5f    // smallest fraction of the window width and height drawn
+#define DYNAMIC_RESOLUTION_MAX_SCALE         1.0f    // largest fraction of the window width and height drawn
+#define DYNAMIC_RESOLUTION_DEFAULT_TARGET_MS 16.667  // frame time budget of the 'r' key without --dynamic-resolution
+
+
+/**
+ * @brief Reports what the controller did at its last adjustment.
+ */
+typedef enum {
+    DYNAMIC_RESOLUTION_OFF,       // the scene is drawn at window resolution
+    DYNAMIC_RESOLUTION_HOLDING,   // the frame time is within the target, the scale is kept
+    DYNAMIC_RESOLUTION_LOWERING,  // the frame time is over the target, the scale shrinks
+    DYNAMIC_RESOLUTION_RAISING,   // the frame time is well under the target, the scale grows
+    DYNAMIC_RESOLUTION_STATE_COUNT
+} dynamic_resolution_state;
+
+/**
+ * @brief Current scale and controller state.
+ */
+typedef struct {
+    dynamic_resolution_state state;        // last decision of the controller
+    GLfloat                  scale;        // fraction of the window width and height drawn
+    int                      width;        // drawn width in pixels
+    int                      height;       // drawn height in pixels
+    double                   target_ms;    // frame time budget in milliseconds
+    double                   smoothed_ms;  // moving average of the measured frame times
+} dynamic_resolution_status;
+
+
+/**
+ * @brief Enables or disables the resolution scaling.
+ *
+ * Needs framebuffer objects and framebuffer blits, without them the
+ * scaling stays disabled. Enabling starts again at full scale.
+ *
+ * @param enabled   1 to enable the scaling, 0 to draw at window resolution.
+ * @param target_ms Frame time budget in milliseconds.
+ * @return int Returns 1 if the scaling is enabled afterwards, 0 otherwise.
+ */
+int dynamic_resolution_enable(int enabled, double target_ms);
+
+/**
+ * @brief Checks if the resolution scaling is enabled.
+ *
+ * @return int Returns 1 if enabled, 0 otherwise.
+ */
+int dynamic_resolution_enabled(void);
+
+/**
+ * @brief Starts measuring a frame and binds the target it is drawn into.
+ *
+ * Below full scale the offscreen target is bound with a viewport and
+ * scissor box of the scaled size, so clearing and drawing only touch
+ * the scaled pixels. Must be called before the frame is submitted.
+ *
+ * @param width  Window width in pixels.
+ * @param height Window height in pixels.
+ */
+void dynamic_resolution_begin_frame(int width, int height);
+
+/**
+ * @brief Upscales the frame into the window and adjusts the scale.
+ *
+ * Restores the framebuffer, viewport and scissor test that were current
+ * before dynamic_resolution_begin_frame.
+ */
+void dynamic_resolution_end_frame(void);
+
+/**
+ * @brief Returns the fraction of the window width and height drawn this frame.
+ *
+ * @return GLfloat The scale, 1 while the scaling is disabled.
+ */
+GLfloat dynamic_resolution_scale(void);
+
+/**
+ * @brief Copies the current scale and controller state.
+ *
+ * @param status Output status.
+ */
+void dynamic_resolution_get_status(dynamic_resolution_status* status);
+
+/**
+ * @brief Returns a readable name of a controller state.
+ *
+ * @param state The controller state.
+ * @return const char* Name of the state, e.g. "lowering".
+ */
+const char* dynamic_resolution_state_name(dynamic_resolution_state state);
+
+/**
+ * @brief Frees the offscreen target.
+ */
+void dynamic_resolution_cleanup(void);
@@ -1,28 +1,74 @@
 /**
  * @file environment.h
- * @brief Environment module for rendering floor, walls, and origin sphere.
+ * @brief Environment module for rendering floor and walls.
  *
  * Defines constants and declarations for environment geometry and textures.
+ * The surfaces are tessellated once into vertex arrays and only tessellated
+ * again when the size of the environment changes.
  */
 
 
 #pragma once
 
 
+#include "geometry.h"
+
 #include <GL/freeglut.h>
 
 
-#define ENVIRONMENT_RADIUS_XZ   10  // radius of environment floor and walls in XZ plane
-#define ENVIRONMENT_HEIGHT      10  // height of the environment 
-#define ENVIRONMENT_FLOOR_Y   (-1)  // y coordinate of the floor
+#define ENVIRONMENT_RADIUS_XZ   10     // radius of environment floor and walls in XZ plane
+#define ENVIRONMENT_HEIGHT      10     // height of the environment
+#define ENVIRONMENT_FLOOR_Y   (-1)     // y coordinate of the floor
+#define ENVIRONMENT_SLICES      20     // subdivisions around the z axis of every surface
+#define ENVIRONMENT_STACKS      20     // subdivisions along the radius or the z axis of every surface
+
+
+/**
+ * @brief A vertex of an environment surface.
+ */
+typedef struct {
+    point_3d  position;     // vertex coordinates
+    vector_3d normal;       // vertex normal
+    GLfloat   texcoord[2];  // texture coordinates { s, t }
+} environment_vertex;
+
+/**
+ * @brief A tessellated surface, drawn as indexed triangles.
+ *
+ * Surfaces are tessellated in their own frame with z as the axis,
+ * like the GLU quadrics they replace.
+ */
+typedef struct {
+    environment_vertex* vertices;       // array of vertices
+    GLushort*           indices;        // array of triangle indices
+    int                 vertex_count;   // number of vertices
+    int                 index_count;    // number of indices
+    GLuint              vertex_buffer;  // buffer object of the vertices, 0 if not uploaded
+    GLuint              index_buffer;   // buffer object of the indices, 0 if not uploaded
+    GLuint              vertex_array;   // vertex array object of the core backend, 0 if not created
+    GLuint              display_list;   // display list of the fixed backend, 0 if not compiled
+} environment_surface;
 
 
-extern GLUquadric* quadric_environment;    // quadric object used for floor and walls
-extern GLuint      texture_id_environment; // texture ID for environment surface
-extern GLUquadric* quadric_origin_sphere;  // quadric object for rendering origin sphere
+extern GLuint              texture_id_environment;  // texture ID for environment surface
+extern environment_surface environment_floor;       // floor disk, one unit wider than the walls
+extern environment_surface environment_walls;       // cylindrical walls, one unit higher than the environment
 
 
 /**
- * @brief Initialize environment resources like quadrics and textures.
+ * @brief Initialize environment resources like surfaces and textures.
  */
 void environment_initialize(void);
+
+/**
+ * @brief Draws a surface with a single draw call.
+ *
+ * @param surface     The surface to draw.
+ * @param use_buffers 1 to draw from buffer objects if uploaded, 0 to draw from client memory.
+ */
+void environment_draw_surface(const environment_surface* surface, int use_buffers);
+
+/**
+ * @brief Frees the surfaces and their buffer objects.
+ */
+void environment_cleanup(void);
@@ -0,0 +1,81 @@
+/**
+ * @file frame_pacing.h
+ * @brief Limits the frame rate of the window and idles while nothing changes.
+ *
+ * The GLUT idle callback asks before every frame whether to draw. Frames
+ * are scheduled on the monotonic clock at the target rate and the main
+ * thread sleeps until the next one is due, instead of posting redisplays
+ * in a tight loop. While the window is hidden, or nothing changed since
+ * the last frame in the idle-when-unchanged mode, no frame is drawn and
+ * the thread keeps sleeping.
+ */
+
+
+#pragma once
+
+
+#define FRAME_PACING_IDLE_POLL_MS   5.0    // sleep between checks while nothing changed
+#define FRAME_PACING_HIDDEN_POLL_MS 100.0  // sleep between checks while the window is hidden
+#define FRAME_PACING_SWAP_DRIVER    -1     // swap interval that keeps the driver setting
+
+
+/**
+ * @brief Counters of the pacing since startup.
+ */
+typedef struct {
+    double target_fps;      // frame rate limit, 0 for none
+    int    swap_interval;   // vertical blanks per swap, FRAME_PACING_SWAP_DRIVER if not set
+    int    idle_unchanged;  // 1 if unchanged frames are skipped
+    int    visible;         // 1 if the window can be seen
+    long   frames_drawn;    // frames drawn
+    long   frames_skipped;  // checks that found nothing to draw, unchanged or hidden
+    double asleep_ms;       // time slept while pacing in milliseconds
+    double elapsed_ms;      // time since the pacing started in milliseconds
+} frame_pacing_stats;
+
+
+/**
+ * @brief Sets the frame rate limit, the vertical sync and the idle mode.
+ *
+ * Must be called with the window context current.
+ *
+ * @param target_fps     Frames per second at most, 0 for no limit.
+ * @param swap_interval  Vertical blanks per swap, 0 for no vertical sync,
+ *                       FRAME_PACING_SWAP_DRIVER to keep the driver setting.
+ * @param idle_unchanged 1 to skip frames while nothing changed, 0 to draw all.
+ */
+void frame_pacing_initialize(double target_fps, int swap_interval, int idle_unchanged);
+
+/**
+ * @brief Sleeps until the next frame is due and decides if it is drawn.
+ *
+ * @param step Simulation step of the latest snapshot.
+ * @return int Returns 1 if a frame should be drawn now, 0 to ask again later.
+ */
+int frame_pacing_wait(unsigned step);
+
+/**
+ * @brief Records the simulation step a frame was drawn from.
+ *
+ * @param step Simulation step of the drawn snapshot.
+ */
+void frame_pacing_frame_drawn(unsigned step);
+
+/**
+ * @brief Requests a frame for a change outside the simulation, e.g. a toggled setting.
+ */
+void frame_pacing_invalidate(void);
+
+/**
+ * @brief Tells the pacing if the window can be seen.
+ *
+ * @param visible 1 if any part of the window is shown, 0 if it is hidden or minimized.
+ */
+void frame_pacing_set_visible(int visible);
+
+/**
+ * @brief Copies the counters of the pacing.
+ *
+ * @param stats Output counters.
+ */
+void frame_pacing_get_stats(frame_pacing_stats* stats);
@@ -0,0 +1,98 @@
+/**
+ * @file frame_stats.h
+ * @brief Per-frame rendering statistics and render path comparison.
+ *
+ * Measures the time spent rendering each frame. In comparison mode the
+ * renderer cycles through all supported render paths, measuring each one
+ * for a fixed number of frames and printing the average frame times.
+ */
+
+
+#pragma once
+
+
+#define FRAME_STATS_COMPARISON_FRAMES 300  // frames measured per render path when comparing
+
+
+/**
+ * @brief Statistics of the last rendered frame.
+ */
+typedef struct {
+    double frame_time_ms;             // time spent rendering the frame in milliseconds
+    int    objects_visible;           // scene objects and boids that passed culling
+    int    objects_culled;            // scene objects and boids outside the view frustum
+    int    objects_fog_culled;        // scene objects and boids hidden by the fog
+    int    objects_simplified;        // scene objects drawn at a reduced level of detail
+    double culling_time_ms;           // time spent testing bounds in milliseconds
+    int    state_calls_issued;        // state changes passed on to OpenGL
+    int    state_calls_skipped;       // state changes skipped by the state cache
+    int    objects_occluded;          // scene objects and boids hidden behind occluders
+    int    occluders_rasterized;      // scene objects rasterized into the occlusion buffer
+    int    occluder_triangles;        // triangles rasterized into the occlusion buffer
+    double occlusion_raster_time_ms;  // time spent rasterizing occluders in milliseconds
+    int    draw_calls;                // draw calls, glBegin/glEnd blocks and display lists issued by the backend
+    int    resolution_width;          // width the scene was drawn at, below the window width with dynamic resolution
+    int    resolution_height;         // height the scene was drawn at, below the window height with dynamic resolution
+    double record_time_ms;            // time spent recording and sorting the scene objects and boids in milliseconds
+    int    record_threads;            // threads that recorded the draw list, the render thread included
+    int    boid_pyramids;             // visible boids drawn as pyramids
+    int    boid_impostors;            // visible boids drawn as impostor quads
+    int    point_lights;              // point lights reaching the view
+    int    light_cluster_refs;        // lights listed in the clusters, summed over all clusters
+    double light_assign_time_ms;      // time spent placing the point lights and sorting them into clusters in milliseconds
+    int    raster_triangles;          // triangles rasterized by the software backend after clipping
+    int    raster_fragments;          // fragments shaded by the software backend
+    int    raster_threads;            // threads that drew the tiles of the software backend, the render thread included
+    double raster_time_ms;            // time the software backend spent drawing and showing the frame in milliseconds
+} frame_stats;
+
+
+extern frame_stats current_frame_stats;  // statistics of the last rendered frame.
+extern int         comparison_on;        // 1 indicates render path comparison enabled, 0 disabled.
+
+
+/**
+ * @brief Marks the start of a rendered frame.
+ */
+void frame_stats_begin_frame(void);
+
+/**
+ * @brief Marks the end of a rendered frame and records its statistics.
+ *
+ * In comparison mode this waits for OpenGL to finish the frame so
+ * driver and GPU work is included in the measured time.
+ */
+void frame_stats_end_frame(void);
+
+/**
+ * @brief Prints the statistics of the last rendered frame to the console.
+ */
+void frame_stats_print(void);
+
+/**
+ * @brief Toggles the render path comparison mode.
+ *
+ * When enabled, starts measuring the immediate path and then every other
+ * supported path in turn. When disabled, restores the previous path.
+ * Render paths only exist in the fixed-function backend, other backends
+ * are compared by running them one after the other.
+ */
+void frame_stats_toggle_comparison(void);
+
+/**
+ * @brief Sorts frame times ascending.
+ *
+ * @param times Frame times in milliseconds, sorted in place.
+ * @param count Number of frame times.
+ */
+void frame_stats_sort_times(double* times, int count);
+
+/**
+ * @brief Returns a percentile of sorted frame times by the nearest rank.
+ *
+ * @param sorted     Frame times in ascending order.
+ * @param count      Number of frame times, at least one.
+ * @param percentile Percentile between 0 and 100.
+ * @return double The frame time at that percentile.
+ */
+double frame_stats_percentile(const double* sorted, int count, double percentile);
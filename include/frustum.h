@@ -0,0 +1,87 @@
+/**
+ * @file frustum.h
+ * @brief View-frustum planes and batched bounding sphere tests.
+ *
+ * The six planes are extracted from the product of the projection and
+ * view matrices. Spheres are tested in batches stored as separate arrays
+ * per coordinate, four at a time with SSE where it is available.
+ */
+
+
+#pragma once
+
+
+#include "geometry.h"
+
+
+#define FRUSTUM_PLANE_COUNT 6  // left, right, bottom, top, near, far
+
+
+/**
+ * @brief Planes of a view frustum in world space.
+ *
+ * Each plane is { a, b, c, d } with a unit normal pointing into the
+ * frustum, so a point p is inside when a*x + b*y + c*z + d >= 0.
+ */
+typedef struct {
+    GLfloat planes[FRUSTUM_PLANE_COUNT][4];  // normalized plane equations
+} frustum;
+
+
+/**
+ * @brief Extracts the frustum from the camera matrices.
+ *
+ * @param frustum    Output frustum in world space.
+ * @param projection Column-major projection matrix.
+ * @param view       Column-major view matrix.
+ */
+void frustum_extract(frustum* frustum, const GLfloat projection[16], const GLfloat view[16]);
+
+/**
+ * @brief Tests a batch of bounding spheres against the frustum.
+ *
+ * @param frustum  The frustum.
+ * @param center_x X coordinates of the sphere centers.
+ * @param center_y Y coordinates of the sphere centers.
+ * @param center_z Z coordinates of the sphere centers.
+ * @param radius   Radii of the spheres.
+ * @param count    Number of spheres.
+ * @param visible  Output, 1 for every sphere intersecting the frustum, 0 otherwise.
+ * @return int Number of visible spheres.
+ */
+int frustum_test_spheres(
+    const frustum*       frustum,
+    const GLfloat*       center_x,
+    const GLfloat*       center_y,
+    const GLfloat*       center_z,
+    const GLfloat*       radius,
+          int            count,
+          unsigned char* visible
+);
+
+/**
+ * @brief Calculates the nearest view depth of a batch of bounding spheres.
+ *
+ * The depth is measured from the eye along the view direction, the
+ * distance OpenGL uses for fog, and is negative for spheres reaching
+ * behind the eye.
+ *
+ * @param frustum  The frustum.
+ * @param eye      Position of the camera.
+ * @param center_x X coordinates of the sphere centers.
+ * @param center_y Y coordinates of the sphere centers.
+ * @param center_z Z coordinates of the sphere centers.
+ * @param radius   Radii of the spheres.
+ * @param count    Number of spheres.
+ * @param depth    Output nearest depth of every sphere.
+ */
+void frustum_nearest_depths(
+    const frustum*  frustum,
+    const point_3d  eye,
+    const GLfloat*  center_x,
+    const GLfloat*  center_y,
+    const GLfloat*  center_z,
+    const GLfloat*  radius,
+          int       count,
+          GLfloat*  depth
+);
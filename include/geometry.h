@@ -118,3 +118,85 @@ void geometry_calculate_normal(
     const point_3d  p3, 
           vector_3d normal
 );
+
+/**
+ * @brief Calculate the orientation basis of an object facing a direction.
+ *
+ * The basis equals a yaw rotation about the y axis followed by a pitch
+ * rotation about the x axis, without evaluating any trigonometric
+ * functions. The forward axis of the basis is the direction itself.
+ *
+ * @param direction The normalized direction the object faces.
+ * @param right The resulting x axis of the basis.
+ * @param up The resulting y axis of the basis.
+ */
+void geometry_calculate_basis(
+    const vector_3d direction, 
+          vector_3d right, 
+          vector_3d up
+);
+
+/**
+ * @brief Calculate the orientation bases of many directions at once.
+ *
+ * Gives the same axes as geometry_calculate_basis for every direction,
+ * four directions at a time with SSE where it is available.
+ *
+ * @param directions The first normalized direction.
+ * @param stride Floats from one direction to the next.
+ * @param count Number of directions.
+ * @param right The resulting x axis of every basis.
+ * @param up The resulting y axis of every basis.
+ */
+void geometry_calculate_bases(
+    const GLfloat*   directions, 
+          int        stride, 
+          int        count, 
+          vector_3d* right, 
+          vector_3d* up
+);
+
+/**
+ * @brief Multiply two column-major 4x4 matrices.
+ *
+ * @param a The left matrix.
+ * @param b The right matrix.
+ * @param result The resulting product a * b, must not alias a or b.
+ */
+void geometry_multiply_matrices(
+    const GLfloat a[16], 
+    const GLfloat b[16], 
+          GLfloat result[16]
+);
+
+/**
+ * @brief Calculate the view matrix of a camera, as built by gluLookAt.
+ *
+ * @param eye Position of the camera.
+ * @param target Point the camera looks at.
+ * @param up Up direction of the camera.
+ * @param matrix The resulting column-major view matrix.
+ */
+void geometry_calculate_look_at_matrix(
+    const point_3d  eye, 
+    const point_3d  target, 
+    const vector_3d up, 
+          GLfloat   matrix[16]
+);
+
+/**
+ * @brief Calculate a perspective projection matrix, as built by gluPerspective.
+ *
+ * @param fov Vertical field of view in degrees.
+ * @param aspect Width divided by height of the viewport.
+ * @param near_plane Distance to the near clipping plane.
+ * @param far_plane Distance to the far clipping plane.
+ * @param matrix The resulting column-major projection matrix.
+ */
+void geometry_calculate_perspective_matrix(
+    GLdouble fov, 
+    GLdouble aspect, 
+    GLdouble near_plane, 
+    GLdouble far_plane, 
+    GLfloat  matrix[16]
+);
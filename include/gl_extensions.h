@@ -0,0 +1,339 @@
+/**
+ * @file gl_extensions.h
+ * @brief Loads OpenGL entry points beyond the OpenGL 1.1 headers.
+ *
+ * The Windows OpenGL headers and library only expose OpenGL 1.1, so
+ * newer functions are loaded at runtime through glutGetProcAddress.
+ * Each loaded function is reached through its usual OpenGL name, and
+ * the gl_extensions flags report which feature sets are available.
+ */
+
+
+#pragma once
+
+
+#include <GL/freeglut.h>
+
+#include <stddef.h>
+
+
+#ifndef APIENTRY
+#define APIENTRY
+#endif
+
+
+// OpenGL 1.5 buffer object tokens.
+#ifndef GL_ARRAY_BUFFER
+#define GL_ARRAY_BUFFER         0x8892
+#define GL_ELEMENT_ARRAY_BUFFER 0x8893
+#define GL_STREAM_DRAW          0x88E0
+#define GL_STATIC_DRAW          0x88E4
+#define GL_DYNAMIC_DRAW         0x88E8
+#define GL_WRITE_ONLY           0x88B9
+#endif
+
+// OpenGL 2.1 pixel buffer object tokens.
+#ifndef GL_PIXEL_PACK_BUFFER
+#define GL_READ_ONLY            0x88B8
+#define GL_STREAM_READ          0x88E1
+#define GL_PIXEL_PACK_BUFFER    0x88EB
+#endif
+
+// OpenGL 2.0 shader tokens.
+#ifndef GL_VERTEX_SHADER
+#define GL_FRAGMENT_SHADER  0x8B30
+#define GL_VERTEX_SHADER    0x8B31
+#define GL_COMPILE_STATUS   0x8B81
+#define GL_LINK_STATUS      0x8B82
+#define GL_INFO_LOG_LENGTH  0x8B84
+#endif
+
+// OpenGL 3.0 framebuffer object tokens.
+#ifndef GL_FRAMEBUFFER
+#define GL_DEPTH_COMPONENT24     0x81A6
+#define GL_FRAMEBUFFER_COMPLETE  0x8CD5
+#define GL_COLOR_ATTACHMENT0     0x8CE0
+#define GL_DEPTH_ATTACHMENT      0x8D00
+#define GL_FRAMEBUFFER           0x8D40
+#define GL_RENDERBUFFER          0x8D41
+#endif
+#ifndef GL_READ_FRAMEBUFFER
+#define GL_FRAMEBUFFER_BINDING   0x8CA6
+#define GL_READ_FRAMEBUFFER      0x8CA8
+#define GL_DRAW_FRAMEBUFFER      0x8CA9
+#endif
+
+// OpenGL 3.1 uniform buffer tokens.
+#ifndef GL_UNIFORM_BUFFER
+#define GL_UNIFORM_BUFFER 0x8A11
+#define GL_INVALID_INDEX  0xFFFFFFFFu
+#endif
+
+// OpenGL 1.3 texture unit and 3.1 texture buffer tokens.
+#ifndef GL_TEXTURE0
+#define GL_TEXTURE0 0x84C0
+#endif
+#ifndef GL_TEXTURE_BUFFER
+#define GL_TEXTURE_BUFFER 0x8C2A
+#endif
+#ifndef GL_RGBA32F
+#define GL_RGBA32F 0x8814
+#endif
+#ifndef GL_R16UI
+#define GL_R16UI   0x8234
+#define GL_RG32UI  0x823C
+#endif
+
+// OpenGL 3.0 to 4.4 buffer mapping and sync object tokens.
+#ifndef GL_MAP_WRITE_BIT
+#define GL_MAP_WRITE_BIT               0x0002
+#define GL_MAP_INVALIDATE_BUFFER_BIT   0x0008
+#endif
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT          0x0040
+#define GL_MAP_COHERENT_BIT            0x0080
+#endif
+#ifndef GL_SYNC_GPU_COMMANDS_COMPLETE
+#define GL_SYNC_FLUSH_COMMANDS_BIT     0x00000001
+#define GL_SYNC_GPU_COMMANDS_COMPLETE  0x9117
+#define GL_ALREADY_SIGNALED            0x911A
+#define GL_TIMEOUT_EXPIRED             0x911B
+#define GL_CONDITION_SATISFIED         0x911C
+#define GL_WAIT_FAILED                 0x911D
+#endif
+
+typedef ptrdiff_t              gl_size_pointer;  // GLsizeiptr
+typedef ptrdiff_t              gl_int_pointer;   // GLintptr
+typedef char                   gl_char;          // GLchar
+typedef unsigned long long     gl_uint64;        // GLuint64
+typedef struct gl_sync_object* gl_sync;          // GLsync
+
+
+/**
+ * @brief Reports which optional OpenGL feature sets were loaded.
+ */
+typedef struct {
+    int vertex_buffer_objects;  // 1 if OpenGL 1.5 buffer objects are available
+    int pixel_buffer_objects;   // 1 if pixels can be read into buffer objects, OpenGL 2.1
+    int shaders;                // 1 if OpenGL 2.0 shader programs are available
+    int instanced_arrays;       // 1 if instanced drawing with attribute divisors is available
+    int persistent_mapping;     // 1 if buffers can stay mapped while drawing, with fences
+    int framebuffer_objects;    // 1 if offscreen framebuffers with renderbuffers are available
+    int framebuffer_blit;       // 1 if framebuffers can be copied and scaled into each other
+    int vertex_array_objects;   // 1 if OpenGL 3.0 vertex array objects are available
+    int uniform_buffers;        // 1 if OpenGL 3.1 uniform buffer objects are available
+    int texture_buffers;        // 1 if OpenGL 3.1 buffer textures can be bound to further texture units
+    int swap_control;           // 1 if the swap interval of the window can be set
+} gl_extension_support;
+
+/**
+ * @brief Looks up an entry point by name, e.g. eglGetProcAddress.
+ */
+typedef GLUTproc (*gl_extensions_loader)(const char* name);
+
+
+// Feature sets available in the current context.
+extern gl_extension_support gl_extensions;
+
+
+typedef void      (APIENTRY* gl_gen_buffers_proc)(GLsizei count, GLuint* buffers);
+typedef void      (APIENTRY* gl_delete_buffers_proc)(GLsizei count, const GLuint* buffers);
+typedef void      (APIENTRY* gl_bind_buffer_proc)(GLenum target, GLuint buffer);
+typedef void      (APIENTRY* gl_buffer_data_proc)(GLenum target, gl_size_pointer size, const void* data, GLenum usage);
+typedef void      (APIENTRY* gl_buffer_sub_data_proc)(GLenum target, gl_int_pointer offset, gl_size_pointer size, const void* data);
+typedef void*     (APIENTRY* gl_map_buffer_proc)(GLenum target, GLenum access);
+typedef GLboolean (APIENTRY* gl_unmap_buffer_proc)(GLenum target);
+
+extern gl_gen_buffers_proc     gl_extensions_gen_buffers;
+extern gl_delete_buffers_proc  gl_extensions_delete_buffers;
+extern gl_bind_buffer_proc     gl_extensions_bind_buffer;
+extern gl_buffer_data_proc     gl_extensions_buffer_data;
+extern gl_buffer_sub_data_proc gl_extensions_buffer_sub_data;
+extern gl_map_buffer_proc      gl_extensions_map_buffer;
+extern gl_unmap_buffer_proc    gl_extensions_unmap_buffer;
+
+typedef GLuint    (APIENTRY* gl_create_shader_proc)(GLenum type);
+typedef void      (APIENTRY* gl_delete_shader_proc)(GLuint shader);
+typedef void      (APIENTRY* gl_shader_source_proc)(GLuint shader, GLsizei count, const gl_char* const* sources, const GLint* lengths);
+typedef void      (APIENTRY* gl_compile_shader_proc)(GLuint shader);
+typedef void      (APIENTRY* gl_get_shader_iv_proc)(GLuint shader, GLenum name, GLint* value);
+typedef void      (APIENTRY* gl_get_shader_info_log_proc)(GLuint shader, GLsizei size, GLsizei* length, gl_char* log);
+typedef GLuint    (APIENTRY* gl_create_program_proc)(void);
+typedef void      (APIENTRY* gl_delete_program_proc)(GLuint program);
+typedef void      (APIENTRY* gl_attach_shader_proc)(GLuint program, GLuint shader);
+typedef void      (APIENTRY* gl_bind_attrib_location_proc)(GLuint program, GLuint index, const gl_char* name);
+typedef void      (APIENTRY* gl_link_program_proc)(GLuint program);
+typedef void      (APIENTRY* gl_get_program_iv_proc)(GLuint program, GLenum name, GLint* value);
+typedef void      (APIENTRY* gl_get_program_info_log_proc)(GLuint program, GLsizei size, GLsizei* length, gl_char* log);
+typedef void      (APIENTRY* gl_use_program_proc)(GLuint program);
+typedef GLint     (APIENTRY* gl_get_uniform_location_proc)(GLuint program, const gl_char* name);
+typedef void      (APIENTRY* gl_uniform_1i_proc)(GLint location, GLint value);
+typedef void      (APIENTRY* gl_uniform_1f_proc)(GLint location, GLfloat value);
+typedef void      (APIENTRY* gl_uniform_4fv_proc)(GLint location, GLsizei count, const GLfloat* value);
+typedef void      (APIENTRY* gl_uniform_matrix_4fv_proc)(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value);
+typedef void      (APIENTRY* gl_enable_vertex_attrib_array_proc)(GLuint index);
+typedef void      (APIENTRY* gl_disable_vertex_attrib_array_proc)(GLuint index);
+typedef void      (APIENTRY* gl_vertex_attrib_pointer_proc)(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void* pointer);
+typedef void      (APIENTRY* gl_vertex_attrib_divisor_proc)(GLuint index, GLuint divisor);
+typedef void      (APIENTRY* gl_draw_arrays_instanced_proc)(GLenum mode, GLint first, GLsizei count, GLsizei instance_count);
+
+extern gl_create_shader_proc               gl_extensions_create_shader;
+extern gl_delete_shader_proc               gl_extensions_delete_shader;
+extern gl_shader_source_proc               gl_extensions_shader_source;
+extern gl_compile_shader_proc              gl_extensions_compile_shader;
+extern gl_get_shader_iv_proc               gl_extensions_get_shader_iv;
+extern gl_get_shader_info_log_proc         gl_extensions_get_shader_info_log;
+extern gl_create_program_proc              gl_extensions_create_program;
+extern gl_delete_program_proc              gl_extensions_delete_program;
+extern gl_attach_shader_proc               gl_extensions_attach_shader;
+extern gl_bind_attrib_location_proc        gl_extensions_bind_attrib_location;
+extern gl_link_program_proc                gl_extensions_link_program;
+extern gl_get_program_iv_proc              gl_extensions_get_program_iv;
+extern gl_get_program_info_log_proc        gl_extensions_get_program_info_log;
+extern gl_use_program_proc                 gl_extensions_use_program;
+extern gl_get_uniform_location_proc        gl_extensions_get_uniform_location;
+extern gl_uniform_1i_proc                  gl_extensions_uniform_1i;
+extern gl_uniform_1f_proc                  gl_extensions_uniform_1f;
+extern gl_uniform_4fv_proc                 gl_extensions_uniform_4fv;
+extern gl_uniform_matrix_4fv_proc          gl_extensions_uniform_matrix_4fv;
+extern gl_enable_vertex_attrib_array_proc  gl_extensions_enable_vertex_attrib_array;
+extern gl_disable_vertex_attrib_array_proc gl_extensions_disable_vertex_attrib_array;
+extern gl_vertex_attrib_pointer_proc       gl_extensions_vertex_attrib_pointer;
+extern gl_vertex_attrib_divisor_proc       gl_extensions_vertex_attrib_divisor;
+extern gl_draw_arrays_instanced_proc       gl_extensions_draw_arrays_instanced;
+typedef void*     (APIENTRY* gl_map_buffer_range_proc)(GLenum target, gl_int_pointer offset, gl_size_pointer length, GLbitfield access);
+typedef void      (APIENTRY* gl_buffer_storage_proc)(GLenum target, gl_size_pointer size, const void* data, GLbitfield flags);
+typedef gl_sync   (APIENTRY* gl_fence_sync_proc)(GLenum condition, GLbitfield flags);
+typedef GLenum    (APIENTRY* gl_client_wait_sync_proc)(gl_sync sync, GLbitfield flags, gl_uint64 timeout);
+typedef void      (APIENTRY* gl_delete_sync_proc)(gl_sync sync);
+
+extern gl_map_buffer_range_proc gl_extensions_map_buffer_range;
+extern gl_buffer_storage_proc   gl_extensions_buffer_storage;
+extern gl_fence_sync_proc       gl_extensions_fence_sync;
+extern gl_client_wait_sync_proc gl_extensions_client_wait_sync;
+extern gl_delete_sync_proc      gl_extensions_delete_sync;
+
+typedef void      (APIENTRY* gl_gen_vertex_arrays_proc)(GLsizei count, GLuint* arrays);
+typedef void      (APIENTRY* gl_delete_vertex_arrays_proc)(GLsizei count, const GLuint* arrays);
+typedef void      (APIENTRY* gl_bind_vertex_array_proc)(GLuint array);
+typedef GLuint    (APIENTRY* gl_get_uniform_block_index_proc)(GLuint program, const gl_char* name);
+typedef void      (APIENTRY* gl_uniform_block_binding_proc)(GLuint program, GLuint block_index, GLuint binding);
+typedef void      (APIENTRY* gl_bind_buffer_base_proc)(GLenum target, GLuint index, GLuint buffer);
+
+extern gl_gen_vertex_arrays_proc       gl_extensions_gen_vertex_arrays;
+extern gl_delete_vertex_arrays_proc    gl_extensions_delete_vertex_arrays;
+extern gl_bind_vertex_array_proc       gl_extensions_bind_vertex_array;
+extern gl_get_uniform_block_index_proc gl_extensions_get_uniform_block_index;
+extern gl_uniform_block_binding_proc   gl_extensions_uniform_block_binding;
+extern gl_bind_buffer_base_proc        gl_extensions_bind_buffer_base;
+
+typedef void      (APIENTRY* gl_active_texture_proc)(GLenum texture);
+typedef void      (APIENTRY* gl_tex_buffer_proc)(GLenum target, GLenum internal_format, GLuint buffer);
+
+extern gl_active_texture_proc gl_extensions_active_texture;
+extern gl_tex_buffer_proc     gl_extensions_tex_buffer;
+
+typedef void      (APIENTRY* gl_gen_framebuffers_proc)(GLsizei count, GLuint* framebuffers);
+typedef void      (APIENTRY* gl_delete_framebuffers_proc)(GLsizei count, const GLuint* framebuffers);
+typedef void      (APIENTRY* gl_bind_framebuffer_proc)(GLenum target, GLuint framebuffer);
+typedef GLenum    (APIENTRY* gl_check_framebuffer_status_proc)(GLenum target);
+typedef void      (APIENTRY* gl_framebuffer_renderbuffer_proc)(GLenum target, GLenum attachment, GLenum renderbuffer_target, GLuint renderbuffer);
+typedef void      (APIENTRY* gl_gen_renderbuffers_proc)(GLsizei count, GLuint* renderbuffers);
+typedef void      (APIENTRY* gl_delete_renderbuffers_proc)(GLsizei count, const GLuint* renderbuffers);
+typedef void      (APIENTRY* gl_bind_renderbuffer_proc)(GLenum target, GLuint renderbuffer);
+typedef void      (APIENTRY* gl_renderbuffer_storage_proc)(GLenum target, GLenum format, GLsizei width, GLsizei height);
+typedef void      (APIENTRY* gl_blit_framebuffer_proc)(GLint source_x0, GLint source_y0, GLint source_x1, GLint source_y1, GLint destination_x0, GLint destination_y0, GLint destination_x1, GLint destination_y1, GLbitfield mask, GLenum filter);
+
+extern gl_gen_framebuffers_proc         gl_extensions_gen_framebuffers;
+extern gl_delete_framebuffers_proc      gl_extensions_delete_framebuffers;
+extern gl_bind_framebuffer_proc         gl_extensions_bind_framebuffer;
+extern gl_check_framebuffer_status_proc gl_extensions_check_framebuffer_status;
+extern gl_framebuffer_renderbuffer_proc gl_extensions_framebuffer_renderbuffer;
+extern gl_gen_renderbuffers_proc        gl_extensions_gen_renderbuffers;
+extern gl_delete_renderbuffers_proc     gl_extensions_delete_renderbuffers;
+extern gl_bind_renderbuffer_proc        gl_extensions_bind_renderbuffer;
+extern gl_renderbuffer_storage_proc     gl_extensions_renderbuffer_storage;
+extern gl_blit_framebuffer_proc         gl_extensions_blit_framebuffer;
+
+// Sets the number of vertical blanks a buffer swap waits for, 0 to swap immediately.
+// Loaded from WGL_EXT_swap_control or GLX_MESA_swap_control, which share this form.
+typedef int       (APIENTRY* gl_swap_interval_proc)(int interval);
+
+extern gl_swap_interval_proc gl_extensions_swap_interval;
+
+#define glGenBuffers    gl_extensions_gen_buffers
+#define glDeleteBuffers gl_extensions_delete_buffers
+#define glBindBuffer    gl_extensions_bind_buffer
+#define glBufferData    gl_extensions_buffer_data
+#define glBufferSubData gl_extensions_buffer_sub_data
+#define glMapBuffer     gl_extensions_map_buffer
+#define glUnmapBuffer   gl_extensions_unmap_buffer
+
+#define glCreateShader             gl_extensions_create_shader
+#define glDeleteShader             gl_extensions_delete_shader
+#define glShaderSource             gl_extensions_shader_source
+#define glCompileShader            gl_extensions_compile_shader
+#define glGetShaderiv              gl_extensions_get_shader_iv
+#define glGetShaderInfoLog         gl_extensions_get_shader_info_log
+#define glCreateProgram            gl_extensions_create_program
+#define glDeleteProgram            gl_extensions_delete_program
+#define glAttachShader             gl_extensions_attach_shader
+#define glBindAttribLocation       gl_extensions_bind_attrib_location
+#define glLinkProgram              gl_extensions_link_program
+#define glGetProgramiv             gl_extensions_get_program_iv
+#define glGetProgramInfoLog        gl_extensions_get_program_info_log
+#define glUseProgram               gl_extensions_use_program
+#define glGetUniformLocation       gl_extensions_get_uniform_location
+#define glUniform1i                gl_extensions_uniform_1i
+#define glUniform1f                gl_extensions_uniform_1f
+#define glUniform4fv               gl_extensions_uniform_4fv
+#define glUniformMatrix4fv         gl_extensions_uniform_matrix_4fv
+#define glEnableVertexAttribArray  gl_extensions_enable_vertex_attrib_array
+#define glDisableVertexAttribArray gl_extensions_disable_vertex_attrib_array
+#define glVertexAttribPointer      gl_extensions_vertex_attrib_pointer
+#define glVertexAttribDivisor      gl_extensions_vertex_attrib_divisor
+#define glDrawArraysInstanced      gl_extensions_draw_arrays_instanced
+
+#define glMapBufferRange gl_extensions_map_buffer_range
+#define glBufferStorage  gl_extensions_buffer_storage
+#define glFenceSync      gl_extensions_fence_sync
+#define glClientWaitSync gl_extensions_client_wait_sync
+#define glDeleteSync     gl_extensions_delete_sync
+
+#define glGenVertexArrays      gl_extensions_gen_vertex_arrays
+#define glDeleteVertexArrays   gl_extensions_delete_vertex_arrays
+#define glBindVertexArray      gl_extensions_bind_vertex_array
+#define glGetUniformBlockIndex gl_extensions_get_uniform_block_index
+#define glUniformBlockBinding  gl_extensions_uniform_block_binding
+#define glBindBufferBase       gl_extensions_bind_buffer_base
+
+#define glActiveTexture gl_extensions_active_texture
+#define glTexBuffer     gl_extensions_tex_buffer
+
+#define glGenFramebuffers         gl_extensions_gen_framebuffers
+#define glDeleteFramebuffers      gl_extensions_delete_framebuffers
+#define glBindFramebuffer         gl_extensions_bind_framebuffer
+#define glCheckFramebufferStatus  gl_extensions_check_framebuffer_status
+#define glFramebufferRenderbuffer gl_extensions_framebuffer_renderbuffer
+#define glGenRenderbuffers        gl_extensions_gen_renderbuffers
+#define glDeleteRenderbuffers     gl_extensions_delete_renderbuffers
+#define glBindRenderbuffer        gl_extensions_bind_renderbuffer
+#define glRenderbufferStorage     gl_extensions_renderbuffer_storage
+#define glBlitFramebuffer         gl_extensions_blit_framebuffer
+
+
+/**
+ * @brief Replaces glutGetProcAddress for contexts not created by GLUT.
+ *
+ * Must be called before gl_extensions_initialize.
+ *
+ * @param loader The lookup function, NULL to use glutGetProcAddress.
+ */
+void gl_extensions_set_loader(gl_extensions_loader loader);
+
+/**
+ * @brief Loads all optional entry points for the current context.
+ *
+ * Must be called once after the window and its context were created.
+ */
+void gl_extensions_initialize(void);
@@ -0,0 +1,95 @@
+/**
+ * @file gl_state.h
+ * @brief Shadowed OpenGL state that skips redundant state changes.
+ *
+ * Keeps a copy of the material, the bound 2D texture, the enabled
+ * capabilities and the line width last sent to OpenGL. Setting a value
+ * that is already current does not reach the driver. Values start out
+ * unknown, so the first change of each one is always issued.
+ *
+ * State changed through these functions must not be changed directly
+ * with OpenGL calls, or the shadow copy no longer matches.
+ */
+
+
+#pragma once
+
+
+#include "lighting.h"
+
+#include <GL/freeglut.h>
+
+
+#define GL_STATE_MAX_CAPABILITIES 16  // distinct capabilities tracked by gl_state_enable
+
+
+/**
+ * @brief Front face material set as a whole before a draw.
+ */
+typedef struct {
+    color   ambient;    // ambient reflectance
+    color   diffuse;    // diffuse reflectance
+    color   specular;   // specular reflectance
+    color   emission;   // emitted color
+    GLfloat shininess;  // specular exponent, OpenGL accepts 0 to 128
+} gl_material;
+
+/**
+ * @brief Counts state changes since the statistics were last reset.
+ */
+typedef struct {
+    int calls_issued;   // state changes passed on to OpenGL
+    int calls_skipped;  // state changes that matched the shadow copy
+} gl_state_stats;
+
+
+/**
+ * @brief Sets the front face material, issuing only the changed parameters.
+ *
+ * @param material The material of the following draws.
+ */
+void gl_state_set_material(const gl_material* material);
+
+/**
+ * @brief Binds a 2D texture unless it is already bound.
+ *
+ * @param texture_id Name of the texture, 0 to unbind.
+ */
+void gl_state_bind_texture(GLuint texture_id);
+
+/**
+ * @brief Enables or disables a capability unless it is already in that state.
+ *
+ * @param capability The capability, e.g. GL_FOG.
+ * @param enabled    1 to enable the capability, 0 to disable it.
+ */
+void gl_state_enable(GLenum capability, int enabled);
+
+/**
+ * @brief Sets the rasterized line width unless it is already current.
+ *
+ * @param width Width of lines in pixels.
+ */
+void gl_state_line_width(GLfloat width);
+
+/**
+ * @brief Counts a state change made outside these functions.
+ *
+ * Lets state shadowed elsewhere, like shader uniforms, be counted
+ * together with the fixed-function state.
+ *
+ * @param issued 1 if the change reached OpenGL, 0 if it was skipped.
+ */
+void gl_state_count_call(int issued);
+
+/**
+ * @brief Returns the state change counts since the last reset.
+ *
+ * @param stats Output counts.
+ */
+void gl_state_get_stats(gl_state_stats* stats);
+
+/**
+ * @brief Resets the state change counts, e.g. at the start of a frame.
+ */
+void gl_state_reset_stats(void);
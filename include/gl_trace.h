@@ -0,0 +1,210 @@
+/**
+ * @file gl_trace.h
+ * @brief Counts the OpenGL calls of every render pass of a frame.
+ *
+ * Including this header in a source file routes the draw, vertex,
+ * state, matrix and texture calls it makes through macros that add to
+ * the counts of the current render pass before calling OpenGL. Draws
+ * and vertices recorded into display lists are counted again whenever
+ * the list is replayed. The counts of the last frame are shown on an
+ * overlay, printed, and written to a CSV file with one row per pass
+ * and frame. The CPU time between the pass switches is kept as well,
+ * so benchmarks can tell which pass the render thread spent time in.
+ *
+ * Builds that define GL_TRACE as 0 compile the macros out, so the
+ * instrumented files make their OpenGL calls directly. The pass times
+ * are still measured.
+ *
+ * Arguments of the counted calls that also feed the counts, like the
+ * vertex count of glDrawElements, are evaluated twice and must not
+ * have side effects.
+ */
+
+
+#pragma once
+
+
+#include "gl_extensions.h"
+#include "renderer.h"
+
+#include <GL/freeglut.h>
+
+
+#ifndef GL_TRACE
+#define GL_TRACE 1  // defined as 0 by builds that compile the call counting out
+#endif
+
+#define GL_TRACE_MAX_DISPLAY_LISTS 256  // display list names whose recorded calls are remembered
+
+
+/**
+ * @brief OpenGL calls counted for one render pass.
+ */
+typedef struct {
+    int draws;          // draw calls, glBegin/glEnd blocks and replayed display lists
+    int vertices;       // vertices submitted, of every instance and replayed display list
+    int begin_blocks;   // glBegin/glEnd blocks, including replayed ones
+    int state_changes;  // capability, client array, material, light, fog, line, buffer, program and uniform changes
+    int matrix_pushes;  // glPushMatrix calls
+    int texture_binds;  // glBindTexture calls
+} gl_trace_counts;
+
+/**
+ * @brief OpenGL calls of one frame.
+ */
+typedef struct {
+    gl_trace_counts passes[RENDER_PASS_COUNT];   // counts of each render pass
+    gl_trace_counts total;                       // sum of all passes
+    double          pass_ms[RENDER_PASS_COUNT];  // CPU time spent in each render pass in milliseconds
+} gl_trace_frame;
+
+
+extern int              gl_trace_overlay_on;  // 1 indicates the call count overlay shown, 0 hidden.
+extern gl_trace_counts* gl_trace_counting;    // counts the calls are currently added to.
+
+
+/**
+ * @brief Starts counting the calls of a frame, outside any scene pass.
+ */
+void gl_trace_begin_frame(void);
+
+/**
+ * @brief Adds the following calls to the counts of a render pass.
+ *
+ * @param pass The render pass.
+ */
+void gl_trace_set_pass(render_pass pass);
+
+/**
+ * @brief Stops counting, keeps the frame and writes it to the CSV file.
+ *
+ * Calls made before the next frame starts are not counted.
+ */
+void gl_trace_end_frame(void);
+
+/**
+ * @brief Copies the counts of the last finished frame.
+ *
+ * @param frame Output counts.
+ */
+void gl_trace_get_frame(gl_trace_frame* frame);
+
+/**
+ * @brief Writes the counts of every following frame to a CSV file.
+ *
+ * @param file_path Path of the file, replaced if it exists.
+ * @return int Returns 1 if the file was opened, 0 otherwise.
+ */
+int gl_trace_open_csv(const char* file_path);
+
+/**
+ * @brief Closes the CSV file, if one is open.
+ */
+void gl_trace_close_csv(void);
+
+/**
+ * @brief Draws the counts of the last frame over the current framebuffer.
+ *
+ * Does nothing while the overlay is hidden. The text is drawn with
+ * fixed-function bitmaps, so it needs the fixed backend and a window.
+ *
+ * @param width  Width of the framebuffer in pixels.
+ * @param height Height of the framebuffer in pixels.
+ */
+void gl_trace_draw_overlay(int width, int height);
+
+/**
+ * @brief Prints the counts of the last frame and the mean of all frames.
+ */
+void gl_trace_print(void);
+
+/**
+ * @brief Starts counting the calls recorded into a display list.
+ *
+ * @param list Name of the display list.
+ */
+void gl_trace_new_list(GLuint list);
+
+/**
+ * @brief Stops counting the calls recorded into a display list.
+ */
+void gl_trace_end_list(void);
+
+/**
+ * @brief Counts a replayed display list with the calls recorded into it.
+ *
+ * @param list Name of the display list.
+ */
+void gl_trace_call_list(GLuint list);
+
+
+#if GL_TRACE
+
+#define GL_TRACE_ADD(field, amount) (gl_trace_counting->field += (amount))  // adds to a count of the current pass
+
+// Draws and vertices.
+#define glBegin(mode)                         (GL_TRACE_ADD(draws, 1), GL_TRACE_ADD(begin_blocks, 1), glBegin(mode))
+#define glVertex3f(x, y, z)                   (GL_TRACE_ADD(vertices, 1), glVertex3f(x, y, z))
+#define glVertex3fv(vertex)                   (GL_TRACE_ADD(vertices, 1), glVertex3fv(vertex))
+#define glDrawArrays(mode, first, count)      (GL_TRACE_ADD(draws, 1), GL_TRACE_ADD(vertices, count), \
+                                               glDrawArrays(mode, first, count))
+#define glDrawElements(mode, count, type, indices) \
+                                              (GL_TRACE_ADD(draws, 1), GL_TRACE_ADD(vertices, count), \
+                                               glDrawElements(mode, count, type, indices))
+#define gl_extensions_draw_arrays_instanced(mode, first, count, instances)           \
+                                              (GL_TRACE_ADD(draws, 1),                \
+                                               GL_TRACE_ADD(vertices, (count) * (instances)), \
+                                               gl_extensions_draw_arrays_instanced(mode, first, count, instances))
+#define glNewList(list, mode)                 (gl_trace_new_list(list), glNewList(list, mode))
+#define glEndList()                           (glEndList(), gl_trace_end_list())
+#define glCallList(list)                      (gl_trace_call_list(list), glCallList(list))
+
+// Matrices and textures.
+#define glPushMatrix()                        (GL_TRACE_ADD(matrix_pushes, 1), glPushMatrix())
+#define glBindTexture(target, texture)        (GL_TRACE_ADD(texture_binds, 1), glBindTexture(target, texture))
+
+// Fixed-function state.
+#define glEnable(capability)                  (GL_TRACE_ADD(state_changes, 1), glEnable(capability))
+#define glDisable(capability)                 (GL_TRACE_ADD(state_changes, 1), glDisable(capability))
+#define glEnableClientState(array)            (GL_TRACE_ADD(state_changes, 1), glEnableClientState(array))
+#define glDisableClientState(array)           (GL_TRACE_ADD(state_changes, 1), glDisableClientState(array))
+#define glVertexPointer(size, type, stride, pointer) \
+                                              (GL_TRACE_ADD(state_changes, 1), glVertexPointer(size, type, stride, pointer))
+#define glNormalPointer(type, stride, pointer) \
+                                              (GL_TRACE_ADD(state_changes, 1), glNormalPointer(type, stride, pointer))
+#define glTexCoordPointer(size, type, stride, pointer) \
+                                              (GL_TRACE_ADD(state_changes, 1), glTexCoordPointer(size, type, stride, pointer))
+#define glColorPointer(size, type, stride, pointer) \
+                                              (GL_TRACE_ADD(state_changes, 1), glColorPointer(size, type, stride, pointer))
+#define glMaterialf(face, name, value)        (GL_TRACE_ADD(state_changes, 1), glMaterialf(face, name, value))
+#define glMaterialfv(face, name, values)      (GL_TRACE_ADD(state_changes, 1), glMaterialfv(face, name, values))
+#define glLightfv(light, name, values)        (GL_TRACE_ADD(state_changes, 1), glLightfv(light, name, values))
+#define glFogf(name, value)                   (GL_TRACE_ADD(state_changes, 1), glFogf(name, value))
+#define glLineWidth(width)                    (GL_TRACE_ADD(state_changes, 1), glLineWidth(width))
+
+// Buffer, program and uniform state, reached through the loaded entry points.
+#define gl_extensions_bind_buffer(target, buffer) \
+    (GL_TRACE_ADD(state_changes, 1), gl_extensions_bind_buffer(target, buffer))
+#define gl_extensions_bind_vertex_array(array) \
+    (GL_TRACE_ADD(state_changes, 1), gl_extensions_bind_vertex_array(array))
+#define gl_extensions_bind_framebuffer(target, framebuffer) \
+    (GL_TRACE_ADD(state_changes, 1), gl_extensions_bind_framebuffer(target, framebuffer))
+#define gl_extensions_use_program(program) \
+    (GL_TRACE_ADD(state_changes, 1), gl_extensions_use_program(program))
+#define gl_extensions_uniform_1i(location, value) \
+    (GL_TRACE_ADD(state_changes, 1), gl_extensions_uniform_1i(location, value))
+#define gl_extensions_uniform_1f(location, value) \
+    (GL_TRACE_ADD(state_changes, 1), gl_extensions_uniform_1f(location, value))
+#define gl_extensions_uniform_4fv(location, count, values) \
+    (GL_TRACE_ADD(state_changes, 1), gl_extensions_uniform_4fv(location, count, values))
+#define gl_extensions_uniform_matrix_4fv(location, count, transpose, values) \
+    (GL_TRACE_ADD(state_changes, 1), gl_extensions_uniform_matrix_4fv(location, count, transpose, values))
+#define gl_extensions_enable_vertex_attrib_array(attribute) \
+    (GL_TRACE_ADD(state_changes, 1), gl_extensions_enable_vertex_attrib_array(attribute))
+#define gl_extensions_vertex_attrib_pointer(attribute, size, type, normalized, stride, pointer) \
+    (GL_TRACE_ADD(state_changes, 1),                                                           \
+     gl_extensions_vertex_attrib_pointer(attribute, size, type, normalized, stride, pointer))
+#define gl_extensions_vertex_attrib_divisor(attribute, divisor) \
+    (GL_TRACE_ADD(state_changes, 1), gl_extensions_vertex_attrib_divisor(attribute, divisor))
+
+#endif
@@ -20,23 +20,38 @@
   */
 void callback_display(void);
 
+/**
+ * @brief Renders one frame into the current framebuffer.
+ *
+ * Shared by the display callback and the headless mode,
+ * which has no window and no buffers to swap.
+ */
+void callback_render_frame(void);
+
 /**
  * @brief Called when the GLUT window is resized.
  *
- * Updates the OpenGL viewport and projection
- * matrix to maintain correct aspect ratio.
+ * Updates the OpenGL viewport and the window size
+ * the projection takes its aspect ratio from.
  *
  * @param width  New width of the window in pixels.
  * @param height New height of the window in pixels.
  */
 void callback_reshape(int width, int height);
 
+/**
+ * @brief Called when the GLUT window is shown, covered or minimized.
+ *
+ * @param state Visibility of the window, e.g. GLUT_HIDDEN.
+ */
+void callback_window_status(int state);
+
 /**
  * @brief Called when the application is idle.
  *
- * This serves as the main update loop. It updates
- * simulation elements such as water, submarine,
- * camera, and boids, then triggers a redraw.
+ * Steps the simulation if it does not run on a thread
+ * of its own, then triggers a redraw when the frame
+ * pacing decides one is due.
  */
 void callback_idle(void);
 
@@ -0,0 +1,30 @@
+/**
+ * @file headless.h
+ * @brief Offscreen rendering without a window, for benchmarks and CI.
+ *
+ * Creates a surfaceless EGL context, for example on Mesa llvmpipe, and
+ * renders into a framebuffer object of the configured size. The scene
+ * is updated and drawn for a fixed number of frames, then the frame
+ * time percentiles are printed. Selected frames can be saved as PNG
+ * for image regression checks.
+ *
+ * EGL is only used by builds that define HEADLESS_EGL as 1 and link
+ * against libEGL; other builds report that the mode is unavailable.
+ */
+
+
+#pragma once
+
+
+#define HEADLESS_DUMP_FILE_FORMAT "frame_%04d.png"  // file name of dumped frames, by frame number
+
+
+/**
+ * @brief Renders main_options.headless_frames frames offscreen.
+ *
+ * Uses the size, render path and dumped frames from main_options.
+ * Replaces window creation and the GLUT main loop.
+ *
+ * @return int Exit code, 0 on success.
+ */
+int headless_run(void);
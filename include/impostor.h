@@ -0,0 +1,87 @@
+/**
+ * @file impostor.h
+ * @brief Camera-facing quads standing in for distant copies of a small shape.
+ *
+ * The shape is rasterized once on the CPU into an atlas texture, one
+ * cell for each angle between its forward axis and the direction to the
+ * viewer. Every copy is then drawn as a quad facing the camera, turned
+ * so the forward axis of the cell follows the projected heading of the
+ * copy, and textured with the cell closest to its viewing angle. The
+ * roll of the shape about its forward axis is not represented.
+ */
+
+
+#pragma once
+
+
+#include "geometry.h"
+#include "mesh.h"
+
+#include <GL/freeglut.h>
+
+
+#define IMPOSTOR_VIEW_COUNT    8     // atlas cells, from looking at the back to looking at the front
+#define IMPOSTOR_CELL_SIZE    16     // width and height of one atlas cell in texels
+#define IMPOSTOR_SAMPLES       4     // samples per texel along each axis when rasterizing the atlas
+#define IMPOSTOR_VERTEX_COUNT  6     // two triangles per quad
+#define IMPOSTOR_ALPHA_CUTOFF  0.5f  // texels of lower coverage are discarded
+
+
+/**
+ * @brief A vertex of an impostor quad, in world space.
+ */
+typedef struct {
+    point_3d  position;     // corner of the quad
+    vector_3d normal;       // towards the camera, so the quad is lit like the faces it shows
+    GLfloat   texcoord[2];  // texture coordinates into the atlas { s, t }
+} impostor_vertex;
+
+
+/**
+ * @brief Rasterizes a triangle list into an impostor atlas texture.
+ *
+ * The texels hold a shade of gray that is modulated by the lit material
+ * color and the coverage of the shape in alpha.
+ *
+ * @param vertices     Triangle list of the shape, normals per face.
+ * @param vertex_count Number of vertices.
+ * @param radius       Radius of a sphere around the origin enclosing the shape.
+ * @return GLuint The texture ID of the atlas.
+ */
+GLuint impostor_create_atlas(const mesh_vertex* vertices, int vertex_count, GLfloat radius);
+
+/**
+ * @brief Returns the texels of the last atlas created.
+ *
+ * The texels are kept after the upload, so a software rasterizer can
+ * sample the atlas.
+ *
+ * @param width  Output width of the atlas in texels.
+ * @param height Output height of the atlas in texels.
+ * @return const unsigned char* RGBA texels row by row from t = 0.
+ */
+const unsigned char* impostor_get_atlas_texels(int* width, int* height);
+
+/**
+ * @brief Lists the quad of one copy of the shape.
+ *
+ * @param position        Position of the copy.
+ * @param direction       Normalized forward axis of the copy.
+ * @param camera_position Position of the camera.
+ * @param radius          Radius the atlas was created with, times the scale of the copy.
+ * @param vertices        Output triangles of the quad.
+ */
+void impostor_list_quad(
+    const point_3d        position,
+    const vector_3d       direction,
+    const point_3d        camera_position,
+          GLfloat         radius,
+          impostor_vertex vertices[IMPOSTOR_VERTEX_COUNT]
+);
+
+/**
+ * @brief Frees an impostor atlas texture.
+ *
+ * @param texture_id The texture ID, set to 0.
+ */
+void impostor_destroy_atlas(GLuint* texture_id);
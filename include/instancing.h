@@ -0,0 +1,94 @@
+/**
+ * @file instancing.h
+ * @brief Draws many copies of one shape with a single instanced draw call.
+ *
+ * The shape is uploaded once into a static buffer object. Every frame the
+ * transforms of all copies are streamed into an instance buffer and the
+ * whole set is drawn with one glDrawArraysInstanced call. A shader applies
+ * the instance transform and replicates the fixed-function lighting of
+ * GL_LIGHT0, the current material and the GL_EXP fog.
+ */
+
+
+#pragma once
+
+
+#include "geometry.h"
+#include "mesh.h"
+
+
+/**
+ * @brief Placement of one instance, streamed to the instance buffer.
+ *
+ * The basis vectors are the columns of the instance rotation and may be
+ * scaled to scale the instance.
+ */
+typedef struct {
+    point_3d  position;  // translation of the instance
+    vector_3d right;     // model x axis in world space
+    vector_3d up;        // model y axis in world space
+    vector_3d forward;   // model z axis in world space
+} instance_transform;
+
+/**
+ * @brief A shape uploaded for instanced drawing.
+ */
+typedef struct {
+    GLuint  vertex_buffer;      // static triangle list of the shape, 0 if not created
+    GLsizei vertex_count;       // number of vertices in vertex_buffer
+    GLuint  instance_buffer;    // streamed instance transforms
+    GLsizei instance_capacity;  // number of transforms instance_buffer can hold
+} instanced_shape;
+
+
+/**
+ * @brief Checks if instanced drawing is available in the current context.
+ *
+ * Compiles the instancing shader on the first call.
+ *
+ * @return int Returns 1 if instanced shapes can be drawn, 0 otherwise.
+ */
+int instancing_supported(void);
+
+/**
+ * @brief Uploads a triangle list as an instanced shape.
+ *
+ * @param shape        Output shape.
+ * @param vertices     Triangle list, three vertices per face.
+ * @param vertex_count Number of vertices.
+ */
+void instancing_create_shape(
+          instanced_shape* shape,
+    const mesh_vertex*     vertices,
+          GLsizei          vertex_count
+);
+
+/**
+ * @brief Streams the instance transforms and draws all instances in one call.
+ *
+ * Uses the current modelview and projection matrices, material and fog
+ * parameters.
+ *
+ * @param shape          The shape to draw.
+ * @param instances      Transforms of all instances.
+ * @param instance_count Number of instances.
+ * @param fog_enabled    Nonzero to apply the fog.
+ */
+void instancing_draw(
+          instanced_shape*    shape,
+    const instance_transform* instances,
+          GLsizei             instance_count,
+          int                 fog_enabled
+);
+
+/**
+ * @brief Frees the buffer objects of a shape.
+ *
+ * @param shape The shape to destroy.
+ */
+void instancing_destroy_shape(instanced_shape* shape);
+
+/**
+ * @brief Frees the instancing shader.
+ */
+void instancing_cleanup(void);
@@ -0,0 +1,102 @@
+/**
+ * @file light_clusters.h
+ * @brief Clustered assignment of point lights for forward shading.
+ *
+ * The view frustum is divided into a grid of clusters, LIGHT_CLUSTERS_X
+ * by LIGHT_CLUSTERS_Y tiles on the screen and LIGHT_CLUSTERS_Z slices
+ * in depth. The slices grow exponentially from the near to the far
+ * plane, so clusters are about as deep as they are wide. Every cluster
+ * is bounded by a view-space box. Each frame the light spheres are
+ * moved into view space and tested against the boxes of the slices they
+ * reach, four boxes at a time with SSE where it is available. The lists
+ * of the lights touching every cluster are packed into one index array,
+ * which a shader reads for the cluster of each fragment.
+ */
+
+
+#pragma once
+
+
+#include "geometry.h"
+#include "lighting.h"
+
+#include <GL/freeglut.h>
+
+
+#define LIGHT_CLUSTERS_X           16                                                       // tiles across the screen
+#define LIGHT_CLUSTERS_Y            9                                                       // tiles up the screen
+#define LIGHT_CLUSTERS_Z           24                                                       // depth slices between the near and far plane
+#define LIGHT_CLUSTER_COUNT        (LIGHT_CLUSTERS_X * LIGHT_CLUSTERS_Y * LIGHT_CLUSTERS_Z)  // clusters of the grid
+#define LIGHT_CLUSTERS_MAX_LIGHTS  1024                                                     // lights assigned per frame at most
+#define LIGHT_CLUSTERS_MAX_INDICES 32768                                                    // light references of all clusters at most
+
+
+/**
+ * @brief A point light with a limited range.
+ *
+ * The light falls off smoothly and reaches zero at its radius, so it
+ * never lights anything outside its sphere.
+ */
+typedef struct {
+    point_3d position;     // center in world space
+    GLfloat  radius;       // distance at which the light has faded out
+    color    light_color;  // diffuse color, alpha unused
+} point_light;
+
+/**
+ * @brief Lights of a frame sorted into the clusters of the view.
+ *
+ * The lights of cluster c are lights[indices[offset + i]] for i below
+ * count, with { offset, count } = clusters[c]. Clusters are numbered
+ * x + LIGHT_CLUSTERS_X * (y + LIGHT_CLUSTERS_Y * z), from the bottom
+ * left tile and the nearest slice.
+ */
+typedef struct {
+    GLfloat  lights[LIGHT_CLUSTERS_MAX_LIGHTS][2][4];  // per light { view-space x, y, z, radius } and { r, g, b, 0 }
+    int      light_count;                              // used entries of lights, the lights reaching the view
+    GLuint   clusters[LIGHT_CLUSTER_COUNT][2];         // { offset into indices, number of lights } per cluster
+    GLushort indices[LIGHT_CLUSTERS_MAX_INDICES];      // light lists of all clusters, one after the other
+    int      index_count;                              // used entries of indices
+    int      dropped;                                  // light references dropped over LIGHT_CLUSTERS_MAX_INDICES
+    GLfloat  tile_scale[2];                            // tile of a fragment is its window coordinates times tile_scale
+    GLfloat  slice_scale;                              // slice of a view depth d is log(d) * slice_scale + slice_bias
+    GLfloat  slice_bias;                               // see slice_scale
+} light_cluster_grid;
+
+
+/**
+ * @brief Divides a perspective view frustum into the cluster boxes.
+ *
+ * Only recomputes the boxes when the projection changed since the last call.
+ *
+ * @param fov        Vertical field of view in degrees.
+ * @param width      Width of the drawn viewport in pixels.
+ * @param height     Height of the drawn viewport in pixels.
+ * @param near_plane Distance of the near plane.
+ * @param far_plane  Distance of the far plane.
+ */
+void light_clusters_set_projection(
+    GLfloat fov,
+    int     width,
+    int     height,
+    GLfloat near_plane,
+    GLfloat far_plane
+);
+
+/**
+ * @brief Sorts the lights of a frame into the clusters.
+ *
+ * Lights entirely outside the frustum are left out. At most
+ * LIGHT_CLUSTERS_MAX_LIGHTS lights are assigned.
+ *
+ * @param grid        Output lights and cluster lists.
+ * @param view        Column-major view matrix.
+ * @param lights      The lights in world space.
+ * @param light_count Number of lights.
+ */
+void light_clusters_assign(
+          light_cluster_grid* grid,
+    const GLfloat             view[16],
+    const point_light*        lights,
+          int                 light_count
+);
@@ -1,6 +1,11 @@
 /**
  * @file lighting.h
  * @brief Interface for setting up scene lighting.
+ *
+ * The scene is lit by the global ambient light and one directional
+ * light. Its colors are shared by every backend, only the fixed-function
+ * backend loads them into GL_LIGHT0. Point lights are sorted into the
+ * clusters of light_clusters.h and only shaded by the core backend.
  */
 
 
@@ -10,10 +15,19 @@
 #include <GL/freeglut.h>
 
 
+#define LIGHT_AMBIENT_GLOBAL { 0.2f, 0.2f, 0.2f, 1.0f }   // global ambient light of the scene
+#define LIGHT_AMBIENT        { 0.0f, 0.0f, 0.0f, 0.0f }   // ambient color of the light
+#define LIGHT_DIFFUSE        { 0.9f, 0.9f, 0.9f, 1.0f }   // diffuse color of the light
+#define LIGHT_SPECULAR       { 0.9f, 0.9f, 0.9f, 1.0f }   // specular color of the light
+#define LIGHT_POSITION       { 0.0f, 10.0f, 0.0f, 0.0f }  // world-space direction towards the light, w = 0
+
+
 typedef GLfloat color[4];  // { r, g, b, a }
 
 
 /**
  * @brief Initializes global and directional lighting for the scene.
+ *
+ * Sets up the fixed-function GL_LIGHT0, the position is set every frame.
  */
 void lighting_initialize(void);
@@ -10,6 +10,9 @@
 #include "geometry.h"
 
 
+#define MESH_LOD_COUNT 3  // levels of detail, the loaded mesh plus simplified ones
+
+
 /**
  * @brief A single triangular face in a mesh, storing vertex and normal indices.
  */
@@ -18,21 +21,38 @@ typedef struct {
     int normal_numbers[3]; /**< Indices of the normals */
 } mesh_face;
 
+/**
+ * @brief A vertex as stored in a mesh vertex buffer object.
+ */
+typedef struct {
+    point_3d  position;  // vertex coordinates
+    vector_3d normal;    // vertex normal
+} mesh_vertex;
+
 /**
  * @brief A structure holding vertices, normals, and faces of a 3D model.
  */
 typedef struct {
-    point_3d* vertices;      // array of vertex coordinates
-    vector_3d* normals;      // array of normal vectors
-    mesh_face* faces;        // array of mesh faces
-    int        vertex_count; // number of vertices
-    int        normal_count; // number of normals
-    int        face_count;   // number of faces
+    point_3d*  vertices;               // array of vertex coordinates
+    vector_3d* normals;                // array of normal vectors
+    mesh_face* faces;                  // array of mesh faces
+    int        vertex_count;           // number of vertices
+    int        normal_count;           // number of normals
+    int        face_count;             // number of faces
+    point_3d   bounds_center;          // center of the bounding sphere in model space
+    GLfloat    bounds_radius;          // radius of the bounding sphere in model space
+    GLuint     vertex_buffer;          // buffer object of unique vertex/normal pairs, 0 if not uploaded
+    GLuint     index_buffer;           // buffer object of triangle indices, 0 if not uploaded
+    int        index_count;            // number of indices in index_buffer
+    unsigned   revision;               // incremented every time the mesh is loaded
+    GLuint     display_list;           // display list compiled from the faces, 0 if not compiled
+    unsigned   display_list_revision;  // mesh revision the display list was compiled from
+    GLuint     vertex_array;           // vertex array object of the core backend, 0 if not created
 } mesh;
 
 
 /**
- * @brief Frees memory allocated for the mesh.
+ * @brief Frees memory, buffer objects, vertex array and display list allocated for the mesh.
  *
  * @param mesh Pointer to the mesh to clean up.
  */
@@ -45,3 +65,28 @@ void mesh_cleanup(mesh* mesh);
  * @param local_file_path Path to the .obj file.
  */
 void mesh_initialize(mesh* mesh, const char* local_file_path);
+
+/**
+ * @brief Builds a simplified copy of a mesh by vertex clustering.
+ *
+ * The bounding box of the source is divided into a grid of cells.
+ * All vertices within one cell are merged into their average, and faces
+ * that collapse to a line or point are dropped. Normals are shared with
+ * the source indices, so shading stays close to the original.
+ *
+ * @param source     The loaded mesh to simplify.
+ * @param target     Output mesh, must be zeroed or cleaned up.
+ * @param resolution Number of cells along the longest side of the bounds.
+ */
+void mesh_simplify(const mesh* source, mesh* target, int resolution);
+
+/**
+ * @brief Uploads the mesh into vertex and index buffer objects.
+ *
+ * Each unique vertex/normal pair of the faces becomes one vertex,
+ * so the whole mesh can be drawn with a single glDrawElements call.
+ * Does nothing if buffer objects are not supported.
+ *
+ * @param mesh Pointer to the loaded mesh to upload.
+ */
+void mesh_upload(mesh* mesh);
@@ -0,0 +1,68 @@
+/**
+ * @file occlusion.h
+ * @brief Software hierarchical-Z occlusion culling.
+ *
+ * Large occluders are rasterized on the CPU into a small depth buffer,
+ * four pixels at a time with SSE where it is available. The buffer is
+ * reduced into a pyramid whose texels hold the farthest depth below
+ * them, so a bounding box is tested against a handful of texels of the
+ * level matching its screen size. A box is occluded when its nearest
+ * depth lies behind every occluder it covers.
+ *
+ * Depths are normalized device depths in [-1, 1], which grow with the
+ * view distance and are linear in screen space.
+ */
+
+
+#pragma once
+
+
+#include "mesh.h"
+
+
+#define OCCLUSION_WIDTH       256  // depth buffer width in pixels, a multiple of 4
+#define OCCLUSION_HEIGHT      128  // depth buffer height in pixels
+#define OCCLUSION_LEVEL_COUNT 6    // pyramid levels, each halving the one before
+#define OCCLUSION_TEST_TEXELS 4    // texels per axis read by one box test at most
+
+
+/**
+ * @brief Clears the depth buffer and captures the view and projection.
+ *
+ * @param projection Column-major projection matrix.
+ * @param view       Column-major view matrix.
+ */
+void occlusion_begin(const GLfloat projection[16], const GLfloat view[16]);
+
+/**
+ * @brief Rasterizes the faces of a mesh into the depth buffer.
+ *
+ * Faces of both windings are drawn. Faces reaching in front of the near
+ * plane are skipped, so an occluder never hides more than it covers.
+ *
+ * @param mesh  The occluder mesh.
+ * @param model Column-major model matrix of the mesh.
+ * @return int Number of faces that were rasterized.
+ */
+int occlusion_rasterize_mesh(const mesh* mesh, const GLfloat model[16]);
+
+/**
+ * @brief Builds the pyramid levels from the rasterized depth buffer.
+ *
+ * Must be called after the last occluder and before the first test.
+ */
+void occlusion_build_pyramid(void);
+
+/**
+ * @brief Tests a world-space bounding box against the occluders.
+ *
+ * @param minimum Corner of the box with the smallest coordinates.
+ * @param maximum Corner of the box with the largest coordinates.
+ * @return int Returns 0 if the box is hidden by the occluders, 1 if it may be visible.
+ */
+int occlusion_test_box(const point_3d minimum, const point_3d maximum);
+
+/**
+ * @brief Frees the buffers used to project occluders.
+ */
+void occlusion_cleanup(void);
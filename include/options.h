@@ -0,0 +1,86 @@
+/**
+ * @file options.h
+ * @brief Startup options parsed from the command line.
+ *
+ * Options use the form --name=value. Arguments that are not
+ * recognized are left alone, so GLUT arguments can be mixed in.
+ */
+
+
+#pragma once
+
+
+#include "benchmark.h"
+#include "capture.h"
+#include "frame_pacing.h"
+#include "renderer.h"
+#include "stream_buffer.h"
+#include "window.h"
+
+
+#define DEFAULT_OPTIONS_RENDER_PATH     RENDER_PATH_INSTANCED   // newest path, falls back when unsupported
+#define DEFAULT_OPTIONS_STREAM_MODE     STREAM_MODE_PERSISTENT  // falls back to orphaning when unsupported
+#define DEFAULT_OPTIONS_HEADLESS_FRAMES 0                       // opens a window instead of rendering offscreen
+#define DEFAULT_OPTIONS_BACKEND         RENDER_BACKEND_FIXED    // runs on every context
+#define DEFAULT_OPTIONS_DYNAMIC_RES_MS  0.0                     // draws at window resolution
+#define DEFAULT_OPTIONS_TARGET_FPS      60.0                    // the simulation rate, faster frames repeat snapshots
+#define DEFAULT_OPTIONS_SWAP_INTERVAL   FRAME_PACING_SWAP_DRIVER  // vertical sync as configured in the driver
+#define DEFAULT_OPTIONS_IDLE_UNCHANGED  1                       // no frames while nothing changes
+#define DEFAULT_OPTIONS_CAPTURE_FORMAT  CAPTURE_FORMAT_PNG      // format of the 'k' key without --capture
+#define DEFAULT_OPTIONS_RECORD_THREADS  1                       // records the draw list on the render thread only
+#define DEFAULT_OPTIONS_IMPOSTOR_DIST   6.0                     // view depth beyond which a boid covers about 16 pixels at 720 lines
+#define DEFAULT_OPTIONS_POINT_LIGHTS    0                       // lit by the directional light only
+#define DEFAULT_OPTIONS_RASTER_THREADS  4                       // tiles of the software backend drawn by the render thread and three workers
+#define DEFAULT_OPTIONS_DRAW_ORDER      DRAW_ORDER_DEPTH        // fewest fragments shaded
+#define DEFAULT_OPTIONS_TEXTURE_BUDGET  4.0                     // megabytes of streamed texture memory, as DEFAULT_TEXTURE_MEMORY_BUDGET
+
+#define OPTIONS_MAX_DUMP_FRAMES 16  // frames that --dump-frames can select
+
+
+/**
+ * @brief Stores the options chosen at startup.
+ */
+typedef struct {
+    render_path         render_path;                           // path used to submit meshes (--render-path)
+    stream_mode         stream_mode;                           // update strategy of streamed buffers (--stream-mode)
+    int                 headless_frames;                       // frames rendered offscreen, 0 for a window (--headless)
+    int                 width;                                 // window or framebuffer width in pixels (--size)
+    int                 height;                                // window or framebuffer height in pixels (--size)
+    int                 dump_frames[OPTIONS_MAX_DUMP_FRAMES];  // headless frames saved as PNG (--dump-frames)
+    int                 dump_frame_count;                      // used entries of dump_frames
+    render_backend_type backend;                               // backend submitting the frames (--backend)
+    double              dynamic_resolution_ms;                 // frame time budget of dynamic resolution, 0 for off (--dynamic-resolution)
+    double              target_fps;                            // frame rate limit of the window, 0 for none (--fps)
+    int                 swap_interval;                         // vertical blanks per swap, or FRAME_PACING_SWAP_DRIVER (--vsync)
+    int                 idle_unchanged;                        // 1 to skip frames while nothing changes (--idle)
+    int                 capture_on;                            // 1 to capture frames from the start (--capture)
+    capture_format      capture_format;                        // how captured frames are written (--capture)
+    const char*         gl_trace_file;                         // CSV file of the OpenGL calls per pass and frame, NULL for none (--gl-trace)
+    int                 record_threads;                        // threads recording the draw list, the render thread included (--record-threads)
+    double              impostor_distance;                     // view depth beyond which boids are drawn as impostors, 0 for never (--impostor-distance)
+    const char*         benchmark_file;                        // path file of the flythrough benchmark, NULL for none (--benchmark)
+    const char*         benchmark_json_file;                   // file receiving the benchmark results (--benchmark-json)
+    int                 point_lights;                          // bioluminescent point lights of the scene, 0 for none (--point-lights)
+    int                 raster_threads;                        // threads drawing the tiles of the software backend, the render thread included (--raster-threads)
+    draw_order          draw_order;                            // order the draws of a frame are submitted in (--draw-order)
+    double              texture_budget_mb;                     // memory budget of the streamed textures in megabytes (--texture-budget)
+} options;
+
+
+extern options main_options;  // global startup options.
+
+
+/**
+ * @brief Parses the startup options from the command line.
+ *
+ * Must be called before the renderer is initialized.
+ *
+ * @param argc Argument count from main().
+ * @param argv Argument vector from main().
+ */
+void options_initialize(int argc, char** argv);
+
+/**
+ * @brief Prints the supported command line options to the console.
+ */
+void options_print_usage(void);
@@ -0,0 +1,38 @@
+/**
+ * @file png.h
+ * @brief Minimal PNG writer for captured frames.
+ *
+ * Writes 8-bit RGB images with uncompressed deflate blocks. The files
+ * are larger than compressed ones, but need no external library and
+ * decode to exactly the captured pixels.
+ */
+
+
+#pragma once
+
+
+/**
+ * @brief Prepares the lookup tables shared by all writes.
+ *
+ * Called by the first write otherwise, so it is only needed
+ * before files are written from several threads at once.
+ */
+void png_initialize(void);
+
+/**
+ * @brief Writes an 8-bit RGB image to a PNG file.
+ *
+ * @param local_file_path Path of the file to write.
+ * @param width           Width of the image in pixels.
+ * @param height          Height of the image in pixels.
+ * @param pixels          Tightly packed RGB rows, width * height * 3 bytes.
+ * @param bottom_up       1 if the first row is the bottom one, as read by glReadPixels.
+ * @return int Returns 1 on success, 0 if the file could not be written.
+ */
+int png_write_rgb(
+    const char* local_file_path,
+    int width,
+    int height,
+    const unsigned char* pixels,
+    int bottom_up
+);
@@ -0,0 +1,136 @@
+/**
+ * @file render_backend.h
+ * @brief Interface between the renderer and the OpenGL code drawing a frame.
+ *
+ * The renderer culls the scene, selects levels of detail and sorts the
+ * draws, then records everything a frame needs into a draw list. A
+ * backend turns the draw list into OpenGL calls. The fixed-function
+ * backend uses the matrix stack, glMaterial and the render paths of
+ * older contexts, the core backend uses an OpenGL 3.3 core profile with
+ * vertex array objects, a uniform buffer of per-frame data and a single
+ * shader program. The software backend rasterizes the draw list on the
+ * CPU and copies the frame into the framebuffer.
+ */
+
+
+#pragma once
+
+
+#include "debug_draw.h"
+#include "environment.h"
+#include "gl_state.h"
+#include "impostor.h"
+#include "instancing.h"
+#include "light_clusters.h"
+#include "mesh.h"
+#include "renderer.h"
+#include "simulation.h"
+
+#include <GL/freeglut.h>
+
+
+#define DRAW_LIST_CAPACITY        64  // draw items recorded per frame at most
+#define BOID_PYRAMID_VERTEX_COUNT 18  // six triangles
+
+#define IMPOSTOR_LIST_CAPACITY (BOID_COUNT * IMPOSTOR_VERTEX_COUNT)  // impostor vertices recorded per frame at most
+
+#define DRAW_KEY_LAYER_SHIFT    56          // submission layer, the most significant part of a draw key
+#define DRAW_KEY_TEXTURE_SHIFT  40          // bound texture, or the quantized view depth in the depth order
+#define DRAW_KEY_MATERIAL_SHIFT 24          // interned material
+#define DRAW_KEY_FIELD_MASK     0xFFFFull   // texture and material bits
+#define DRAW_KEY_SEQUENCE_MASK  0xFFFFFFull // order of recording, the least significant part
+
+#define WATER_VERTEX_COUNT ((WATER_GRID_SIZE + 1) * (WATER_GRID_SIZE + 1))  // vertices streamed per frame
+#define WATER_INDEX_COUNT  (WATER_GRID_SIZE * 2 * (WATER_GRID_SIZE + 1) +    \
+                            (WATER_GRID_SIZE - 1) * 2)                       // rows joined by degenerate triangles
+
+
+typedef unsigned long long draw_key;  // orders the draws of a frame when compared as a whole
+
+
+/**
+ * @brief Selects what a draw item draws.
+ */
+typedef enum {
+    DRAW_ITEM_MESH,       // a mesh with a model matrix
+    DRAW_ITEM_SURFACE,    // an environment surface with a model matrix
+    DRAW_ITEM_WATER,      // the water grid of the snapshot with a model matrix
+    DRAW_ITEM_BOIDS,      // the boid pyramid once for every boid transform
+    DRAW_ITEM_IMPOSTORS,  // the impostor quads of the distant boids as one triangle list
+    DRAW_ITEM_DEBUG       // a range of the debug line vertices in world space, unlit
+} draw_item_type;
+
+/**
+ * @brief One draw with the state it needs.
+ */
+typedef struct {
+    draw_item_type       type;        // what the item draws
+    render_pass          pass;        // part of the scene the item belongs to
+    draw_key             key;         // sort order by layer, texture or depth, material and recording order
+    GLuint               texture_id;  // bound texture, 0 for none
+    gl_material          material;    // material of the draw
+    GLfloat              line_width;  // width of lines, including wireframes
+    GLfloat              model[16];   // column-major model matrix, unused for boids and debug lines
+    mesh*                mesh;        // mesh of DRAW_ITEM_MESH
+    environment_surface* surface;     // surface of DRAW_ITEM_SURFACE
+    int                  first;       // first debug vertex of DRAW_ITEM_DEBUG
+    int                  count;       // number of debug vertices of DRAW_ITEM_DEBUG
+} draw_item;
+
+/**
+ * @brief Everything a backend needs to draw one frame, in drawing order.
+ *
+ * The items are sorted by their keys before the list is submitted.
+ */
+typedef struct {
+    GLfloat                    projection[16];                             // column-major projection matrix
+    GLfloat                    view[16];                                   // column-major view matrix
+    int                        fog_enabled;                                // 1 if the GL_EXP fog is applied
+    GLfloat                    fog_density;                                // density of the fog
+    const simulation_snapshot* snapshot;                                   // simulation state of the frame
+    draw_item                  items[DRAW_LIST_CAPACITY];                  // draws in submission order
+    int                        item_count;                                 // used entries of items
+    instance_transform         boids[BOID_COUNT];                          // transforms of the visible boids drawn as pyramids
+    int                        boid_count;                                 // used entries of boids
+    const mesh_vertex*         boid_pyramid;                               // triangle list of one boid
+    impostor_vertex            impostor_vertices[IMPOSTOR_LIST_CAPACITY];  // quads of the boids beyond the impostor distance
+    int                        impostor_vertex_count;                      // used entries of impostor_vertices
+    const debug_draw_batch*    debug;                                      // debug lines of the frame, NULL if compiled out
+    const light_cluster_grid*  lights;                                     // point lights sorted into clusters, NULL without point lights
+} draw_list;
+
+/**
+ * @brief A set of functions drawing frames with one flavour of OpenGL.
+ */
+typedef struct {
+    const char* name;                       // readable name, e.g. "core"
+    int  (*initialize)(void);               // sets up the context state, returns 0 if unsupported
+    void (*upload_mesh)(mesh* mesh);        // prepares a loaded mesh for drawing
+    void (*submit)(const draw_list* list);  // clears the framebuffer and draws a frame
+    void (*present)(void);                  // shows the drawn frame
+    void (*clean_up)(void);                 // frees the resources of the backend
+} render_backend;
+
+
+extern const render_backend render_backend_fixed;     // fixed-function OpenGL with selectable render paths.
+extern const render_backend render_backend_core;      // OpenGL 3.3 core profile with shaders.
+extern const render_backend render_backend_software;  // tile rasterizer on the CPU, shown with glDrawPixels.
+
+
+/**
+ * @brief Lists the water grid as a single triangle strip.
+ *
+ * @param indices Output indices into the vertices of the water grid.
+ */
+void render_backend_list_water_strip(GLushort indices[WATER_INDEX_COUNT]);
+
+/**
+ * @brief Copies the water grid of a snapshot into buffer vertices.
+ *
+ * @param snapshot Simulation state holding the water grid.
+ * @param vertices Output vertices, row by row.
+ */
+void render_backend_copy_water_vertices(
+    const simulation_snapshot* snapshot,
+          mesh_vertex          vertices[WATER_VERTEX_COUNT]
+);
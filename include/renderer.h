@@ -1,25 +1,156 @@
 /**
  * @file renderer.h
  * @brief Renderer interface for scene initialization, drawing, and cleanup.
+ *
+ * The renderer decides what is drawn each frame, a render backend
+ * decides how it reaches OpenGL.
  */
 
 
 #pragma once
 
 
-extern int fog_on;         // 1 indicates fog enabled, 0 disabled.
-extern int wire_frame_on;  // 1 indicates wireframe rendering enabled, 0 disabled.
+#include "simulation.h"
+
+#include <GL/freeglut.h>
+
+
+#define DEFAULT_FOG_DENSITY 0.1f   // density of the GL_EXP underwater fog
+#define FOG_DENSITY_STEP    1.25f  // factor applied per fog density key press
+#define FOG_COLOR           { 0.0f, 0.0f, 1.0f, 1.0f }  // color the underwater fog fades to
+
+
+/**
+ * @brief Selects how meshes are submitted to OpenGL.
+ *
+ * Paths are ordered from oldest to newest, an unsupported
+ * path falls back to the one before it.
+ */
+typedef enum {
+    RENDER_PATH_IMMEDIATE,     // legacy glBegin/glEnd block per face
+    RENDER_PATH_DISPLAY_LIST,  // display lists compiled once, for legacy contexts
+    RENDER_PATH_VBO,           // one glDrawElements per mesh from buffer objects
+    RENDER_PATH_INSTANCED,     // buffer objects, whole boid flock in one instanced draw
+    RENDER_PATH_COUNT          // number of render paths
+} render_path;
+
+/**
+ * @brief Selects the backend submitting the frames to OpenGL.
+ */
+typedef enum {
+    RENDER_BACKEND_FIXED,     // fixed-function pipeline through the render paths, any compatibility context
+    RENDER_BACKEND_CORE,      // shaders, vertex array objects and uniform buffers, OpenGL 3.3 core profile
+    RENDER_BACKEND_SOFTWARE,  // multithreaded tile rasterizer on the CPU, any compatibility context
+    RENDER_BACKEND_COUNT      // number of render backends
+} render_backend_type;
+
+/**
+ * @brief Selects the order the draws of a frame are submitted in.
+ */
+typedef enum {
+    DRAW_ORDER_STATE,  // scene passes in turn, grouped by texture and material
+    DRAW_ORDER_DEPTH,  // opaque objects front to back, then the large surfaces behind them
+    DRAW_ORDER_COUNT   // number of draw orders
+} draw_order;
+
+/**
+ * @brief Groups the draws of a frame by the part of the scene they draw.
+ */
+typedef enum {
+    RENDER_PASS_DEBUG,        // debug lines, including the origin axes and sphere
+    RENDER_PASS_ENVIRONMENT,  // floor and walls
+    RENDER_PASS_WATER,        // water surface
+    RENDER_PASS_SUBMARINE,    // the submarine
+    RENDER_PASS_CORAL,        // all coral
+    RENDER_PASS_BOIDS,        // the boid flock
+    RENDER_PASS_OTHER,        // clearing, upscaling and anything else outside the scene passes
+    RENDER_PASS_COUNT         // number of render passes
+} render_pass;
+
+
+extern int                 fog_on;            // 1 indicates fog enabled, 0 disabled.
+extern GLfloat             fog_density;       // density of the GL_EXP fog.
+extern int                 wire_frame_on;     // 1 indicates wireframe rendering enabled, 0 disabled.
+extern render_path         mesh_render_path;  // path used to submit meshes by the fixed backend.
+extern int                 culling_on;        // 1 indicates frustum culling enabled, 0 disabled.
+extern int                 occlusion_on;      // 1 indicates occlusion culling enabled, 0 disabled.
+extern render_backend_type renderer_backend;  // backend submitting the frames.
 
 
 /**
- * @brief Initializes rendering state and scene objects.
+ * @brief Initializes the render backend, rendering state and scene objects.
+ *
+ * Must be called with a current context, a core profile context
+ * if the core backend was chosen.
+ *
+ * @return int Returns 1 on success, 0 if no backend could be initialized.
  */
-void renderer_initialize(void);
+int renderer_initialize(void);
+
+/**
+ * @brief Enables or disables the fog and sets its density.
+ *
+ * Also updates the distance beyond which the fog hides objects
+ * completely, which drives fog culling and level of detail.
+ *
+ * @param enabled 1 to enable the fog, 0 to disable it.
+ * @param density Density of the GL_EXP fog.
+ */
+void renderer_set_fog(int enabled, GLfloat density);
 
 /**
  * @brief Renders all elements of the scene.
+ *
+ * Clears the framebuffer and draws the scene from the snapshot camera.
+ *
+ * @param snapshot Simulation state to draw.
+ */
+void renderer_draw(const simulation_snapshot* snapshot);
+
+/**
+ * @brief Shows the rendered frame in the window.
+ */
+void renderer_present(void);
+
+/**
+ * @brief Checks if a render path is supported by the current context.
+ *
+ * @param path The render path to check.
+ * @return int Returns 1 if the path can be used, 0 otherwise.
+ */
+int renderer_path_supported(render_path path);
+
+/**
+ * @brief Returns a readable name of a render path.
+ *
+ * @param path The render path.
+ * @return const char* Name of the path, e.g. "display-list".
+ */
+const char* renderer_path_name(render_path path);
+
+/**
+ * @brief Returns a readable name of a render backend.
+ *
+ * @param backend The render backend.
+ * @return const char* Name of the backend, e.g. "core".
+ */
+const char* renderer_backend_name(render_backend_type backend);
+
+/**
+ * @brief Returns a readable name of a draw order.
+ *
+ * @param order The draw order.
+ * @return const char* Name of the order, e.g. "depth".
+ */
+const char* renderer_draw_order_name(draw_order order);
+
+/**
+ * @brief Returns a readable name of a render pass.
+ *
+ * @param pass The render pass.
+ * @return const char* Name of the pass, e.g. "coral".
  */
-void renderer_draw(void);
+const char* renderer_pass_name(render_pass pass);
 
 /**
  * @brief Cleans up renderer-specific resources.
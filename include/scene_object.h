@@ -14,20 +14,24 @@
 #include <GL/freeglut.h>
 
 
+#define SCENE_OBJECT_LOD_RESOLUTION 32  // clustering cells of the first simplified level, halved per level
+
+
 /**
  * @brief Represents a 3D object loaded from an OBJ file.
  */
 typedef struct {
-    point_3d  position;   // position of the object in 3D space
-    vector_3d direction;  // direction the object is facing
-    GLfloat   speed;      // movement speed of the object
-    GLfloat   rotation;   // rotation offset (used for correcting model orientation)
-    GLfloat   scale;      // scale factor
-    mesh      mesh;       // mesh data of the object
-    color     ambient;    // ambient color of the object
-    color     diffuse;    // diffuse color of the object
-    color     specular;   // specular color of the object
-    GLfloat   shine;      // shininess coefficient for specular lighting
+    point_3d  position;                  // position of the object in 3D space
+    vector_3d direction;                 // direction the object is facing
+    GLfloat   speed;                     // movement speed of the object
+    GLfloat   rotation;                  // rotation offset (used for correcting model orientation)
+    GLfloat   scale;                     // scale factor
+    mesh      mesh;                      // mesh data of the object
+    mesh      lods[MESH_LOD_COUNT - 1];  // simplified meshes, coarser with every level
+    color     ambient;                   // ambient color of the object
+    color     diffuse;                   // diffuse color of the object
+    color     specular;                  // specular color of the object
+    GLfloat   shine;                     // shininess coefficient for specular lighting
 } scene_object;
 
 
@@ -46,3 +50,21 @@ void scene_object_cleanup(scene_object* object);
  * @param local_file_path Path to the local .obj file.
  */
 void scene_object_initialize(scene_object* object, const char* local_file_path);
+
+/**
+ * @brief Calculates the model matrix a scene object is drawn with.
+ *
+ * The object faces the direction through its orientation basis and is
+ * then rotated about the y axis by its rotation offset and scaled.
+ *
+ * @param object   The scene object.
+ * @param position Position the object is drawn at.
+ * @param facing   Direction the object faces, not necessarily normalized.
+ * @param matrix   Output column-major model matrix.
+ */
+void scene_object_calculate_matrix(
+    const scene_object* object, 
+    const point_3d      position, 
+    const vector_3d     facing, 
+          GLfloat       matrix[16]
+);
@@ -0,0 +1,31 @@
+/**
+ * @file shader.h
+ * @brief Compiles and links GLSL shader programs.
+ */
+
+
+#pragma once
+
+
+#include "gl_extensions.h"
+
+
+/**
+ * @brief Compiles a vertex and a fragment shader and links them into a program.
+ *
+ * Compile and link errors are printed to the console. Attribute names
+ * are bound to their index in the array before linking, so the caller
+ * can address attributes by index.
+ *
+ * @param vertex_source   GLSL source of the vertex shader.
+ * @param fragment_source GLSL source of the fragment shader.
+ * @param attributes      Attribute names in index order, or NULL.
+ * @param attribute_count Number of attribute names.
+ * @return GLuint The linked program, or 0 on failure.
+ */
+GLuint shader_create_program(
+    const char*        vertex_source,
+    const char*        fragment_source,
+    const char* const* attributes,
+    int                attribute_count
+);
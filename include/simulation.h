@@ -0,0 +1,102 @@
+/**
+ * @file simulation.h
+ * @brief Fixed-step simulation decoupled from rendering.
+ *
+ * The water, submarine, camera and boids are advanced in fixed steps,
+ * optionally on a thread of their own. After every step the state the
+ * renderer needs is copied into an immutable snapshot, published through
+ * a triple buffer. The renderer always draws the latest complete
+ * snapshot, so it never waits for a step and never sees one half done.
+ * The submarine matrix and the boid orientations are calculated with the
+ * snapshot, once per step however many frames draw it.
+ */
+
+
+#pragma once
+
+
+#include "boids/boids.h"
+#include "geometry.h"
+#include "water.h"
+
+
+#define SIMULATION_STEP_MS        (1000.0 / 60.0)  // simulated time advanced per step
+#define SIMULATION_MAX_LAG_MS     250.0            // lag after which the thread skips steps instead of catching up
+#define SIMULATION_SNAPSHOT_COUNT 3                // written, ready and read snapshots
+
+
+/**
+ * @brief State of the scene after one simulation step, read by the renderer.
+ */
+typedef struct {
+    unsigned  step;                                                     // number of steps taken before the copy
+    point_3d  submarine_position;                                       // position of the submarine
+    vector_3d submarine_direction;                                      // movement direction of the submarine
+    point_3d  camera_position;                                          // position of the main camera
+    point_3d  camera_look_at;                                           // point the main camera faces
+    GLfloat   submarine_model[16];                                      // column-major model matrix of the submarine
+    boid      boids[BOID_COUNT];                                        // position and direction of every boid
+    vector_3d boid_right[BOID_COUNT];                                   // x axis of the orientation basis of every boid
+    vector_3d boid_up[BOID_COUNT];                                      // y axis of the orientation basis of every boid
+    point_3d  water_vertices[WATER_GRID_SIZE + 1][WATER_GRID_SIZE + 1];  // water grid with wave heights
+    vector_3d water_normals[WATER_GRID_SIZE + 1][WATER_GRID_SIZE + 1];   // water grid normals
+} simulation_snapshot;
+
+
+/**
+ * @brief Prepares the snapshot buffers and publishes the initial state.
+ *
+ * Must be called after the scene was initialized and before
+ * the first snapshot is acquired.
+ */
+void simulation_initialize(void);
+
+/**
+ * @brief Advances the simulation by one step and publishes a snapshot.
+ *
+ * Called by the simulation thread, or by the caller
+ * directly if no thread was started.
+ */
+void simulation_step(void);
+
+/**
+ * @brief Starts stepping the simulation on its own thread in real time.
+ *
+ * @return int Returns 1 if the thread was started, 0 otherwise.
+ */
+int simulation_start_thread(void);
+
+/**
+ * @brief Checks if the simulation is stepped by its own thread.
+ *
+ * @return int Returns 1 if the thread is running, 0 otherwise.
+ */
+int simulation_thread_running(void);
+
+/**
+ * @brief Returns the latest complete snapshot.
+ *
+ * The snapshot stays unchanged until the next call, which
+ * must come from the same thread.
+ *
+ * @return const simulation_snapshot* The latest published snapshot.
+ */
+const simulation_snapshot* simulation_acquire_snapshot(void);
+
+/**
+ * @brief Locks the simulation state against concurrent steps.
+ *
+ * Input handlers hold the lock while they change the submarine
+ * or the camera, so a step never sees a half made change.
+ */
+void simulation_lock(void);
+
+/**
+ * @brief Unlocks the simulation state.
+ */
+void simulation_unlock(void);
+
+/**
+ * @brief Stops the simulation thread if running and frees its resources.
+ */
+void simulation_clean_up(void);
@@ -0,0 +1,143 @@
+/**
+ * @file software_raster.h
+ * @brief Multithreaded tile rasterizer drawing triangles on the CPU.
+ *
+ * Triangles are clipped in clip space, snapped to a fixed-point grid of
+ * SOFTWARE_RASTER_SUBPIXELS steps per pixel and binned into square tiles
+ * of SOFTWARE_RASTER_TILE_SIZE pixels in the order they are added. At the
+ * end of the frame the tiles are handed out one at a time to a worker
+ * pool, and every tile draws its own list of triangles into its own
+ * part of the color and depth buffers.
+ * Coverage is decided by integer edge functions with a top-left fill
+ * rule, evaluated for four pixels at once with SSE2 where it is
+ * available, so triangles sharing an edge neither overlap nor leave
+ * gaps. Colors, texture coordinates and fog distances are interpolated
+ * perspective-correct and the depth test, alpha cutout, GL_EXP fog and
+ * alpha blending follow the OpenGL pipeline of the other backends.
+ *
+ * No pixel is written by more than one thread and every tile draws its
+ * triangles in the order they were added, so frames do not depend on
+ * the number of threads or on which thread draws which tile.
+ */
+
+
+#pragma once
+
+
+#include "lighting.h"
+#include "texture.h"
+
+#include <GL/freeglut.h>
+
+
+#define SOFTWARE_RASTER_TILE_SIZE  64    // width and height of a tile in pixels
+#define SOFTWARE_RASTER_SUBPIXELS  16    // fixed-point steps per pixel vertices are snapped to
+#define SOFTWARE_RASTER_GUARD_BAND 2.0f  // x and y are clipped at this multiple of w instead of at the viewport
+
+
+/**
+ * @brief A vertex in clip space with the values interpolated across its triangles.
+ */
+typedef struct {
+    GLfloat position[4];  // clip-space position { x, y, z, w }
+    GLfloat color[4];     // lit color { r, g, b, a }, between 0 and 1
+    GLfloat texcoord[2];  // texture coordinates { s, t }
+    GLfloat fog;          // eye-space distance the fog is applied over
+} raster_vertex;
+
+/**
+ * @brief Texels of a texture sampled by the rasterizer, in rows from t = 0.
+ */
+typedef struct {
+    const GLubyte* levels[TEXTURE_MAX_MIP_LEVELS];   // texels of each mip level
+    int            widths[TEXTURE_MAX_MIP_LEVELS];   // width of each level
+    int            heights[TEXTURE_MAX_MIP_LEVELS];  // height of each level
+    int            level_count;                      // used levels, 1 samples the base level like GL_LINEAR
+    int            channels;                         // 3 for RGB texels, 4 for RGBA
+} raster_texture;
+
+/**
+ * @brief Pipeline state of a triangle.
+ */
+typedef struct {
+    const raster_texture* texture;  // modulates the color with GL_REPEAT wrapping, NULL for none
+    GLfloat               cutout;   // fragments of this alpha or less are discarded, negative to keep all
+} raster_state;
+
+/**
+ * @brief Work done by the rasterizer in the last frame.
+ */
+typedef struct {
+    int triangles;    // triangles set up after clipping
+    int bin_entries;  // triangles listed in the tiles, summed over all tiles
+    int fragments;    // fragments that passed the depth test and were shaded
+    int threads;      // threads drawing the tiles, the calling thread included
+} raster_stats;
+
+
+/**
+ * @brief Starts the worker threads of the rasterizer.
+ *
+ * @param thread_count Threads drawing the tiles, the calling thread included.
+ * @return int Threads that draw the tiles, fewer if the system refused some.
+ */
+int software_raster_initialize(int thread_count);
+
+/**
+ * @brief Empties the tiles for a new frame.
+ *
+ * The buffers are resized when the size changed. They are cleared
+ * tile by tile when the frame is drawn.
+ *
+ * @param width       Width of the frame in pixels.
+ * @param height      Height of the frame in pixels.
+ * @param fog_density Density of the GL_EXP fog, 0 for none.
+ * @param fog_color   Color the fog fades to.
+ * @return int Returns 1 if the buffers are ready, 0 if they could not be allocated.
+ */
+int software_raster_begin_frame(int width, int height, GLfloat fog_density, const color fog_color);
+
+/**
+ * @brief Clips a triangle and bins the pieces into the tiles they touch.
+ *
+ * Both windings are drawn.
+ *
+ * @param a     First corner.
+ * @param b     Second corner.
+ * @param c     Third corner.
+ * @param state Texture and cutout of the triangle, the texture must stay valid until the frame is drawn.
+ */
+void software_raster_triangle(
+    const raster_vertex* a,
+    const raster_vertex* b,
+    const raster_vertex* c,
+    const raster_state*  state
+);
+
+/**
+ * @brief Clips a line and bins it as a quad of the given width.
+ *
+ * @param a     Start point.
+ * @param b     End point.
+ * @param width Width of the line in pixels.
+ */
+void software_raster_line(const raster_vertex* a, const raster_vertex* b, GLfloat width);
+
+/**
+ * @brief Clears and draws all tiles on the worker threads.
+ *
+ * @param stats Output work done for the frame.
+ */
+void software_raster_end_frame(raster_stats* stats);
+
+/**
+ * @brief Returns the drawn frame.
+ *
+ * @return const GLubyte* RGBA pixels row by row from the bottom row, valid until the next frame begins.
+ */
+const GLubyte* software_raster_pixels(void);
+
+/**
+ * @brief Stops the worker threads and frees the buffers and tiles.
+ */
+void software_raster_clean_up(void);
@@ -0,0 +1,98 @@
+/**
+ * @file stream_buffer.h
+ * @brief Vertex buffer rewritten by the CPU every frame.
+ *
+ * Two update strategies are supported. Orphaning reallocates the buffer
+ * storage before every write, so the driver hands out fresh memory while
+ * draws of earlier frames still read the old one. The persistent ring
+ * keeps one buffer of STREAM_BUFFER_REGIONS regions mapped for its whole
+ * lifetime and writes the regions in turn, each guarded by a fence that
+ * is only waited on if the GPU is still reading that region.
+ */
+
+
+#pragma once
+
+
+#include "gl_extensions.h"
+
+#include <stddef.h>
+
+
+#define STREAM_BUFFER_REGIONS 3  // regions of the persistent ring, one frame each
+
+
+/**
+ * @brief Selects how a stream buffer is updated.
+ */
+typedef enum {
+    STREAM_MODE_ORPHAN,      // reallocate the storage before every write
+    STREAM_MODE_PERSISTENT,  // persistently mapped ring of fenced regions
+    STREAM_MODE_COUNT        // number of stream modes
+} stream_mode;
+
+/**
+ * @brief A vertex buffer streamed from the CPU.
+ */
+typedef struct {
+    GLuint      buffer;                          // buffer object, 0 if not created
+    size_t      region_size;                     // bytes written per update
+    stream_mode mode;                            // update strategy in use
+    int         region;                          // region of the current update
+    GLubyte*    mapping;                         // persistent mapping of all regions, or NULL
+    gl_sync     fences[STREAM_BUFFER_REGIONS];   // fence after the last draw from each region
+} stream_buffer;
+
+
+/**
+ * @brief Creates a stream buffer.
+ *
+ * The persistent mode falls back to orphaning if the context
+ * cannot keep buffers mapped.
+ *
+ * @param stream      Output stream buffer.
+ * @param region_size Bytes written per update.
+ * @param mode        Preferred update strategy.
+ */
+void stream_buffer_create(stream_buffer* stream, size_t region_size, stream_mode mode);
+
+/**
+ * @brief Starts an update and binds the buffer to GL_ARRAY_BUFFER.
+ *
+ * @param stream The stream buffer.
+ * @param offset Output byte offset of the written region in the buffer,
+ *               to be added to the attribute pointers.
+ * @return void* Memory to write region_size bytes to, or NULL on failure.
+ */
+void* stream_buffer_begin(stream_buffer* stream, size_t* offset);
+
+/**
+ * @brief Finishes writing the region started by stream_buffer_begin.
+ *
+ * The buffer stays bound for the following draws.
+ *
+ * @param stream The stream buffer.
+ */
+void stream_buffer_end(stream_buffer* stream);
+
+/**
+ * @brief Marks the end of all draws reading the current region.
+ *
+ * @param stream The stream buffer.
+ */
+void stream_buffer_fence(stream_buffer* stream);
+
+/**
+ * @brief Frees the buffer object and its fences.
+ *
+ * @param stream The stream buffer.
+ */
+void stream_buffer_destroy(stream_buffer* stream);
+
+/**
+ * @brief Returns a readable name of a stream mode.
+ *
+ * @param mode The stream mode.
+ * @return const char* Name of the mode, e.g. "persistent".
+ */
+const char* stream_buffer_mode_name(stream_mode mode);
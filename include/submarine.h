@@ -14,7 +14,7 @@
 #define DEFAULT_SUBMARINE_ROTATION  90.000f  // rotation to properly align the submarine to the scene.
 #define DEFAULT_SUBMARINE_SCALE      0.004f  // default submarine object scale
 #define DEFAULT_SUBMARINE_YAW       90.000f  // default submarine yaw
-#define DEFAULT_SUBMARINE_SHINE    150.000f  // default submarine shine
+#define DEFAULT_SUBMARINE_SHINE    128.000f  // default submarine shine, the largest OpenGL accepts
 
 
 // Global submarine scene object.
@@ -1,9 +1,12 @@
 /**
  * @file texture.h
- * @brief Texture loading interface for OpenGL.
+ * @brief Texture loading and mip streaming interface for OpenGL.
  *
- * Provides functionality to load an image file
- * and generate an OpenGL texture from it.
+ * Provides functionality to load an image file and generate an OpenGL
+ * texture from it. Textures are streamed: only the smallest mip levels
+ * are uploaded at load, and finer levels are uploaded on demand based
+ * on the screen-space texel density requested by the renderer. Unused
+ * fine levels are evicted to keep all textures under a memory budget.
  */
 
 
@@ -11,15 +14,120 @@
 
 #include <GL/freeglut.h>
 
+#include <stddef.h>
+
+
+#define TEXTURE_MAX_COUNT              8                  // maximum number of streamed textures
+#define TEXTURE_MAX_MIP_LEVELS        16                  // maximum mip levels per texture
+#define TEXTURE_INITIAL_RESIDENT_SIZE 32                  // largest mip dimension uploaded at load
+#define TEXTURE_LEVELS_PER_UPDATE      1                  // finer levels streamed per texture per frame
+#define DEFAULT_TEXTURE_MEMORY_BUDGET (4 * 1024 * 1024)  // bytes of texture memory for all textures
+
+
+/**
+ * @brief Residency statistics of a single streamed texture.
+ */
+typedef struct {
+    GLuint id;                    // OpenGL texture ID
+    GLint  width;                 // width of the base level in texels
+    GLint  height;                // height of the base level in texels
+    GLint  level_count;           // number of levels in the full mip chain
+    GLint  resident_base_level;   // finest mip level currently uploaded
+    GLint  requested_base_level;  // finest mip level requested last frame
+    size_t resident_bytes;        // bytes used by all uploaded levels
+} texture_stats;
+
+/**
+ * @brief Residency of all streamed textures and the work of the streamer.
+ */
+typedef struct {
+    int    resident_levels;  // mip levels uploaded, summed over all textures
+    size_t resident_bytes;   // bytes used by all uploaded levels
+    size_t budget_bytes;     // memory budget shared by all textures
+    int    levels_streamed;  // finer levels uploaded by texture_streaming_update since startup
+    int    levels_evicted;   // levels evicted to stay within the budget since startup
+} texture_streaming_stats;
+
 
 /**
  * @brief Loads an image from a file and creates an OpenGL texture.
  *
  * This function loads the image located at `local_file_path` into memory,
- * generates a new OpenGL texture ID, and uploads the image data to the GPU.
+ * generates a new OpenGL texture ID, builds the full mip chain on the CPU
+ * and uploads only the smallest levels to the GPU. Finer levels are
+ * streamed in later by texture_streaming_update.
  * The texture uses mipmaps and linear filtering.
  *
  * @param local_file_path The path to the image file to load.
  * @return GLuint The generated OpenGL texture ID.
  */
 GLuint texture_create_from_file(const char* local_file_path);
+
+/**
+ * @brief Requests detail for a texture based on its screen-space density.
+ *
+ * Called by the renderer for every surface using the texture. The finest
+ * request of the frame wins. A density of 1.0 means one texel per pixel
+ * on the base level, 4.0 means four texels per pixel so level 2 is enough.
+ *
+ * @param texture_id       OpenGL texture ID returned by texture_create_from_file.
+ * @param texels_per_pixel Base level texels covered by one screen pixel.
+ */
+void texture_request_density(GLuint texture_id, GLfloat texels_per_pixel);
+
+/**
+ * @brief Streams requested levels in and evicts unused levels.
+ *
+ * Called once per frame after all density requests were made. Uploads
+ * at most TEXTURE_LEVELS_PER_UPDATE finer levels per texture and evicts
+ * unrequested fine levels while the memory budget is exceeded.
+ */
+void texture_streaming_update(void);
+
+/**
+ * @brief Sets the memory budget shared by all streamed textures.
+ *
+ * @param budget_bytes Budget in bytes. The smallest levels of each
+ *                     texture are always kept, even over budget.
+ */
+void texture_set_memory_budget(size_t budget_bytes);
+
+/**
+ * @brief Copies the residency statistics of a streamed texture.
+ *
+ * @param texture_id OpenGL texture ID returned by texture_create_from_file.
+ * @param stats      Output statistics.
+ * @return int Returns 1 if the texture is known, 0 otherwise.
+ */
+int texture_get_stats(GLuint texture_id, texture_stats* stats);
+
+/**
+ * @brief Copies the residency of all textures and the streaming counts.
+ *
+ * @param stats Output statistics.
+ */
+void texture_get_streaming_stats(texture_streaming_stats* stats);
+
+/**
+ * @brief Returns the CPU copy of one level of a texture's mip chain.
+ *
+ * Every level stays on the CPU whether or not it is resident, so a
+ * software rasterizer can sample the full chain.
+ *
+ * @param texture_id OpenGL texture ID returned by texture_create_from_file.
+ * @param level      Mip level, 0 for the base level.
+ * @param width      Output width of the level in texels.
+ * @param height     Output height of the level in texels.
+ * @return const GLubyte* RGB texels row by row from t = 0, NULL if the texture or level is unknown.
+ */
+const GLubyte* texture_get_level(GLuint texture_id, GLint level, GLint* width, GLint* height);
+
+/**
+ * @brief Prints the residency statistics of all textures to the console.
+ */
+void texture_print_stats(void);
+
+/**
+ * @brief Frees the CPU mip chains and deletes all streamed textures.
+ */
+void texture_cleanup(void);
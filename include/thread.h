@@ -0,0 +1,115 @@
+/**
+ * @file thread.h
+ * @brief Minimal threads, mutexes and condition variables on Windows and POSIX systems.
+ */
+
+
+#pragma once
+
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN  // keep windows.h from pulling in rarely used headers
+#endif
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+
+#ifdef _WIN32
+typedef HANDLE             thread_handle;     // running thread
+typedef CRITICAL_SECTION   thread_mutex;      // mutual exclusion lock
+typedef CONDITION_VARIABLE thread_condition;  // waits for a change guarded by a mutex
+#else
+typedef pthread_t          thread_handle;     // running thread
+typedef pthread_mutex_t    thread_mutex;      // mutual exclusion lock
+typedef pthread_cond_t     thread_condition;  // waits for a change guarded by a mutex
+#endif
+
+typedef void (*thread_function)(void* argument);  // entry point of a thread
+
+
+/**
+ * @brief Starts a thread.
+ *
+ * @param thread   Output handle of the started thread.
+ * @param function Entry point of the thread.
+ * @param argument Argument passed to the entry point.
+ * @return int Returns 1 if the thread was started, 0 otherwise.
+ */
+int thread_create(thread_handle* thread, thread_function function, void* argument);
+
+/**
+ * @brief Waits until a thread has returned and releases its handle.
+ *
+ * @param thread The thread to wait for.
+ */
+void thread_join(thread_handle* thread);
+
+/**
+ * @brief Initializes a mutex.
+ *
+ * @param mutex The mutex to initialize.
+ */
+void thread_mutex_initialize(thread_mutex* mutex);
+
+/**
+ * @brief Releases the resources of a mutex that is no longer locked.
+ *
+ * @param mutex The mutex to destroy.
+ */
+void thread_mutex_destroy(thread_mutex* mutex);
+
+/**
+ * @brief Blocks until the mutex is owned by the calling thread.
+ *
+ * @param mutex The mutex to lock.
+ */
+void thread_mutex_lock(thread_mutex* mutex);
+
+/**
+ * @brief Releases a mutex owned by the calling thread.
+ *
+ * @param mutex The mutex to unlock.
+ */
+void thread_mutex_unlock(thread_mutex* mutex);
+
+/**
+ * @brief Initializes a condition variable.
+ *
+ * @param condition The condition variable to initialize.
+ */
+void thread_condition_initialize(thread_condition* condition);
+
+/**
+ * @brief Releases the resources of a condition variable nobody waits on.
+ *
+ * @param condition The condition variable to destroy.
+ */
+void thread_condition_destroy(thread_condition* condition);
+
+/**
+ * @brief Unlocks the mutex, waits for a signal and locks the mutex again.
+ *
+ * Waits may end without a signal, so callers check their
+ * condition again in a loop.
+ *
+ * @param condition The condition variable to wait on.
+ * @param mutex     The mutex owned by the calling thread.
+ */
+void thread_condition_wait(thread_condition* condition, thread_mutex* mutex);
+
+/**
+ * @brief Wakes up one thread waiting on the condition variable.
+ *
+ * @param condition The condition variable to signal.
+ */
+void thread_condition_signal(thread_condition* condition);
+
+/**
+ * @brief Wakes up all threads waiting on the condition variable.
+ *
+ * @param condition The condition variable to signal.
+ */
+void thread_condition_broadcast(thread_condition* condition);
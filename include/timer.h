@@ -0,0 +1,38 @@
+/**
+ * @file timer.h
+ * @brief Monotonic high resolution clock for frame timing.
+ */
+
+
+#pragma once
+
+
+/**
+ * @brief Returns the time of a monotonic clock in milliseconds.
+ *
+ * The origin is arbitrary, only differences between two calls are meaningful.
+ *
+ * @return double Current time in milliseconds.
+ */
+double timer_now_ms(void);
+
+/**
+ * @brief Suspends the calling thread for about the given time.
+ *
+ * The thread may wake up later than requested, never earlier by design,
+ * so callers pacing a loop should measure the time again afterwards.
+ *
+ * @param milliseconds Time to sleep in milliseconds, nothing happens if not positive.
+ */
+void timer_sleep_ms(double milliseconds);
+
+/**
+ * @brief Suspends the calling thread until the monotonic clock reaches a deadline.
+ *
+ * Sleeps for most of the time and yields for the last fraction of a
+ * millisecond, which the sleep functions of the system cannot resolve,
+ * so the thread wakes up close to the deadline without spinning long.
+ *
+ * @param deadline_ms Time of timer_now_ms to wake up at, returns at once if it passed.
+ */
+void timer_sleep_until_ms(double deadline_ms);
@@ -19,8 +19,9 @@
 #define WATER_GRID_SIZE 100  // number of water grid squares
 
 
-// Global water vertices for drawing.
-extern point_3d water_vertices[WATER_GRID_SIZE + 1][WATER_GRID_SIZE + 1];
+// Global water vertices and their normals for drawing.
+extern point_3d  water_vertices[WATER_GRID_SIZE + 1][WATER_GRID_SIZE + 1];
+extern vector_3d water_normals[WATER_GRID_SIZE + 1][WATER_GRID_SIZE + 1];
 
 
 /**
@@ -28,7 +29,7 @@ extern point_3d water_vertices[WATER_GRID_SIZE + 1][WATER_GRID_SIZE + 1];
  *        a flat plane centered at the origin.
  *
  * Sets the X and Z coordinates spaced evenly over a square region,
- * and sets all Y coordinates (height) to 0.
+ * sets all Y coordinates (height) to 0 and all normals to point up.
  */
 void water_initialize(void);
 
@@ -36,6 +37,9 @@ void water_initialize(void);
  * @brief Updates the water surface vertex heights to simulate waves.
  *
  * Adjusts the Y coordinate of each vertex based on a sine wave
- * that varies over time and position to create an animated water effect.
+ * that varies over time and position to create an animated water effect,
+ * and tilts the normals along the slope of the wave.
+ *
+ * @param elapsed_ms Simulated time since the start in milliseconds.
  */
-void water_update(void);
+void water_update(GLfloat elapsed_ms);
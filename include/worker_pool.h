@@ -0,0 +1,68 @@
+/**
+ * @file worker_pool.h
+ * @brief A fixed set of threads running the tasks of a job in parallel.
+ *
+ * A job is a function called once for every task index. The threads
+ * sleep between jobs and the calling thread takes part in running the
+ * tasks, so a pool without threads runs every task on the caller.
+ * Tasks are handed out one at a time, so threads that finish early
+ * take over the remaining ones.
+ */
+
+
+#pragma once
+
+
+#include "thread.h"
+
+
+#define WORKER_POOL_MAX_THREADS 15  // threads of a pool at most, besides the calling thread
+
+
+typedef void (*worker_task)(void* argument, int task);  // runs one task of a job
+
+
+/**
+ * @brief Threads and the job they are working on.
+ */
+typedef struct {
+    thread_handle    threads[WORKER_POOL_MAX_THREADS];  // started threads
+    int              thread_count;                      // used entries of threads
+    thread_mutex     mutex;                             // guards the job and the counters below
+    thread_condition job_started;                       // signaled when a job is posted or the pool stops
+    thread_condition job_finished;                      // signaled when the last task of a job is done
+    worker_task      task;                              // function of the current job
+    void*            argument;                          // argument of the current job
+    int              task_count;                        // tasks of the current job
+    int              next_task;                         // next task to hand out
+    int              tasks_done;                        // tasks of the current job finished
+    unsigned         job_number;                        // incremented for every job posted
+    int              stopping;                          // 1 once the threads should return
+} worker_pool;
+
+
+/**
+ * @brief Starts the threads of a pool.
+ *
+ * @param pool         The pool to start.
+ * @param thread_count Threads besides the calling thread, at most WORKER_POOL_MAX_THREADS.
+ * @return int Number of threads started, fewer if the system refused some.
+ */
+int worker_pool_create(worker_pool* pool, int thread_count);
+
+/**
+ * @brief Runs every task of a job and waits until all are done.
+ *
+ * @param pool       The pool.
+ * @param task       Function called once for every task index.
+ * @param argument   Argument passed to every call.
+ * @param task_count Number of tasks, indexed from 0.
+ */
+void worker_pool_run(worker_pool* pool, worker_task task, void* argument, int task_count);
+
+/**
+ * @brief Stops and joins the threads of a pool.
+ *
+ * @param pool The pool to stop.
+ */
+void worker_pool_destroy(worker_pool* pool);
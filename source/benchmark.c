@@ -0,0 +1,467 @@
+/**
+ * @file benchmark.c
+ * @brief Implements the scripted flythrough and its frame time report.
+ */
+
+
+#include "benchmark.h"
+
+#include "camera.h"
+#include "frame_stats.h"
+#include "geometry.h"
+#include "gl_trace.h"
+#include "renderer.h"
+#include "simulation.h"
+#include "submarine.h"
+#include "window.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+#define POINT_VALUES  5                        // submarine x, y and z, camera theta and phi
+#define LINE_LENGTH   256                      // characters of a path file line at most
+#define SUMMARY_COUNT (RENDER_PASS_COUNT + 1)  // every render pass, then the whole frame
+
+
+/**
+ * @brief A timed point of the path.
+ */
+typedef struct {
+    double  time_s;                // time the point is passed, counted from the end of the warm-up
+    GLfloat values[POINT_VALUES];  // submarine position, camera angles in degrees
+} path_point;
+
+/**
+ * @brief Mean and percentiles of a series of times.
+ */
+typedef struct {
+    double mean;  // mean time in milliseconds
+    double p50;   // median in milliseconds
+    double p95;   // 95th percentile in milliseconds
+    double p99;   // 99th percentile in milliseconds
+    double max;   // longest time in milliseconds
+} time_summary;
+
+
+static const char* path_file = NULL;  // file the path was loaded from, NULL if no benchmark runs
+
+static path_point points[BENCHMARK_MAX_POINTS];           // points of the path in increasing time
+static int        point_count   = 0;                      // used entries of points
+static int        warmup_frames = 0;                      // unmeasured frames before the path starts
+static int        path_frames   = 0;                      // measured frames, one per simulation step of the path
+static unsigned   seed          = BENCHMARK_DEFAULT_SEED;  // seed of the random numbers
+
+static int     frames_ended = 0;               // frames recorded so far, warm-up included
+static double* frame_times  = NULL;            // CPU time of every measured frame
+static double* pass_times[RENDER_PASS_COUNT];  // CPU time of every render pass of every measured frame
+static long    draw_calls   = 0;               // draw calls of all measured frames
+
+
+/**
+ * @brief Parses one line of a path file.
+ *
+ * @param line        The line, without comments.
+ * @param line_number Number of the line, counted from 1.
+ * @return int Returns 1 if the line was valid or empty, 0 otherwise.
+ */
+static int parse_line(const char* line, int line_number)
+{
+    while (*line == ' ' || *line == '\t')
+    {
+        ++line;
+    }
+    if (*line == '\0' || *line == '\n' || *line == '\r')
+    {
+        return 1;
+    }
+
+    if (strncmp(line, "seed", 4) == 0 && sscanf_s(line + 4, "%u", &seed) == 1)
+    {
+        return 1;
+    }
+    if (strncmp(line, "warmup", 6) == 0 && sscanf_s(line + 6, "%d", &warmup_frames) == 1 && warmup_frames >= 0)
+    {
+        return 1;
+    }
+    if (strncmp(line, "point", 5) == 0 && point_count < BENCHMARK_MAX_POINTS)
+    {
+        path_point* point = &points[point_count];
+        if (sscanf_s(
+                line + 5,
+                "%lf %f %f %f %f %f",
+                &point->time_s,
+                &point->values[0],
+                &point->values[1],
+                &point->values[2],
+                &point->values[3],
+                &point->values[4]
+            ) == 1 + POINT_VALUES &&
+            (point_count == 0 || point->time_s > points[point_count - 1].time_s))
+        {
+            ++point_count;
+            return 1;
+        }
+    }
+
+    printf("Invalid line %d of the benchmark path: %s", line_number, line);
+    return 0;
+}
+
+/**
+ * @brief Loads a path file and seeds the random numbers of the scene.
+ *
+ * @param file_path Path of the file.
+ * @return int Returns 1 if the path was loaded, 0 otherwise.
+ */
+int benchmark_load(const char* file_path)
+{
+    FILE* file = NULL;
+    if (fopen_s(&file, file_path, "r") != 0 || file == NULL)
+    {
+        printf("Could not open the benchmark path %s.\n\n", file_path);
+        return 0;
+    }
+
+    point_count   = 0;
+    warmup_frames = BENCHMARK_DEFAULT_WARMUP;
+    seed          = BENCHMARK_DEFAULT_SEED;
+
+    char line[LINE_LENGTH];
+    int  line_number = 0;
+    int  valid       = 1;
+    while (valid && fgets(line, sizeof(line), file) != NULL)
+    {
+        char* comment = strchr(line, '#');
+        if (comment != NULL)
+        {
+            *comment = '\0';
+        }
+        valid = parse_line(line, ++line_number);
+    }
+    (void)fclose(file);
+
+    if (!valid)
+    {
+        return 0;
+    }
+    if (point_count < 2)
+    {
+        printf("The benchmark path %s needs at least two points.\n\n", file_path);
+        return 0;
+    }
+
+    // One frame per simulation step, both ends of the path included.
+    path_frames = (int)(points[point_count - 1].time_s * 1000.0 / SIMULATION_STEP_MS) + 1;
+
+    frame_times = malloc((size_t)path_frames * sizeof(double));
+    int allocated = frame_times != NULL;
+    for (int pass = 0; pass < RENDER_PASS_COUNT; ++pass)
+    {
+        pass_times[pass] = malloc((size_t)path_frames * sizeof(double));
+        allocated = allocated && pass_times[pass] != NULL;
+    }
+    if (!allocated)
+    {
+        printf("Could not allocate the times of %d benchmark frames.\n\n", path_frames);
+        benchmark_clean_up();
+        return 0;
+    }
+
+    frames_ended = 0;
+    draw_calls   = 0;
+    path_file    = file_path;
+    srand(seed);
+    return 1;
+}
+
+/**
+ * @brief Checks if a path was loaded.
+ *
+ * @return int Returns 1 while a benchmark runs, 0 otherwise.
+ */
+int benchmark_active(void)
+{
+    return path_file != NULL;
+}
+
+/**
+ * @brief Returns the number of frames of the benchmark, warm-up included.
+ *
+ * @return int Number of frames.
+ */
+int benchmark_frame_count(void)
+{
+    return warmup_frames + path_frames;
+}
+
+/**
+ * @brief Moves the submarine and the camera angles to a step of the path.
+ *
+ * The path is a uniform Catmull-Rom spline through the points, with
+ * the end points repeated, so it passes every point at its time. The
+ * submarine faces along the tangent and does not move by itself.
+ *
+ * @param step Simulation step, counted from 1.
+ */
+void benchmark_drive(unsigned step)
+{
+    int path_step = (int)step - warmup_frames - 1;
+    if (path_step < 0)
+    {
+        path_step = 0;
+    }
+    const double time_s = path_step * SIMULATION_STEP_MS / 1000.0;
+
+    int segment = 0;
+    while (segment < point_count - 2 && time_s > points[segment + 1].time_s)
+    {
+        ++segment;
+    }
+
+    const path_point* p0 = &points[segment > 0 ? segment - 1 : 0];
+    const path_point* p1 = &points[segment];
+    const path_point* p2 = &points[segment + 1];
+    const path_point* p3 = &points[segment + 2 < point_count ? segment + 2 : point_count - 1];
+
+    GLfloat u = (GLfloat)((time_s - p1->time_s) / (p2->time_s - p1->time_s));
+    if (u < 0.0f)
+    {
+        u = 0.0f;
+    }
+    else if (u > 1.0f)
+    {
+        u = 1.0f;
+    }
+
+    GLfloat values[POINT_VALUES];
+    GLfloat tangent[POINT_VALUES];
+    for (int i = 0; i < POINT_VALUES; ++i)
+    {
+        const GLfloat a = 2.0f * p1->values[i];
+        const GLfloat b = p2->values[i] - p0->values[i];
+        const GLfloat c = 2.0f * p0->values[i] - 5.0f * p1->values[i] + 4.0f * p2->values[i] - p3->values[i];
+        const GLfloat d = 3.0f * (p1->values[i] - p2->values[i]) + p3->values[i] - p0->values[i];
+
+        values[i]  = 0.5f * (a + (b + (c + d * u) * u) * u);
+        tangent[i] = 0.5f * (b + (2.0f * c + 3.0f * d * u) * u);
+    }
+
+    vector_3d direction = { tangent[0], tangent[1], tangent[2] };
+    for (int i = 0; i < 3; ++i)
+    {
+        object_submarine.position[i] = values[i];
+    }
+    if (!geometry_is_zero_vector(direction))
+    {
+        geometry_normalize_vector(direction);
+        for (int i = 0; i < 3; ++i)
+        {
+            object_submarine.direction[i] = direction[i];
+        }
+    }
+    object_submarine.speed = 0.0f;
+
+    main_camera.theta = geometry_degree_to_radian(values[3]);
+    main_camera.phi   = geometry_degree_to_radian(values[4]);
+}
+
+/**
+ * @brief Records the CPU time of a finished frame.
+ *
+ * @param frame_ms Time of the frame in milliseconds.
+ * @return int Returns 1 once the last frame was recorded, 0 otherwise.
+ */
+int benchmark_end_frame(double frame_ms)
+{
+    const int measured = frames_ended++ - warmup_frames;
+    if (measured >= 0 && measured < path_frames)
+    {
+        gl_trace_frame trace;
+        gl_trace_get_frame(&trace);
+
+        frame_times[measured] = frame_ms;
+        for (int pass = 0; pass < RENDER_PASS_COUNT; ++pass)
+        {
+            pass_times[pass][measured] = trace.pass_ms[pass];
+        }
+        draw_calls += current_frame_stats.draw_calls;
+    }
+    return frames_ended >= benchmark_frame_count();
+}
+
+/**
+ * @brief Sorts a series of times and summarizes it.
+ *
+ * @param times   Times in milliseconds, sorted in place.
+ * @param count   Number of times, at least one.
+ * @param summary Output summary.
+ */
+static void summarize(double* times, int count, time_summary* summary)
+{
+    double total = 0.0;
+    for (int i = 0; i < count; ++i)
+    {
+        total += times[i];
+    }
+    frame_stats_sort_times(times, count);
+
+    summary->mean = total / count;
+    summary->p50  = frame_stats_percentile(times, count, 50.0);
+    summary->p95  = frame_stats_percentile(times, count, 95.0);
+    summary->p99  = frame_stats_percentile(times, count, 99.0);
+    summary->max  = times[count - 1];
+}
+
+/**
+ * @brief Writes a string as a JSON string literal.
+ *
+ * @param file  The file.
+ * @param value The string.
+ */
+static void write_json_string(FILE* file, const char* value)
+{
+    fputc('"', file);
+    for (; *value != '\0'; ++value)
+    {
+        if (*value == '"' || *value == '\\')
+        {
+            fputc('\\', file);
+        }
+        fputc(*value, file);
+    }
+    fputc('"', file);
+}
+
+/**
+ * @brief Writes a summary as a JSON object.
+ *
+ * @param file    The file.
+ * @param summary The summary.
+ */
+static void write_json_summary(FILE* file, const time_summary* summary)
+{
+    fprintf(
+        file,
+        "{ \"mean\": %.4f, \"p50\": %.4f, \"p95\": %.4f, \"p99\": %.4f, \"max\": %.4f }",
+        summary->mean,
+        summary->p50,
+        summary->p95,
+        summary->p99,
+        summary->max
+    );
+}
+
+/**
+ * @brief Writes the configuration and the summaries to a JSON file.
+ *
+ * @param json_path Path of the file, replaced if it exists.
+ * @param summaries Summary of every render pass, then of the whole frame.
+ */
+static void write_json(const char* json_path, const time_summary summaries[SUMMARY_COUNT])
+{
+    FILE* file = NULL;
+    if (fopen_s(&file, json_path, "w") != 0 || file == NULL)
+    {
+        printf("Could not open %s for the benchmark results.\n\n", json_path);
+        return;
+    }
+
+    fprintf(file, "{\n  \"path\": ");
+    write_json_string(file, path_file);
+    fprintf(file, ",\n  \"seed\": %u,\n", seed);
+    fprintf(file, "  \"backend\": \"%s\",\n", renderer_backend_name(renderer_backend));
+    if (renderer_backend == RENDER_BACKEND_FIXED)
+    {
+        fprintf(file, "  \"render_path\": \"%s\",\n", renderer_path_name(mesh_render_path));
+    }
+    else
+    {
+        fprintf(file, "  \"render_path\": null,\n");
+    }
+    fprintf(file, "  \"width\": %d,\n  \"height\": %d,\n", main_window.width, main_window.height);
+    fprintf(file, "  \"warmup_frames\": %d,\n  \"frames\": %d,\n", warmup_frames, path_frames);
+    fprintf(file, "  \"draw_calls\": %.1f,\n", (double)draw_calls / path_frames);
+    fprintf(file, "  \"frame_ms\": ");
+    write_json_summary(file, &summaries[RENDER_PASS_COUNT]);
+    fprintf(file, ",\n  \"pass_ms\": {\n");
+    for (int pass = 0; pass < RENDER_PASS_COUNT; ++pass)
+    {
+        fprintf(file, "    \"%s\": ", renderer_pass_name((render_pass)pass));
+        write_json_summary(file, &summaries[pass]);
+        fprintf(file, pass + 1 < RENDER_PASS_COUNT ? ",\n" : "\n");
+    }
+    fprintf(file, "  }\n}\n");
+
+    (void)fclose(file);
+    printf("Saved the benchmark results to %s.\n\n", json_path);
+}
+
+/**
+ * @brief Prints the measured frame times and writes them to a JSON file.
+ *
+ * The frame times are the whole frame on the CPU, the pass times the
+ * render thread time between switches of the render pass, see gl_trace.
+ *
+ * @param json_path Path of the JSON file, replaced if it exists.
+ */
+void benchmark_report(const char* json_path)
+{
+    if (!benchmark_active() || frames_ended < benchmark_frame_count())
+    {
+        return;
+    }
+
+    time_summary summaries[SUMMARY_COUNT];
+    for (int pass = 0; pass < RENDER_PASS_COUNT; ++pass)
+    {
+        summarize(pass_times[pass], path_frames, &summaries[pass]);
+    }
+    summarize(frame_times, path_frames, &summaries[RENDER_PASS_COUNT]);
+
+    printf(
+        "Benchmark %s (%d frames after %d warm-up, seed %u, %dx%d, %s backend, %s)\n",
+        path_file,
+        path_frames,
+        warmup_frames,
+        seed,
+        main_window.width,
+        main_window.height,
+        renderer_backend_name(renderer_backend),
+        renderer_backend == RENDER_BACKEND_FIXED ? renderer_path_name(mesh_render_path) : "no render paths"
+    );
+    printf("-------------------\n");
+    printf("%-12s%9s%9s%9s%9s%9s\n", "ms", "mean", "p50", "p95", "p99", "max");
+    for (int i = 0; i < SUMMARY_COUNT; ++i)
+    {
+        printf(
+            "%-12s%9.3f%9.3f%9.3f%9.3f%9.3f\n",
+            i < RENDER_PASS_COUNT ? renderer_pass_name((render_pass)i) : "frame",
+            summaries[i].mean,
+            summaries[i].p50,
+            summaries[i].p95,
+            summaries[i].p99,
+            summaries[i].max
+        );
+    }
+    printf("draw calls:\t%.1f per frame\n\n", (double)draw_calls / path_frames);
+
+    write_json(json_path, summaries);
+}
+
+/**
+ * @brief Frees the path and the measured times.
+ */
+void benchmark_clean_up(void)
+{
+    free(frame_times);
+    frame_times = NULL;
+    for (int pass = 0; pass < RENDER_PASS_COUNT; ++pass)
+    {
+        free(pass_times[pass]);
+        pass_times[pass] = NULL;
+    }
+    path_file   = NULL;
+    point_count = 0;
+}
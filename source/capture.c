@@ -0,0 +1,574 @@
+/**
+ * @file capture.c
+ * @brief Implements the pixel buffer ring and the encoding workers.
+ */
+
+
+#include "capture.h"
+
+#include "gl_extensions.h"
+#include "png.h"
+#include "thread.h"
+#include "timer.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+/**
+ * @brief One frame on its way to the disk.
+ */
+typedef struct {
+    int            frame;     // capture frame number, counted from 1
+    int            width;     // width in pixels
+    int            height;    // height in pixels
+    unsigned char* pixels;    // RGBA rows, bottom row first as read by glReadPixels
+    size_t         capacity;  // bytes pixels can hold
+    unsigned char* planes;    // Y, U and V planes of the YUV format, top row first
+} capture_job;
+
+
+static int            capturing      = 0;                   // 1 between capture_start and capture_stop
+static capture_format current_format = CAPTURE_FORMAT_PNG;  // how the frames are written
+static capture_stats  counters       = { 0 };               // counters of the current or last capture
+static int            frame_count    = 0;                   // frames read since the capture started
+
+static GLuint pixel_buffers[CAPTURE_BUFFER_COUNT];  // ring of pixel pack buffers, 0 until created
+static int    buffer_frames[CAPTURE_BUFFER_COUNT];  // frame read into each buffer, 0 if none is pending
+static int    buffer_width  = 0;                    // width the buffers were sized for
+static int    buffer_height = 0;                    // height the buffers were sized for
+static int    next_buffer   = 0;                    // buffer the next frame is read into, the oldest one
+
+static capture_job      jobs[CAPTURE_JOB_COUNT];         // frames being captured
+static int              free_jobs[CAPTURE_JOB_COUNT];    // stack of idle jobs
+static int              free_count     = 0;              // used entries of free_jobs
+static int              queued_jobs[CAPTURE_JOB_COUNT];  // ring of jobs waiting for a worker
+static int              queue_first    = 0;              // oldest entry of queued_jobs
+static int              queue_count    = 0;              // used entries of queued_jobs
+static int              stop_requested = 0;              // 1 once the workers should return
+static thread_mutex     jobs_mutex;                      // guards the job lists and the worker counters
+static thread_condition job_queued;                      // signaled when a job waits for a worker
+static thread_condition job_finished;                    // signaled when a job became idle again
+static thread_handle    workers[CAPTURE_WORKER_COUNT];   // encoding threads
+static int              worker_count   = 0;              // started entries of workers
+
+
+/**
+ * @brief Converts the RGBA rows of a job into tightly packed RGB in place.
+ *
+ * Every pixel moves to a lower or equal offset, so a forward pass never
+ * overwrites a pixel that was not converted yet.
+ */
+static void pack_rgb(capture_job* job)
+{
+    const size_t pixel_count = (size_t)job->width * (size_t)job->height;
+    for (size_t i = 0; i < pixel_count; ++i)
+    {
+        job->pixels[i * 3 + 0] = job->pixels[i * 4 + 0];
+        job->pixels[i * 3 + 1] = job->pixels[i * 4 + 1];
+        job->pixels[i * 3 + 2] = job->pixels[i * 4 + 2];
+    }
+}
+
+/**
+ * @brief Converts the RGBA rows of a job into BT.601 limited range I420 planes.
+ *
+ * Rows are flipped to start at the top. Each chroma sample averages a
+ * block of 2x2 pixels, clamped at the right and bottom edges.
+ */
+static void convert_yuv(capture_job* job)
+{
+    const int width         = job->width;
+    const int height        = job->height;
+    const int chroma_width  = (width + 1) / 2;
+    const int chroma_height = (height + 1) / 2;
+
+    unsigned char* y_plane = job->planes;
+    unsigned char* u_plane = y_plane + (size_t)width * (size_t)height;
+    unsigned char* v_plane = u_plane + (size_t)chroma_width * (size_t)chroma_height;
+
+    for (int row = 0; row < height; ++row)
+    {
+        const unsigned char* source = job->pixels + (size_t)(height - 1 - row) * (size_t)width * 4;
+        unsigned char*       luma   = y_plane + (size_t)row * (size_t)width;
+        for (int column = 0; column < width; ++column)
+        {
+            const int r = source[column * 4 + 0];
+            const int g = source[column * 4 + 1];
+            const int b = source[column * 4 + 2];
+            luma[column] = (unsigned char)(16 + ((66 * r + 129 * g + 25 * b + 128) >> 8));
+        }
+    }
+
+    for (int row = 0; row < chroma_height; ++row)
+    {
+        const int top    = height - 1 - row * 2;
+        const int bottom = top > 0 ? top - 1 : top;
+        for (int column = 0; column < chroma_width; ++column)
+        {
+            const int left  = column * 2;
+            const int right = left + 1 < width ? left + 1 : left;
+
+            int r = 0;
+            int g = 0;
+            int b = 0;
+            const int rows[2]    = { top, bottom };
+            const int columns[2] = { left, right };
+            for (int i = 0; i < 4; ++i)
+            {
+                const unsigned char* pixel =
+                    job->pixels + ((size_t)rows[i / 2] * (size_t)width + (size_t)columns[i % 2]) * 4;
+                r += pixel[0];
+                g += pixel[1];
+                b += pixel[2];
+            }
+            r /= 4;
+            g /= 4;
+            b /= 4;
+
+            const size_t index = (size_t)row * (size_t)chroma_width + (size_t)column;
+            u_plane[index] = (unsigned char)(128 + ((-38 * r - 74 * g + 112 * b + 128) >> 8));
+            v_plane[index] = (unsigned char)(128 + ((112 * r - 94 * g - 18 * b + 128) >> 8));
+        }
+    }
+}
+
+/**
+ * @brief Encodes a job and writes it to its file.
+ */
+static void write_job(capture_job* job)
+{
+    char file_path[64];
+
+    if (current_format == CAPTURE_FORMAT_PNG)
+    {
+        (void)sprintf_s(file_path, sizeof(file_path), CAPTURE_PNG_FILE_FORMAT, job->frame);
+        pack_rgb(job);
+        if (!png_write_rgb(file_path, job->width, job->height, job->pixels, 1))
+        {
+            printf("Could not write the captured frame %s.\n", file_path);
+        }
+        return;
+    }
+
+    (void)sprintf_s(file_path, sizeof(file_path), CAPTURE_YUV_FILE_FORMAT, job->frame);
+    convert_yuv(job);
+
+    const size_t chroma_size = (size_t)((job->width + 1) / 2) * (size_t)((job->height + 1) / 2);
+    const size_t size        = (size_t)job->width * (size_t)job->height + chroma_size * 2;
+
+    FILE* file = NULL;
+    if (fopen_s(&file, file_path, "wb") != 0 || file == NULL)
+    {
+        printf("Could not write the captured frame %s.\n", file_path);
+        return;
+    }
+    (void)fwrite(job->planes, 1, size, file);
+    fclose(file);
+}
+
+/**
+ * @brief Encodes queued jobs until asked to stop and the queue is empty.
+ */
+static void run_worker(void* argument)
+{
+    (void)argument;
+
+    thread_mutex_lock(&jobs_mutex);
+    for (;;)
+    {
+        while (queue_count == 0 && !stop_requested)
+        {
+            thread_condition_wait(&job_queued, &jobs_mutex);
+        }
+        if (queue_count == 0)
+        {
+            break;
+        }
+
+        const int index = queued_jobs[queue_first];
+        queue_first = (queue_first + 1) % CAPTURE_JOB_COUNT;
+        --queue_count;
+        thread_mutex_unlock(&jobs_mutex);
+
+        const double start_ms = timer_now_ms();
+        write_job(&jobs[index]);
+        const double encode_ms = timer_now_ms() - start_ms;
+
+        thread_mutex_lock(&jobs_mutex);
+        free_jobs[free_count++] = index;
+        ++counters.frames_written;
+        counters.total_encode_ms += encode_ms;
+        thread_condition_signal(&job_finished);
+    }
+    thread_mutex_unlock(&jobs_mutex);
+}
+
+/**
+ * @brief Takes an idle job sized for a frame.
+ *
+ * @param width  Width of the frame in pixels.
+ * @param height Height of the frame in pixels.
+ * @param wait   1 to wait for a worker to finish a job, 0 to give up at once.
+ * @return capture_job* The job, or NULL if none is idle or memory ran out.
+ */
+static capture_job* acquire_job(int width, int height, int wait)
+{
+    thread_mutex_lock(&jobs_mutex);
+    while (free_count == 0 && wait)
+    {
+        thread_condition_wait(&job_finished, &jobs_mutex);
+    }
+    const int index = free_count > 0 ? free_jobs[--free_count] : -1;
+    thread_mutex_unlock(&jobs_mutex);
+
+    if (index < 0)
+    {
+        return NULL;
+    }
+
+    capture_job* job  = &jobs[index];
+    const size_t size = (size_t)width * (size_t)height * 4;
+    if (job->capacity < size)
+    {
+        free(job->pixels);
+        free(job->planes);
+        job->pixels   = malloc(size);
+        job->planes   = malloc(size);
+        job->capacity = job->pixels != NULL && job->planes != NULL ? size : 0;
+    }
+    if (job->capacity == 0)
+    {
+        thread_mutex_lock(&jobs_mutex);
+        free_jobs[free_count++] = index;
+        thread_mutex_unlock(&jobs_mutex);
+        return NULL;
+    }
+
+    job->width  = width;
+    job->height = height;
+    return job;
+}
+
+/**
+ * @brief Hands a filled job to the workers.
+ */
+static void queue_job(capture_job* job)
+{
+    thread_mutex_lock(&jobs_mutex);
+    queued_jobs[(queue_first + queue_count) % CAPTURE_JOB_COUNT] = (int)(job - jobs);
+    ++queue_count;
+    thread_condition_signal(&job_queued);
+    thread_mutex_unlock(&jobs_mutex);
+}
+
+/**
+ * @brief Maps a pending pixel buffer and queues its frame.
+ *
+ * @param buffer Index of the buffer in the ring.
+ * @param wait   1 to wait for an idle job, 0 to drop the frame if none is idle.
+ */
+static void collect_buffer(int buffer, int wait)
+{
+    if (buffer_frames[buffer] == 0)
+    {
+        return;
+    }
+
+    capture_job* job = acquire_job(buffer_width, buffer_height, wait);
+    if (job == NULL)
+    {
+        ++counters.frames_dropped;
+        buffer_frames[buffer] = 0;
+        return;
+    }
+    job->frame = buffer_frames[buffer];
+    buffer_frames[buffer] = 0;
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, pixel_buffers[buffer]);
+    const void* pixels = glMapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY);
+    if (pixels != NULL)
+    {
+        memcpy(job->pixels, pixels, (size_t)buffer_width * (size_t)buffer_height * 4);
+        (void)glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    if (pixels == NULL)
+    {
+        ++counters.frames_dropped;
+        thread_mutex_lock(&jobs_mutex);
+        free_jobs[free_count++] = (int)(job - jobs);
+        thread_mutex_unlock(&jobs_mutex);
+        return;
+    }
+    queue_job(job);
+}
+
+/**
+ * @brief Queues the frames of all pending buffers, oldest first.
+ */
+static void collect_all_buffers(void)
+{
+    for (int i = 0; i < CAPTURE_BUFFER_COUNT; ++i)
+    {
+        collect_buffer((next_buffer + i) % CAPTURE_BUFFER_COUNT, 1);
+    }
+}
+
+/**
+ * @brief Deletes the pixel buffers.
+ */
+static void delete_buffers(void)
+{
+    if (pixel_buffers[0] != 0)
+    {
+        glDeleteBuffers(CAPTURE_BUFFER_COUNT, pixel_buffers);
+    }
+    for (int i = 0; i < CAPTURE_BUFFER_COUNT; ++i)
+    {
+        pixel_buffers[i] = 0;
+        buffer_frames[i] = 0;
+    }
+    buffer_width  = 0;
+    buffer_height = 0;
+    next_buffer   = 0;
+}
+
+/**
+ * @brief Sizes the ring of pixel buffers for a framebuffer.
+ *
+ * @param width  Width of the framebuffer in pixels.
+ * @param height Height of the framebuffer in pixels.
+ */
+static void create_buffers(int width, int height)
+{
+    delete_buffers();
+
+    glGenBuffers(CAPTURE_BUFFER_COUNT, pixel_buffers);
+    for (int i = 0; i < CAPTURE_BUFFER_COUNT; ++i)
+    {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, pixel_buffers[i]);
+        glBufferData(GL_PIXEL_PACK_BUFFER, (gl_size_pointer)width * height * 4, NULL, GL_STREAM_READ);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    buffer_width  = width;
+    buffer_height = height;
+}
+
+/**
+ * @brief Starts capturing every drawn frame.
+ *
+ * @param format How the frames are written.
+ * @return int Returns 1 if capturing, 0 if the workers could not be started.
+ */
+int capture_start(capture_format format)
+{
+    if (capturing)
+    {
+        return 1;
+    }
+
+    png_initialize();
+
+    thread_mutex_initialize(&jobs_mutex);
+    thread_condition_initialize(&job_queued);
+    thread_condition_initialize(&job_finished);
+
+    for (int i = 0; i < CAPTURE_JOB_COUNT; ++i)
+    {
+        free_jobs[i] = i;
+    }
+    free_count     = CAPTURE_JOB_COUNT;
+    queue_first    = 0;
+    queue_count    = 0;
+    stop_requested = 0;
+
+    worker_count = 0;
+    while (worker_count < CAPTURE_WORKER_COUNT &&
+           thread_create(&workers[worker_count], run_worker, NULL))
+    {
+        ++worker_count;
+    }
+    if (worker_count == 0)
+    {
+        printf("Could not start the capture workers.\n\n");
+        thread_condition_destroy(&job_finished);
+        thread_condition_destroy(&job_queued);
+        thread_mutex_destroy(&jobs_mutex);
+        return 0;
+    }
+
+    current_format = format;
+    frame_count    = 0;
+    memset(&counters, 0, sizeof(counters));
+    capturing = 1;
+
+    printf(
+        "Capturing frames as %s through %s.\n\n",
+        capture_format_name(format),
+        gl_extensions.pixel_buffer_objects ? "a ring of pixel buffers" : "synchronous reads"
+    );
+    return 1;
+}
+
+/**
+ * @brief Writes the frames still in flight and stops capturing.
+ */
+void capture_stop(void)
+{
+    if (!capturing)
+    {
+        return;
+    }
+
+    if (gl_extensions.pixel_buffer_objects)
+    {
+        collect_all_buffers();
+        delete_buffers();
+    }
+
+    thread_mutex_lock(&jobs_mutex);
+    stop_requested = 1;
+    thread_condition_broadcast(&job_queued);
+    thread_mutex_unlock(&jobs_mutex);
+
+    for (int i = 0; i < worker_count; ++i)
+    {
+        thread_join(&workers[i]);
+    }
+    worker_count = 0;
+
+    for (int i = 0; i < CAPTURE_JOB_COUNT; ++i)
+    {
+        free(jobs[i].pixels);
+        free(jobs[i].planes);
+        jobs[i].pixels   = NULL;
+        jobs[i].planes   = NULL;
+        jobs[i].capacity = 0;
+    }
+
+    thread_condition_destroy(&job_finished);
+    thread_condition_destroy(&job_queued);
+    thread_mutex_destroy(&jobs_mutex);
+    capturing = 0;
+
+    const int frames  = counters.frames_read > 0 ? counters.frames_read : 1;
+    const int written = counters.frames_written > 0 ? counters.frames_written : 1;
+    printf(
+        "Captured %d of %d frames as %s (%d dropped), %.3f ms per frame on the render thread, %.3f ms per frame encoding.\n\n",
+        counters.frames_written,
+        counters.frames_read,
+        capture_format_name(current_format),
+        counters.frames_dropped,
+        counters.total_overhead_ms / frames,
+        counters.total_encode_ms / written
+    );
+}
+
+/**
+ * @brief Checks if frames are being captured.
+ *
+ * @return int Returns 1 while capturing, 0 otherwise.
+ */
+int capture_active(void)
+{
+    return capturing;
+}
+
+/**
+ * @brief Reads back the frame just drawn into the current framebuffer.
+ *
+ * With pixel buffer objects the read only queues a transfer into the
+ * oldest buffer of the ring, after the frame read into it
+ * CAPTURE_BUFFER_COUNT frames ago was collected.
+ *
+ * @param width  Width of the framebuffer in pixels.
+ * @param height Height of the framebuffer in pixels.
+ */
+void capture_frame(int width, int height)
+{
+    if (!capturing || width <= 0 || height <= 0)
+    {
+        return;
+    }
+
+    const double start_ms = timer_now_ms();
+    const int    frame    = ++frame_count;
+    ++counters.frames_read;
+
+    if (gl_extensions.pixel_buffer_objects)
+    {
+        if (width != buffer_width || height != buffer_height)
+        {
+            collect_all_buffers();
+            create_buffers(width, height);
+        }
+
+        collect_buffer(next_buffer, 0);
+
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, pixel_buffers[next_buffer]);
+        glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+        buffer_frames[next_buffer] = frame;
+        next_buffer = (next_buffer + 1) % CAPTURE_BUFFER_COUNT;
+    }
+    else
+    {
+        capture_job* job = acquire_job(width, height, 0);
+        if (job != NULL)
+        {
+            job->frame = frame;
+            glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, job->pixels);
+            queue_job(job);
+        }
+        else
+        {
+            ++counters.frames_dropped;
+        }
+    }
+
+    counters.last_overhead_ms   = timer_now_ms() - start_ms;
+    counters.total_overhead_ms += counters.last_overhead_ms;
+}
+
+/**
+ * @brief Copies the counters of the current or last capture.
+ *
+ * @param stats Output counters.
+ */
+void capture_get_stats(capture_stats* stats)
+{
+    if (capturing)
+    {
+        thread_mutex_lock(&jobs_mutex);
+        *stats = counters;
+        thread_mutex_unlock(&jobs_mutex);
+        return;
+    }
+    *stats = counters;
+}
+
+/**
+ * @brief Returns a readable name of a capture format.
+ *
+ * @param format The capture format.
+ * @return const char* Name of the format.
+ */
+const char* capture_format_name(capture_format format)
+{
+    switch (format)
+    {
+    case CAPTURE_FORMAT_PNG:
+        return "png";
+
+    case CAPTURE_FORMAT_YUV:
+        return "yuv";
+
+    default:
+        return "unknown";
+    }
+}
@@ -0,0 +1,250 @@
+/**
+ * @file debug_draw.c
+ * @brief Implements the batch of debug lines recorded every frame.
+ */
+
+
+#include "debug_draw.h"
+
+#include <math.h>
+
+
+#if DEBUG_DRAW
+
+int debug_draw_on = 1;  // starts as one until debug drawing is turned off by user.
+
+static debug_draw_batch batch;  // lines of the frame being recorded.
+
+
+/**
+ * @brief Empties the batch for a new frame.
+ */
+void debug_draw_begin_frame(void)
+{
+    for (int i = 0; i < DEBUG_DRAW_WEIGHT_COUNT; ++i)
+    {
+        batch.counts[i] = 0;
+    }
+    batch.dropped = 0;
+}
+
+/**
+ * @brief Converts a color channel to a byte.
+ *
+ * @param channel Channel from 0 to 1, clamped.
+ * @return GLubyte The channel from 0 to 255.
+ */
+static GLubyte channel_to_byte(GLfloat channel)
+{
+    return (GLubyte)(fminf(fmaxf(channel, 0.0f), 1.0f) * 255.0f + 0.5f);
+}
+
+/**
+ * @brief Reserves the vertices of a number of lines of one weight.
+ *
+ * @param weight     Width of the lines.
+ * @param line_count Number of lines.
+ * @return debug_vertex* The first of 2 * line_count vertices, NULL if the batch is full or off.
+ */
+static debug_vertex* reserve_lines(debug_draw_weight weight, int line_count)
+{
+    if (!debug_draw_on)
+    {
+        return NULL;
+    }
+
+    int* count = &batch.counts[weight];
+    if (*count + 2 * line_count > DEBUG_DRAW_CAPACITY)
+    {
+        batch.dropped += line_count;
+        return NULL;
+    }
+
+    debug_vertex* vertices = &batch.vertices[weight * DEBUG_DRAW_CAPACITY + *count];
+    *count += 2 * line_count;
+    return vertices;
+}
+
+/**
+ * @brief Sets a reserved vertex.
+ *
+ * @param vertex   The vertex.
+ * @param position Position in world space.
+ * @param bytes    Color as bytes.
+ */
+static void set_vertex(debug_vertex* vertex, const point_3d position, const GLubyte bytes[4])
+{
+    for (int i = 0; i < 3; ++i)
+    {
+        vertex->position[i] = position[i];
+    }
+    for (int i = 0; i < 4; ++i)
+    {
+        vertex->color[i] = bytes[i];
+    }
+}
+
+/**
+ * @brief Adds a line.
+ *
+ * @param weight     Width of the line.
+ * @param start      Start point.
+ * @param end        End point.
+ * @param line_color Color of the line, unlit.
+ */
+void debug_draw_line(
+          debug_draw_weight weight,
+    const point_3d          start,
+    const point_3d          end,
+    const color             line_color
+)
+{
+    debug_vertex* vertices = reserve_lines(weight, 1);
+    if (vertices == NULL)
+    {
+        return;
+    }
+
+    const GLubyte bytes[4] = {
+        channel_to_byte(line_color[0]),
+        channel_to_byte(line_color[1]),
+        channel_to_byte(line_color[2]),
+        channel_to_byte(line_color[3])
+    };
+    set_vertex(&vertices[0], start, bytes);
+    set_vertex(&vertices[1], end,   bytes);
+}
+
+/**
+ * @brief Adds the twelve edges of an axis-aligned box.
+ *
+ * @param weight     Width of the lines.
+ * @param minimum    Corner with the smallest coordinates.
+ * @param maximum    Corner with the largest coordinates.
+ * @param line_color Color of the lines, unlit.
+ */
+void debug_draw_box(
+          debug_draw_weight weight,
+    const point_3d          minimum,
+    const point_3d          maximum,
+    const color             line_color
+)
+{
+    debug_vertex* vertices = reserve_lines(weight, 12);
+    if (vertices == NULL)
+    {
+        return;
+    }
+
+    const GLubyte bytes[4] = {
+        channel_to_byte(line_color[0]),
+        channel_to_byte(line_color[1]),
+        channel_to_byte(line_color[2]),
+        channel_to_byte(line_color[3])
+    };
+
+    // Corner i takes the maximum along x, y and z for bits 0, 1 and 2 of i.
+    point_3d corners[8];
+    for (int i = 0; i < 8; ++i)
+    {
+        corners[i][0] = (i & 1) ? maximum[0] : minimum[0];
+        corners[i][1] = (i & 2) ? maximum[1] : minimum[1];
+        corners[i][2] = (i & 4) ? maximum[2] : minimum[2];
+    }
+
+    // Every edge joins two corners that differ in one bit.
+    int line = 0;
+    for (int i = 0; i < 8; ++i)
+    {
+        for (int bit = 1; bit < 8; bit <<= 1)
+        {
+            if ((i & bit) == 0)
+            {
+                set_vertex(&vertices[2 * line],     corners[i],       bytes);
+                set_vertex(&vertices[2 * line + 1], corners[i | bit], bytes);
+                ++line;
+            }
+        }
+    }
+}
+
+/**
+ * @brief Adds a sphere as its great circles about the x, y and z axes.
+ *
+ * @param weight     Width of the lines.
+ * @param center     Center of the sphere.
+ * @param radius     Radius of the sphere.
+ * @param line_color Color of the lines, unlit.
+ */
+void debug_draw_sphere(
+          debug_draw_weight weight,
+    const point_3d          center,
+          GLfloat           radius,
+    const color             line_color
+)
+{
+    debug_vertex* vertices = reserve_lines(weight, 3 * DEBUG_DRAW_CIRCLE_SEGMENTS);
+    if (vertices == NULL)
+    {
+        return;
+    }
+
+    const GLubyte bytes[4] = {
+        channel_to_byte(line_color[0]),
+        channel_to_byte(line_color[1]),
+        channel_to_byte(line_color[2]),
+        channel_to_byte(line_color[3])
+    };
+
+    GLfloat sines[DEBUG_DRAW_CIRCLE_SEGMENTS + 1];
+    GLfloat cosines[DEBUG_DRAW_CIRCLE_SEGMENTS + 1];
+    for (int i = 0; i <= DEBUG_DRAW_CIRCLE_SEGMENTS; ++i)
+    {
+        const GLfloat angle = 2.0f * PI * (GLfloat)i / (GLfloat)DEBUG_DRAW_CIRCLE_SEGMENTS;
+        sines[i]   = radius * sinf(angle);
+        cosines[i] = radius * cosf(angle);
+    }
+
+    // The circle about an axis lies in the plane of the two other axes.
+    int line = 0;
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        const int first  = (axis + 1) % 3;
+        const int second = (axis + 2) % 3;
+
+        for (int i = 0; i < DEBUG_DRAW_CIRCLE_SEGMENTS; ++i)
+        {
+            for (int end = 0; end < 2; ++end)
+            {
+                point_3d point = { center[0], center[1], center[2] };
+                point[first]  += cosines[i + end];
+                point[second] += sines[i + end];
+                set_vertex(&vertices[2 * line + end], point, bytes);
+            }
+            ++line;
+        }
+    }
+}
+
+/**
+ * @brief Returns the lines recorded since the frame began.
+ *
+ * @return const debug_draw_batch* The batch, valid until the next frame begins.
+ */
+const debug_draw_batch* debug_draw_get_batch(void)
+{
+    return &batch;
+}
+
+/**
+ * @brief Returns the line width of a weight.
+ *
+ * @param weight The weight.
+ * @return GLfloat Width in pixels.
+ */
+GLfloat debug_draw_weight_width(debug_draw_weight weight)
+{
+    return weight == DEBUG_DRAW_BOLD ? DEBUG_DRAW_BOLD_WIDTH : DEBUG_DRAW_THIN_WIDTH;
+}
+
+#endif
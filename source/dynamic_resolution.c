@@ -0,0 +1,370 @@
+/**
+ * @file dynamic_resolution.c
+ * @brief Implements the scaled offscreen target and the frame time controller.
+ */
+
+
+#include "dynamic_resolution.h"
+
+#include "gl_extensions.h"
+#include "gl_trace.h"
+#include "timer.h"
+
+#include <math.h>
+#include <stdio.h>
+
+
+#define DYNAMIC_RESOLUTION_SMOOTHING      0.2    // weight of the newest frame time in the moving average
+#define DYNAMIC_RESOLUTION_ADJUST_FRAMES  8      // frames between two adjustments of the scale
+#define DYNAMIC_RESOLUTION_RAISE_HEADROOM 0.8    // fraction of the target the frame time must stay under to raise the scale
+#define DYNAMIC_RESOLUTION_MAX_LOWER_STEP 0.1f   // largest decrease of the scale per adjustment
+#define DYNAMIC_RESOLUTION_MAX_RAISE_STEP 0.05f  // largest increase of the scale per adjustment, slower to avoid oscillation
+#define DYNAMIC_RESOLUTION_SPIKE_FACTOR   4.0    // frame times are clamped to this multiple of the target
+
+
+static int                       scaling_on = 0;  // 1 while the scale follows the frame time
+static dynamic_resolution_status controller = {   // scale and controller state of the current frame
+    DYNAMIC_RESOLUTION_OFF,
+    DYNAMIC_RESOLUTION_MAX_SCALE,
+    0,
+    0,
+    DYNAMIC_RESOLUTION_DEFAULT_TARGET_MS,
+    0.0
+};
+
+static GLuint framebuffer        = 0;  // offscreen target, 0 until created
+static GLuint color_renderbuffer = 0;  // RGBA color attachment, 0 until created
+static GLuint depth_renderbuffer = 0;  // depth attachment, 0 until created
+static int    target_width       = 0;  // width of the attachments in pixels
+static int    target_height      = 0;  // height of the attachments in pixels
+
+static GLint  output_framebuffer = 0;    // framebuffer the frame is upscaled into, the window or the headless target
+static int    output_width       = 0;    // width of the output framebuffer in pixels
+static int    output_height      = 0;    // height of the output framebuffer in pixels
+static int    frame_redirected   = 0;    // 1 if the current frame is drawn into the offscreen target
+static double frame_start_ms     = 0.0;  // time the current frame started
+static int    frames_measured    = 0;    // frames measured since the last adjustment
+
+
+/**
+ * @brief Deletes the offscreen target and its attachments.
+ */
+static void destroy_target(void)
+{
+    if (framebuffer != 0)
+    {
+        glDeleteFramebuffers(1, &framebuffer);
+        framebuffer = 0;
+    }
+
+    GLuint* renderbuffers[] = { &color_renderbuffer, &depth_renderbuffer };
+    for (int i = 0; i < 2; ++i)
+    {
+        if (*renderbuffers[i] != 0)
+        {
+            glDeleteRenderbuffers(1, renderbuffers[i]);
+            *renderbuffers[i] = 0;
+        }
+    }
+
+    target_width  = 0;
+    target_height = 0;
+}
+
+/**
+ * @brief Creates the offscreen target at the full output size.
+ *
+ * The target is not resized when the scale changes, only the part of
+ * it that is drawn, so adjusting the scale never reallocates memory.
+ *
+ * @param width  Width in pixels.
+ * @param height Height in pixels.
+ * @return int Returns 1 if the target is complete, 0 otherwise.
+ */
+static int create_target(int width, int height)
+{
+    destroy_target();
+
+    glGenRenderbuffers(1, &color_renderbuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, color_renderbuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+
+    glGenRenderbuffers(1, &depth_renderbuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, depth_renderbuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glGenFramebuffers(1, &framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, color_renderbuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depth_renderbuffer);
+
+    const GLenum framebuffer_status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    glBindFramebuffer(GL_FRAMEBUFFER, (GLuint)output_framebuffer);
+
+    if (framebuffer_status != GL_FRAMEBUFFER_COMPLETE)
+    {
+        printf("The dynamic resolution target of %dx%d is incomplete.\n", width, height);
+        destroy_target();
+        return 0;
+    }
+
+    target_width  = width;
+    target_height = height;
+    return 1;
+}
+
+/**
+ * @brief Converts a scale into a drawn size of at least one pixel.
+ *
+ * @param size  Full size in pixels.
+ * @param scale Fraction of the size drawn.
+ * @return int The drawn size in pixels.
+ */
+static int scaled_size(int size, GLfloat scale)
+{
+    const int scaled = (int)((GLfloat)size * scale + 0.5f);
+    return scaled > 1 ? scaled : 1;
+}
+
+/**
+ * @brief Feeds a frame time to the controller and adjusts the scale.
+ *
+ * The drawn pixels grow with the square of the scale, so the scale is
+ * corrected by the square root of the ratio between the target and the
+ * smoothed frame time. Frame costs that do not depend on the pixel count
+ * make this an overestimate, which the step limits and the averaging
+ * over several frames absorb.
+ *
+ * @param frame_ms Cost of the frame in milliseconds.
+ */
+static void update_controller(double frame_ms)
+{
+    const double spike_ms = controller.target_ms * DYNAMIC_RESOLUTION_SPIKE_FACTOR;
+    if (frame_ms > spike_ms)
+    {
+        frame_ms = spike_ms;
+    }
+
+    if (controller.smoothed_ms <= 0.0)
+    {
+        controller.smoothed_ms = frame_ms;
+    }
+    else
+    {
+        controller.smoothed_ms += (frame_ms - controller.smoothed_ms) * DYNAMIC_RESOLUTION_SMOOTHING;
+    }
+
+    if (++frames_measured < DYNAMIC_RESOLUTION_ADJUST_FRAMES)
+    {
+        return;
+    }
+    frames_measured = 0;
+
+    GLfloat scale = controller.scale;
+    if (controller.smoothed_ms > controller.target_ms)
+    {
+        const GLfloat lowered = scale * (GLfloat)sqrt(controller.target_ms / controller.smoothed_ms);
+        scale = fmaxf(lowered, scale - DYNAMIC_RESOLUTION_MAX_LOWER_STEP);
+    }
+    else if (controller.smoothed_ms < controller.target_ms * DYNAMIC_RESOLUTION_RAISE_HEADROOM)
+    {
+        const GLfloat raised = scale * (GLfloat)sqrt(
+            controller.target_ms * DYNAMIC_RESOLUTION_RAISE_HEADROOM / controller.smoothed_ms
+        );
+        scale = fminf(raised, scale + DYNAMIC_RESOLUTION_MAX_RAISE_STEP);
+    }
+    scale = fminf(fmaxf(scale, DYNAMIC_RESOLUTION_MIN_SCALE), DYNAMIC_RESOLUTION_MAX_SCALE);
+
+    if (scale < controller.scale)
+    {
+        controller.state = DYNAMIC_RESOLUTION_LOWERING;
+    }
+    else if (scale > controller.scale)
+    {
+        controller.state = DYNAMIC_RESOLUTION_RAISING;
+    }
+    else
+    {
+        controller.state = DYNAMIC_RESOLUTION_HOLDING;
+    }
+    controller.scale = scale;
+}
+
+/**
+ * @brief Enables or disables the resolution scaling.
+ *
+ * @param enabled   1 to enable the scaling, 0 to draw at window resolution.
+ * @param target_ms Frame time budget in milliseconds.
+ * @return int Returns 1 if the scaling is enabled afterwards, 0 otherwise.
+ */
+int dynamic_resolution_enable(int enabled, double target_ms)
+{
+    if (enabled && !gl_extensions.framebuffer_blit)
+    {
+        printf("Dynamic resolution needs framebuffer objects with blits.\n\n");
+        enabled = 0;
+    }
+
+    scaling_on             = enabled;
+    controller.state       = enabled ? DYNAMIC_RESOLUTION_HOLDING : DYNAMIC_RESOLUTION_OFF;
+    controller.scale       = DYNAMIC_RESOLUTION_MAX_SCALE;
+    controller.target_ms   = target_ms;
+    controller.smoothed_ms = 0.0;
+    frames_measured        = 0;
+
+    return scaling_on;
+}
+
+/**
+ * @brief Checks if the resolution scaling is enabled.
+ *
+ * @return int Returns 1 if enabled, 0 otherwise.
+ */
+int dynamic_resolution_enabled(void)
+{
+    return scaling_on;
+}
+
+/**
+ * @brief Starts measuring a frame and binds the target it is drawn into.
+ *
+ * @param width  Window width in pixels.
+ * @param height Window height in pixels.
+ */
+void dynamic_resolution_begin_frame(int width, int height)
+{
+    output_width     = width;
+    output_height    = height;
+    frame_redirected = 0;
+
+    controller.width  = width;
+    controller.height = height;
+
+    if (!scaling_on)
+    {
+        return;
+    }
+
+    frame_start_ms = timer_now_ms();
+
+    if (controller.scale >= DYNAMIC_RESOLUTION_MAX_SCALE || width <= 0 || height <= 0)
+    {
+        return;
+    }
+
+    // The window is framebuffer 0, headless rendering has its own target.
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &output_framebuffer);
+
+    if ((width != target_width || height != target_height) &&
+        !create_target(width, height))
+    {
+        dynamic_resolution_enable(0, controller.target_ms);
+        return;
+    }
+
+    controller.width  = scaled_size(width, controller.scale);
+    controller.height = scaled_size(height, controller.scale);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glViewport(0, 0, controller.width, controller.height);
+    glScissor(0, 0, controller.width, controller.height);
+    glEnable(GL_SCISSOR_TEST);
+    frame_redirected = 1;
+}
+
+/**
+ * @brief Upscales the frame into the window and adjusts the scale.
+ *
+ * The frame is finished before it is measured, so the rasterization an
+ * implementation defers until the swap is counted, and the controller
+ * sees the same cost with and without vertical sync.
+ */
+void dynamic_resolution_end_frame(void)
+{
+    if (frame_redirected)
+    {
+        // Blits are clipped by the scissor box.
+        glDisable(GL_SCISSOR_TEST);
+
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, (GLuint)output_framebuffer);
+        glBlitFramebuffer(
+            0, 0, controller.width, controller.height,
+            0, 0, output_width, output_height,
+            GL_COLOR_BUFFER_BIT,
+            GL_LINEAR
+        );
+        glBindFramebuffer(GL_FRAMEBUFFER, (GLuint)output_framebuffer);
+        glViewport(0, 0, output_width, output_height);
+        frame_redirected = 0;
+    }
+
+    if (!scaling_on)
+    {
+        return;
+    }
+
+    glFinish();
+    update_controller(timer_now_ms() - frame_start_ms);
+}
+
+/**
+ * @brief Returns the fraction of the window width and height drawn this frame.
+ *
+ * @return GLfloat The scale, 1 while the scaling is disabled.
+ */
+GLfloat dynamic_resolution_scale(void)
+{
+    return scaling_on ? controller.scale : DYNAMIC_RESOLUTION_MAX_SCALE;
+}
+
+/**
+ * @brief Copies the current scale and controller state.
+ *
+ * @param status Output status.
+ */
+void dynamic_resolution_get_status(dynamic_resolution_status* status)
+{
+    *status = controller;
+}
+
+/**
+ * @brief Returns a readable name of a controller state.
+ *
+ * @param state The controller state.
+ * @return const char* Name of the state.
+ */
+const char* dynamic_resolution_state_name(dynamic_resolution_state state)
+{
+    switch (state)
+    {
+    case DYNAMIC_RESOLUTION_OFF:
+        return "off";
+
+    case DYNAMIC_RESOLUTION_HOLDING:
+        return "holding";
+
+    case DYNAMIC_RESOLUTION_LOWERING:
+        return "lowering";
+
+    case DYNAMIC_RESOLUTION_RAISING:
+        return "raising";
+
+    default:
+        return "unknown";
+    }
+}
+
+/**
+ * @brief Frees the offscreen target.
+ */
+void dynamic_resolution_cleanup(void)
+{
+    if (gl_extensions.framebuffer_objects)
+    {
+        destroy_target();
+    }
+    scaling_on   = 0;
+    controller.state = DYNAMIC_RESOLUTION_OFF;
+}
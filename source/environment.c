@@ -2,36 +2,360 @@
  * @file environment.c
  * @brief Implementation of environment initialization functions.
  *
- * Creates quadric objects and loads environment textures.
+ * Tessellates the floor and walls and loads environment
+ * textures. The surfaces follow the vertex layout, normals and texture
+ * coordinates of gluDisk and gluCylinder, so they look the
+ * same as the quadrics did, but are built once instead of every frame.
  */
 
 
 #include "environment.h"
 
+#include "gl_extensions.h"
+#include "gl_trace.h"
 #include "texture.h"
 
-#include <GL/glu.h>
+#include <math.h>
+#include <stddef.h>
+#include <stdlib.h>
 
 
-GLUquadric* quadric_environment;    // quadric object used for floor and walls
-GLuint      texture_id_environment; // texture ID for environment surface
-GLUquadric* quadric_origin_sphere;  // quadric object for rendering origin sphere
+GLuint              texture_id_environment;           // texture ID for environment surface
+environment_surface environment_floor      = { 0 };  // floor disk, one unit wider than the walls
+environment_surface environment_walls      = { 0 };  // cylindrical walls, one unit higher than the environment
 
 
 /**
- * @brief Initialize environment quadrics and textures.
+ * @brief Frees the arrays and buffer objects of a surface.
  *
- * Creates new quadrics for the environment and origin sphere,
- * enables texture mapping on the environment quadric,
- * and loads the sand texture for the environment floor and walls.
+ * @param surface The surface to free.
  */
-void environment_initialize(void)
+static void free_surface(environment_surface* surface)
+{
+    free(surface->vertices);
+    free(surface->indices);
+
+    if (surface->vertex_buffer != 0)
+    {
+        glDeleteBuffers(1, &surface->vertex_buffer);
+        glDeleteBuffers(1, &surface->index_buffer);
+    }
+    if (surface->vertex_array != 0)
+    {
+        glDeleteVertexArrays(1, &surface->vertex_array);
+    }
+    if (surface->display_list != 0)
+    {
+        glDeleteLists(surface->display_list, 1);
+    }
+
+    const environment_surface empty = { 0 };
+    *surface = empty;
+}
+
+/**
+ * @brief Allocates the arrays of a surface.
+ *
+ * @param surface      The surface, freed before.
+ * @param vertex_count Number of vertices.
+ * @param index_count  Number of indices.
+ * @return int Returns 1 on success, 0 if out of memory.
+ */
+static int allocate_surface(environment_surface* surface, int vertex_count, int index_count)
+{
+    surface->vertices = calloc((size_t)vertex_count, sizeof(environment_vertex));
+    surface->indices  = malloc((size_t)index_count * sizeof(GLushort));
+    if (surface->vertices == NULL || surface->indices == NULL)
+    {
+        free_surface(surface);
+        return 0;
+    }
+
+    surface->vertex_count = vertex_count;
+    surface->index_count  = 0;
+    return 1;
+}
+
+/**
+ * @brief Uploads a surface into vertex and index buffer objects if supported.
+ *
+ * @param surface The tessellated surface.
+ */
+static void upload_surface(environment_surface* surface)
+{
+    if (!gl_extensions.vertex_buffer_objects || surface->vertices == NULL)
+    {
+        return;
+    }
+
+    glGenBuffers(1, &surface->vertex_buffer);
+    glBindBuffer(GL_ARRAY_BUFFER, surface->vertex_buffer);
+    glBufferData(
+        GL_ARRAY_BUFFER,
+        sizeof(environment_vertex) * surface->vertex_count,
+        surface->vertices,
+        GL_STATIC_DRAW
+    );
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    glGenBuffers(1, &surface->index_buffer);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, surface->index_buffer);
+    glBufferData(
+        GL_ELEMENT_ARRAY_BUFFER,
+        sizeof(GLushort) * surface->index_count,
+        surface->indices,
+        GL_STATIC_DRAW
+    );
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+}
+
+/**
+ * @brief Sets a vertex of a surface.
+ */
+static void set_vertex(
+    environment_vertex* vertex,
+    GLfloat x, GLfloat y, GLfloat z,
+    GLfloat normal_x, GLfloat normal_y, GLfloat normal_z,
+    GLfloat s, GLfloat t
+)
+{
+    vertex->position[0] = x;
+    vertex->position[1] = y;
+    vertex->position[2] = z;
+    vertex->normal[0]   = normal_x;
+    vertex->normal[1]   = normal_y;
+    vertex->normal[2]   = normal_z;
+    vertex->texcoord[0] = s;
+    vertex->texcoord[1] = t;
+}
+
+/**
+ * @brief Appends one triangle to the indices of a surface.
+ */
+static void add_triangle(environment_surface* surface, int a, int b, int c)
+{
+    surface->indices[surface->index_count++] = (GLushort)a;
+    surface->indices[surface->index_count++] = (GLushort)b;
+    surface->indices[surface->index_count++] = (GLushort)c;
+}
+
+/**
+ * @brief Appends the triangles of a GLU quad strip between two rings.
+ *
+ * Rings hold ENVIRONMENT_SLICES + 1 vertices. The strip alternates
+ * between the first and the second ring, starting with the first.
+ *
+ * @param surface The surface.
+ * @param first   Index of the first vertex of the first ring.
+ * @param second  Index of the first vertex of the second ring.
+ */
+static void add_band(environment_surface* surface, int first, int second)
 {
-    quadric_environment = gluNewQuadric();
-    gluQuadricTexture(quadric_environment, GL_TRUE);
+    for (int i = 0; i < ENVIRONMENT_SLICES; ++i)
+    {
+        add_triangle(surface, first + i, second + i, first + i + 1);
+        add_triangle(surface, first + i + 1, second + i, second + i + 1);
+    }
+}
 
-    texture_id_environment = 
+/**
+ * @brief Calculates the sines and cosines of the slice angles.
+ *
+ * The last slice repeats the first one, so rings close exactly.
+ */
+static void calculate_slice_angles(GLfloat sines[], GLfloat cosines[])
+{
+    for (int i = 0; i < ENVIRONMENT_SLICES; ++i)
+    {
+        const GLfloat angle = 2.0f * PI * i / ENVIRONMENT_SLICES;
+        sines[i]   = sinf(angle);
+        cosines[i] = cosf(angle);
+    }
+    sines[ENVIRONMENT_SLICES]   = sines[0];
+    cosines[ENVIRONMENT_SLICES] = cosines[0];
+}
+
+/**
+ * @brief Tessellates a disk in the z = 0 plane facing +z, like gluDisk.
+ *
+ * The rings run from the rim inwards and the innermost ring is closed
+ * with a fan around the center. Texture coordinates map the diameter
+ * of the disk to the texture once.
+ *
+ * @param surface The surface, freed before.
+ * @param radius  Radius of the disk.
+ */
+static void tessellate_disk(environment_surface* surface, GLfloat radius)
+{
+    const int ring_size = ENVIRONMENT_SLICES + 1;
+    if (!allocate_surface(
+        surface,
+        1 + ENVIRONMENT_STACKS * ring_size,
+        ((ENVIRONMENT_STACKS - 1) * 6 + 3) * ENVIRONMENT_SLICES
+    ))
+    {
+        return;
+    }
+
+    GLfloat sines[ENVIRONMENT_SLICES + 1];
+    GLfloat cosines[ENVIRONMENT_SLICES + 1];
+    calculate_slice_angles(sines, cosines);
+
+    for (int j = 0; j < ENVIRONMENT_STACKS; ++j)
+    {
+        const GLfloat ring_radius = radius - radius * ((GLfloat)j / ENVIRONMENT_STACKS);
+        const GLfloat texture_radius = ring_radius / radius / 2.0f;
+
+        for (int i = 0; i <= ENVIRONMENT_SLICES; ++i)
+        {
+            set_vertex(
+                &surface->vertices[1 + j * ring_size + i],
+                ring_radius * sines[i], ring_radius * cosines[i], 0.0f,
+                0.0f, 0.0f, 1.0f,
+                texture_radius * sines[i] + 0.5f, texture_radius * cosines[i] + 0.5f
+            );
+        }
+    }
+    set_vertex(&surface->vertices[0], 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.5f, 0.5f);
+
+    for (int j = 0; j < ENVIRONMENT_STACKS - 1; ++j)
+    {
+        add_band(surface, 1 + j * ring_size, 1 + (j + 1) * ring_size);
+    }
+
+    // Fan around the center, wound like the rings.
+    const int inner_ring = 1 + (ENVIRONMENT_STACKS - 1) * ring_size;
+    for (int i = ENVIRONMENT_SLICES; i > 0; --i)
+    {
+        add_triangle(surface, 0, inner_ring + i, inner_ring + i - 1);
+    }
+}
+
+/**
+ * @brief Tessellates an open cylinder around the z axis from z = 0, like gluCylinder.
+ *
+ * Texture coordinates map the circumference and the height of the
+ * cylinder to the texture once.
+ *
+ * @param surface The surface, freed before.
+ * @param radius  Radius of the cylinder.
+ * @param height  Height of the cylinder.
+ */
+static void tessellate_cylinder(environment_surface* surface, GLfloat radius, GLfloat height)
+{
+    const int ring_size = ENVIRONMENT_SLICES + 1;
+    if (!allocate_surface(
+        surface,
+        (ENVIRONMENT_STACKS + 1) * ring_size,
+        ENVIRONMENT_STACKS * ENVIRONMENT_SLICES * 6
+    ))
+    {
+        return;
+    }
+
+    GLfloat sines[ENVIRONMENT_SLICES + 1];
+    GLfloat cosines[ENVIRONMENT_SLICES + 1];
+    calculate_slice_angles(sines, cosines);
+
+    for (int j = 0; j <= ENVIRONMENT_STACKS; ++j)
+    {
+        const GLfloat z = j * height / ENVIRONMENT_STACKS;
+
+        for (int i = 0; i <= ENVIRONMENT_SLICES; ++i)
+        {
+            set_vertex(
+                &surface->vertices[j * ring_size + i],
+                radius * sines[i], radius * cosines[i], z,
+                sines[i], cosines[i], 0.0f,
+                1.0f - (GLfloat)i / ENVIRONMENT_SLICES, (GLfloat)j / ENVIRONMENT_STACKS
+            );
+        }
+    }
+
+    for (int j = 0; j < ENVIRONMENT_STACKS; ++j)
+    {
+        add_band(surface, j * ring_size, (j + 1) * ring_size);
+    }
+}
+
+/**
+ * @brief Initialize environment surfaces and textures.
+ *
+ * Tessellates the floor and walls, uploading them
+ * into buffer objects if supported, and loads the sand texture for
+ * the environment floor and walls.
+ */
+void environment_initialize(void)
+{
+    texture_id_environment =
         texture_create_from_file("resources/assets/textures/sand.jpg");
 
-    quadric_origin_sphere = gluNewQuadric();
+    tessellate_disk(&environment_floor, (GLfloat)ENVIRONMENT_RADIUS_XZ + 1.0f);
+    tessellate_cylinder(
+        &environment_walls,
+        (GLfloat)ENVIRONMENT_RADIUS_XZ,
+        (GLfloat)ENVIRONMENT_HEIGHT + 1.0f
+    );
+    upload_surface(&environment_floor);
+    upload_surface(&environment_walls);
+}
+
+/**
+ * @brief Draws a surface as indexed triangles with a single draw call.
+ *
+ * @param surface     The surface to draw.
+ * @param use_buffers 1 to draw from buffer objects if uploaded, 0 to draw from client memory.
+ */
+void environment_draw_surface(const environment_surface* surface, int use_buffers)
+{
+    if (surface->vertices == NULL)
+    {
+        return;
+    }
+
+    const char*     vertices = (const char*)surface->vertices;
+    const GLushort* indices  = surface->indices;
+
+    use_buffers = use_buffers && surface->vertex_buffer != 0;
+    if (use_buffers)
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, surface->vertex_buffer);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, surface->index_buffer);
+        vertices = NULL;
+        indices  = NULL;
+    }
+
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_NORMAL_ARRAY);
+    glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+    glVertexPointer(
+        3, GL_FLOAT, sizeof(environment_vertex), vertices + offsetof(environment_vertex, position)
+    );
+    glNormalPointer(
+        GL_FLOAT, sizeof(environment_vertex), vertices + offsetof(environment_vertex, normal)
+    );
+    glTexCoordPointer(
+        2, GL_FLOAT, sizeof(environment_vertex), vertices + offsetof(environment_vertex, texcoord)
+    );
+
+    glDrawElements(GL_TRIANGLES, surface->index_count, GL_UNSIGNED_SHORT, indices);
+
+    glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+    glDisableClientState(GL_NORMAL_ARRAY);
+    glDisableClientState(GL_VERTEX_ARRAY);
+
+    if (use_buffers)
+    {
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+}
+
+/**
+ * @brief Frees the surfaces and their buffer objects.
+ */
+void environment_cleanup(void)
+{
+    free_surface(&environment_floor);
+    free_surface(&environment_walls);
 }
@@ -0,0 +1,172 @@
+/**
+ * @file frame_pacing.c
+ * @brief Implements the frame limiter and the idle loop of the window.
+ */
+
+
+#include "frame_pacing.h"
+
+#include "gl_extensions.h"
+#include "timer.h"
+
+#include <stdio.h>
+
+
+static frame_pacing_stats pacing = {  // settings and counters since startup
+    0.0,
+    FRAME_PACING_SWAP_DRIVER,
+    0,
+    1,
+    0,
+    0,
+    0.0,
+    0.0
+};
+
+static double   start_ms        = 0.0;  // time the pacing started
+static double   next_frame_ms   = 0.0;  // time the next frame is due
+static double   frame_period_ms = 0.0;  // time between frames, 0 without a limit
+static unsigned drawn_step      = 0;    // simulation step of the last drawn frame
+static int      frame_requested = 1;    // 1 if the next frame is drawn even if the step is unchanged
+
+
+/**
+ * @brief Sleeps until a time and counts the time slept.
+ *
+ * @param deadline_ms Time of timer_now_ms to wake up at.
+ */
+static void sleep_until(double deadline_ms)
+{
+    const double before_ms = timer_now_ms();
+    if (deadline_ms <= before_ms)
+    {
+        return;
+    }
+
+    timer_sleep_until_ms(deadline_ms);
+    pacing.asleep_ms += timer_now_ms() - before_ms;
+}
+
+/**
+ * @brief Sets the frame rate limit, the vertical sync and the idle mode.
+ *
+ * @param target_fps     Frames per second at most, 0 for no limit.
+ * @param swap_interval  Vertical blanks per swap, 0 for no vertical sync,
+ *                       FRAME_PACING_SWAP_DRIVER to keep the driver setting.
+ * @param idle_unchanged 1 to skip frames while nothing changed, 0 to draw all.
+ */
+void frame_pacing_initialize(double target_fps, int swap_interval, int idle_unchanged)
+{
+    pacing.target_fps     = target_fps > 0.0 ? target_fps : 0.0;
+    pacing.swap_interval  = FRAME_PACING_SWAP_DRIVER;
+    pacing.idle_unchanged = idle_unchanged;
+    pacing.frames_drawn   = 0;
+    pacing.frames_skipped = 0;
+    pacing.asleep_ms      = 0.0;
+    pacing.elapsed_ms     = 0.0;
+
+    if (swap_interval != FRAME_PACING_SWAP_DRIVER)
+    {
+        if (gl_extensions.swap_control && gl_extensions_swap_interval(swap_interval))
+        {
+            pacing.swap_interval = swap_interval;
+        }
+        else
+        {
+            printf("The swap interval cannot be set, vertical sync is left to the driver.\n\n");
+        }
+    }
+
+    frame_period_ms = pacing.target_fps > 0.0 ? 1000.0 / pacing.target_fps : 0.0;
+    start_ms        = timer_now_ms();
+    next_frame_ms   = start_ms;
+    frame_requested = 1;
+}
+
+/**
+ * @brief Sleeps until the next frame is due and decides if it is drawn.
+ *
+ * Deadlines advance by the frame period, so the rate holds even if a
+ * single frame wakes up late. A loop that fell more than a period
+ * behind restarts from the current time instead of drawing the missed
+ * frames back to back.
+ *
+ * @param step Simulation step of the latest snapshot.
+ * @return int Returns 1 if a frame should be drawn now, 0 to ask again later.
+ */
+int frame_pacing_wait(unsigned step)
+{
+    pacing.elapsed_ms = timer_now_ms() - start_ms;
+
+    if (!pacing.visible)
+    {
+        ++pacing.frames_skipped;
+        sleep_until(timer_now_ms() + FRAME_PACING_HIDDEN_POLL_MS);
+        return 0;
+    }
+
+    // Nothing to show yet, check again soon without waiting a whole period.
+    if (pacing.idle_unchanged && !frame_requested && step == drawn_step)
+    {
+        ++pacing.frames_skipped;
+        sleep_until(timer_now_ms() + FRAME_PACING_IDLE_POLL_MS);
+        return 0;
+    }
+
+    if (frame_period_ms > 0.0)
+    {
+        sleep_until(next_frame_ms);
+
+        const double now_ms = timer_now_ms();
+        next_frame_ms += frame_period_ms;
+        if (now_ms - next_frame_ms > frame_period_ms)
+        {
+            next_frame_ms = now_ms + frame_period_ms;
+        }
+    }
+    return 1;
+}
+
+/**
+ * @brief Records the simulation step a frame was drawn from.
+ *
+ * @param step Simulation step of the drawn snapshot.
+ */
+void frame_pacing_frame_drawn(unsigned step)
+{
+    drawn_step      = step;
+    frame_requested = 0;
+    ++pacing.frames_drawn;
+}
+
+/**
+ * @brief Requests a frame for a change outside the simulation.
+ */
+void frame_pacing_invalidate(void)
+{
+    frame_requested = 1;
+}
+
+/**
+ * @brief Tells the pacing if the window can be seen.
+ *
+ * @param visible 1 if any part of the window is shown, 0 if it is hidden or minimized.
+ */
+void frame_pacing_set_visible(int visible)
+{
+    pacing.visible = visible;
+    if (visible)
+    {
+        frame_requested = 1;
+    }
+}
+
+/**
+ * @brief Copies the counters of the pacing.
+ *
+ * @param stats Output counters.
+ */
+void frame_pacing_get_stats(frame_pacing_stats* stats)
+{
+    *stats = pacing;
+}
@@ -0,0 +1,351 @@
+/**
+ * @file frame_stats.c
+ * @brief Implements frame timing and the render path comparison mode.
+ */
+
+
+#include "frame_stats.h"
+
+#include "capture.h"
+#include "dynamic_resolution.h"
+#include "frame_pacing.h"
+#include "gl_trace.h"
+#include "options.h"
+#include "renderer.h"
+#include "texture.h"
+#include "timer.h"
+
+#include <GL/freeglut.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+
+frame_stats current_frame_stats = { .record_threads = 1 };  // statistics of the last rendered frame.
+int         comparison_on       = 0;                         // starts as zero until comparison is turned on by user.
+
+static double      frame_start_ms           = 0.0;                    // time the current frame started
+static double      comparison_total_ms      = 0.0;                    // time accumulated on the measured path
+static int         comparison_frame_count   = 0;                      // frames measured on the measured path
+static double      comparison_average_ms[RENDER_PATH_COUNT];          // last average of each path
+static render_path path_before_comparison   = RENDER_PATH_IMMEDIATE;  // path restored when comparison ends
+
+
+/**
+ * @brief Returns the next supported render path after the given one.
+ */
+static render_path next_supported_path(const render_path path)
+{
+    render_path next = path;
+    do
+    {
+        next = (render_path)((next + 1) % RENDER_PATH_COUNT);
+    } while (!renderer_path_supported(next));
+
+    return next;
+}
+
+/**
+ * @brief Orders frame times ascending for qsort.
+ */
+static int compare_times(const void* a, const void* b)
+{
+    const double time_a = *(const double*)a;
+    const double time_b = *(const double*)b;
+    return (time_a > time_b) - (time_a < time_b);
+}
+
+/**
+ * @brief Prints the averages of all measured paths relative to immediate mode.
+ */
+static void print_comparison(void)
+{
+    printf("Render path comparison\n");
+    printf("-------------------\n");
+
+    for (int i = 0; i < RENDER_PATH_COUNT; ++i)
+    {
+        if (comparison_average_ms[i] <= 0.0)
+        {
+            continue;
+        }
+
+        printf(
+            "%s:\t%.3f ms/frame",
+            renderer_path_name((render_path)i),
+            comparison_average_ms[i]
+        );
+        if (i != RENDER_PATH_IMMEDIATE &&
+            comparison_average_ms[RENDER_PATH_IMMEDIATE] > 0.0)
+        {
+            printf(
+                " (%.1fx faster than immediate)",
+                comparison_average_ms[RENDER_PATH_IMMEDIATE] /
+                comparison_average_ms[i]
+            );
+        }
+        printf("\n");
+    }
+    printf("\n");
+}
+
+/**
+ * @brief Marks the start of a rendered frame.
+ */
+void frame_stats_begin_frame(void)
+{
+    frame_start_ms = timer_now_ms();
+}
+
+/**
+ * @brief Marks the end of a rendered frame and records its statistics.
+ *
+ * In comparison mode, once enough frames were measured on the current
+ * path, its average is recorded and the next supported path is measured.
+ */
+void frame_stats_end_frame(void)
+{
+    if (comparison_on)
+    {
+        glFinish();
+    }
+
+    current_frame_stats.frame_time_ms = timer_now_ms() - frame_start_ms;
+
+    if (!comparison_on)
+    {
+        return;
+    }
+
+    comparison_total_ms += current_frame_stats.frame_time_ms;
+    if (++comparison_frame_count < FRAME_STATS_COMPARISON_FRAMES)
+    {
+        return;
+    }
+
+    comparison_average_ms[mesh_render_path] =
+        comparison_total_ms / comparison_frame_count;
+    comparison_total_ms    = 0.0;
+    comparison_frame_count = 0;
+
+    mesh_render_path = next_supported_path(mesh_render_path);
+    if (mesh_render_path == RENDER_PATH_IMMEDIATE)
+    {
+        print_comparison();
+    }
+}
+
+/**
+ * @brief Prints the statistics of the last rendered frame to the console.
+ *
+ * Ends with the OpenGL calls of every render pass.
+ */
+void frame_stats_print(void)
+{
+    printf(
+        "Frame statistics (%s backend, %s)\n",
+        renderer_backend_name(renderer_backend),
+        renderer_backend == RENDER_BACKEND_FIXED ? renderer_path_name(mesh_render_path) : "no render paths"
+    );
+    printf("-------------------\n");
+    printf("frame time:\t%.3f ms\n", current_frame_stats.frame_time_ms);
+    printf(
+        "culling:\t%d visible, %d outside the frustum, %d hidden by fog in %.4f ms%s\n",
+        current_frame_stats.objects_visible,
+        current_frame_stats.objects_culled,
+        current_frame_stats.objects_fog_culled,
+        current_frame_stats.culling_time_ms,
+        culling_on ? "" : " (off)"
+    );
+    printf(
+        "occlusion:\t%d hidden by %d occluders (%d triangles rasterized in %.4f ms)%s\n",
+        current_frame_stats.objects_occluded,
+        current_frame_stats.occluders_rasterized,
+        current_frame_stats.occluder_triangles,
+        current_frame_stats.occlusion_raster_time_ms,
+        culling_on && occlusion_on ? "" : " (off)"
+    );
+    printf(
+        "detail:\t\t%d objects simplified by fog (density %.3f)\n",
+        current_frame_stats.objects_simplified,
+        fog_density
+    );
+    printf(
+        "state:\t\t%d calls issued, %d skipped\n",
+        current_frame_stats.state_calls_issued,
+        current_frame_stats.state_calls_skipped
+    );
+    printf("draw calls:\t%d\n", current_frame_stats.draw_calls);
+
+    texture_streaming_stats textures;
+    texture_get_streaming_stats(&textures);
+    printf(
+        "textures:\t%d mip levels resident, %zu of %zu bytes, %d streamed in, %d evicted\n",
+        textures.resident_levels,
+        textures.resident_bytes,
+        textures.budget_bytes,
+        textures.levels_streamed,
+        textures.levels_evicted
+    );
+    printf(
+        "recording:\t%.4f ms on %d thread%s\n",
+        current_frame_stats.record_time_ms,
+        current_frame_stats.record_threads,
+        current_frame_stats.record_threads == 1 ? "" : "s"
+    );
+    printf(
+        "boids:		%d pyramids, %d impostors beyond %.1f%s\n",
+        current_frame_stats.boid_pyramids,
+        current_frame_stats.boid_impostors,
+        main_options.impostor_distance,
+        main_options.impostor_distance > 0.0 ? "" : " (off)"
+    );
+    printf(
+        "lights:\t\t%d of %d point lights in view, %d cluster entries in %.4f ms%s\n",
+        current_frame_stats.point_lights,
+        main_options.point_lights,
+        current_frame_stats.light_cluster_refs,
+        current_frame_stats.light_assign_time_ms,
+        renderer_backend != RENDER_BACKEND_CORE && main_options.point_lights > 0 ? " (not shaded)" : ""
+    );
+    if (renderer_backend == RENDER_BACKEND_SOFTWARE)
+    {
+        printf(
+            "raster:\t\t%d triangles, %d fragments in %.4f ms on %d thread%s\n",
+            current_frame_stats.raster_triangles,
+            current_frame_stats.raster_fragments,
+            current_frame_stats.raster_time_ms,
+            current_frame_stats.raster_threads,
+            current_frame_stats.raster_threads == 1 ? "" : "s"
+        );
+    }
+
+    frame_pacing_stats pacing;
+    frame_pacing_get_stats(&pacing);
+    char limit[32] = "no frame limit";
+    if (pacing.target_fps > 0.0)
+    {
+        (void)sprintf_s(limit, sizeof(limit), "%.0f fps limit", pacing.target_fps);
+    }
+    printf(
+        "pacing:\t\t%s, vsync %s, idle %s, %ld frames drawn, %ld checks skipped, %.0f%% of %.1f s asleep\n",
+        limit,
+        pacing.swap_interval == FRAME_PACING_SWAP_DRIVER ? "by driver" : (pacing.swap_interval > 0 ? "on" : "off"),
+        pacing.idle_unchanged ? "when unchanged" : "off",
+        pacing.frames_drawn,
+        pacing.frames_skipped,
+        pacing.elapsed_ms > 0.0 ? pacing.asleep_ms / pacing.elapsed_ms * 100.0 : 0.0,
+        pacing.elapsed_ms / 1000.0
+    );
+
+    if (capture_active())
+    {
+        capture_stats capture;
+        capture_get_stats(&capture);
+        printf(
+            "capture:\t%.3f ms on the render thread (%.3f ms mean), %d read, %d written, %d dropped\n",
+            capture.last_overhead_ms,
+            capture.frames_read > 0 ? capture.total_overhead_ms / capture.frames_read : 0.0,
+            capture.frames_read,
+            capture.frames_written,
+            capture.frames_dropped
+        );
+    }
+
+    dynamic_resolution_status resolution;
+    dynamic_resolution_get_status(&resolution);
+    if (dynamic_resolution_enabled())
+    {
+        printf(
+            "resolution:\t%dx%d (%.0f%% next frame), %s at %.3f ms for a %.3f ms target\n\n",
+            current_frame_stats.resolution_width,
+            current_frame_stats.resolution_height,
+            resolution.scale * 100.0f,
+            dynamic_resolution_state_name(resolution.state),
+            resolution.smoothed_ms,
+            resolution.target_ms
+        );
+    }
+    else
+    {
+        printf(
+            "resolution:\t%dx%d (dynamic resolution off)\n\n",
+            current_frame_stats.resolution_width,
+            current_frame_stats.resolution_height
+        );
+    }
+
+    gl_trace_print();
+}
+
+/**
+ * @brief Toggles the render path comparison mode.
+ */
+void frame_stats_toggle_comparison(void)
+{
+    if (renderer_backend != RENDER_BACKEND_FIXED)
+    {
+        printf(
+            "The %s backend has no render paths, compare it by running --backend=%s and --backend=%s.\n\n",
+            renderer_backend_name(renderer_backend),
+            renderer_backend_name(RENDER_BACKEND_FIXED),
+            renderer_backend_name(renderer_backend)
+        );
+        return;
+    }
+
+    comparison_on = !comparison_on;
+
+    if (comparison_on)
+    {
+        path_before_comparison = mesh_render_path;
+        mesh_render_path       = RENDER_PATH_IMMEDIATE;
+        comparison_total_ms    = 0.0;
+        comparison_frame_count = 0;
+        for (int i = 0; i < RENDER_PATH_COUNT; ++i)
+        {
+            comparison_average_ms[i] = 0.0;
+        }
+
+        printf(
+            "Comparing render paths over %d frames each...\n\n",
+            FRAME_STATS_COMPARISON_FRAMES
+        );
+    }
+    else
+    {
+        mesh_render_path = path_before_comparison;
+    }
+}
+
+/**
+ * @brief Sorts frame times ascending.
+ *
+ * @param times Frame times in milliseconds, sorted in place.
+ * @param count Number of frame times.
+ */
+void frame_stats_sort_times(double* times, int count)
+{
+    qsort(times, (size_t)count, sizeof(double), compare_times);
+}
+
+/**
+ * @brief Returns a percentile of sorted frame times by the nearest rank.
+ *
+ * @param sorted     Frame times in ascending order.
+ * @param count      Number of frame times.
+ * @param percentile Percentile between 0 and 100.
+ * @return double The frame time at that percentile.
+ */
+double frame_stats_percentile(const double* sorted, int count, double percentile)
+{
+    int rank = (int)(percentile / 100.0 * count + 0.999999);
+    if (rank < 1)
+    {
+        rank = 1;
+    }
+    if (rank > count)
+    {
+        rank = count;
+    }
+    return sorted[rank - 1];
+}
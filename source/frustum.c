@@ -0,0 +1,213 @@
+/**
+ * @file frustum.c
+ * @brief Implements frustum plane extraction and batched sphere tests.
+ */
+
+
+#include "frustum.h"
+
+#include <math.h>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define FRUSTUM_SSE 1
+#include <xmmintrin.h>
+#else
+#define FRUSTUM_SSE 0
+#endif
+
+
+/**
+ * @brief Extracts the frustum from the camera matrices.
+ *
+ * The rows of clip = projection * view give the planes as sums and
+ * differences of the fourth row with the first three (Gribb/Hartmann).
+ *
+ * @param frustum    Output frustum in world space.
+ * @param projection Column-major projection matrix.
+ * @param view       Column-major view matrix.
+ */
+void frustum_extract(frustum* frustum, const GLfloat projection[16], const GLfloat view[16])
+{
+    GLfloat clip[16];
+    geometry_multiply_matrices(projection, view, clip);
+
+    for (int i = 0; i < FRUSTUM_PLANE_COUNT; ++i)
+    {
+        const int     row   = i / 2;                        // x, y or z row of clip
+        const GLfloat sign  = (i % 2 == 0) ? 1.0f : -1.0f;  // left, bottom and near add the row
+        GLfloat*      plane = frustum->planes[i];
+
+        for (int k = 0; k < 4; ++k)
+        {
+            plane[k] = clip[k * 4 + 3] + sign * clip[k * 4 + row];
+        }
+
+        const GLfloat length = 
+            sqrtf(plane[0] * plane[0] + plane[1] * plane[1] + plane[2] * plane[2]);
+        for (int k = 0; k < 4; ++k)
+        {
+            plane[k] /= length;
+        }
+    }
+}
+
+/**
+ * @brief Tests one bounding sphere against all planes.
+ *
+ * @return int 1 if the sphere intersects the frustum, 0 otherwise.
+ */
+static int test_sphere(
+    const frustum* frustum,
+    GLfloat        x,
+    GLfloat        y,
+    GLfloat        z,
+    GLfloat        radius
+)
+{
+    for (int i = 0; i < FRUSTUM_PLANE_COUNT; ++i)
+    {
+        const GLfloat* plane = frustum->planes[i];
+        if (plane[0] * x + plane[1] * y + plane[2] * z + plane[3] < -radius)
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * @brief Tests a batch of bounding spheres against the frustum.
+ *
+ * With SSE, four spheres are tested against each plane at once and
+ * the remaining spheres are tested one by one.
+ *
+ * @param frustum  The frustum.
+ * @param center_x X coordinates of the sphere centers.
+ * @param center_y Y coordinates of the sphere centers.
+ * @param center_z Z coordinates of the sphere centers.
+ * @param radius   Radii of the spheres.
+ * @param count    Number of spheres.
+ * @param visible  Output, 1 for every sphere intersecting the frustum, 0 otherwise.
+ * @return int Number of visible spheres.
+ */
+int frustum_test_spheres(
+    const frustum*       frustum,
+    const GLfloat*       center_x,
+    const GLfloat*       center_y,
+    const GLfloat*       center_z,
+    const GLfloat*       radius,
+          int            count,
+          unsigned char* visible
+)
+{
+    int visible_count = 0;
+    int i = 0;
+
+#if FRUSTUM_SSE
+    for (; i + 4 <= count; i += 4)
+    {
+        const __m128 x          = _mm_loadu_ps(center_x + i);
+        const __m128 y          = _mm_loadu_ps(center_y + i);
+        const __m128 z          = _mm_loadu_ps(center_z + i);
+        const __m128 negative_r = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(radius + i));
+
+        __m128 inside = _mm_cmpeq_ps(x, x);  // all lanes set.
+        for (int p = 0; p < FRUSTUM_PLANE_COUNT; ++p)
+        {
+            const GLfloat* plane = frustum->planes[p];
+
+            __m128 distance = _mm_add_ps(
+                _mm_add_ps(
+                    _mm_mul_ps(x, _mm_set1_ps(plane[0])),
+                    _mm_mul_ps(y, _mm_set1_ps(plane[1]))
+                ),
+                _mm_add_ps(
+                    _mm_mul_ps(z, _mm_set1_ps(plane[2])),
+                    _mm_set1_ps(plane[3])
+                )
+            );
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negative_r));
+        }
+
+        const int mask = _mm_movemask_ps(inside);
+        for (int lane = 0; lane < 4; ++lane)
+        {
+            visible[i + lane] = (unsigned char)((mask >> lane) & 1);
+            visible_count    += visible[i + lane];
+        }
+    }
+#endif
+
+    for (; i < count; ++i)
+    {
+        visible[i] = (unsigned char)test_sphere(
+            frustum, center_x[i], center_y[i], center_z[i], radius[i]
+        );
+        visible_count += visible[i];
+    }
+
+    return visible_count;
+}
+
+/**
+ * @brief Calculates the nearest view depth of a batch of bounding spheres.
+ *
+ * The near plane normal is the view direction, so the depth of a center
+ * is the near plane distance shifted to the eye.
+ *
+ * @param frustum  The frustum.
+ * @param eye      Position of the camera.
+ * @param center_x X coordinates of the sphere centers.
+ * @param center_y Y coordinates of the sphere centers.
+ * @param center_z Z coordinates of the sphere centers.
+ * @param radius   Radii of the spheres.
+ * @param count    Number of spheres.
+ * @param depth    Output nearest depth of every sphere.
+ */
+void frustum_nearest_depths(
+    const frustum*  frustum,
+    const point_3d  eye,
+    const GLfloat*  center_x,
+    const GLfloat*  center_y,
+    const GLfloat*  center_z,
+    const GLfloat*  radius,
+          int       count,
+          GLfloat*  depth
+)
+{
+    const GLfloat* forward = frustum->planes[4];  // near plane
+    const GLfloat  eye_depth = 
+        forward[0] * eye[0] + forward[1] * eye[1] + forward[2] * eye[2];
+    int i = 0;
+
+#if FRUSTUM_SSE
+    const __m128 forward_x = _mm_set1_ps(forward[0]);
+    const __m128 forward_y = _mm_set1_ps(forward[1]);
+    const __m128 forward_z = _mm_set1_ps(forward[2]);
+    const __m128 offset    = _mm_set1_ps(eye_depth);
+
+    for (; i + 4 <= count; i += 4)
+    {
+        const __m128 center_depth = _mm_add_ps(
+            _mm_add_ps(
+                _mm_mul_ps(_mm_loadu_ps(center_x + i), forward_x),
+                _mm_mul_ps(_mm_loadu_ps(center_y + i), forward_y)
+            ),
+            _mm_mul_ps(_mm_loadu_ps(center_z + i), forward_z)
+        );
+        _mm_storeu_ps(
+            depth + i, 
+            _mm_sub_ps(_mm_sub_ps(center_depth, offset), _mm_loadu_ps(radius + i))
+        );
+    }
+#endif
+
+    for (; i < count; ++i)
+    {
+        depth[i] = 
+            forward[0] * center_x[i] + 
+            forward[1] * center_y[i] + 
+            forward[2] * center_z[i] - 
+            eye_depth - radius[i];
+    }
+}
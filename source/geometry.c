@@ -9,6 +9,13 @@
 #include "geometry.h"
 #include <math.h>
 
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define GEOMETRY_SSE 1
+#include <xmmintrin.h>
+#else
+#define GEOMETRY_SSE 0
+#endif
+
 #define DEGREE_TO_RADIAN (PI / 180.0f)
 
 /**
@@ -160,3 +167,215 @@ void geometry_calculate_normal(
 
     geometry_normalize_vector(normal);
 }
+
+/**
+ * @brief Calculate the orientation basis of an object facing a direction.
+ *
+ * Matches glRotatef(yaw, 0, 1, 0) followed by glRotatef(-pitch, 1, 0, 0)
+ * with the angles of geometry_calculate_yaw_degree and
+ * geometry_calculate_pitch_degree. The cosine of the pitch is the length
+ * of the horizontal part of the direction, and the sine and cosine of the
+ * yaw are its normalized x and z components.
+ *
+ * @param direction The normalized direction the object faces.
+ * @param right Output x axis of the basis.
+ * @param up Output y axis of the basis.
+ */
+void geometry_calculate_basis(
+    const vector_3d direction, 
+          vector_3d right, 
+          vector_3d up
+)
+{
+    const GLfloat horizontal = 
+        sqrtf(direction[0] * direction[0] + direction[2] * direction[2]);
+
+    // Facing straight up or down, atan2 gives a yaw of zero.
+    const GLfloat sin_yaw = horizontal > 0.0f ? direction[0] / horizontal : 0.0f;
+    const GLfloat cos_yaw = horizontal > 0.0f ? direction[2] / horizontal : 1.0f;
+
+    right[0] =  cos_yaw;
+    right[1] =  0.0f;
+    right[2] = -sin_yaw;
+
+    up[0] = -direction[1] * sin_yaw;
+    up[1] =  horizontal;
+    up[2] = -direction[1] * cos_yaw;
+}
+
+/**
+ * @brief Calculate the orientation bases of many directions at once.
+ *
+ * The SSE path gathers four directions, takes the length of their
+ * horizontal parts with one square root and divides all four at once.
+ * Square roots and divisions are exact in both paths, so the axes equal
+ * those of geometry_calculate_basis bit for bit.
+ *
+ * @param directions The first normalized direction.
+ * @param stride Floats from one direction to the next.
+ * @param count Number of directions.
+ * @param right The resulting x axis of every basis.
+ * @param up The resulting y axis of every basis.
+ */
+void geometry_calculate_bases(
+    const GLfloat*   directions, 
+          int        stride, 
+          int        count, 
+          vector_3d* right, 
+          vector_3d* up
+)
+{
+    int i = 0;
+
+#if GEOMETRY_SSE
+    for (; i + 4 <= count; i += 4)
+    {
+        const GLfloat* d0 = directions + (i + 0) * stride;
+        const GLfloat* d1 = directions + (i + 1) * stride;
+        const GLfloat* d2 = directions + (i + 2) * stride;
+        const GLfloat* d3 = directions + (i + 3) * stride;
+
+        const __m128 x = _mm_set_ps(d3[0], d2[0], d1[0], d0[0]);
+        const __m128 y = _mm_set_ps(d3[1], d2[1], d1[1], d0[1]);
+        const __m128 z = _mm_set_ps(d3[2], d2[2], d1[2], d0[2]);
+
+        const __m128 horizontal = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(z, z)));
+        const __m128 facing     = _mm_cmpgt_ps(horizontal, _mm_setzero_ps());
+
+        // Lanes facing straight up or down divide by zero and are replaced.
+        const __m128 sin_yaw = _mm_and_ps(facing, _mm_div_ps(x, horizontal));
+        const __m128 cos_yaw = _mm_or_ps(
+            _mm_and_ps(facing, _mm_div_ps(z, horizontal)),
+            _mm_andnot_ps(facing, _mm_set1_ps(1.0f))
+        );
+        const __m128 sign_bit   = _mm_set1_ps(-0.0f);
+        const __m128 negative_y = _mm_xor_ps(y, sign_bit);
+
+        GLfloat lanes[5][4];
+        _mm_storeu_ps(lanes[0], cos_yaw);
+        _mm_storeu_ps(lanes[1], _mm_xor_ps(sin_yaw, sign_bit));
+        _mm_storeu_ps(lanes[2], _mm_mul_ps(negative_y, sin_yaw));
+        _mm_storeu_ps(lanes[3], horizontal);
+        _mm_storeu_ps(lanes[4], _mm_mul_ps(negative_y, cos_yaw));
+
+        for (int lane = 0; lane < 4; ++lane)
+        {
+            right[i + lane][0] = lanes[0][lane];
+            right[i + lane][1] = 0.0f;
+            right[i + lane][2] = lanes[1][lane];
+
+            up[i + lane][0] = lanes[2][lane];
+            up[i + lane][1] = lanes[3][lane];
+            up[i + lane][2] = lanes[4][lane];
+        }
+    }
+#endif
+
+    for (; i < count; ++i)
+    {
+        geometry_calculate_basis(directions + i * stride, right[i], up[i]);
+    }
+}
+
+/**
+ * @brief Multiply two column-major 4x4 matrices.
+ *
+ * @param a The left matrix.
+ * @param b The right matrix.
+ * @param result Output product a * b, must not alias a or b.
+ */
+void geometry_multiply_matrices(
+    const GLfloat a[16], 
+    const GLfloat b[16], 
+          GLfloat result[16]
+)
+{
+    for (int column = 0; column < 4; ++column)
+    {
+        for (int row = 0; row < 4; ++row)
+        {
+            result[column * 4 + row] =
+                a[0 * 4 + row] * b[column * 4 + 0] +
+                a[1 * 4 + row] * b[column * 4 + 1] +
+                a[2 * 4 + row] * b[column * 4 + 2] +
+                a[3 * 4 + row] * b[column * 4 + 3];
+        }
+    }
+}
+
+/**
+ * @brief Calculate the view matrix of a camera, as built by gluLookAt.
+ *
+ * @param eye Position of the camera.
+ * @param target Point the camera looks at.
+ * @param up Up direction of the camera.
+ * @param matrix Output column-major view matrix.
+ */
+void geometry_calculate_look_at_matrix(
+    const point_3d  eye, 
+    const point_3d  target, 
+    const vector_3d up, 
+          GLfloat   matrix[16]
+)
+{
+    vector_3d forward = { 
+        target[0] - eye[0], 
+        target[1] - eye[1], 
+        target[2] - eye[2] 
+    };
+    vector_3d side;
+    vector_3d camera_up;
+
+    geometry_normalize_vector(forward);
+    geometry_cross_product(forward, up, side);
+    geometry_normalize_vector(side);
+    geometry_cross_product(side, forward, camera_up);
+
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        matrix[axis * 4 + 0] =  side[axis];
+        matrix[axis * 4 + 1] =  camera_up[axis];
+        matrix[axis * 4 + 2] = -forward[axis];
+        matrix[axis * 4 + 3] =  0.0f;
+    }
+    for (int row = 0; row < 3; ++row)
+    {
+        matrix[12 + row] = -(
+            matrix[0 + row] * eye[0] + 
+            matrix[4 + row] * eye[1] + 
+            matrix[8 + row] * eye[2]
+        );
+    }
+    matrix[15] = 1.0f;
+}
+
+/**
+ * @brief Calculate a perspective projection matrix, as built by gluPerspective.
+ *
+ * @param fov Vertical field of view in degrees.
+ * @param aspect Width divided by height of the viewport.
+ * @param near_plane Distance to the near clipping plane.
+ * @param far_plane Distance to the far clipping plane.
+ * @param matrix Output column-major projection matrix.
+ */
+void geometry_calculate_perspective_matrix(
+    GLdouble fov, 
+    GLdouble aspect, 
+    GLdouble near_plane, 
+    GLdouble far_plane, 
+    GLfloat  matrix[16]
+)
+{
+    const GLdouble cotangent = 1.0 / tan(fov / 2.0 * 3.14159265358979323846 / 180.0);
+    const GLdouble depth     = far_plane - near_plane;
+
+    for (int i = 0; i < 16; ++i)
+    {
+        matrix[i] = 0.0f;
+    }
+    matrix[0]  = (GLfloat)(cotangent / aspect);
+    matrix[5]  = (GLfloat)cotangent;
+    matrix[10] = (GLfloat)(-(far_plane + near_plane) / depth);
+    matrix[11] = -1.0f;
+    matrix[14] = (GLfloat)(-2.0 * near_plane * far_plane / depth);
+}
@@ -0,0 +1,362 @@
+/**
+ * @file gl_extensions.c
+ * @brief Implements runtime loading of OpenGL entry points.
+ */
+
+
+#include "gl_extensions.h"
+
+#include <stdio.h>
+#include <string.h>
+
+
+gl_extension_support gl_extensions = { 0 };  // nothing is available until loaded.
+
+gl_gen_buffers_proc     gl_extensions_gen_buffers     = NULL;
+gl_delete_buffers_proc  gl_extensions_delete_buffers  = NULL;
+gl_bind_buffer_proc     gl_extensions_bind_buffer     = NULL;
+gl_buffer_data_proc     gl_extensions_buffer_data     = NULL;
+gl_buffer_sub_data_proc gl_extensions_buffer_sub_data = NULL;
+gl_map_buffer_proc      gl_extensions_map_buffer      = NULL;
+gl_unmap_buffer_proc    gl_extensions_unmap_buffer    = NULL;
+
+gl_create_shader_proc               gl_extensions_create_shader               = NULL;
+gl_delete_shader_proc               gl_extensions_delete_shader               = NULL;
+gl_shader_source_proc               gl_extensions_shader_source               = NULL;
+gl_compile_shader_proc              gl_extensions_compile_shader              = NULL;
+gl_get_shader_iv_proc               gl_extensions_get_shader_iv               = NULL;
+gl_get_shader_info_log_proc         gl_extensions_get_shader_info_log         = NULL;
+gl_create_program_proc              gl_extensions_create_program              = NULL;
+gl_delete_program_proc              gl_extensions_delete_program              = NULL;
+gl_attach_shader_proc               gl_extensions_attach_shader               = NULL;
+gl_bind_attrib_location_proc        gl_extensions_bind_attrib_location        = NULL;
+gl_link_program_proc                gl_extensions_link_program                = NULL;
+gl_get_program_iv_proc              gl_extensions_get_program_iv              = NULL;
+gl_get_program_info_log_proc        gl_extensions_get_program_info_log        = NULL;
+gl_use_program_proc                 gl_extensions_use_program                 = NULL;
+gl_get_uniform_location_proc        gl_extensions_get_uniform_location        = NULL;
+gl_uniform_1i_proc                  gl_extensions_uniform_1i                  = NULL;
+gl_uniform_1f_proc                  gl_extensions_uniform_1f                  = NULL;
+gl_uniform_4fv_proc                 gl_extensions_uniform_4fv                 = NULL;
+gl_uniform_matrix_4fv_proc          gl_extensions_uniform_matrix_4fv          = NULL;
+gl_enable_vertex_attrib_array_proc  gl_extensions_enable_vertex_attrib_array  = NULL;
+gl_disable_vertex_attrib_array_proc gl_extensions_disable_vertex_attrib_array = NULL;
+gl_vertex_attrib_pointer_proc       gl_extensions_vertex_attrib_pointer       = NULL;
+gl_vertex_attrib_divisor_proc       gl_extensions_vertex_attrib_divisor       = NULL;
+gl_draw_arrays_instanced_proc       gl_extensions_draw_arrays_instanced       = NULL;
+
+gl_map_buffer_range_proc gl_extensions_map_buffer_range = NULL;
+gl_buffer_storage_proc   gl_extensions_buffer_storage   = NULL;
+gl_fence_sync_proc       gl_extensions_fence_sync       = NULL;
+gl_client_wait_sync_proc gl_extensions_client_wait_sync = NULL;
+gl_delete_sync_proc      gl_extensions_delete_sync      = NULL;
+
+gl_gen_vertex_arrays_proc       gl_extensions_gen_vertex_arrays       = NULL;
+gl_delete_vertex_arrays_proc    gl_extensions_delete_vertex_arrays    = NULL;
+gl_bind_vertex_array_proc       gl_extensions_bind_vertex_array       = NULL;
+gl_get_uniform_block_index_proc gl_extensions_get_uniform_block_index = NULL;
+gl_uniform_block_binding_proc   gl_extensions_uniform_block_binding   = NULL;
+gl_bind_buffer_base_proc        gl_extensions_bind_buffer_base        = NULL;
+
+gl_active_texture_proc gl_extensions_active_texture = NULL;
+gl_tex_buffer_proc     gl_extensions_tex_buffer     = NULL;
+
+gl_gen_framebuffers_proc         gl_extensions_gen_framebuffers         = NULL;
+gl_delete_framebuffers_proc      gl_extensions_delete_framebuffers      = NULL;
+gl_bind_framebuffer_proc         gl_extensions_bind_framebuffer         = NULL;
+gl_check_framebuffer_status_proc gl_extensions_check_framebuffer_status = NULL;
+gl_framebuffer_renderbuffer_proc gl_extensions_framebuffer_renderbuffer = NULL;
+gl_gen_renderbuffers_proc        gl_extensions_gen_renderbuffers        = NULL;
+gl_delete_renderbuffers_proc     gl_extensions_delete_renderbuffers     = NULL;
+gl_bind_renderbuffer_proc        gl_extensions_bind_renderbuffer        = NULL;
+gl_renderbuffer_storage_proc     gl_extensions_renderbuffer_storage     = NULL;
+gl_blit_framebuffer_proc         gl_extensions_blit_framebuffer         = NULL;
+
+gl_swap_interval_proc gl_extensions_swap_interval = NULL;
+
+static gl_extensions_loader extensions_loader = NULL;  // glutGetProcAddress when NULL.
+
+
+/**
+ * @brief Looks up a single entry point with the current loader.
+ *
+ * @param name Name of the function.
+ * @return GLUTproc The entry point, or NULL if it is not exported.
+ */
+static GLUTproc get_proc_address(const char* name)
+{
+    if (extensions_loader != NULL)
+    {
+        return extensions_loader(name);
+    }
+    return glutGetProcAddress(name);
+}
+
+/**
+ * @brief Looks up an entry point by its core name, then its ARB name.
+ *
+ * @param core_name Name of the core function, e.g. "glGenBuffers".
+ * @param arb_name  Name of the ARB extension function, or NULL.
+ * @return GLUTproc The entry point, or NULL if neither name is exported.
+ */
+static GLUTproc load_function(const char* core_name, const char* arb_name)
+{
+    GLUTproc function = get_proc_address(core_name);
+    if (function == NULL && arb_name != NULL)
+    {
+        function = get_proc_address(arb_name);
+    }
+    return function;
+}
+
+/**
+ * @brief Loads the OpenGL 1.5 buffer object entry points.
+ */
+static void load_vertex_buffer_objects(void)
+{
+    gl_extensions_gen_buffers     = (gl_gen_buffers_proc)load_function("glGenBuffers", "glGenBuffersARB");
+    gl_extensions_delete_buffers  = (gl_delete_buffers_proc)load_function("glDeleteBuffers", "glDeleteBuffersARB");
+    gl_extensions_bind_buffer     = (gl_bind_buffer_proc)load_function("glBindBuffer", "glBindBufferARB");
+    gl_extensions_buffer_data     = (gl_buffer_data_proc)load_function("glBufferData", "glBufferDataARB");
+    gl_extensions_buffer_sub_data = (gl_buffer_sub_data_proc)load_function("glBufferSubData", "glBufferSubDataARB");
+    gl_extensions_map_buffer      = (gl_map_buffer_proc)load_function("glMapBuffer", "glMapBufferARB");
+    gl_extensions_unmap_buffer    = (gl_unmap_buffer_proc)load_function("glUnmapBuffer", "glUnmapBufferARB");
+
+    gl_extensions.vertex_buffer_objects =
+        gl_extensions_gen_buffers     != NULL &&
+        gl_extensions_delete_buffers  != NULL &&
+        gl_extensions_bind_buffer     != NULL &&
+        gl_extensions_buffer_data     != NULL &&
+        gl_extensions_buffer_sub_data != NULL &&
+        gl_extensions_map_buffer      != NULL &&
+        gl_extensions_unmap_buffer    != NULL;
+}
+
+/**
+ * @brief Checks if pixels can be packed into buffer objects.
+ *
+ * Pixel buffer objects add no entry points to those of buffer objects,
+ * so they are detected by the context version, or by the extension
+ * string of older contexts.
+ */
+static void detect_pixel_buffer_objects(void)
+{
+    const char* version = (const char*)glGetString(GL_VERSION);
+    int major = 0;
+    int minor = 0;
+    if (version != NULL && sscanf_s(version, "%d.%d", &major, &minor) == 2 &&
+        (major > 2 || (major == 2 && minor >= 1)))
+    {
+        gl_extensions.pixel_buffer_objects = gl_extensions.vertex_buffer_objects;
+        return;
+    }
+
+    const char* extensions = (const char*)glGetString(GL_EXTENSIONS);
+    gl_extensions.pixel_buffer_objects =
+        gl_extensions.vertex_buffer_objects &&
+        extensions != NULL &&
+        strstr(extensions, "GL_ARB_pixel_buffer_object") != NULL;
+}
+
+/**
+ * @brief Loads the OpenGL 2.0 shader program entry points.
+ */
+static void load_shaders(void)
+{
+    gl_extensions_create_shader               = (gl_create_shader_proc)load_function("glCreateShader", NULL);
+    gl_extensions_delete_shader               = (gl_delete_shader_proc)load_function("glDeleteShader", NULL);
+    gl_extensions_shader_source               = (gl_shader_source_proc)load_function("glShaderSource", NULL);
+    gl_extensions_compile_shader              = (gl_compile_shader_proc)load_function("glCompileShader", NULL);
+    gl_extensions_get_shader_iv               = (gl_get_shader_iv_proc)load_function("glGetShaderiv", NULL);
+    gl_extensions_get_shader_info_log         = (gl_get_shader_info_log_proc)load_function("glGetShaderInfoLog", NULL);
+    gl_extensions_create_program              = (gl_create_program_proc)load_function("glCreateProgram", NULL);
+    gl_extensions_delete_program              = (gl_delete_program_proc)load_function("glDeleteProgram", NULL);
+    gl_extensions_attach_shader               = (gl_attach_shader_proc)load_function("glAttachShader", NULL);
+    gl_extensions_bind_attrib_location        = (gl_bind_attrib_location_proc)load_function("glBindAttribLocation", NULL);
+    gl_extensions_link_program                = (gl_link_program_proc)load_function("glLinkProgram", NULL);
+    gl_extensions_get_program_iv              = (gl_get_program_iv_proc)load_function("glGetProgramiv", NULL);
+    gl_extensions_get_program_info_log        = (gl_get_program_info_log_proc)load_function("glGetProgramInfoLog", NULL);
+    gl_extensions_use_program                 = (gl_use_program_proc)load_function("glUseProgram", NULL);
+    gl_extensions_get_uniform_location        = (gl_get_uniform_location_proc)load_function("glGetUniformLocation", NULL);
+    gl_extensions_uniform_1i                  = (gl_uniform_1i_proc)load_function("glUniform1i", NULL);
+    gl_extensions_uniform_1f                  = (gl_uniform_1f_proc)load_function("glUniform1f", NULL);
+    gl_extensions_uniform_4fv                 = (gl_uniform_4fv_proc)load_function("glUniform4fv", NULL);
+    gl_extensions_uniform_matrix_4fv          = (gl_uniform_matrix_4fv_proc)load_function("glUniformMatrix4fv", NULL);
+    gl_extensions_enable_vertex_attrib_array  = (gl_enable_vertex_attrib_array_proc)load_function("glEnableVertexAttribArray", NULL);
+    gl_extensions_disable_vertex_attrib_array = (gl_disable_vertex_attrib_array_proc)load_function("glDisableVertexAttribArray", NULL);
+    gl_extensions_vertex_attrib_pointer       = (gl_vertex_attrib_pointer_proc)load_function("glVertexAttribPointer", NULL);
+
+    gl_extensions.shaders =
+        gl_extensions_create_shader               != NULL &&
+        gl_extensions_delete_shader               != NULL &&
+        gl_extensions_shader_source               != NULL &&
+        gl_extensions_compile_shader              != NULL &&
+        gl_extensions_get_shader_iv               != NULL &&
+        gl_extensions_get_shader_info_log         != NULL &&
+        gl_extensions_create_program              != NULL &&
+        gl_extensions_delete_program              != NULL &&
+        gl_extensions_attach_shader               != NULL &&
+        gl_extensions_bind_attrib_location        != NULL &&
+        gl_extensions_link_program                != NULL &&
+        gl_extensions_get_program_iv              != NULL &&
+        gl_extensions_get_program_info_log        != NULL &&
+        gl_extensions_use_program                 != NULL &&
+        gl_extensions_get_uniform_location        != NULL &&
+        gl_extensions_uniform_1i                  != NULL &&
+        gl_extensions_uniform_1f                  != NULL &&
+        gl_extensions_uniform_4fv                 != NULL &&
+        gl_extensions_uniform_matrix_4fv          != NULL &&
+        gl_extensions_enable_vertex_attrib_array  != NULL &&
+        gl_extensions_disable_vertex_attrib_array != NULL &&
+        gl_extensions_vertex_attrib_pointer       != NULL;
+}
+
+/**
+ * @brief Loads the OpenGL 3.3 (ARB_instanced_arrays) instancing entry points.
+ */
+static void load_instanced_arrays(void)
+{
+    gl_extensions_vertex_attrib_divisor = (gl_vertex_attrib_divisor_proc)load_function("glVertexAttribDivisor", "glVertexAttribDivisorARB");
+    gl_extensions_draw_arrays_instanced = (gl_draw_arrays_instanced_proc)load_function("glDrawArraysInstanced", "glDrawArraysInstancedARB");
+
+    gl_extensions.instanced_arrays =
+        gl_extensions.shaders &&
+        gl_extensions.vertex_buffer_objects &&
+        gl_extensions_vertex_attrib_divisor != NULL &&
+        gl_extensions_draw_arrays_instanced != NULL;
+}
+
+/**
+ * @brief Loads the OpenGL 4.4 (ARB_buffer_storage) persistent mapping
+ *        entry points together with the sync objects it relies on.
+ */
+static void load_persistent_mapping(void)
+{
+    gl_extensions_map_buffer_range = (gl_map_buffer_range_proc)load_function("glMapBufferRange", NULL);
+    gl_extensions_buffer_storage   = (gl_buffer_storage_proc)load_function("glBufferStorage", NULL);
+    gl_extensions_fence_sync       = (gl_fence_sync_proc)load_function("glFenceSync", NULL);
+    gl_extensions_client_wait_sync = (gl_client_wait_sync_proc)load_function("glClientWaitSync", NULL);
+    gl_extensions_delete_sync      = (gl_delete_sync_proc)load_function("glDeleteSync", NULL);
+
+    gl_extensions.persistent_mapping =
+        gl_extensions.vertex_buffer_objects &&
+        gl_extensions_map_buffer_range != NULL &&
+        gl_extensions_buffer_storage   != NULL &&
+        gl_extensions_fence_sync       != NULL &&
+        gl_extensions_client_wait_sync != NULL &&
+        gl_extensions_delete_sync      != NULL;
+}
+
+/**
+ * @brief Loads the OpenGL 3.0 (EXT_framebuffer_object and
+ *        EXT_framebuffer_blit) framebuffer entry points.
+ */
+static void load_framebuffer_objects(void)
+{
+    gl_extensions_gen_framebuffers         = (gl_gen_framebuffers_proc)load_function("glGenFramebuffers", "glGenFramebuffersEXT");
+    gl_extensions_delete_framebuffers      = (gl_delete_framebuffers_proc)load_function("glDeleteFramebuffers", "glDeleteFramebuffersEXT");
+    gl_extensions_bind_framebuffer         = (gl_bind_framebuffer_proc)load_function("glBindFramebuffer", "glBindFramebufferEXT");
+    gl_extensions_check_framebuffer_status = (gl_check_framebuffer_status_proc)load_function("glCheckFramebufferStatus", "glCheckFramebufferStatusEXT");
+    gl_extensions_framebuffer_renderbuffer = (gl_framebuffer_renderbuffer_proc)load_function("glFramebufferRenderbuffer", "glFramebufferRenderbufferEXT");
+    gl_extensions_gen_renderbuffers        = (gl_gen_renderbuffers_proc)load_function("glGenRenderbuffers", "glGenRenderbuffersEXT");
+    gl_extensions_delete_renderbuffers     = (gl_delete_renderbuffers_proc)load_function("glDeleteRenderbuffers", "glDeleteRenderbuffersEXT");
+    gl_extensions_bind_renderbuffer        = (gl_bind_renderbuffer_proc)load_function("glBindRenderbuffer", "glBindRenderbufferEXT");
+    gl_extensions_renderbuffer_storage     = (gl_renderbuffer_storage_proc)load_function("glRenderbufferStorage", "glRenderbufferStorageEXT");
+    gl_extensions_blit_framebuffer         = (gl_blit_framebuffer_proc)load_function("glBlitFramebuffer", "glBlitFramebufferEXT");
+
+    gl_extensions.framebuffer_objects =
+        gl_extensions_gen_framebuffers         != NULL &&
+        gl_extensions_delete_framebuffers      != NULL &&
+        gl_extensions_bind_framebuffer         != NULL &&
+        gl_extensions_check_framebuffer_status != NULL &&
+        gl_extensions_framebuffer_renderbuffer != NULL &&
+        gl_extensions_gen_renderbuffers        != NULL &&
+        gl_extensions_delete_renderbuffers     != NULL &&
+        gl_extensions_bind_renderbuffer        != NULL &&
+        gl_extensions_renderbuffer_storage     != NULL;
+
+    gl_extensions.framebuffer_blit =
+        gl_extensions.framebuffer_objects &&
+        gl_extensions_blit_framebuffer != NULL;
+}
+
+/**
+ * @brief Loads the OpenGL 3.0 vertex array object and
+ *        the OpenGL 3.1 uniform buffer entry points.
+ */
+static void load_vertex_arrays_and_uniform_buffers(void)
+{
+    gl_extensions_gen_vertex_arrays       = (gl_gen_vertex_arrays_proc)load_function("glGenVertexArrays", NULL);
+    gl_extensions_delete_vertex_arrays    = (gl_delete_vertex_arrays_proc)load_function("glDeleteVertexArrays", NULL);
+    gl_extensions_bind_vertex_array       = (gl_bind_vertex_array_proc)load_function("glBindVertexArray", NULL);
+    gl_extensions_get_uniform_block_index = (gl_get_uniform_block_index_proc)load_function("glGetUniformBlockIndex", NULL);
+    gl_extensions_uniform_block_binding   = (gl_uniform_block_binding_proc)load_function("glUniformBlockBinding", NULL);
+    gl_extensions_bind_buffer_base        = (gl_bind_buffer_base_proc)load_function("glBindBufferBase", NULL);
+
+    gl_extensions.vertex_array_objects =
+        gl_extensions.vertex_buffer_objects &&
+        gl_extensions_gen_vertex_arrays    != NULL &&
+        gl_extensions_delete_vertex_arrays != NULL &&
+        gl_extensions_bind_vertex_array    != NULL;
+
+    gl_extensions.uniform_buffers =
+        gl_extensions.vertex_buffer_objects &&
+        gl_extensions.shaders &&
+        gl_extensions_get_uniform_block_index != NULL &&
+        gl_extensions_uniform_block_binding   != NULL &&
+        gl_extensions_bind_buffer_base        != NULL;
+}
+
+/**
+ * @brief Loads the OpenGL 1.3 texture unit selection and
+ *        the OpenGL 3.1 buffer texture entry points.
+ */
+static void load_texture_buffers(void)
+{
+    gl_extensions_active_texture = (gl_active_texture_proc)load_function("glActiveTexture", "glActiveTextureARB");
+    gl_extensions_tex_buffer     = (gl_tex_buffer_proc)load_function("glTexBuffer", "glTexBufferARB");
+
+    gl_extensions.texture_buffers =
+        gl_extensions.vertex_buffer_objects &&
+        gl_extensions_active_texture != NULL &&
+        gl_extensions_tex_buffer     != NULL;
+}
+
+/**
+ * @brief Loads the swap interval control of the window system.
+ *
+ * GLX_SGI_swap_control is not used, as it cannot disable the
+ * vertical sync with an interval of 0.
+ */
+static void load_swap_control(void)
+{
+    gl_extensions_swap_interval = (gl_swap_interval_proc)load_function("wglSwapIntervalEXT", "glXSwapIntervalMESA");
+
+    gl_extensions.swap_control = gl_extensions_swap_interval != NULL;
+}
+
+/**
+ * @brief Replaces glutGetProcAddress for contexts not created by GLUT.
+ *
+ * @param loader The lookup function, NULL to use glutGetProcAddress.
+ */
+void gl_extensions_set_loader(gl_extensions_loader loader)
+{
+    extensions_loader = loader;
+}
+
+/**
+ * @brief Loads all optional entry points for the current context.
+ */
+void gl_extensions_initialize(void)
+{
+    load_vertex_buffer_objects();
+    detect_pixel_buffer_objects();
+    load_shaders();
+    load_instanced_arrays();
+    load_persistent_mapping();
+    load_framebuffer_objects();
+    load_vertex_arrays_and_uniform_buffers();
+    load_texture_buffers();
+    load_swap_control();
+}
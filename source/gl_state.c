@@ -0,0 +1,221 @@
+/**
+ * @file gl_state.c
+ * @brief Implements the shadowed OpenGL state.
+ */
+
+
+#include "gl_state.h"
+
+#include "gl_trace.h"
+
+#include <string.h>
+
+
+#define MATERIAL_COLOR_COUNT 4       // ambient, diffuse, specular and emission
+#define MAX_SHININESS        128.0f  // largest specular exponent OpenGL accepts
+
+
+/**
+ * @brief Last known state of a capability.
+ */
+typedef struct {
+    GLenum capability;  // the capability, e.g. GL_FOG
+    int    enabled;     // 1 if enabled, 0 if disabled
+} capability_state;
+
+
+static const GLenum material_color_names[MATERIAL_COLOR_COUNT] = {
+    GL_AMBIENT,
+    GL_DIFFUSE,
+    GL_SPECULAR,
+    GL_EMISSION
+};
+
+static color   material_colors[MATERIAL_COLOR_COUNT];        // current material colors
+static int     material_colors_known[MATERIAL_COLOR_COUNT];  // 1 once the color was set
+static GLfloat material_shininess       = 0.0f;              // current specular exponent
+static int     material_shininess_known = 0;                 // 1 once the exponent was set
+
+static GLuint bound_texture       = 0;  // current 2D texture
+static int    bound_texture_known = 0;  // 1 once a texture was bound
+
+static capability_state capabilities[GL_STATE_MAX_CAPABILITIES];  // capabilities set so far
+static int              capability_count = 0;                     // used entries of capabilities
+
+static GLfloat line_width       = 1.0f;  // current line width
+static int     line_width_known = 0;     // 1 once the width was set
+
+static gl_state_stats state_stats = { 0, 0 };  // counts since the last reset
+
+
+/**
+ * @brief Counts a state change as issued or skipped.
+ *
+ * @param issued 1 if the change reached OpenGL, 0 if it was skipped.
+ */
+void gl_state_count_call(int issued)
+{
+    if (issued)
+    {
+        ++state_stats.calls_issued;
+    }
+    else
+    {
+        ++state_stats.calls_skipped;
+    }
+}
+
+/**
+ * @brief Sets the front face material, issuing only the changed parameters.
+ *
+ * Each color and the shininess are compared on their own, so materials
+ * that only differ in their diffuse color cost a single call.
+ *
+ * @param material The material of the following draws.
+ */
+void gl_state_set_material(const gl_material* material)
+{
+    const GLfloat* values[MATERIAL_COLOR_COUNT] = {
+        material->ambient,
+        material->diffuse,
+        material->specular,
+        material->emission
+    };
+
+    for (int i = 0; i < MATERIAL_COLOR_COUNT; ++i)
+    {
+        if (material_colors_known[i] &&
+            memcmp(material_colors[i], values[i], sizeof(color)) == 0)
+        {
+            gl_state_count_call(0);
+            continue;
+        }
+
+        glMaterialfv(GL_FRONT, material_color_names[i], values[i]);
+        memcpy(material_colors[i], values[i], sizeof(color));
+        material_colors_known[i] = 1;
+        gl_state_count_call(1);
+    }
+
+    if (material_shininess_known && material_shininess == material->shininess)
+    {
+        gl_state_count_call(0);
+        return;
+    }
+
+    glMaterialf(GL_FRONT, GL_SHININESS, material->shininess);
+    gl_state_count_call(1);
+
+    // OpenGL rejects exponents out of range and keeps the current one.
+    if (material->shininess >= 0.0f && material->shininess <= MAX_SHININESS)
+    {
+        material_shininess       = material->shininess;
+        material_shininess_known = 1;
+    }
+}
+
+/**
+ * @brief Binds a 2D texture unless it is already bound.
+ *
+ * @param texture_id Name of the texture, 0 to unbind.
+ */
+void gl_state_bind_texture(GLuint texture_id)
+{
+    if (bound_texture_known && bound_texture == texture_id)
+    {
+        gl_state_count_call(0);
+        return;
+    }
+
+    glBindTexture(GL_TEXTURE_2D, texture_id);
+    bound_texture       = texture_id;
+    bound_texture_known = 1;
+    gl_state_count_call(1);
+}
+
+/**
+ * @brief Enables or disables a capability unless it is already in that state.
+ *
+ * Capabilities beyond GL_STATE_MAX_CAPABILITIES are passed on every time.
+ *
+ * @param capability The capability, e.g. GL_FOG.
+ * @param enabled    1 to enable the capability, 0 to disable it.
+ */
+void gl_state_enable(GLenum capability, int enabled)
+{
+    enabled = enabled != 0;
+
+    capability_state* state = NULL;
+    for (int i = 0; i < capability_count; ++i)
+    {
+        if (capabilities[i].capability == capability)
+        {
+            state = &capabilities[i];
+            break;
+        }
+    }
+
+    if (state != NULL && state->enabled == enabled)
+    {
+        gl_state_count_call(0);
+        return;
+    }
+
+    if (enabled)
+    {
+        glEnable(capability);
+    }
+    else
+    {
+        glDisable(capability);
+    }
+    gl_state_count_call(1);
+
+    if (state == NULL && capability_count < GL_STATE_MAX_CAPABILITIES)
+    {
+        state             = &capabilities[capability_count++];
+        state->capability = capability;
+    }
+    if (state != NULL)
+    {
+        state->enabled = enabled;
+    }
+}
+
+/**
+ * @brief Sets the rasterized line width unless it is already current.
+ *
+ * @param width Width of lines in pixels.
+ */
+void gl_state_line_width(GLfloat width)
+{
+    if (line_width_known && line_width == width)
+    {
+        gl_state_count_call(0);
+        return;
+    }
+
+    glLineWidth(width);
+    line_width       = width;
+    line_width_known = 1;
+    gl_state_count_call(1);
+}
+
+/**
+ * @brief Returns the state change counts since the last reset.
+ *
+ * @param stats Output counts.
+ */
+void gl_state_get_stats(gl_state_stats* stats)
+{
+    *stats = state_stats;
+}
+
+/**
+ * @brief Resets the state change counts.
+ */
+void gl_state_reset_stats(void)
+{
+    state_stats.calls_issued  = 0;
+    state_stats.calls_skipped = 0;
+}
@@ -0,0 +1,456 @@
+/**
+ * @file gl_trace.c
+ * @brief Implements the per-pass OpenGL call counts, their overlay and CSV file.
+ */
+
+
+#include "gl_trace.h"
+
+#include "gl_state.h"
+#include "timer.h"
+
+#include <stdio.h>
+#include <string.h>
+
+
+#define COUNT_FIELDS           6                    // fields of gl_trace_counts
+#define OVERLAY_LINE_LENGTH    96                   // characters of an overlay line at most
+#define OVERLAY_LINE_HEIGHT    15                   // pixels between overlay lines
+#define OVERLAY_CHARACTER_SIZE 8                    // pixels per character of the overlay font
+#define OVERLAY_MARGIN         8                    // pixels between the overlay and the framebuffer corner
+#define OVERLAY_FONT           GLUT_BITMAP_8_BY_13  // fixed-width bitmap font of the overlay
+
+
+static gl_trace_counts ignored;  // receives the calls made outside a frame
+
+int              gl_trace_overlay_on = 0;         // starts as zero until the overlay is turned on by user.
+gl_trace_counts* gl_trace_counting   = &ignored;  // starts outside a frame until the first frame begins.
+
+static const char* const count_names[COUNT_FIELDS] = {
+    "draws",
+    "vertices",
+    "begin_blocks",
+    "state_changes",
+    "matrix_pushes",
+    "texture_binds"
+};
+
+static gl_trace_frame current_frame;                               // counts of the frame being drawn
+static gl_trace_frame last_frame;                                  // counts of the last finished frame
+static double         sums[RENDER_PASS_COUNT + 1][COUNT_FIELDS];  // counts of all frames, the total last
+static long           frames_counted = 0;                          // frames finished since startup
+
+static render_pass timed_pass      = RENDER_PASS_OTHER;  // pass the CPU time is currently added to
+static double      pass_started_ms = 0.0;                // time the current pass was entered
+
+static gl_trace_counts  list_counts[GL_TRACE_MAX_DISPLAY_LISTS];  // calls recorded into each display list
+static gl_trace_counts* counting_before_list = NULL;              // counts restored once a list is recorded
+
+static FILE* csv_file = NULL;  // file receiving every frame, NULL if none
+
+
+/**
+ * @brief Lists the counts in the order of count_names.
+ *
+ * @param counts The counts.
+ * @param values Output values.
+ */
+static void list_values(const gl_trace_counts* counts, int values[COUNT_FIELDS])
+{
+    values[0] = counts->draws;
+    values[1] = counts->vertices;
+    values[2] = counts->begin_blocks;
+    values[3] = counts->state_changes;
+    values[4] = counts->matrix_pushes;
+    values[5] = counts->texture_binds;
+}
+
+/**
+ * @brief Adds one set of counts to another.
+ *
+ * @param sum    Counts receiving the sum.
+ * @param counts Counts to add.
+ */
+static void add_counts(gl_trace_counts* sum, const gl_trace_counts* counts)
+{
+    sum->draws         += counts->draws;
+    sum->vertices      += counts->vertices;
+    sum->begin_blocks  += counts->begin_blocks;
+    sum->state_changes += counts->state_changes;
+    sum->matrix_pushes += counts->matrix_pushes;
+    sum->texture_binds += counts->texture_binds;
+}
+
+/**
+ * @brief Writes the counts of every pass and their total as CSV rows.
+ *
+ * @param frame Number of the frame, counted from 1.
+ * @param counts Counts of the frame.
+ */
+static void write_csv_rows(long frame, const gl_trace_frame* counts)
+{
+    for (int pass = 0; pass <= RENDER_PASS_COUNT; ++pass)
+    {
+        int values[COUNT_FIELDS];
+        list_values(pass < RENDER_PASS_COUNT ? &counts->passes[pass] : &counts->total, values);
+
+        fprintf(
+            csv_file,
+            "%ld,%s",
+            frame,
+            pass < RENDER_PASS_COUNT ? renderer_pass_name((render_pass)pass) : "total"
+        );
+        for (int i = 0; i < COUNT_FIELDS; ++i)
+        {
+            fprintf(csv_file, ",%d", values[i]);
+        }
+        fprintf(csv_file, "\n");
+    }
+}
+
+/**
+ * @brief Adds the time since the current pass was entered to its CPU time.
+ *
+ * @param now_ms Current time of timer_now_ms.
+ */
+static void add_pass_time(double now_ms)
+{
+    current_frame.pass_ms[timed_pass] += now_ms - pass_started_ms;
+    pass_started_ms = now_ms;
+}
+
+/**
+ * @brief Starts counting the calls of a frame, outside any scene pass.
+ */
+void gl_trace_begin_frame(void)
+{
+    memset(&current_frame, 0, sizeof(current_frame));
+    gl_trace_counting = &current_frame.passes[RENDER_PASS_OTHER];
+    timed_pass        = RENDER_PASS_OTHER;
+    pass_started_ms   = timer_now_ms();
+}
+
+/**
+ * @brief Adds the following calls to the counts of a render pass.
+ *
+ * The time since the last switch is added to the pass left.
+ *
+ * @param pass The render pass.
+ */
+void gl_trace_set_pass(render_pass pass)
+{
+    gl_trace_counting = &current_frame.passes[pass];
+    if (pass != timed_pass)
+    {
+        add_pass_time(timer_now_ms());
+        timed_pass = pass;
+    }
+}
+
+/**
+ * @brief Stops counting, keeps the frame and writes it to the CSV file.
+ */
+void gl_trace_end_frame(void)
+{
+    gl_trace_counting = &ignored;
+    add_pass_time(timer_now_ms());
+
+    memset(&current_frame.total, 0, sizeof(current_frame.total));
+    for (int pass = 0; pass < RENDER_PASS_COUNT; ++pass)
+    {
+        add_counts(&current_frame.total, &current_frame.passes[pass]);
+    }
+    last_frame = current_frame;
+    ++frames_counted;
+
+    for (int pass = 0; pass <= RENDER_PASS_COUNT; ++pass)
+    {
+        int values[COUNT_FIELDS];
+        list_values(pass < RENDER_PASS_COUNT ? &last_frame.passes[pass] : &last_frame.total, values);
+        for (int i = 0; i < COUNT_FIELDS; ++i)
+        {
+            sums[pass][i] += values[i];
+        }
+    }
+
+    if (csv_file != NULL)
+    {
+        write_csv_rows(frames_counted, &last_frame);
+    }
+}
+
+/**
+ * @brief Copies the counts of the last finished frame.
+ *
+ * @param frame Output counts.
+ */
+void gl_trace_get_frame(gl_trace_frame* frame)
+{
+    *frame = last_frame;
+}
+
+/**
+ * @brief Writes the counts of every following frame to a CSV file.
+ *
+ * @param file_path Path of the file, replaced if it exists.
+ * @return int Returns 1 if the file was opened, 0 otherwise.
+ */
+int gl_trace_open_csv(const char* file_path)
+{
+    if (!GL_TRACE)
+    {
+        printf("OpenGL call counting is compiled out, %s is not written.\n\n", file_path);
+        return 0;
+    }
+
+    gl_trace_close_csv();
+    if (fopen_s(&csv_file, file_path, "w") != 0 || csv_file == NULL)
+    {
+        printf("Could not open %s for the OpenGL call counts.\n\n", file_path);
+        csv_file = NULL;
+        return 0;
+    }
+
+    fprintf(csv_file, "frame,pass");
+    for (int i = 0; i < COUNT_FIELDS; ++i)
+    {
+        fprintf(csv_file, ",%s", count_names[i]);
+    }
+    fprintf(csv_file, "\n");
+    return 1;
+}
+
+/**
+ * @brief Closes the CSV file, if one is open.
+ */
+void gl_trace_close_csv(void)
+{
+    if (csv_file != NULL)
+    {
+        (void)fclose(csv_file);
+        csv_file = NULL;
+    }
+}
+
+/**
+ * @brief Formats a row of the call count table.
+ *
+ * @param line   Output text of OVERLAY_LINE_LENGTH characters.
+ * @param name   Name of the row.
+ * @param values Counts of the row.
+ */
+static void format_row(char line[OVERLAY_LINE_LENGTH], const char* name, const double values[COUNT_FIELDS])
+{
+    (void)sprintf_s(
+        line,
+        OVERLAY_LINE_LENGTH,
+        "%-12s%7.0f%9.0f%8.0f%8.0f%8.0f%7.0f",
+        name,
+        values[0],
+        values[1],
+        values[2],
+        values[3],
+        values[4],
+        values[5]
+    );
+}
+
+/**
+ * @brief Formats the header and one row per pass and total of a frame.
+ *
+ * @param lines Output text, RENDER_PASS_COUNT + 2 lines.
+ * @param frame Counts of the frame.
+ */
+static void format_table(char lines[][OVERLAY_LINE_LENGTH], const gl_trace_frame* frame)
+{
+    (void)sprintf_s(
+        lines[0],
+        OVERLAY_LINE_LENGTH,
+        "%-12s%7s%9s%8s%8s%8s%7s",
+        "pass", "draws", "vertices", "begins", "states", "pushes", "binds"
+    );
+
+    for (int pass = 0; pass <= RENDER_PASS_COUNT; ++pass)
+    {
+        int    counts[COUNT_FIELDS];
+        double values[COUNT_FIELDS];
+        list_values(pass < RENDER_PASS_COUNT ? &frame->passes[pass] : &frame->total, counts);
+        for (int i = 0; i < COUNT_FIELDS; ++i)
+        {
+            values[i] = counts[i];
+        }
+        format_row(
+            lines[pass + 1],
+            pass < RENDER_PASS_COUNT ? renderer_pass_name((render_pass)pass) : "total",
+            values
+        );
+    }
+}
+
+/**
+ * @brief Draws the counts of the last frame over the current framebuffer.
+ *
+ * The table is drawn in the top left corner on a translucent backdrop.
+ * Lighting, fog, texturing and depth testing are turned off through
+ * the state cache while drawing and turned back on afterwards.
+ *
+ * @param width  Width of the framebuffer in pixels.
+ * @param height Height of the framebuffer in pixels.
+ */
+void gl_trace_draw_overlay(int width, int height)
+{
+    if (!gl_trace_overlay_on || renderer_backend != RENDER_BACKEND_FIXED)
+    {
+        return;
+    }
+
+    char lines[RENDER_PASS_COUNT + 2][OVERLAY_LINE_LENGTH];
+    int  line_count = 1;
+    if (GL_TRACE)
+    {
+        format_table(lines, &last_frame);
+        line_count = RENDER_PASS_COUNT + 2;
+    }
+    else
+    {
+        (void)sprintf_s(lines[0], OVERLAY_LINE_LENGTH, "OpenGL call counting is compiled out");
+    }
+
+    glMatrixMode(GL_PROJECTION);
+    glPushMatrix();
+    glLoadIdentity();
+    glOrtho(0.0, (GLdouble)width, 0.0, (GLdouble)height, -1.0, 1.0);
+    glMatrixMode(GL_MODELVIEW);
+    glPushMatrix();
+    glLoadIdentity();
+
+    gl_state_enable(GL_LIGHTING, 0);
+    gl_state_enable(GL_FOG, 0);
+    gl_state_enable(GL_TEXTURE_2D, 0);
+    gl_state_enable(GL_DEPTH_TEST, 0);
+
+    const int right  = OVERLAY_MARGIN * 2 + (int)strlen(lines[0]) * OVERLAY_CHARACTER_SIZE;
+    const int top    = height - OVERLAY_MARGIN;
+    const int bottom = top - OVERLAY_MARGIN - line_count * OVERLAY_LINE_HEIGHT;
+
+    glColor4f(0.0f, 0.0f, 0.0f, 0.6f);
+    glBegin(GL_QUADS);
+        glVertex2i(0, bottom);
+        glVertex2i(right, bottom);
+        glVertex2i(right, height);
+        glVertex2i(0, height);
+    glEnd();
+
+    glColor4f(1.0f, 1.0f, 1.0f, 1.0f);
+    for (int i = 0; i < line_count; ++i)
+    {
+        glRasterPos2i(OVERLAY_MARGIN, top - (i + 1) * OVERLAY_LINE_HEIGHT);
+        glutBitmapString(OVERLAY_FONT, (const unsigned char*)lines[i]);
+    }
+
+    gl_state_enable(GL_DEPTH_TEST, 1);
+    gl_state_enable(GL_TEXTURE_2D, 1);
+    gl_state_enable(GL_FOG, fog_on);
+    gl_state_enable(GL_LIGHTING, 1);
+
+    glPopMatrix();
+    glMatrixMode(GL_PROJECTION);
+    glPopMatrix();
+    glMatrixMode(GL_MODELVIEW);
+}
+
+/**
+ * @brief Prints the counts of the last frame and the mean of all frames.
+ */
+void gl_trace_print(void)
+{
+    if (!GL_TRACE)
+    {
+        printf("OpenGL call counting is compiled out.\n\n");
+        return;
+    }
+    if (frames_counted == 0)
+    {
+        return;
+    }
+
+    char lines[RENDER_PASS_COUNT + 2][OVERLAY_LINE_LENGTH];
+
+    printf("OpenGL calls of the last frame\n");
+    printf("-------------------\n");
+    format_table(lines, &last_frame);
+    for (int i = 0; i < RENDER_PASS_COUNT + 2; ++i)
+    {
+        printf("%s\n", lines[i]);
+    }
+    printf("\n");
+
+    printf("OpenGL calls per frame (mean of %ld frames)\n", frames_counted);
+    printf("-------------------\n");
+    printf("%s\n", lines[0]);
+    for (int pass = 0; pass <= RENDER_PASS_COUNT; ++pass)
+    {
+        double values[COUNT_FIELDS];
+        for (int i = 0; i < COUNT_FIELDS; ++i)
+        {
+            values[i] = sums[pass][i] / frames_counted;
+        }
+        format_row(
+            lines[pass + 1],
+            pass < RENDER_PASS_COUNT ? renderer_pass_name((render_pass)pass) : "total",
+            values
+        );
+        printf("%s\n", lines[pass + 1]);
+    }
+    printf("\n");
+}
+
+/**
+ * @brief Starts counting the calls recorded into a display list.
+ *
+ * Lists beyond GL_TRACE_MAX_DISPLAY_LISTS are recorded uncounted.
+ *
+ * @param list Name of the display list.
+ */
+void gl_trace_new_list(GLuint list)
+{
+    counting_before_list = gl_trace_counting;
+    gl_trace_counting    = &ignored;
+
+    if (list < GL_TRACE_MAX_DISPLAY_LISTS)
+    {
+        memset(&list_counts[list], 0, sizeof(list_counts[list]));
+        gl_trace_counting = &list_counts[list];
+    }
+}
+
+/**
+ * @brief Stops counting the calls recorded into a display list.
+ */
+void gl_trace_end_list(void)
+{
+    gl_trace_counting    = counting_before_list;
+    counting_before_list = NULL;
+}
+
+/**
+ * @brief Counts a replayed display list with the calls recorded into it.
+ *
+ * The replay is a single draw call of the application, the blocks,
+ * vertices and state changes recorded into the list are counted as
+ * if they were made again.
+ *
+ * @param list Name of the display list.
+ */
+void gl_trace_call_list(GLuint list)
+{
+    gl_trace_counts* counting = gl_trace_counting;
+
+    if (list < GL_TRACE_MAX_DISPLAY_LISTS)
+    {
+        const int draws = counting->draws;
+        add_counts(counting, &list_counts[list]);
+        counting->draws = draws;
+    }
+    ++counting->draws;
+}
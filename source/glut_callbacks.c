@@ -11,103 +11,151 @@
 
 #include "glut_callbacks.h"
 
-#include "boids/boids.h"
+#include "benchmark.h"
 #include "camera.h"
+#include "capture.h"
+#include "debug_draw.h"
+#include "dynamic_resolution.h"
+#include "frame_pacing.h"
+#include "frame_stats.h"
+#include "gl_trace.h"
+#include "options.h"
 #include "renderer.h"
+#include "simulation.h"
 #include "submarine.h"
-#include "water.h"
+#include "texture.h"
+#include "timer.h"
 #include "window.h"
 
+#include <stdio.h>
+
+
+ /**
+  * @brief Steps, renders and times one frame of a benchmark.
+  *
+  * The time is taken like in headless mode, from the simulation step
+  * until OpenGL finished the frame, and excludes the buffer swap. The
+  * results are reported and GLUT exits once the path ends.
+  */
+static void draw_benchmark_frame(void)
+{
+    const double start_ms = timer_now_ms();
+    simulation_step();
+    callback_render_frame();
+    glFinish();
+    const int finished = benchmark_end_frame(timer_now_ms() - start_ms);
+
+    renderer_present();
+
+    if (finished)
+    {
+        benchmark_report(main_options.benchmark_json_file);
+        benchmark_clean_up();
+        capture_stop();
+        gl_trace_close_csv();
+        glutExit();
+    }
+}
 
  /**
   * @brief GLUT display callback.
   *
-  * Clears the buffers, sets up the camera view with gluLookAt,
-  * configures lighting, calls the renderer to draw the scene,
-  * and swaps buffers to display the rendered frame.
+  * Renders the frame and presents it through the render backend.
   */
 void callback_display(void)
 {
-    // Clear color and depth buffers to prepare for new frame rendering.
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-    // Reset the model-view matrix.
-    glLoadIdentity();
-
-    // Setup camera view based on current camera position and look_at target.
-    gluLookAt(
-        main_camera.position[0], 
-        main_camera.position[1], 
-        main_camera.position[2],
-        main_camera.look_at[0], 
-        main_camera.look_at[1], 
-        main_camera.look_at[2],
-        0.0, 
-        1.0, 
-        0.0
-    );
-
-    // Set light position for the scene.
-    const GLfloat light_position[4] = { 0.0f, 10.0f, 0.0f };
-    glLightfv(GL_LIGHT0, GL_POSITION, light_position);
+    if (benchmark_active())
+    {
+        draw_benchmark_frame();
+        return;
+    }
 
-    // Call the renderer to draw all scene objects.
-    renderer_draw();
+    callback_render_frame();
 
     // Swap front and back buffers to display the rendered image.
-    glutSwapBuffers();
+    renderer_present();
+}
+
+/**
+ * @brief Renders one frame into the current framebuffer.
+ *
+ * Calls the renderer to draw the scene as recorded in the latest
+ * simulation snapshot. The renderer clears the buffers and builds
+ * the camera view and projection from the snapshot.
+ */
+void callback_render_frame(void)
+{
+    frame_stats_begin_frame();
+
+    const simulation_snapshot* snapshot = simulation_acquire_snapshot();
+
+    // Call the renderer to draw all scene objects.
+    renderer_draw(snapshot);
+    frame_pacing_frame_drawn(snapshot->step);
+
+    gl_trace_draw_overlay(main_window.width, main_window.height);
+
+    // Queue the read back of the frame before it is swapped.
+    capture_frame(main_window.width, main_window.height);
+
+    frame_stats_end_frame();
 }
 
 /**
  * @brief GLUT reshape callback.
  *
- * Updates the OpenGL viewport and projection matrix whenever
- * the window size changes to maintain correct aspect ratio.
+ * Updates the OpenGL viewport whenever the window size changes. The
+ * renderer derives the aspect ratio of the projection from the size.
  *
  * @param width  New window width.
  * @param height New window height.
  */
 void callback_reshape(int width, int height)
 {
+    // Remember the new window size for screen-space calculations.
+    main_window.width  = width;
+    main_window.height = height;
+
     // Set viewport to cover the entire new window.
     glViewport(0, 0, width, height);
 
-    // Switch to projection matrix mode to update projection.
-    glMatrixMode(GL_PROJECTION);
-    glLoadIdentity();
-
-    // Calculate the aspect ratio to avoid distortion.
-    const double aspect = (double)width / (double)height;
-
-    // Setup perspective projection with current
-    // camera FOV and near/far clipping planes.
-    gluPerspective(
-        main_camera.fov, 
-        aspect, 
-        DEFAULT_CAMERA_NEAR_PLANE, 
-        DEFAULT_CAMERA_FAR_PLANE
-    );
+    frame_pacing_invalidate();
+}
 
-    // Switch back to model-view matrix mode for further transformations.
-    glMatrixMode(GL_MODELVIEW);
+/**
+ * @brief GLUT window status callback.
+ *
+ * Stops drawing while the window is hidden or minimized.
+ *
+ * @param state GLUT_VISIBLE, GLUT_PARTIALLY_RETAINED, GLUT_FULLY_RETAINED
+ *              or GLUT_FULLY_COVERED, GLUT_HIDDEN when minimized.
+ */
+void callback_window_status(int state)
+{
+    frame_pacing_set_visible(state != GLUT_HIDDEN && state != GLUT_FULLY_COVERED);
 }
 
 /**
  * @brief GLUT idle callback.
  *
- * Called when the application is idle. Used here as the main update loop.
- * Updates the water simulation, submarine state, camera, and boids,
- * then triggers a redisplay to refresh the screen.
+ * Called when the application is idle. Steps the simulation here only
+ * if it has no thread of its own and no benchmark steps it per frame.
+ * Then sleeps until the next frame is due and triggers a redisplay to
+ * draw the latest snapshot, unless the window is hidden or nothing
+ * changed since the last frame.
  */
 void callback_idle(void)
 {
-    water_update();
-    submarine_update();
-    camera_update();
-    boids_update();
+    if (!simulation_thread_running() && !benchmark_active())
+    {
+        simulation_step();
+    }
 
-    // Request GLUT to redraw the window.
-    glutPostRedisplay();
+    // Request GLUT to redraw the window once the frame is due.
+    if (frame_pacing_wait(simulation_acquire_snapshot()->step))
+    {
+        glutPostRedisplay();
+    }
 }
 
 /**
@@ -135,6 +183,8 @@ void callback_passive_motion(int x, int y)
     GLint mouse_delta_x = x - main_window.mouse_x;
     GLint mouse_delta_y = y - main_window.mouse_y;
 
+    simulation_lock();
+
     // Update camera horizontal angle (theta)
     // based on horizontal mouse movement.
     main_camera.theta += (GLfloat)mouse_delta_x * main_window.mouse_sensitivity;
@@ -153,6 +203,8 @@ void callback_passive_motion(int x, int y)
         main_camera.phi = -PI / 2 + 0.01f;
     }
 
+    simulation_unlock();
+
     // Update stored mouse position.
     main_window.mouse_x = x;
     main_window.mouse_y = y;
@@ -171,6 +223,8 @@ void callback_passive_motion(int x, int y)
  */
 void callback_keyboard_up(unsigned char key, int x, int y)
 {
+    simulation_lock();
+
     // Stop movement in the relevant direction when key released.
     switch (key)
     {
@@ -208,6 +262,8 @@ void callback_keyboard_up(unsigned char key, int x, int y)
     {
         object_submarine.speed = 0.0f;
     }
+
+    simulation_unlock();
 }
 
 /**
@@ -223,6 +279,10 @@ void callback_keyboard_up(unsigned char key, int x, int y)
  */
 void callback_keyboard(unsigned char key, int x, int y)
 {
+    int quit = 0;  // set to 1 to quit once the simulation state is unlocked.
+
+    simulation_lock();
+
     switch (key)
     {
     case 'w':
@@ -277,20 +337,97 @@ void callback_keyboard(unsigned char key, int x, int y)
 
     case 'b':
         // Toggle OpenGL fog effect.
-        if (fog_on)
+        renderer_set_fog(!fog_on, fog_density);
+        break;
+
+    case '[':
+        // Thin out the fog.
+        renderer_set_fog(fog_on, fog_density / FOG_DENSITY_STEP);
+        break;
+
+    case ']':
+        // Thicken the fog.
+        renderer_set_fog(fog_on, fog_density * FOG_DENSITY_STEP);
+        break;
+
+    case 'c':
+        // Toggle render path frame time comparison.
+        frame_stats_toggle_comparison();
+        break;
+
+    case 't':
+        // Print texture streaming statistics.
+        texture_print_stats();
+        break;
+
+    case ',':
+        // Halve the texture memory budget, which evicts unused levels.
+        main_options.texture_budget_mb /= 2.0;
+        texture_set_memory_budget((size_t)(main_options.texture_budget_mb * 1024.0 * 1024.0));
+        break;
+
+    case '.':
+        // Double the texture memory budget.
+        main_options.texture_budget_mb *= 2.0;
+        texture_set_memory_budget((size_t)(main_options.texture_budget_mb * 1024.0 * 1024.0));
+        break;
+
+    case 'v':
+        // Toggle view-frustum culling.
+        culling_on = !culling_on;
+        break;
+
+    case 'o':
+        // Toggle occlusion culling.
+        occlusion_on = !occlusion_on;
+        break;
+
+    case 'r':
+        // Toggle dynamic resolution scaling.
+        dynamic_resolution_enable(
+            !dynamic_resolution_enabled(),
+            main_options.dynamic_resolution_ms > 0.0 ?
+                main_options.dynamic_resolution_ms :
+                DYNAMIC_RESOLUTION_DEFAULT_TARGET_MS
+        );
+        break;
+
+    case 'g':
+        // Toggle the OpenGL call count overlay.
+        gl_trace_overlay_on = !gl_trace_overlay_on;
+        if (gl_trace_overlay_on && renderer_backend != RENDER_BACKEND_FIXED)
         {
-            glDisable(GL_FOG);
+            printf("The call count overlay needs the fixed backend, 'p' prints the counts.\n\n");
+        }
+        break;
+
+#if DEBUG_DRAW
+    case 'x':
+        // Toggle debug lines, including the origin marker.
+        debug_draw_on = !debug_draw_on;
+        break;
+#endif
+
+    case 'k':
+        // Toggle frame capture.
+        if (capture_active())
+        {
+            capture_stop();
         }
         else
         {
-            glEnable(GL_FOG);
+            capture_start(main_options.capture_format);
         }
-        fog_on = !fog_on;
+        break;
+
+    case 'p':
+        // Print the statistics of the last frame.
+        frame_stats_print();
         break;
 
     case 'q':
         // Quit the application cleanly.
-        glutExit();
+        quit = 1;
         break;
 
     default:
@@ -303,6 +440,19 @@ void callback_keyboard(unsigned char key, int x, int y)
     {
         object_submarine.speed = SUBMARINE_SPEED;
     }
+
+    simulation_unlock();
+
+    // Settings changed by keys are not part of the snapshot.
+    frame_pacing_invalidate();
+
+    if (quit)
+    {
+        // Write the frames still in flight, GLUT exits without returning.
+        capture_stop();
+        gl_trace_close_csv();
+        glutExit();
+    }
 }
 
 /**
@@ -317,6 +467,8 @@ void callback_keyboard(unsigned char key, int x, int y)
  */
 void callback_special_up(int key, int x, int y)
 {
+    simulation_lock();
+
     if (key == GLUT_KEY_UP &&
         object_submarine.direction[1] > 0.0f)
     {
@@ -333,6 +485,8 @@ void callback_special_up(int key, int x, int y)
     {
         object_submarine.speed = 0.0f;
     }
+
+    simulation_unlock();
 }
 
 /**
@@ -347,6 +501,8 @@ void callback_special_up(int key, int x, int y)
  */
 void callback_special(int key, int x, int y)
 {
+    simulation_lock();
+
     if (key == GLUT_KEY_UP)
     {
         // Move submarine up along the y-axis.
@@ -363,4 +519,6 @@ void callback_special(int key, int x, int y)
     {
         object_submarine.speed = SUBMARINE_SPEED;
     }
+
+    simulation_unlock();
 }
@@ -0,0 +1,512 @@
+/**
+ * @file headless.c
+ * @brief Implements offscreen rendering and frame time reporting.
+ */
+
+
+#include "headless.h"
+
+#include "benchmark.h"
+#include "capture.h"
+#include "dynamic_resolution.h"
+#include "gl_extensions.h"
+#include "frame_stats.h"
+#include "gl_trace.h"
+#include "glut_callbacks.h"
+#include "options.h"
+#include "png.h"
+#include "renderer.h"
+#include "simulation.h"
+#include "texture.h"
+#include "timer.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifndef HEADLESS_EGL
+#define HEADLESS_EGL 0  // defined as 1 by builds that link against libEGL
+#endif
+
+#if HEADLESS_EGL
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+
+#if HEADLESS_EGL
+
+/**
+ * @brief Frame statistics summed over all headless frames.
+ */
+typedef struct {
+    long   draw_calls;        // draw calls issued
+    long   state_calls;       // state changes issued
+    double drawn_scale;       // drawn fraction of the framebuffer width
+    double record_ms;         // time spent recording the draw lists in milliseconds
+    long   boid_pyramids;     // visible boids drawn as pyramids
+    long   boid_impostors;    // visible boids drawn as impostor quads
+    long   point_lights;      // point lights reaching the view
+    long   light_refs;        // lights listed in the clusters
+    double light_ms;          // time spent sorting the point lights into clusters in milliseconds
+    long   raster_triangles;  // triangles rasterized by the software backend
+    long   raster_fragments;  // fragments shaded by the software backend
+    double raster_ms;         // time the software backend spent drawing in milliseconds
+} frame_totals;
+
+
+static EGLDisplay egl_display = EGL_NO_DISPLAY;  // display of the offscreen context
+static EGLContext egl_context = EGL_NO_CONTEXT;  // offscreen context, current while running
+
+static GLuint framebuffer        = 0;  // offscreen framebuffer, 0 until created
+static GLuint color_renderbuffer = 0;  // RGBA color attachment, 0 until created
+static GLuint depth_renderbuffer = 0;  // depth attachment, 0 until created
+
+
+/**
+ * @brief Looks up OpenGL entry points through EGL.
+ *
+ * @param name Name of the function.
+ * @return GLUTproc The entry point, or NULL if it is not exported.
+ */
+static GLUTproc get_egl_proc_address(const char* name)
+{
+    return (GLUTproc)eglGetProcAddress(name);
+}
+
+/**
+ * @brief Creates a surfaceless OpenGL context and makes it current.
+ *
+ * Prefers the Mesa surfaceless platform, which needs no display server,
+ * and falls back to the default display.
+ *
+ * @return int Returns 1 on success, 0 otherwise.
+ */
+static int create_context(void)
+{
+    PFNEGLGETPLATFORMDISPLAYEXTPROC get_platform_display =
+        (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+    if (get_platform_display != NULL)
+    {
+        egl_display = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+    }
+    if (egl_display == EGL_NO_DISPLAY)
+    {
+        egl_display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    }
+
+    EGLint major = 0;
+    EGLint minor = 0;
+    if (egl_display == EGL_NO_DISPLAY || !eglInitialize(egl_display, &major, &minor))
+    {
+        printf("Could not initialize EGL.\n");
+        return 0;
+    }
+
+    if (!eglBindAPI(EGL_OPENGL_API))
+    {
+        printf("EGL does not support desktop OpenGL.\n");
+        return 0;
+    }
+
+    const EGLint config_attributes[] = {
+        EGL_SURFACE_TYPE,    EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_NONE
+    };
+    EGLConfig config       = NULL;
+    EGLint    config_count = 0;
+    (void)eglChooseConfig(egl_display, config_attributes, &config, 1, &config_count);
+
+    // The core backend gets an OpenGL 3.3 core profile, the fixed-function
+    // backend a compatibility profile. The fixed-function backend is used
+    // if the core profile cannot be created.
+    if (main_options.backend == RENDER_BACKEND_CORE)
+    {
+        const EGLint core_attributes[] = {
+            EGL_CONTEXT_MAJOR_VERSION,       3,
+            EGL_CONTEXT_MINOR_VERSION,       3,
+            EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+            EGL_NONE
+        };
+        egl_context = eglCreateContext(
+            egl_display,
+            config_count > 0 ? config : NULL,
+            EGL_NO_CONTEXT,
+            core_attributes
+        );
+        if (egl_context == EGL_NO_CONTEXT)
+        {
+            printf("Could not create an OpenGL 3.3 core profile context, using the fixed backend.\n");
+            main_options.backend = RENDER_BACKEND_FIXED;
+        }
+    }
+    if (egl_context == EGL_NO_CONTEXT)
+    {
+        egl_context = eglCreateContext(
+            egl_display,
+            config_count > 0 ? config : NULL,
+            EGL_NO_CONTEXT,
+            NULL
+        );
+    }
+    if (egl_context == EGL_NO_CONTEXT ||
+        !eglMakeCurrent(egl_display, EGL_NO_SURFACE, EGL_NO_SURFACE, egl_context))
+    {
+        printf("Could not create a surfaceless OpenGL context.\n");
+        return 0;
+    }
+
+    printf("Headless EGL %d.%d: %s\n\n", major, minor, (const char*)glGetString(GL_RENDERER));
+    return 1;
+}
+
+/**
+ * @brief Releases the offscreen context.
+ */
+static void destroy_context(void)
+{
+    if (egl_display == EGL_NO_DISPLAY)
+    {
+        return;
+    }
+
+    (void)eglMakeCurrent(egl_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    if (egl_context != EGL_NO_CONTEXT)
+    {
+        (void)eglDestroyContext(egl_display, egl_context);
+        egl_context = EGL_NO_CONTEXT;
+    }
+    (void)eglTerminate(egl_display);
+    egl_display = EGL_NO_DISPLAY;
+}
+
+/**
+ * @brief Creates and binds the offscreen framebuffer.
+ *
+ * A surfaceless context has no default framebuffer, so color and depth
+ * renderbuffers of the requested size are attached to one.
+ *
+ * @param width  Width in pixels.
+ * @param height Height in pixels.
+ * @return int Returns 1 if the framebuffer is complete, 0 otherwise.
+ */
+static int create_framebuffer(int width, int height)
+{
+    if (!gl_extensions.framebuffer_objects)
+    {
+        printf("Headless rendering needs framebuffer objects.\n");
+        return 0;
+    }
+
+    glGenRenderbuffers(1, &color_renderbuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, color_renderbuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+
+    glGenRenderbuffers(1, &depth_renderbuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, depth_renderbuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glGenFramebuffers(1, &framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, color_renderbuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depth_renderbuffer);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+    {
+        printf("The offscreen framebuffer of %dx%d is incomplete.\n", width, height);
+        return 0;
+    }
+    return 1;
+}
+
+/**
+ * @brief Deletes the offscreen framebuffer and its renderbuffers.
+ */
+static void destroy_framebuffer(void)
+{
+    if (!gl_extensions.framebuffer_objects)
+    {
+        return;
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    if (framebuffer != 0)
+    {
+        glDeleteFramebuffers(1, &framebuffer);
+        framebuffer = 0;
+    }
+
+    GLuint* renderbuffers[] = { &color_renderbuffer, &depth_renderbuffer };
+    for (int i = 0; i < 2; ++i)
+    {
+        if (*renderbuffers[i] != 0)
+        {
+            glDeleteRenderbuffers(1, renderbuffers[i]);
+            *renderbuffers[i] = 0;
+        }
+    }
+}
+
+/**
+ * @brief Checks if a frame was selected with --dump-frames.
+ *
+ * @param frame Frame number, counted from 1.
+ * @return int Returns 1 if the frame is saved, 0 otherwise.
+ */
+static int is_dumped_frame(int frame)
+{
+    for (int i = 0; i < main_options.dump_frame_count; ++i)
+    {
+        if (main_options.dump_frames[i] == frame)
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Reads the offscreen framebuffer back and saves it as PNG.
+ *
+ * @param frame  Frame number, counted from 1.
+ * @param pixels Buffer of width * height * 3 bytes.
+ */
+static void dump_frame(int frame, unsigned char* pixels)
+{
+    const int width  = main_options.width;
+    const int height = main_options.height;
+
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, pixels);
+
+    char file_path[64];
+    (void)sprintf_s(file_path, sizeof(file_path), HEADLESS_DUMP_FILE_FORMAT, frame);
+    if (png_write_rgb(file_path, width, height, pixels, 1))
+    {
+        printf("Saved frame %d to %s.\n", frame, file_path);
+    }
+}
+
+/**
+ * @brief Prints the mean and percentiles of the measured frame times.
+ *
+ * Also prints the mean driver calls per frame, so runs of
+ * different backends can be compared, and the mean drawn
+ * resolution if dynamic resolution is enabled.
+ *
+ * @param times  Frame times in milliseconds, sorted in place.
+ * @param count  Number of frame times.
+ * @param totals Frame statistics summed over all frames.
+ */
+static void print_frame_times(double* times, int count, const frame_totals* totals)
+{
+    const double percentiles[] = { 50.0, 90.0, 95.0, 99.0 };
+
+    double total = 0.0;
+    for (int i = 0; i < count; ++i)
+    {
+        total += times[i];
+    }
+    frame_stats_sort_times(times, count);
+
+    printf(
+        "Headless frame times (%d frames, %dx%d, %s backend, %s)\n",
+        count,
+        main_options.width,
+        main_options.height,
+        renderer_backend_name(renderer_backend),
+        renderer_backend == RENDER_BACKEND_FIXED ? renderer_path_name(mesh_render_path) : "no render paths"
+    );
+    printf("-------------------\n");
+    printf("min:\t%.3f ms\n", times[0]);
+    for (int i = 0; i < (int)(sizeof(percentiles) / sizeof(percentiles[0])); ++i)
+    {
+        printf("p%.0f:\t%.3f ms\n", percentiles[i], frame_stats_percentile(times, count, percentiles[i]));
+    }
+    printf("max:\t%.3f ms\n", times[count - 1]);
+    printf("mean:\t%.3f ms\n", total / count);
+    printf(
+        "calls:\t%.1f draw calls, %.1f state changes per frame\n",
+        (double)totals->draw_calls / count,
+        (double)totals->state_calls / count
+    );
+    printf(
+        "record:\t%.4f ms per frame on %d thread%s, %s draw order\n",
+        totals->record_ms / count,
+        current_frame_stats.record_threads,
+        current_frame_stats.record_threads == 1 ? "" : "s",
+        renderer_draw_order_name(main_options.draw_order)
+    );
+    printf(
+        "boids:\t%.1f pyramids, %.1f impostors per frame\n",
+        (double)totals->boid_pyramids / count,
+        (double)totals->boid_impostors / count
+    );
+    texture_streaming_stats textures;
+    texture_get_streaming_stats(&textures);
+    printf(
+        "textures:\t%d mip levels resident, %zu of %zu bytes, %d streamed in, %d evicted\n",
+        textures.resident_levels,
+        textures.resident_bytes,
+        textures.budget_bytes,
+        textures.levels_streamed,
+        textures.levels_evicted
+    );
+    if (main_options.point_lights > 0)
+    {
+        printf(
+            "lights:\t%.1f of %d point lights in view, %.1f cluster entries in %.4f ms per frame\n",
+            (double)totals->point_lights / count,
+            main_options.point_lights,
+            (double)totals->light_refs / count,
+            totals->light_ms / count
+        );
+    }
+    if (renderer_backend == RENDER_BACKEND_SOFTWARE)
+    {
+        printf(
+            "raster:\t%.1f triangles, %.1f fragments in %.3f ms per frame on %d thread%s\n",
+            (double)totals->raster_triangles / count,
+            (double)totals->raster_fragments / count,
+            totals->raster_ms / count,
+            current_frame_stats.raster_threads,
+            current_frame_stats.raster_threads == 1 ? "" : "s"
+        );
+    }
+    if (capture_active())
+    {
+        capture_stats capture;
+        capture_get_stats(&capture);
+        printf(
+            "capture:\t%.3f ms per frame on the render thread, %d frames read, %d dropped\n",
+            capture.total_overhead_ms / count,
+            capture.frames_read,
+            capture.frames_dropped
+        );
+    }
+    if (dynamic_resolution_enabled())
+    {
+        dynamic_resolution_status resolution;
+        dynamic_resolution_get_status(&resolution);
+        printf(
+            "scale:\t%.1f%% mean, %.1f%% last, %s at %.3f ms for a %.3f ms target\n",
+            totals->drawn_scale / count * 100.0,
+            resolution.scale * 100.0f,
+            dynamic_resolution_state_name(resolution.state),
+            resolution.smoothed_ms,
+            resolution.target_ms
+        );
+    }
+    printf("\n");
+}
+
+#endif
+
+/**
+ * @brief Renders main_options.headless_frames frames offscreen.
+ *
+ * The simulation is stepped on the calling thread, once per frame, so
+ * runs are reproducible. A benchmark path replaces the frame count
+ * with its own and is reported at the end. Each frame is timed on the CPU clock from the
+ * simulation step to the end of drawing. glFinish is included, so work
+ * the driver defers is counted in the frame that issued it.
+ *
+ * @return int Exit code, 0 on success.
+ */
+int headless_run(void)
+{
+#if HEADLESS_EGL
+    const int frame_count = benchmark_active() ? benchmark_frame_count() : main_options.headless_frames;
+
+    if (!create_context())
+    {
+        destroy_context();
+        return 1;
+    }
+    gl_extensions_set_loader(get_egl_proc_address);
+
+    if (!renderer_initialize())
+    {
+        destroy_context();
+        return 1;
+    }
+    simulation_initialize();
+
+    double*        times  = malloc((size_t)frame_count * sizeof(double));
+    unsigned char* pixels = NULL;
+    if (main_options.dump_frame_count > 0)
+    {
+        pixels = malloc((size_t)main_options.width * (size_t)main_options.height * 3);
+    }
+
+    int exit_code = 1;
+    if (times != NULL &&
+        (pixels != NULL || main_options.dump_frame_count == 0) &&
+        create_framebuffer(main_options.width, main_options.height))
+    {
+        callback_reshape(main_options.width, main_options.height);
+        if (main_options.capture_on)
+        {
+            capture_start(main_options.capture_format);
+        }
+        if (main_options.gl_trace_file != NULL)
+        {
+            gl_trace_open_csv(main_options.gl_trace_file);
+        }
+
+        frame_totals totals = { 0, 0, 0.0, 0.0, 0, 0, 0, 0, 0.0, 0, 0, 0.0 };
+        for (int frame = 1; frame <= frame_count; ++frame)
+        {
+            const double start_ms = timer_now_ms();
+            simulation_step();
+            callback_render_frame();
+            glFinish();
+            times[frame - 1] = timer_now_ms() - start_ms;
+            if (benchmark_active())
+            {
+                (void)benchmark_end_frame(times[frame - 1]);
+            }
+
+            totals.draw_calls       += current_frame_stats.draw_calls;
+            totals.state_calls      += current_frame_stats.state_calls_issued;
+            totals.drawn_scale      += (double)current_frame_stats.resolution_width / main_options.width;
+            totals.record_ms        += current_frame_stats.record_time_ms;
+            totals.boid_pyramids    += current_frame_stats.boid_pyramids;
+            totals.boid_impostors   += current_frame_stats.boid_impostors;
+            totals.point_lights     += current_frame_stats.point_lights;
+            totals.light_refs       += current_frame_stats.light_cluster_refs;
+            totals.light_ms         += current_frame_stats.light_assign_time_ms;
+            totals.raster_triangles += current_frame_stats.raster_triangles;
+            totals.raster_fragments += current_frame_stats.raster_fragments;
+            totals.raster_ms        += current_frame_stats.raster_time_ms;
+
+            if (pixels != NULL && is_dumped_frame(frame))
+            {
+                dump_frame(frame, pixels);
+            }
+        }
+
+        print_frame_times(times, frame_count, &totals);
+        gl_trace_print();
+        benchmark_report(main_options.benchmark_json_file);
+        exit_code = 0;
+    }
+    capture_stop();
+    gl_trace_close_csv();
+    benchmark_clean_up();
+
+    free(pixels);
+    free(times);
+
+    destroy_framebuffer();
+    simulation_clean_up();
+    renderer_clean_up();
+    destroy_context();
+
+    return exit_code;
+#else
+    printf("Headless rendering needs a build with HEADLESS_EGL defined as 1 and libEGL.\n");
+    return 1;
+#endif
+}
@@ -0,0 +1,350 @@
+/**
+ * @file impostor.c
+ * @brief Implements the impostor atlas and the camera-facing impostor quads.
+ *
+ * Cell v of the atlas shows the shape with the sine of the angle between
+ * its forward axis and the direction to the viewer at -1 + 2v / (n - 1),
+ * so the first cell looks at its back and the last one at its front. In
+ * every cell the projected forward axis points along s.
+ */
+
+
+#include "impostor.h"
+
+#include "gl_state.h"
+#include "gl_trace.h"
+
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+
+
+#define ATLAS_WIDTH   IMPOSTOR_CELL_SIZE                          // texels across the atlas
+#define ATLAS_HEIGHT  (IMPOSTOR_CELL_SIZE * IMPOSTOR_VIEW_COUNT)  // cells stacked along t
+#define CELL_SAMPLES  (IMPOSTOR_CELL_SIZE * IMPOSTOR_SAMPLES)     // samples across one cell
+
+#define SHADE_MINIMUM    0.35f  // shade of faces seen edge-on
+#define SHADE_BACKGROUND 0.6f   // shade of uncovered texels, so filtering does not darken the outline
+
+
+static unsigned char atlas_texels[ATLAS_HEIGHT * ATLAS_WIDTH * 4];  // RGBA texels of the last atlas created
+
+
+/**
+ * @brief Returns the half side of a quad around a sphere of the given radius.
+ *
+ * The quad keeps one uncovered texel along every border of the cell,
+ * so filtering never reaches into the neighbouring cells.
+ *
+ * @param radius Radius of the enclosed sphere.
+ * @return GLfloat Half the side of the quad.
+ */
+static GLfloat quad_extent(GLfloat radius)
+{
+    return radius * (GLfloat)IMPOSTOR_CELL_SIZE / (GLfloat)(IMPOSTOR_CELL_SIZE - 2);
+}
+
+/**
+ * @brief Returns the sine of the viewing angle shown by an atlas cell.
+ *
+ * @param view Index of the cell.
+ * @return GLfloat Forward component towards the viewer, from -1 to 1.
+ */
+static GLfloat view_facing(int view)
+{
+    return -1.0f + 2.0f * (GLfloat)view / (GLfloat)(IMPOSTOR_VIEW_COUNT - 1);
+}
+
+/**
+ * @brief Transforms a vector of the shape into the frame of an atlas cell.
+ *
+ * The frame has x along the projected forward axis, y across it and z
+ * towards the viewer. The shape is turned about y, so its own y axis
+ * stays on the y axis of the cell.
+ *
+ * @param facing Forward component towards the viewer.
+ * @param vector Vector of the shape.
+ * @param result Output vector in the frame of the cell.
+ */
+static void transform_to_cell(GLfloat facing, const vector_3d vector, vector_3d result)
+{
+    const GLfloat across = sqrtf(fmaxf(1.0f - facing * facing, 0.0f));
+
+    // Forward (across, 0, facing), up (-facing, 0, across), right (0, 1, 0).
+    result[0] = -facing * vector[1] + across * vector[2];
+    result[1] = vector[0];
+    result[2] = across * vector[1] + facing * vector[2];
+}
+
+/**
+ * @brief Rasterizes one view of the shape into its atlas cell.
+ *
+ * Every sample keeps the shade of the nearest face covering it, the
+ * texels average the shade of their covered samples.
+ *
+ * @param vertices     Triangle list of the shape.
+ * @param vertex_count Number of vertices.
+ * @param extent       Half the side of the cell in shape units.
+ * @param view         Index of the cell.
+ * @param texels       The RGBA texels of the atlas.
+ */
+static void rasterize_view(
+    const mesh_vertex*   vertices,
+          int            vertex_count,
+          GLfloat        extent,
+          int            view,
+          unsigned char* texels
+)
+{
+    static GLfloat depths[CELL_SAMPLES][CELL_SAMPLES];
+    static GLfloat shades[CELL_SAMPLES][CELL_SAMPLES];
+
+    for (int y = 0; y < CELL_SAMPLES; ++y)
+    {
+        for (int x = 0; x < CELL_SAMPLES; ++x)
+        {
+            depths[y][x] = -FLT_MAX;
+            shades[y][x] = -1.0f;
+        }
+    }
+
+    const GLfloat facing       = view_facing(view);
+    const GLfloat sample_scale = (GLfloat)CELL_SAMPLES / (2.0f * extent);
+
+    for (int first = 0; first + 2 < vertex_count; first += 3)
+    {
+        point_3d  corners[3];
+        vector_3d normal;
+        for (int i = 0; i < 3; ++i)
+        {
+            transform_to_cell(facing, vertices[first + i].position, corners[i]);
+            corners[i][0] = (corners[i][0] + extent) * sample_scale;
+            corners[i][1] = (corners[i][1] + extent) * sample_scale;
+        }
+        transform_to_cell(facing, vertices[first].normal, normal);
+
+        const GLfloat area =
+            (corners[1][0] - corners[0][0]) * (corners[2][1] - corners[0][1]) -
+            (corners[2][0] - corners[0][0]) * (corners[1][1] - corners[0][1]);
+        if (fabsf(area) < 1e-6f)
+        {
+            continue;
+        }
+        const GLfloat shade = SHADE_MINIMUM + (1.0f - SHADE_MINIMUM) * fmaxf(normal[2], 0.0f);
+
+        for (int y = 0; y < CELL_SAMPLES; ++y)
+        {
+            for (int x = 0; x < CELL_SAMPLES; ++x)
+            {
+                const GLfloat px = (GLfloat)x + 0.5f;
+                const GLfloat py = (GLfloat)y + 0.5f;
+
+                GLfloat weights[3];
+                for (int i = 0; i < 3; ++i)
+                {
+                    const GLfloat* a = corners[(i + 1) % 3];
+                    const GLfloat* b = corners[(i + 2) % 3];
+                    weights[i] = ((b[0] - a[0]) * (py - a[1]) - (px - a[0]) * (b[1] - a[1])) / area;
+                }
+                if (weights[0] < 0.0f || weights[1] < 0.0f || weights[2] < 0.0f)
+                {
+                    continue;
+                }
+
+                const GLfloat depth =
+                    weights[0] * corners[0][2] + weights[1] * corners[1][2] + weights[2] * corners[2][2];
+                if (depth > depths[y][x])
+                {
+                    depths[y][x] = depth;
+                    shades[y][x] = shade;
+                }
+            }
+        }
+    }
+
+    for (int t = 0; t < IMPOSTOR_CELL_SIZE; ++t)
+    {
+        for (int s = 0; s < IMPOSTOR_CELL_SIZE; ++s)
+        {
+            int     covered   = 0;
+            GLfloat shade_sum = 0.0f;
+            for (int y = t * IMPOSTOR_SAMPLES; y < (t + 1) * IMPOSTOR_SAMPLES; ++y)
+            {
+                for (int x = s * IMPOSTOR_SAMPLES; x < (s + 1) * IMPOSTOR_SAMPLES; ++x)
+                {
+                    if (shades[y][x] >= 0.0f)
+                    {
+                        ++covered;
+                        shade_sum += shades[y][x];
+                    }
+                }
+            }
+
+            const GLfloat shade = covered > 0 ? shade_sum / (GLfloat)covered : SHADE_BACKGROUND;
+            const GLfloat alpha = (GLfloat)covered / (GLfloat)(IMPOSTOR_SAMPLES * IMPOSTOR_SAMPLES);
+
+            unsigned char* texel = &texels[((view * IMPOSTOR_CELL_SIZE + t) * ATLAS_WIDTH + s) * 4];
+            texel[0] = (unsigned char)(shade * 255.0f + 0.5f);
+            texel[1] = texel[0];
+            texel[2] = texel[0];
+            texel[3] = (unsigned char)(alpha * 255.0f + 0.5f);
+        }
+    }
+}
+
+/**
+ * @brief Rasterizes a triangle list into an impostor atlas texture.
+ *
+ * The texels hold a shade of gray that is modulated by the lit material
+ * color and the coverage of the shape in alpha. Faces turned towards
+ * the viewer are shaded brighter, so the shape keeps its outline and
+ * relief without a normal per texel.
+ *
+ * @param vertices     Triangle list of the shape, normals per face.
+ * @param vertex_count Number of vertices.
+ * @param radius       Radius of a sphere around the origin enclosing the shape.
+ * @return GLuint The texture ID of the atlas.
+ */
+GLuint impostor_create_atlas(const mesh_vertex* vertices, int vertex_count, GLfloat radius)
+{
+    const GLfloat extent = quad_extent(radius);
+    for (int view = 0; view < IMPOSTOR_VIEW_COUNT; ++view)
+    {
+        rasterize_view(vertices, vertex_count, extent, view, atlas_texels);
+    }
+
+    GLuint texture_id = 0;
+    glGenTextures(1, &texture_id);
+    gl_state_bind_texture(texture_id);
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(
+        GL_TEXTURE_2D, 0, GL_RGBA,
+        ATLAS_WIDTH, ATLAS_HEIGHT, 0,
+        GL_RGBA, GL_UNSIGNED_BYTE, atlas_texels
+    );
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    return texture_id;
+}
+
+/**
+ * @brief Returns the texels of the last atlas created.
+ *
+ * @param width  Output width of the atlas in texels.
+ * @param height Output height of the atlas in texels.
+ * @return const unsigned char* RGBA texels row by row from t = 0.
+ */
+const unsigned char* impostor_get_atlas_texels(int* width, int* height)
+{
+    *width  = ATLAS_WIDTH;
+    *height = ATLAS_HEIGHT;
+    return atlas_texels;
+}
+
+/**
+ * @brief Lists the quad of one copy of the shape.
+ *
+ * The quad lies across the direction to the camera. Its s axis follows
+ * the forward axis projected onto the quad, and the forward component
+ * towards the camera selects the atlas cell. A copy pointing straight at
+ * the camera has no projected heading and keeps the camera-facing axis
+ * of the cell it would have turned towards.
+ *
+ * @param position        Position of the copy.
+ * @param direction       Normalized forward axis of the copy.
+ * @param camera_position Position of the camera.
+ * @param radius          Radius the atlas was created with, times the scale of the copy.
+ * @param vertices        Output triangles of the quad.
+ */
+void impostor_list_quad(
+    const point_3d        position,
+    const vector_3d       direction,
+    const point_3d        camera_position,
+          GLfloat         radius,
+          impostor_vertex vertices[IMPOSTOR_VERTEX_COUNT]
+)
+{
+    vector_3d to_camera = {
+        camera_position[0] - position[0],
+        camera_position[1] - position[1],
+        camera_position[2] - position[2]
+    };
+    if (geometry_is_zero_vector(to_camera))
+    {
+        to_camera[2] = 1.0f;
+    }
+    geometry_normalize_vector(to_camera);
+
+    const GLfloat facing =
+        direction[0] * to_camera[0] + direction[1] * to_camera[1] + direction[2] * to_camera[2];
+
+    vector_3d heading = {
+        direction[0] - facing * to_camera[0],
+        direction[1] - facing * to_camera[1],
+        direction[2] - facing * to_camera[2]
+    };
+    if (heading[0] * heading[0] + heading[1] * heading[1] + heading[2] * heading[2] < 1e-8f)
+    {
+        const vector_3d up = { 0.0f, 1.0f, 0.0f };
+        geometry_cross_product(up, to_camera, heading);
+        if (geometry_is_zero_vector(heading))
+        {
+            heading[0] = 1.0f;
+        }
+    }
+    geometry_normalize_vector(heading);
+
+    vector_3d across;
+    geometry_cross_product(to_camera, heading, across);
+
+    int view = (int)floorf((facing + 1.0f) * 0.5f * (GLfloat)(IMPOSTOR_VIEW_COUNT - 1) + 0.5f);
+    if (view < 0)
+    {
+        view = 0;
+    }
+    else if (view >= IMPOSTOR_VIEW_COUNT)
+    {
+        view = IMPOSTOR_VIEW_COUNT - 1;
+    }
+
+    const GLfloat extent   = quad_extent(radius);
+    const GLfloat t_bottom = (GLfloat)view / (GLfloat)IMPOSTOR_VIEW_COUNT;
+    const GLfloat t_top    = (GLfloat)(view + 1) / (GLfloat)IMPOSTOR_VIEW_COUNT;
+
+    // Corners counterclockwise as seen from the camera, as { s, t } signs.
+    const int corners[4][2] = { { -1, -1 }, { 1, -1 }, { 1, 1 }, { -1, 1 } };
+    const int triangles[IMPOSTOR_VERTEX_COUNT] = { 0, 1, 2, 0, 2, 3 };
+
+    for (int i = 0; i < IMPOSTOR_VERTEX_COUNT; ++i)
+    {
+        const int*       corner = corners[triangles[i]];
+        impostor_vertex* vertex = &vertices[i];
+
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            vertex->position[axis] = position[axis] +
+                extent * ((GLfloat)corner[0] * heading[axis] + (GLfloat)corner[1] * across[axis]);
+        }
+        vertex->normal[0]   = to_camera[0];
+        vertex->normal[1]   = to_camera[1];
+        vertex->normal[2]   = to_camera[2];
+        vertex->texcoord[0] = corner[0] < 0 ? 0.0f : 1.0f;
+        vertex->texcoord[1] = corner[1] < 0 ? t_bottom : t_top;
+    }
+}
+
+/**
+ * @brief Frees an impostor atlas texture.
+ *
+ * @param texture_id The texture ID, set to 0.
+ */
+void impostor_destroy_atlas(GLuint* texture_id)
+{
+    if (*texture_id != 0)
+    {
+        glDeleteTextures(1, texture_id);
+        *texture_id = 0;
+    }
+}
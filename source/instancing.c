@@ -0,0 +1,285 @@
+/**
+ * @file instancing.c
+ * @brief Implements instanced drawing of shapes with streamed transforms.
+ */
+
+
+#include "instancing.h"
+
+#include "gl_extensions.h"
+#include "gl_trace.h"
+#include "shader.h"
+
+#include <stddef.h>
+
+
+// Attribute indices, bound in this order when linking.
+enum {
+    ATTRIBUTE_VERTEX_POSITION,
+    ATTRIBUTE_VERTEX_NORMAL,
+    ATTRIBUTE_INSTANCE_POSITION,
+    ATTRIBUTE_INSTANCE_RIGHT,
+    ATTRIBUTE_INSTANCE_UP,
+    ATTRIBUTE_INSTANCE_FORWARD,
+    ATTRIBUTE_COUNT
+};
+
+static const char* const attribute_names[ATTRIBUTE_COUNT] = {
+    "vertex_position",
+    "vertex_normal",
+    "instance_position",
+    "instance_right",
+    "instance_up",
+    "instance_forward"
+};
+
+// Transforms the shape by the instance basis and lights it like GL_LIGHT0
+// in fixed function: infinite viewer, no attenuation, clamped color.
+static const char* const vertex_shader_source =
+    "#version 120\n"
+    "attribute vec3 vertex_position;\n"
+    "attribute vec3 vertex_normal;\n"
+    "attribute vec3 instance_position;\n"
+    "attribute vec3 instance_right;\n"
+    "attribute vec3 instance_up;\n"
+    "attribute vec3 instance_forward;\n"
+    "varying vec4  lit_color;\n"
+    "varying float fog_distance;\n"
+    "void main()\n"
+    "{\n"
+    "    mat3 basis = mat3(instance_right, instance_up, instance_forward);\n"
+    "    vec4 eye_position = gl_ModelViewMatrix *\n"
+    "        vec4(instance_position + basis * vertex_position, 1.0);\n"
+    "    vec3 normal = normalize(gl_NormalMatrix * (basis * vertex_normal));\n"
+    "\n"
+    "    vec4 light_position = gl_LightSource[0].position;\n"
+    "    vec3 light = normalize(light_position.w == 0.0 ?\n"
+    "        light_position.xyz : light_position.xyz - eye_position.xyz);\n"
+    "    float diffuse = max(dot(normal, light), 0.0);\n"
+    "\n"
+    "    vec4 color = gl_FrontLightModelProduct.sceneColor +\n"
+    "                 gl_FrontLightProduct[0].ambient +\n"
+    "                 gl_FrontLightProduct[0].diffuse * diffuse;\n"
+    "    if (diffuse > 0.0)\n"
+    "    {\n"
+    "        vec3 half_vector = normalize(light + vec3(0.0, 0.0, 1.0));\n"
+    "        color += gl_FrontLightProduct[0].specular * pow(\n"
+    "            max(dot(normal, half_vector), 0.0), gl_FrontMaterial.shininess);\n"
+    "    }\n"
+    "    lit_color   = clamp(color, 0.0, 1.0);\n"
+    "    lit_color.a = gl_FrontMaterial.diffuse.a;\n"
+    "\n"
+    "    fog_distance = abs(eye_position.z);\n"
+    "    gl_Position  = gl_ProjectionMatrix * eye_position;\n"
+    "}\n";
+
+// Applies GL_EXP fog when it is enabled.
+static const char* const fragment_shader_source =
+    "#version 120\n"
+    "uniform int   fog_enabled;\n"
+    "varying vec4  lit_color;\n"
+    "varying float fog_distance;\n"
+    "void main()\n"
+    "{\n"
+    "    vec4 color = lit_color;\n"
+    "    if (fog_enabled != 0)\n"
+    "    {\n"
+    "        float fog = clamp(exp(-gl_Fog.density * fog_distance), 0.0, 1.0);\n"
+    "        color.rgb = mix(gl_Fog.color.rgb, color.rgb, fog);\n"
+    "    }\n"
+    "    gl_FragColor = color;\n"
+    "}\n";
+
+static int    program_compiled    = 0;   // 1 once compiling was attempted
+static GLuint program             = 0;   // instancing shader, 0 if unavailable
+static GLint  uniform_fog_enabled = -1;  // location of fog_enabled
+
+
+/**
+ * @brief Checks if instanced drawing is available in the current context.
+ *
+ * @return int Returns 1 if instanced shapes can be drawn, 0 otherwise.
+ */
+int instancing_supported(void)
+{
+    if (!gl_extensions.instanced_arrays)
+    {
+        return 0;
+    }
+
+    if (!program_compiled)
+    {
+        program_compiled = 1;
+        program = shader_create_program(
+            vertex_shader_source,
+            fragment_shader_source,
+            attribute_names,
+            ATTRIBUTE_COUNT
+        );
+        if (program != 0)
+        {
+            uniform_fog_enabled = glGetUniformLocation(program, "fog_enabled");
+        }
+    }
+
+    return program != 0;
+}
+
+/**
+ * @brief Uploads a triangle list as an instanced shape.
+ *
+ * @param shape        Output shape.
+ * @param vertices     Triangle list, three vertices per face.
+ * @param vertex_count Number of vertices.
+ */
+void instancing_create_shape(
+          instanced_shape* shape,
+    const mesh_vertex*     vertices,
+          GLsizei          vertex_count
+)
+{
+    glGenBuffers(1, &shape->vertex_buffer);
+    glBindBuffer(GL_ARRAY_BUFFER, shape->vertex_buffer);
+    glBufferData(
+        GL_ARRAY_BUFFER,
+        (gl_size_pointer)(vertex_count * sizeof(mesh_vertex)),
+        vertices,
+        GL_STATIC_DRAW
+    );
+
+    glGenBuffers(1, &shape->instance_buffer);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    shape->vertex_count      = vertex_count;
+    shape->instance_capacity = 0;
+}
+
+/**
+ * @brief Points an instance attribute into the instance buffer.
+ *
+ * @param attribute Attribute index.
+ * @param offset    Offset of the vector in instance_transform.
+ */
+static void set_instance_attribute(GLuint attribute, size_t offset)
+{
+    glEnableVertexAttribArray(attribute);
+    glVertexAttribPointer(
+        attribute, 3, GL_FLOAT, GL_FALSE,
+        sizeof(instance_transform),
+        (const GLvoid*)offset
+    );
+    glVertexAttribDivisor(attribute, 1);
+}
+
+/**
+ * @brief Streams the instance transforms and draws all instances in one call.
+ *
+ * The instance buffer is orphaned before it is refilled, so the driver
+ * does not stall on the draw of the previous frame still reading it.
+ *
+ * @param shape          The shape to draw.
+ * @param instances      Transforms of all instances.
+ * @param instance_count Number of instances.
+ * @param fog_enabled    Nonzero to apply the fog.
+ */
+void instancing_draw(
+          instanced_shape*    shape,
+    const instance_transform* instances,
+          GLsizei             instance_count,
+          int                 fog_enabled
+)
+{
+    if (instance_count <= 0 || !instancing_supported())
+    {
+        return;
+    }
+
+    const gl_size_pointer instance_bytes =
+        (gl_size_pointer)(instance_count * sizeof(instance_transform));
+
+    glBindBuffer(GL_ARRAY_BUFFER, shape->instance_buffer);
+    if (instance_count > shape->instance_capacity)
+    {
+        shape->instance_capacity = instance_count;
+    }
+    glBufferData(
+        GL_ARRAY_BUFFER,
+        (gl_size_pointer)(shape->instance_capacity * sizeof(instance_transform)),
+        NULL,
+        GL_STREAM_DRAW
+    );
+    glBufferSubData(GL_ARRAY_BUFFER, 0, instance_bytes, instances);
+
+    set_instance_attribute(ATTRIBUTE_INSTANCE_POSITION, offsetof(instance_transform, position));
+    set_instance_attribute(ATTRIBUTE_INSTANCE_RIGHT,    offsetof(instance_transform, right));
+    set_instance_attribute(ATTRIBUTE_INSTANCE_UP,       offsetof(instance_transform, up));
+    set_instance_attribute(ATTRIBUTE_INSTANCE_FORWARD,  offsetof(instance_transform, forward));
+
+    glBindBuffer(GL_ARRAY_BUFFER, shape->vertex_buffer);
+    glEnableVertexAttribArray(ATTRIBUTE_VERTEX_POSITION);
+    glEnableVertexAttribArray(ATTRIBUTE_VERTEX_NORMAL);
+    glVertexAttribPointer(
+        ATTRIBUTE_VERTEX_POSITION, 3, GL_FLOAT, GL_FALSE,
+        sizeof(mesh_vertex),
+        (const GLvoid*)offsetof(mesh_vertex, position)
+    );
+    glVertexAttribPointer(
+        ATTRIBUTE_VERTEX_NORMAL, 3, GL_FLOAT, GL_FALSE,
+        sizeof(mesh_vertex),
+        (const GLvoid*)offsetof(mesh_vertex, normal)
+    );
+
+    glUseProgram(program);
+    glUniform1i(uniform_fog_enabled, fog_enabled);
+
+    glDrawArraysInstanced(GL_TRIANGLES, 0, shape->vertex_count, instance_count);
+
+    glUseProgram(0);
+
+    for (GLuint i = 0; i < ATTRIBUTE_COUNT; ++i)
+    {
+        if (i >= ATTRIBUTE_INSTANCE_POSITION)
+        {
+            glVertexAttribDivisor(i, 0);
+        }
+        glDisableVertexAttribArray(i);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+/**
+ * @brief Frees the buffer objects of a shape.
+ *
+ * @param shape The shape to destroy.
+ */
+void instancing_destroy_shape(instanced_shape* shape)
+{
+    if (shape->vertex_buffer != 0)
+    {
+        glDeleteBuffers(1, &shape->vertex_buffer);
+    }
+    if (shape->instance_buffer != 0)
+    {
+        glDeleteBuffers(1, &shape->instance_buffer);
+    }
+
+    shape->vertex_buffer     = 0;
+    shape->vertex_count      = 0;
+    shape->instance_buffer   = 0;
+    shape->instance_capacity = 0;
+}
+
+/**
+ * @brief Frees the instancing shader.
+ */
+void instancing_cleanup(void)
+{
+    if (program != 0)
+    {
+        glDeleteProgram(program);
+    }
+
+    program             = 0;
+    program_compiled    = 0;
+    uniform_fog_enabled = -1;
+}
@@ -0,0 +1,334 @@
+/**
+ * @file light_clusters.c
+ * @brief Implements the cluster boxes and the assignment of lights to them.
+ */
+
+
+#include "light_clusters.h"
+
+#include <math.h>
+#include <string.h>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define LIGHT_CLUSTERS_SSE 1
+#include <xmmintrin.h>
+#else
+#define LIGHT_CLUSTERS_SSE 0
+#endif
+
+
+#define LIGHT_CLUSTER_TILE_COUNT (LIGHT_CLUSTERS_X * LIGHT_CLUSTERS_Y)  // clusters of one depth slice
+
+
+// View-space boxes of the tiles of every slice, one array per coordinate,
+// indexed like the clusters. All clusters of a slice share its depth range.
+static GLfloat tile_min_x[LIGHT_CLUSTER_COUNT];
+static GLfloat tile_max_x[LIGHT_CLUSTER_COUNT];
+static GLfloat tile_min_y[LIGHT_CLUSTER_COUNT];
+static GLfloat tile_max_y[LIGHT_CLUSTER_COUNT];
+static GLfloat slice_depths[LIGHT_CLUSTERS_Z + 1];  // view distance of every slice boundary, near to far
+
+static GLfloat projection_key[5]  = { 0.0f };  // fov, width, height, near and far plane of the boxes
+static GLfloat grid_tile_scale[2] = { 0.0f };  // tiles per pixel along x and y
+static GLfloat grid_slice_scale   = 0.0f;      // slices per unit of the logarithm of the view depth
+static GLfloat grid_slice_bias    = 0.0f;      // slice of a view depth of 1
+
+static GLushort pair_clusters[LIGHT_CLUSTERS_MAX_INDICES];  // cluster of every light reference, in light order
+static GLushort pair_lights[LIGHT_CLUSTERS_MAX_INDICES];    // light of every light reference
+static GLuint   cluster_fill[LIGHT_CLUSTER_COUNT];          // next free index of every cluster while scattering
+
+
+/**
+ * @brief Divides a perspective view frustum into the cluster boxes.
+ *
+ * A tile spans a fixed range of normalized device coordinates, so at the
+ * view distance d its x extent is that range times d * tan(fov_x / 2).
+ * The box of a cluster encloses the tile at both depths of its slice.
+ *
+ * @param fov        Vertical field of view in degrees.
+ * @param width      Width of the drawn viewport in pixels.
+ * @param height     Height of the drawn viewport in pixels.
+ * @param near_plane Distance of the near plane.
+ * @param far_plane  Distance of the far plane.
+ */
+void light_clusters_set_projection(
+    GLfloat fov,
+    int     width,
+    int     height,
+    GLfloat near_plane,
+    GLfloat far_plane
+)
+{
+    if (width <= 0 || height <= 0)
+    {
+        return;
+    }
+
+    const GLfloat key[5] = { fov, (GLfloat)width, (GLfloat)height, near_plane, far_plane };
+    if (memcmp(key, projection_key, sizeof(key)) == 0)
+    {
+        return;
+    }
+    memcpy(projection_key, key, sizeof(key));
+
+    const GLfloat tan_y     = tanf(fov * PI / 360.0f);
+    const GLfloat tan_x     = tan_y * (GLfloat)width / (GLfloat)height;
+    const GLfloat log_ratio = logf(far_plane / near_plane);
+
+    grid_tile_scale[0] = (GLfloat)LIGHT_CLUSTERS_X / (GLfloat)width;
+    grid_tile_scale[1] = (GLfloat)LIGHT_CLUSTERS_Y / (GLfloat)height;
+    grid_slice_scale   = (GLfloat)LIGHT_CLUSTERS_Z / log_ratio;
+    grid_slice_bias    = -logf(near_plane) * grid_slice_scale;
+
+    for (int z = 0; z <= LIGHT_CLUSTERS_Z; ++z)
+    {
+        slice_depths[z] = near_plane * expf(log_ratio * (GLfloat)z / (GLfloat)LIGHT_CLUSTERS_Z);
+    }
+
+    for (int z = 0; z < LIGHT_CLUSTERS_Z; ++z)
+    {
+        const GLfloat near_depth = slice_depths[z];
+        const GLfloat far_depth  = slice_depths[z + 1];
+
+        for (int y = 0; y < LIGHT_CLUSTERS_Y; ++y)
+        {
+            const GLfloat bottom = tan_y * (2.0f * (GLfloat)y / (GLfloat)LIGHT_CLUSTERS_Y - 1.0f);
+            const GLfloat top    = tan_y * (2.0f * (GLfloat)(y + 1) / (GLfloat)LIGHT_CLUSTERS_Y - 1.0f);
+
+            for (int x = 0; x < LIGHT_CLUSTERS_X; ++x)
+            {
+                const GLfloat left  = tan_x * (2.0f * (GLfloat)x / (GLfloat)LIGHT_CLUSTERS_X - 1.0f);
+                const GLfloat right = tan_x * (2.0f * (GLfloat)(x + 1) / (GLfloat)LIGHT_CLUSTERS_X - 1.0f);
+                const int     index = x + LIGHT_CLUSTERS_X * (y + LIGHT_CLUSTERS_Y * z);
+
+                tile_min_x[index] = fminf(left * near_depth,   left * far_depth);
+                tile_max_x[index] = fmaxf(right * near_depth,  right * far_depth);
+                tile_min_y[index] = fminf(bottom * near_depth, bottom * far_depth);
+                tile_max_y[index] = fmaxf(top * near_depth,    top * far_depth);
+            }
+        }
+    }
+}
+
+/**
+ * @brief Returns the slice holding a view distance.
+ *
+ * @param depth View distance, positive in front of the camera.
+ * @return int The slice, clamped to the grid.
+ */
+static int find_slice(GLfloat depth)
+{
+    const int slice = (int)floorf(logf(depth) * grid_slice_scale + grid_slice_bias);
+    if (slice < 0)
+    {
+        return 0;
+    }
+    return slice < LIGHT_CLUSTERS_Z ? slice : LIGHT_CLUSTERS_Z - 1;
+}
+
+/**
+ * @brief Tests a sphere against the tile boxes of one slice.
+ *
+ * The depth range is shared by all boxes of the slice, so its part of
+ * the squared distance is already taken out of the squared radius.
+ *
+ * @param first      First cluster of the slice.
+ * @param center     View-space center of the sphere.
+ * @param radius_2   Squared radius minus the squared depth distance to the slice.
+ * @param light      Index of the light.
+ * @param pair_count Light references stored so far, updated.
+ * @return int Returns 0 if references had to be dropped, 1 otherwise.
+ */
+static int assign_slice(int first, const GLfloat center[3], GLfloat radius_2, GLushort light, int* pair_count)
+{
+    int count = *pair_count;
+    int i     = 0;
+
+#if LIGHT_CLUSTERS_SSE
+    const __m128 center_x = _mm_set1_ps(center[0]);
+    const __m128 center_y = _mm_set1_ps(center[1]);
+    const __m128 limit    = _mm_set1_ps(radius_2);
+    const __m128 zero     = _mm_setzero_ps();
+
+    for (; i + 4 <= LIGHT_CLUSTER_TILE_COUNT; i += 4)
+    {
+        const int index = first + i;
+
+        const __m128 distance_x = _mm_max_ps(
+            _mm_max_ps(
+                _mm_sub_ps(_mm_loadu_ps(tile_min_x + index), center_x),
+                _mm_sub_ps(center_x, _mm_loadu_ps(tile_max_x + index))
+            ),
+            zero
+        );
+        const __m128 distance_y = _mm_max_ps(
+            _mm_max_ps(
+                _mm_sub_ps(_mm_loadu_ps(tile_min_y + index), center_y),
+                _mm_sub_ps(center_y, _mm_loadu_ps(tile_max_y + index))
+            ),
+            zero
+        );
+        const __m128 distance_2 = _mm_add_ps(
+            _mm_mul_ps(distance_x, distance_x),
+            _mm_mul_ps(distance_y, distance_y)
+        );
+
+        const int mask = _mm_movemask_ps(_mm_cmple_ps(distance_2, limit));
+        if (mask == 0)
+        {
+            continue;
+        }
+        for (int lane = 0; lane < 4; ++lane)
+        {
+            if ((mask >> lane) & 1)
+            {
+                if (count == LIGHT_CLUSTERS_MAX_INDICES)
+                {
+                    *pair_count = count;
+                    return 0;
+                }
+                pair_clusters[count] = (GLushort)(index + lane);
+                pair_lights[count]   = light;
+                ++count;
+            }
+        }
+    }
+#endif
+
+    for (; i < LIGHT_CLUSTER_TILE_COUNT; ++i)
+    {
+        const int     index      = first + i;
+        const GLfloat distance_x = fmaxf(fmaxf(tile_min_x[index] - center[0], center[0] - tile_max_x[index]), 0.0f);
+        const GLfloat distance_y = fmaxf(fmaxf(tile_min_y[index] - center[1], center[1] - tile_max_y[index]), 0.0f);
+
+        if (distance_x * distance_x + distance_y * distance_y > radius_2)
+        {
+            continue;
+        }
+        if (count == LIGHT_CLUSTERS_MAX_INDICES)
+        {
+            *pair_count = count;
+            return 0;
+        }
+        pair_clusters[count] = (GLushort)index;
+        pair_lights[count]   = light;
+        ++count;
+    }
+
+    *pair_count = count;
+    return 1;
+}
+
+/**
+ * @brief Sorts the lights of a frame into the clusters.
+ *
+ * Every light first lists the clusters it touches, slice by slice.
+ * The references are then counted per cluster and scattered into the
+ * index array, so the list of every cluster keeps the light order.
+ *
+ * @param grid        Output lights and cluster lists.
+ * @param view        Column-major view matrix.
+ * @param lights      The lights in world space.
+ * @param light_count Number of lights.
+ */
+void light_clusters_assign(
+          light_cluster_grid* grid,
+    const GLfloat             view[16],
+    const point_light*        lights,
+          int                 light_count
+)
+{
+    const GLfloat near_plane = slice_depths[0];
+    const GLfloat far_plane  = slice_depths[LIGHT_CLUSTERS_Z];
+
+    grid->light_count   = 0;
+    grid->index_count   = 0;
+    grid->dropped       = 0;
+    grid->tile_scale[0] = grid_tile_scale[0];
+    grid->tile_scale[1] = grid_tile_scale[1];
+    grid->slice_scale   = grid_slice_scale;
+    grid->slice_bias    = grid_slice_bias;
+
+    int pair_count = 0;
+    for (int i = 0; i < light_count && grid->light_count < LIGHT_CLUSTERS_MAX_LIGHTS; ++i)
+    {
+        const point_light* light = &lights[i];
+
+        GLfloat center[3];
+        for (int row = 0; row < 3; ++row)
+        {
+            center[row] =
+                view[0 * 4 + row] * light->position[0] +
+                view[1 * 4 + row] * light->position[1] +
+                view[2 * 4 + row] * light->position[2] +
+                view[3 * 4 + row];
+        }
+
+        const GLfloat depth  = -center[2];
+        const GLfloat radius = light->radius;
+        if (depth + radius < near_plane || depth - radius > far_plane || radius <= 0.0f)
+        {
+            continue;
+        }
+
+        const GLushort index      = (GLushort)grid->light_count;
+        const int      first_pair = pair_count;
+        const int      last_slice = find_slice(fminf(depth + radius, far_plane));
+        int            complete   = 1;
+
+        for (int z = find_slice(fmaxf(depth - radius, near_plane)); z <= last_slice && complete; ++z)
+        {
+            const GLfloat distance_z = fmaxf(fmaxf(slice_depths[z] - depth, depth - slice_depths[z + 1]), 0.0f);
+            const GLfloat radius_2   = radius * radius - distance_z * distance_z;
+            if (radius_2 < 0.0f)
+            {
+                continue;
+            }
+            complete = assign_slice(z * LIGHT_CLUSTER_TILE_COUNT, center, radius_2, index, &pair_count);
+        }
+
+        if (!complete)
+        {
+            grid->dropped += pair_count - first_pair;
+            pair_count     = first_pair;
+            continue;
+        }
+        if (pair_count == first_pair)
+        {
+            continue;
+        }
+
+        GLfloat* sphere = grid->lights[grid->light_count][0];
+        GLfloat* tint   = grid->lights[grid->light_count][1];
+        for (int k = 0; k < 3; ++k)
+        {
+            sphere[k] = center[k];
+            tint[k]   = light->light_color[k];
+        }
+        sphere[3] = radius;
+        tint[3]   = 0.0f;
+        ++grid->light_count;
+    }
+
+    for (int c = 0; c < LIGHT_CLUSTER_COUNT; ++c)
+    {
+        grid->clusters[c][1] = 0;
+    }
+    for (int p = 0; p < pair_count; ++p)
+    {
+        ++grid->clusters[pair_clusters[p]][1];
+    }
+
+    GLuint offset = 0;
+    for (int c = 0; c < LIGHT_CLUSTER_COUNT; ++c)
+    {
+        grid->clusters[c][0] = offset;
+        cluster_fill[c]      = offset;
+        offset              += grid->clusters[c][1];
+    }
+    for (int p = 0; p < pair_count; ++p)
+    {
+        grid->indices[cluster_fill[pair_clusters[p]]++] = pair_lights[p];
+    }
+    grid->index_count = pair_count;
+}
@@ -6,6 +6,8 @@
 
 #include "lighting.h"
 
+#include "gl_state.h"
+
 
 /**
  * @brief Configures ambient, diffuse, and specular lighting for the scene.
@@ -13,10 +15,10 @@
 void lighting_initialize(void)
 {
 	// Light color and intensity. Ambient will be zeroAmbient,
-	const color light_diffuse        = { 0.9f, 0.9f, 0.9f, 1.0f };
-	const color light_specular       = { 0.9f, 0.9f, 0.9f, 1.0f };
-	const color light_ambient_global = { 0.2f, 0.2f, 0.2f, 1.0f };
-	const color light_ambient_zero   = { 0.0f, 0.0f, 0.0f, 0.0f };
+	const color light_diffuse        = LIGHT_DIFFUSE;
+	const color light_specular       = LIGHT_SPECULAR;
+	const color light_ambient_global = LIGHT_AMBIENT_GLOBAL;
+	const color light_ambient_zero   = LIGHT_AMBIENT;
 
 	// Set the global ambient light level.
 	glLightModelfv(GL_LIGHT_MODEL_AMBIENT, light_ambient_global);
@@ -27,7 +29,7 @@ void lighting_initialize(void)
 	glLightfv(GL_LIGHT0, GL_DIFFUSE, light_specular);
 
 	//Enable the lighting.
-	glEnable(GL_LIGHTING);
+	gl_state_enable(GL_LIGHTING, 1);
 	// Enable light 0.
-	glEnable(GL_LIGHT0);
+	gl_state_enable(GL_LIGHT0, 1);
 }
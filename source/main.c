@@ -8,9 +8,16 @@
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb/stb_image.h>
 
+#include "benchmark.h"
+#include "capture.h"
+#include "debug_draw.h"
+#include "frame_pacing.h"
+#include "gl_trace.h"
+#include "headless.h"
 #include "renderer.h"
 #include "window.h"
-#include "lighting.h"
+#include "options.h"
+#include "simulation.h"
 
 
 static void print_controls_to_console(void);  // forward declaration.
@@ -26,14 +33,60 @@ static void print_controls_to_console(void);  // forward declaration.
  */
 int main(int argc, char** argv)
 {
+	options_initialize(argc, argv);
+	main_window.width  = main_options.width;
+	main_window.height = main_options.height;
+
+	// Load the path before the scene is built, it seeds the boids.
+	if (main_options.benchmark_file != NULL && !benchmark_load(main_options.benchmark_file))
+	{
+		return 1;
+	}
+
+	if (main_options.headless_frames > 0)
+	{
+		return headless_run();
+	}
+
 	window_initialize(argc, argv);
-	lighting_initialize();
-    renderer_initialize();
+	if (!renderer_initialize())
+	{
+		return 1;
+	}
+	if (benchmark_active())
+	{
+		// Benchmarks draw every frame as fast as they can.
+		frame_pacing_initialize(0.0, main_options.swap_interval, 0);
+	}
+	else
+	{
+		frame_pacing_initialize(main_options.target_fps, main_options.swap_interval, main_options.idle_unchanged);
+	}
+	if (main_options.capture_on)
+	{
+		capture_start(main_options.capture_format);
+	}
+	if (main_options.gl_trace_file != NULL)
+	{
+		gl_trace_open_csv(main_options.gl_trace_file);
+	}
+
+	// Step the simulation on its own thread, the idle callback steps it otherwise.
+	// Benchmarks step it once per frame, so every run draws the same frames.
+	simulation_initialize();
+	if (!benchmark_active() && !simulation_start_thread())
+	{
+		printf("Could not start the simulation thread, stepping it between frames.\n\n");
+	}
 
 	print_controls_to_console();
 
 	glutMainLoop();  // Enter perpetual rendering loop.
 
+	capture_stop();
+	gl_trace_close_csv();
+	benchmark_clean_up();
+	simulation_clean_up();
 	renderer_clean_up();
 
 	return 0;
@@ -50,7 +103,19 @@ static void print_controls_to_console(void)
 	printf("-------------------\n");
 	printf("u:\t\t\ttoggle wire frame mode\n");
 	printf("b:\t\t\ttoggle fog\n");
-	printf("f:\t\t\ttoggle full screen window\n\n");
+	printf("[ / ]:\t\t\tdecrease / increase fog density\n");
+	printf("f:\t\t\ttoggle full screen window\n");
+	printf("c:\t\t\ttoggle render path frame time comparison\n");
+	printf("t:\t\t\tprint texture streaming statistics\n");
+	printf("v:\t\t\ttoggle view-frustum culling\n");
+	printf("o:\t\t\ttoggle occlusion culling\n");
+	printf("r:\t\t\ttoggle dynamic resolution\n");
+	printf("k:\t\t\ttoggle frame capture\n");
+	printf("g:\t\t\ttoggle OpenGL call count overlay\n");
+#if DEBUG_DRAW
+	printf("x:\t\t\ttoggle debug lines\n");
+#endif
+	printf("p:\t\t\tprint frame statistics\n\n");
 
 	// Print the camera controls to the console.
 	printf("Camera Controls\n");
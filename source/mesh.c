@@ -5,11 +5,18 @@
 
 
 #include "mesh.h"
+
+#include "gl_extensions.h"
+
+#include <math.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 
 /**
- * @brief Frees memory allocated for vertices, normals, and faces in a mesh.
+ * @brief Frees memory allocated for vertices, normals, and faces in a mesh,
+ *        along with its buffer objects and display list.
  *
  * This function should be called when the mesh
  * is no longer needed to avoid memory leaks.
@@ -21,6 +28,86 @@ void mesh_cleanup(mesh* mesh)
     free(mesh->vertices);
     free(mesh->normals);
     free(mesh->faces);
+
+    if (mesh->vertex_buffer != 0)
+    {
+        glDeleteBuffers(1, &mesh->vertex_buffer);
+        glDeleteBuffers(1, &mesh->index_buffer);
+        mesh->vertex_buffer = 0;
+        mesh->index_buffer  = 0;
+    }
+
+    if (mesh->vertex_array != 0)
+    {
+        glDeleteVertexArrays(1, &mesh->vertex_array);
+        mesh->vertex_array = 0;
+    }
+
+    if (mesh->display_list != 0)
+    {
+        glDeleteLists(mesh->display_list, 1);
+        mesh->display_list = 0;
+    }
+}
+
+/**
+ * @brief Calculates the axis-aligned bounding box of the mesh vertices.
+ *
+ * @param mesh    Pointer to the loaded mesh.
+ * @param minimum Output lowest coordinates, zero for an empty mesh.
+ * @param maximum Output highest coordinates, zero for an empty mesh.
+ */
+static void calculate_bounding_box(const mesh* mesh, point_3d minimum, point_3d maximum)
+{
+    for (int k = 0; k < 3; ++k)
+    {
+        minimum[k] = mesh->vertex_count > 0 ? mesh->vertices[0][k] : 0.0f;
+        maximum[k] = minimum[k];
+    }
+
+    for (int i = 1; i < mesh->vertex_count; ++i)
+    {
+        for (int k = 0; k < 3; ++k)
+        {
+            if (mesh->vertices[i][k] < minimum[k]) minimum[k] = mesh->vertices[i][k];
+            if (mesh->vertices[i][k] > maximum[k]) maximum[k] = mesh->vertices[i][k];
+        }
+    }
+}
+
+/**
+ * @brief Calculates the bounding sphere of the mesh vertices.
+ *
+ * The sphere is centered on the bounding box, which is close
+ * enough to the minimal sphere for culling.
+ *
+ * @param mesh Pointer to the loaded mesh.
+ */
+static void calculate_bounds(mesh* mesh)
+{
+    point_3d minimum;
+    point_3d maximum;
+    calculate_bounding_box(mesh, minimum, maximum);
+
+    for (int k = 0; k < 3; ++k)
+    {
+        mesh->bounds_center[k] = (minimum[k] + maximum[k]) / 2.0f;
+    }
+
+    GLfloat radius_squared = 0.0f;
+    for (int i = 0; i < mesh->vertex_count; ++i)
+    {
+        const GLfloat dx = mesh->vertices[i][0] - mesh->bounds_center[0];
+        const GLfloat dy = mesh->vertices[i][1] - mesh->bounds_center[1];
+        const GLfloat dz = mesh->vertices[i][2] - mesh->bounds_center[2];
+        const GLfloat distance_squared = dx * dx + dy * dy + dz * dz;
+
+        if (distance_squared > radius_squared)
+        {
+            radius_squared = distance_squared;
+        }
+    }
+    mesh->bounds_radius = sqrtf(radius_squared);
 }
 
 /**
@@ -98,4 +185,216 @@ void mesh_initialize(mesh* mesh, const char* local_file_path)
     }
 
     (void)fclose(read_file);
+
+    calculate_bounds(mesh);
+
+    // Invalidates anything compiled from a previous load.
+    mesh->revision++;
+}
+
+/**
+ * @brief Builds a simplified copy of a mesh by vertex clustering.
+ *
+ * @param source     The loaded mesh to simplify.
+ * @param target     Output mesh, must be zeroed or cleaned up.
+ * @param resolution Number of cells along the longest side of the bounds.
+ */
+void mesh_simplify(const mesh* source, mesh* target, int resolution)
+{
+    point_3d minimum;
+    point_3d maximum;
+    calculate_bounding_box(source, minimum, maximum);
+
+    GLfloat longest_side = 0.0f;
+    for (int k = 0; k < 3; ++k)
+    {
+        if (maximum[k] - minimum[k] > longest_side)
+        {
+            longest_side = maximum[k] - minimum[k];
+        }
+    }
+    const GLfloat cell_size = longest_side > 0.0f ? longest_side / resolution : 1.0f;
+
+    // Dense grid of cluster numbers, -1 for empty cells.
+    const size_t cell_count = (size_t)resolution * resolution * resolution;
+    int*         cells      = malloc(cell_count * sizeof(int));
+    int*         clusters   = malloc(sizeof(int) * (source->vertex_count > 0 ? source->vertex_count : 1));
+    int*         members    = calloc(source->vertex_count > 0 ? source->vertex_count : 1, sizeof(int));
+    memset(cells, 0xFF, cell_count * sizeof(int));
+
+    target->vertices     = malloc(sizeof(point_3d) * (source->vertex_count > 0 ? source->vertex_count : 1));
+    target->vertex_count = 0;
+
+    for (int i = 0; i < source->vertex_count; ++i)
+    {
+        int cell_index[3];
+        for (int k = 0; k < 3; ++k)
+        {
+            cell_index[k] = (int)((source->vertices[i][k] - minimum[k]) / cell_size);
+            if (cell_index[k] >= resolution)
+            {
+                cell_index[k] = resolution - 1;
+            }
+        }
+
+        const size_t cell = 
+            ((size_t)cell_index[0] * resolution + cell_index[1]) * resolution + cell_index[2];
+        if (cells[cell] == -1)
+        {
+            cells[cell] = target->vertex_count++;
+            for (int k = 0; k < 3; ++k)
+            {
+                target->vertices[cells[cell]][k] = 0.0f;
+            }
+        }
+
+        clusters[i] = cells[cell];
+        members[clusters[i]]++;
+        for (int k = 0; k < 3; ++k)
+        {
+            target->vertices[clusters[i]][k] += source->vertices[i][k];
+        }
+    }
+
+    for (int i = 0; i < target->vertex_count; ++i)
+    {
+        for (int k = 0; k < 3; ++k)
+        {
+            target->vertices[i][k] /= (GLfloat)members[i];
+        }
+    }
+
+    target->normal_count = source->normal_count;
+    target->normals      = malloc(sizeof(vector_3d) * (source->normal_count > 0 ? source->normal_count : 1));
+    memcpy(target->normals, source->normals, sizeof(vector_3d) * source->normal_count);
+
+    target->faces      = malloc(sizeof(mesh_face) * (source->face_count > 0 ? source->face_count : 1));
+    target->face_count = 0;
+    for (int i = 0; i < source->face_count; ++i)
+    {
+        const mesh_face face = source->faces[i];
+        const int a = clusters[face.vertex_numbers[0] - 1];
+        const int b = clusters[face.vertex_numbers[1] - 1];
+        const int c = clusters[face.vertex_numbers[2] - 1];
+
+        if (a == b || b == c || a == c)
+        {
+            continue;  // collapsed face.
+        }
+
+        mesh_face* simplified = &target->faces[target->face_count++];
+        *simplified = face;
+        simplified->vertex_numbers[0] = a + 1;
+        simplified->vertex_numbers[1] = b + 1;
+        simplified->vertex_numbers[2] = c + 1;
+    }
+
+    free(cells);
+    free(clusters);
+    free(members);
+
+    for (int k = 0; k < 3; ++k)
+    {
+        target->bounds_center[k] = source->bounds_center[k];
+    }
+    target->bounds_radius = source->bounds_radius;
+
+    // Invalidates anything compiled from a previous simplification.
+    target->revision++;
+}
+
+/**
+ * @brief Uploads the mesh into vertex and index buffer objects.
+ *
+ * OBJ faces index vertices and normals separately, while buffer objects
+ * share one index for both. Every unique vertex/normal pair is found with
+ * an open addressing hash table and becomes one vertex of the buffer.
+ *
+ * @param mesh Pointer to the loaded mesh to upload.
+ */
+void mesh_upload(mesh* mesh)
+{
+    if (!gl_extensions.vertex_buffer_objects || mesh->face_count == 0)
+    {
+        return;
+    }
+
+    const int corner_count = mesh->face_count * 3;
+
+    size_t table_size = 1;
+    while (table_size < (size_t)corner_count * 2)
+    {
+        table_size *= 2;
+    }
+
+    int*         table       = malloc(table_size * sizeof(int));
+    int*         table_keys  = malloc(sizeof(int) * 2 * corner_count);
+    mesh_vertex* vertices    = malloc(sizeof(mesh_vertex) * corner_count);
+    GLuint*      indices     = malloc(sizeof(GLuint) * corner_count);
+    int          vertex_count = 0;
+
+    memset(table, 0xFF, table_size * sizeof(int));  // all slots empty (-1).
+
+    for (int i = 0; i < mesh->face_count; ++i)
+    {
+        for (int j = 0; j < 3; ++j)
+        {
+            const int vertex_index = mesh->faces[i].vertex_numbers[j] - 1;
+            const int normal_index = mesh->faces[i].normal_numbers[j] - 1;
+
+            size_t slot =
+                ((unsigned)vertex_index * 73856093u ^ (unsigned)normal_index * 19349663u) &
+                (table_size - 1);
+
+            while (table[slot] != -1 &&
+                   (table_keys[table[slot] * 2]     != vertex_index ||
+                    table_keys[table[slot] * 2 + 1] != normal_index))
+            {
+                slot = (slot + 1) & (table_size - 1);
+            }
+
+            if (table[slot] == -1)
+            {
+                table[slot] = vertex_count;
+                table_keys[vertex_count * 2]     = vertex_index;
+                table_keys[vertex_count * 2 + 1] = normal_index;
+
+                for (int k = 0; k < 3; ++k)
+                {
+                    vertices[vertex_count].position[k] = mesh->vertices[vertex_index][k];
+                    vertices[vertex_count].normal[k]   = mesh->normals[normal_index][k];
+                }
+                ++vertex_count;
+            }
+
+            indices[i * 3 + j] = (GLuint)table[slot];
+        }
+    }
+
+    glGenBuffers(1, &mesh->vertex_buffer);
+    glBindBuffer(GL_ARRAY_BUFFER, mesh->vertex_buffer);
+    glBufferData(
+        GL_ARRAY_BUFFER,
+        sizeof(mesh_vertex) * vertex_count,
+        vertices,
+        GL_STATIC_DRAW
+    );
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    glGenBuffers(1, &mesh->index_buffer);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh->index_buffer);
+    glBufferData(
+        GL_ELEMENT_ARRAY_BUFFER,
+        sizeof(GLuint) * corner_count,
+        indices,
+        GL_STATIC_DRAW
+    );
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+    mesh->index_count = corner_count;
+
+    free(table);
+    free(table_keys);
+    free(vertices);
+    free(indices);
 }
@@ -0,0 +1,402 @@
+/**
+ * @file occlusion.c
+ * @brief Implements the occluder rasterizer and the hierarchical-Z tests.
+ */
+
+
+#include "occlusion.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define OCCLUSION_SSE 1
+#include <xmmintrin.h>
+#else
+#define OCCLUSION_SSE 0
+#endif
+
+
+#define OCCLUSION_PIXEL_COUNT   (OCCLUSION_WIDTH * OCCLUSION_HEIGHT)  // texels of the first level
+#define OCCLUSION_PYRAMID_COUNT (OCCLUSION_PIXEL_COUNT * 4 / 3)       // texels of all levels, an upper bound
+#define OCCLUSION_FAR_DEPTH     1.0f                                  // depth of pixels without occluders
+
+
+/**
+ * @brief A vertex projected into depth buffer pixels.
+ */
+typedef struct {
+    GLfloat x;        // horizontal pixel coordinate
+    GLfloat y;        // vertical pixel coordinate, up from the bottom row
+    GLfloat z;        // normalized device depth
+    int     clipped;  // 1 if the vertex lies in front of the near plane
+} projected_vertex;
+
+
+static GLfloat view_projection[16];                   // column-major projection * view of the frame
+static GLfloat pyramid[OCCLUSION_PYRAMID_COUNT];      // all levels, the first is the depth buffer
+static int     level_offsets[OCCLUSION_LEVEL_COUNT];  // first texel of every level in pyramid
+
+static projected_vertex* projected_vertices = NULL;  // scratch space of the mesh being rasterized
+static int               projected_capacity = 0;     // vertices projected_vertices can hold
+
+
+/**
+ * @brief Projects a point into depth buffer pixels.
+ *
+ * @param matrix Column-major matrix from the point space to clip space.
+ * @param point  The point.
+ * @param vertex Output projected vertex.
+ */
+static void project_point(const GLfloat matrix[16], const GLfloat* point, projected_vertex* vertex)
+{
+    GLfloat clip[4];
+    for (int row = 0; row < 4; ++row)
+    {
+        clip[row] =
+            matrix[0 * 4 + row] * point[0] +
+            matrix[1 * 4 + row] * point[1] +
+            matrix[2 * 4 + row] * point[2] +
+            matrix[3 * 4 + row];
+    }
+
+    vertex->clipped = clip[2] < -clip[3];
+    if (vertex->clipped)
+    {
+        return;
+    }
+
+    const GLfloat inverse_w = 1.0f / clip[3];
+    vertex->x = (clip[0] * inverse_w * 0.5f + 0.5f) * OCCLUSION_WIDTH;
+    vertex->y = (clip[1] * inverse_w * 0.5f + 0.5f) * OCCLUSION_HEIGHT;
+    vertex->z = clip[2] * inverse_w;
+}
+
+/**
+ * @brief Rasterizes a triangle into the depth buffer, keeping the nearest depth.
+ *
+ * Pixels are covered when their center lies inside all three edges.
+ * Edge functions and depth are planes in screen space, evaluated for
+ * four pixels of a row at once with SSE.
+ */
+static void rasterize_triangle(
+    const projected_vertex* v0,
+    const projected_vertex* v1,
+    const projected_vertex* v2
+)
+{
+    GLfloat area = (v1->x - v0->x) * (v2->y - v0->y) - (v1->y - v0->y) * (v2->x - v0->x);
+    if (area == 0.0f)
+    {
+        return;
+    }
+    if (area < 0.0f)
+    {
+        // Clockwise, swap two corners so the inside is positive.
+        const projected_vertex* swap = v1;
+        v1   = v2;
+        v2   = swap;
+        area = -area;
+    }
+
+    // Pixels whose centers fall into the bounds of the triangle, clamped
+    // to the buffer. Most occluder faces are small and cover no center.
+    int min_x = (int)ceilf(fminf(v0->x, fminf(v1->x, v2->x)) - 0.5f);
+    int max_x = (int)floorf(fmaxf(v0->x, fmaxf(v1->x, v2->x)) - 0.5f) + 1;
+    int min_y = (int)ceilf(fminf(v0->y, fminf(v1->y, v2->y)) - 0.5f);
+    int max_y = (int)floorf(fmaxf(v0->y, fmaxf(v1->y, v2->y)) - 0.5f) + 1;
+    if (min_x < 0)                min_x = 0;
+    if (min_y < 0)                min_y = 0;
+    if (max_x > OCCLUSION_WIDTH)  max_x = OCCLUSION_WIDTH;
+    if (max_y > OCCLUSION_HEIGHT) max_y = OCCLUSION_HEIGHT;
+    if (min_x >= max_x || min_y >= max_y)
+    {
+        return;
+    }
+
+    // Edge function of the edge from a to b, e = ex * x + ey * y + e0,
+    // positive on the side of the third corner.
+    const projected_vertex* corners[3] = { v0, v1, v2 };
+    GLfloat edge_x[3];
+    GLfloat edge_y[3];
+    GLfloat edge_0[3];
+    for (int i = 0; i < 3; ++i)
+    {
+        const projected_vertex* a = corners[i];
+        const projected_vertex* b = corners[(i + 1) % 3];
+        edge_x[i] = a->y - b->y;
+        edge_y[i] = b->x - a->x;
+        edge_0[i] = -(edge_x[i] * a->x + edge_y[i] * a->y);
+    }
+
+    // The edge opposite a corner weights its depth, z = zx * x + zy * y + z0.
+    const GLfloat inverse_area = 1.0f / area;
+    const GLfloat depth_x = (edge_x[1] * v0->z + edge_x[2] * v1->z + edge_x[0] * v2->z) * inverse_area;
+    const GLfloat depth_y = (edge_y[1] * v0->z + edge_y[2] * v1->z + edge_y[0] * v2->z) * inverse_area;
+    const GLfloat depth_0 = (edge_0[1] * v0->z + edge_0[2] * v1->z + edge_0[0] * v2->z) * inverse_area;
+
+#if OCCLUSION_SSE
+    // Rows are processed in aligned groups of four pixels.
+    min_x &= ~3;
+    max_x  = (max_x + 3) & ~3;
+
+    const __m128 lane_offsets = _mm_set_ps(3.5f, 2.5f, 1.5f, 0.5f);  // pixel centers of a group
+    const __m128 zero         = _mm_setzero_ps();
+
+    for (int y = min_y; y < max_y; ++y)
+    {
+        const GLfloat center_y = (GLfloat)y + 0.5f;
+        GLfloat*      row      = pyramid + y * OCCLUSION_WIDTH;
+
+        const __m128 edge_row0 = _mm_set1_ps(edge_y[0] * center_y + edge_0[0]);
+        const __m128 edge_row1 = _mm_set1_ps(edge_y[1] * center_y + edge_0[1]);
+        const __m128 edge_row2 = _mm_set1_ps(edge_y[2] * center_y + edge_0[2]);
+        const __m128 depth_row = _mm_set1_ps(depth_y * center_y + depth_0);
+
+        for (int x = min_x; x < max_x; x += 4)
+        {
+            const __m128 center_x = _mm_add_ps(_mm_set1_ps((GLfloat)x), lane_offsets);
+
+            __m128 inside = _mm_cmpge_ps(
+                _mm_add_ps(_mm_mul_ps(center_x, _mm_set1_ps(edge_x[0])), edge_row0), zero
+            );
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(
+                _mm_add_ps(_mm_mul_ps(center_x, _mm_set1_ps(edge_x[1])), edge_row1), zero
+            ));
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(
+                _mm_add_ps(_mm_mul_ps(center_x, _mm_set1_ps(edge_x[2])), edge_row2), zero
+            ));
+            if (_mm_movemask_ps(inside) == 0)
+            {
+                continue;
+            }
+
+            const __m128 depth   = _mm_add_ps(_mm_mul_ps(center_x, _mm_set1_ps(depth_x)), depth_row);
+            const __m128 stored  = _mm_loadu_ps(row + x);
+            const __m128 nearest = _mm_min_ps(stored, depth);
+            _mm_storeu_ps(
+                row + x,
+                _mm_or_ps(_mm_and_ps(inside, nearest), _mm_andnot_ps(inside, stored))
+            );
+        }
+    }
+#else
+    for (int y = min_y; y < max_y; ++y)
+    {
+        const GLfloat center_y = (GLfloat)y + 0.5f;
+        GLfloat*      row      = pyramid + y * OCCLUSION_WIDTH;
+
+        for (int x = min_x; x < max_x; ++x)
+        {
+            const GLfloat center_x = (GLfloat)x + 0.5f;
+
+            if (edge_x[0] * center_x + edge_y[0] * center_y + edge_0[0] < 0.0f ||
+                edge_x[1] * center_x + edge_y[1] * center_y + edge_0[1] < 0.0f ||
+                edge_x[2] * center_x + edge_y[2] * center_y + edge_0[2] < 0.0f)
+            {
+                continue;
+            }
+
+            const GLfloat depth = depth_x * center_x + depth_y * center_y + depth_0;
+            if (depth < row[x])
+            {
+                row[x] = depth;
+            }
+        }
+    }
+#endif
+}
+
+/**
+ * @brief Clears the depth buffer and captures the view and projection.
+ *
+ * @param projection Column-major projection matrix.
+ * @param view       Column-major view matrix.
+ */
+void occlusion_begin(const GLfloat projection[16], const GLfloat view[16])
+{
+    geometry_multiply_matrices(projection, view, view_projection);
+
+    int offset = 0;
+    for (int level = 0; level < OCCLUSION_LEVEL_COUNT; ++level)
+    {
+        level_offsets[level] = offset;
+        offset += (OCCLUSION_WIDTH >> level) * (OCCLUSION_HEIGHT >> level);
+    }
+
+    for (int i = 0; i < OCCLUSION_PIXEL_COUNT; ++i)
+    {
+        pyramid[i] = OCCLUSION_FAR_DEPTH;
+    }
+}
+
+/**
+ * @brief Rasterizes the faces of a mesh into the depth buffer.
+ *
+ * Every vertex is projected once, then the faces are rasterized from
+ * the projected vertices.
+ *
+ * @param mesh  The occluder mesh.
+ * @param model Column-major model matrix of the mesh.
+ * @return int Number of faces that were rasterized.
+ */
+int occlusion_rasterize_mesh(const mesh* mesh, const GLfloat model[16])
+{
+    if (mesh->vertex_count > projected_capacity)
+    {
+        projected_vertex* grown = realloc(
+            projected_vertices,
+            (size_t)mesh->vertex_count * sizeof(projected_vertex)
+        );
+        if (grown == NULL)
+        {
+            return 0;
+        }
+        projected_vertices = grown;
+        projected_capacity = mesh->vertex_count;
+    }
+
+    GLfloat model_view_projection[16];
+    geometry_multiply_matrices(view_projection, model, model_view_projection);
+
+    for (int i = 0; i < mesh->vertex_count; ++i)
+    {
+        project_point(model_view_projection, mesh->vertices[i], &projected_vertices[i]);
+    }
+
+    int rasterized_count = 0;
+    for (int i = 0; i < mesh->face_count; ++i)
+    {
+        const int* numbers = mesh->faces[i].vertex_numbers;  // 1-based, as in the OBJ file.
+        const projected_vertex* v0 = &projected_vertices[numbers[0] - 1];
+        const projected_vertex* v1 = &projected_vertices[numbers[1] - 1];
+        const projected_vertex* v2 = &projected_vertices[numbers[2] - 1];
+
+        if (v0->clipped || v1->clipped || v2->clipped)
+        {
+            continue;
+        }
+
+        rasterize_triangle(v0, v1, v2);
+        ++rasterized_count;
+    }
+
+    return rasterized_count;
+}
+
+/**
+ * @brief Builds the pyramid levels from the rasterized depth buffer.
+ *
+ * Every texel holds the farthest of the four texels below it, so it
+ * bounds the depth of all occluders within its area.
+ */
+void occlusion_build_pyramid(void)
+{
+    for (int level = 1; level < OCCLUSION_LEVEL_COUNT; ++level)
+    {
+        const int      width        = OCCLUSION_WIDTH >> level;
+        const int      height       = OCCLUSION_HEIGHT >> level;
+        const int      source_width = width * 2;
+        const GLfloat* source       = pyramid + level_offsets[level - 1];
+        GLfloat*       target       = pyramid + level_offsets[level];
+
+        for (int y = 0; y < height; ++y)
+        {
+            const GLfloat* row_bottom = source + (y * 2) * source_width;
+            const GLfloat* row_top    = row_bottom + source_width;
+
+            for (int x = 0; x < width; ++x)
+            {
+                const GLfloat bottom = fmaxf(row_bottom[x * 2], row_bottom[x * 2 + 1]);
+                const GLfloat top    = fmaxf(row_top[x * 2], row_top[x * 2 + 1]);
+                target[y * width + x] = fmaxf(bottom, top);
+            }
+        }
+    }
+}
+
+/**
+ * @brief Tests a world-space bounding box against the occluders.
+ *
+ * The eight corners are projected to a pixel rectangle and their
+ * nearest depth. The coarsest level on which the rectangle spans at most
+ * OCCLUSION_TEST_TEXELS texels per axis is read. Boxes reaching in front
+ * of the near plane or out of the buffer are reported as visible.
+ *
+ * @param minimum Corner of the box with the smallest coordinates.
+ * @param maximum Corner of the box with the largest coordinates.
+ * @return int Returns 0 if the box is hidden by the occluders, 1 if it may be visible.
+ */
+int occlusion_test_box(const point_3d minimum, const point_3d maximum)
+{
+    GLfloat min_x = (GLfloat)OCCLUSION_WIDTH;
+    GLfloat min_y = (GLfloat)OCCLUSION_HEIGHT;
+    GLfloat max_x = 0.0f;
+    GLfloat max_y = 0.0f;
+    GLfloat min_z = OCCLUSION_FAR_DEPTH;
+
+    for (int i = 0; i < 8; ++i)
+    {
+        const point_3d corner = {
+            (i & 1) ? maximum[0] : minimum[0],
+            (i & 2) ? maximum[1] : minimum[1],
+            (i & 4) ? maximum[2] : minimum[2]
+        };
+
+        projected_vertex vertex;
+        project_point(view_projection, corner, &vertex);
+        if (vertex.clipped)
+        {
+            return 1;
+        }
+
+        min_x = fminf(min_x, vertex.x);
+        min_y = fminf(min_y, vertex.y);
+        max_x = fmaxf(max_x, vertex.x);
+        max_y = fmaxf(max_y, vertex.y);
+        min_z = fminf(min_z, vertex.z);
+    }
+
+    if (min_x < 0.0f || min_y < 0.0f ||
+        max_x >= (GLfloat)OCCLUSION_WIDTH || max_y >= (GLfloat)OCCLUSION_HEIGHT)
+    {
+        return 1;
+    }
+
+    const int x0 = (int)min_x;
+    const int y0 = (int)min_y;
+    const int x1 = (int)max_x;
+    const int y1 = (int)max_y;
+
+    int level = 0;
+    while (level < OCCLUSION_LEVEL_COUNT - 1 &&
+           ((x1 >> level) - (x0 >> level) >= OCCLUSION_TEST_TEXELS ||
+            (y1 >> level) - (y0 >> level) >= OCCLUSION_TEST_TEXELS))
+    {
+        ++level;
+    }
+
+    const int      width  = OCCLUSION_WIDTH >> level;
+    const GLfloat* texels = pyramid + level_offsets[level];
+    for (int y = y0 >> level; y <= y1 >> level; ++y)
+    {
+        for (int x = x0 >> level; x <= x1 >> level; ++x)
+        {
+            if (texels[y * width + x] >= min_z)
+            {
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Frees the buffers used to project occluders.
+ */
+void occlusion_cleanup(void)
+{
+    free(projected_vertices);
+    projected_vertices = NULL;
+    projected_capacity = 0;
+}
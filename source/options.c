@@ -0,0 +1,563 @@
+/**
+ * @file options.c
+ * @brief Implements parsing of the startup options.
+ */
+
+
+#include "options.h"
+
+#include "light_clusters.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+// Global startup options.
+options main_options = {
+    DEFAULT_OPTIONS_RENDER_PATH,
+    DEFAULT_OPTIONS_STREAM_MODE,
+    DEFAULT_OPTIONS_HEADLESS_FRAMES,
+    DEFAULT_WINDOW_WIDTH,
+    DEFAULT_WINDOW_HEIGHT,
+    { 0 },
+    0,
+    DEFAULT_OPTIONS_BACKEND,
+    DEFAULT_OPTIONS_DYNAMIC_RES_MS,
+    DEFAULT_OPTIONS_TARGET_FPS,
+    DEFAULT_OPTIONS_SWAP_INTERVAL,
+    DEFAULT_OPTIONS_IDLE_UNCHANGED,
+    0,
+    DEFAULT_OPTIONS_CAPTURE_FORMAT,
+    NULL,
+    DEFAULT_OPTIONS_RECORD_THREADS,
+    DEFAULT_OPTIONS_IMPOSTOR_DIST,
+    NULL,
+    BENCHMARK_JSON_FILE,
+    DEFAULT_OPTIONS_POINT_LIGHTS,
+    DEFAULT_OPTIONS_RASTER_THREADS,
+    DEFAULT_OPTIONS_DRAW_ORDER,
+    DEFAULT_OPTIONS_TEXTURE_BUDGET
+};
+
+
+/**
+ * @brief Returns the value of an argument of the form --name=value.
+ *
+ * @param argument The command line argument.
+ * @param name     The option name including the leading dashes.
+ * @return const char* The value, or NULL if the argument is another option.
+ */
+static const char* option_value(const char* argument, const char* name)
+{
+    const size_t name_length = strlen(name);
+
+    if (strncmp(argument, name, name_length) != 0 ||
+        argument[name_length] != '=')
+    {
+        return NULL;
+    }
+    return argument + name_length + 1;
+}
+
+/**
+ * @brief Parses a render path name into main_options.
+ *
+ * @param value Name of the render path, e.g. "display-list".
+ */
+static void parse_render_path(const char* value)
+{
+    for (int i = 0; i < RENDER_PATH_COUNT; ++i)
+    {
+        if (strcmp(value, renderer_path_name((render_path)i)) == 0)
+        {
+            main_options.render_path = (render_path)i;
+            return;
+        }
+    }
+
+    printf("Unknown render path '%s'.\n\n", value);
+    options_print_usage();
+}
+
+/**
+ * @brief Parses a render backend name into main_options.
+ *
+ * @param value Name of the render backend, e.g. "core".
+ */
+static void parse_backend(const char* value)
+{
+    for (int i = 0; i < RENDER_BACKEND_COUNT; ++i)
+    {
+        if (strcmp(value, renderer_backend_name((render_backend_type)i)) == 0)
+        {
+            main_options.backend = (render_backend_type)i;
+            return;
+        }
+    }
+
+    printf("Unknown render backend '%s'.\n\n", value);
+    options_print_usage();
+}
+
+/**
+ * @brief Parses a stream mode name into main_options.
+ *
+ * @param value Name of the stream mode, e.g. "orphan".
+ */
+static void parse_stream_mode(const char* value)
+{
+    for (int i = 0; i < STREAM_MODE_COUNT; ++i)
+    {
+        if (strcmp(value, stream_buffer_mode_name((stream_mode)i)) == 0)
+        {
+            main_options.stream_mode = (stream_mode)i;
+            return;
+        }
+    }
+
+    printf("Unknown stream mode '%s'.\n\n", value);
+    options_print_usage();
+}
+
+/**
+ * @brief Parses a draw order name into main_options.
+ *
+ * @param value Name of the draw order, e.g. "state".
+ */
+static void parse_draw_order(const char* value)
+{
+    for (int i = 0; i < DRAW_ORDER_COUNT; ++i)
+    {
+        if (strcmp(value, renderer_draw_order_name((draw_order)i)) == 0)
+        {
+            main_options.draw_order = (draw_order)i;
+            return;
+        }
+    }
+
+    printf("Unknown draw order '%s'.\n\n", value);
+    options_print_usage();
+}
+
+/**
+ * @brief Parses the memory budget of the streamed textures into main_options.
+ *
+ * @param value Budget in megabytes, e.g. "0.1".
+ */
+static void parse_texture_budget(const char* value)
+{
+    double megabytes = 0.0;
+    if (sscanf_s(value, "%lf", &megabytes) != 1 || megabytes <= 0.0)
+    {
+        printf("Invalid texture budget '%s'.\n\n", value);
+        options_print_usage();
+        return;
+    }
+
+    main_options.texture_budget_mb = megabytes;
+}
+
+/**
+ * @brief Parses the number of headless frames into main_options.
+ *
+ * @param value Number of frames, e.g. "600".
+ */
+static void parse_headless_frames(const char* value)
+{
+    int frames = 0;
+    if (sscanf_s(value, "%d", &frames) != 1 || frames <= 0)
+    {
+        printf("Invalid frame count '%s'.\n\n", value);
+        options_print_usage();
+        return;
+    }
+
+    main_options.headless_frames = frames;
+}
+
+/**
+ * @brief Parses the dynamic resolution frame time budget into main_options.
+ *
+ * @param value Frame time in milliseconds, e.g. "16.7".
+ */
+static void parse_dynamic_resolution(const char* value)
+{
+    double milliseconds = 0.0;
+    if (sscanf_s(value, "%lf", &milliseconds) != 1 || milliseconds <= 0.0)
+    {
+        printf("Invalid frame time '%s'.\n\n", value);
+        options_print_usage();
+        return;
+    }
+
+    main_options.dynamic_resolution_ms = milliseconds;
+}
+
+/**
+ * @brief Parses the frame rate limit of the window into main_options.
+ *
+ * @param value Frames per second, e.g. "30", or 0 for no limit.
+ */
+static void parse_target_fps(const char* value)
+{
+    double fps = 0.0;
+    if (sscanf_s(value, "%lf", &fps) != 1 || fps < 0.0)
+    {
+        printf("Invalid frame rate '%s'.\n\n", value);
+        options_print_usage();
+        return;
+    }
+
+    main_options.target_fps = fps;
+}
+
+/**
+ * @brief Parses the vertical sync setting into main_options.
+ *
+ * @param value "on", "off" or "driver".
+ */
+static void parse_vsync(const char* value)
+{
+    if (strcmp(value, "on") == 0)
+    {
+        main_options.swap_interval = 1;
+    }
+    else if (strcmp(value, "off") == 0)
+    {
+        main_options.swap_interval = 0;
+    }
+    else if (strcmp(value, "driver") == 0)
+    {
+        main_options.swap_interval = FRAME_PACING_SWAP_DRIVER;
+    }
+    else
+    {
+        printf("Unknown vertical sync setting '%s'.\n\n", value);
+        options_print_usage();
+    }
+}
+
+/**
+ * @brief Parses the idle-when-unchanged mode into main_options.
+ *
+ * @param value "on" or "off".
+ */
+static void parse_idle(const char* value)
+{
+    if (strcmp(value, "on") == 0 || strcmp(value, "off") == 0)
+    {
+        main_options.idle_unchanged = strcmp(value, "on") == 0;
+        return;
+    }
+
+    printf("Unknown idle mode '%s'.\n\n", value);
+    options_print_usage();
+}
+
+/**
+ * @brief Parses a capture format name into main_options and enables capturing.
+ *
+ * @param value Name of the capture format, e.g. "yuv".
+ */
+static void parse_capture(const char* value)
+{
+    for (int i = 0; i < CAPTURE_FORMAT_COUNT; ++i)
+    {
+        if (strcmp(value, capture_format_name((capture_format)i)) == 0)
+        {
+            main_options.capture_on     = 1;
+            main_options.capture_format = (capture_format)i;
+            return;
+        }
+    }
+
+    printf("Unknown capture format '%s'.\n\n", value);
+    options_print_usage();
+}
+
+/**
+ * @brief Parses the number of threads recording the draw list into main_options.
+ *
+ * @param value Number of threads, e.g. "4", including the render thread.
+ */
+static void parse_record_threads(const char* value)
+{
+    int threads = 0;
+    if (sscanf_s(value, "%d", &threads) != 1 || threads <= 0)
+    {
+        printf("Invalid thread count '%s'.\n\n", value);
+        options_print_usage();
+        return;
+    }
+
+    main_options.record_threads = threads;
+}
+
+/**
+ * @brief Parses the number of threads drawing software tiles into main_options.
+ *
+ * @param value Number of threads, e.g. "8", including the render thread.
+ */
+static void parse_raster_threads(const char* value)
+{
+    int threads = 0;
+    if (sscanf_s(value, "%d", &threads) != 1 || threads <= 0)
+    {
+        printf("Invalid thread count '%s'.\n\n", value);
+        options_print_usage();
+        return;
+    }
+
+    main_options.raster_threads = threads;
+}
+
+/**
+ * @brief Parses the view depth at which boids switch to impostors into main_options.
+ *
+ * @param value Depth in world units, e.g. "4.5", or 0 to always draw the pyramids.
+ */
+static void parse_impostor_distance(const char* value)
+{
+    double distance = 0.0;
+    if (sscanf_s(value, "%lf", &distance) != 1 || distance < 0.0)
+    {
+        printf("Invalid impostor distance '%s'.\n\n", value);
+        options_print_usage();
+        return;
+    }
+
+    main_options.impostor_distance = distance;
+}
+
+/**
+ * @brief Parses the number of bioluminescent point lights into main_options.
+ *
+ * @param value Number of lights, e.g. "256", or 0 for none.
+ */
+static void parse_point_lights(const char* value)
+{
+    int lights = 0;
+    if (sscanf_s(value, "%d", &lights) != 1 || lights < 0 || lights > LIGHT_CLUSTERS_MAX_LIGHTS)
+    {
+        printf("Invalid point light count '%s'.\n\n", value);
+        options_print_usage();
+        return;
+    }
+
+    main_options.point_lights = lights;
+}
+
+/**
+ * @brief Parses a size of the form <width>x<height> into main_options.
+ *
+ * @param value The size, e.g. "1920x1080".
+ */
+static void parse_size(const char* value)
+{
+    int width  = 0;
+    int height = 0;
+    if (sscanf_s(value, "%dx%d", &width, &height) != 2 || width <= 0 || height <= 0)
+    {
+        printf("Invalid size '%s'.\n\n", value);
+        options_print_usage();
+        return;
+    }
+
+    main_options.width  = width;
+    main_options.height = height;
+}
+
+/**
+ * @brief Parses a comma separated list of frame numbers into main_options.
+ *
+ * @param value Frame numbers counted from 1, e.g. "1,300,600".
+ */
+static void parse_dump_frames(const char* value)
+{
+    main_options.dump_frame_count = 0;
+
+    while (*value != '\0' && main_options.dump_frame_count < OPTIONS_MAX_DUMP_FRAMES)
+    {
+        char*      end   = NULL;
+        const long frame = strtol(value, &end, 10);
+        if (end == value || frame <= 0 || (*end != ',' && *end != '\0'))
+        {
+            printf("Invalid frame list '%s'.\n\n", value);
+            options_print_usage();
+            return;
+        }
+
+        main_options.dump_frames[main_options.dump_frame_count++] = (int)frame;
+        value = *end == ',' ? end + 1 : end;
+    }
+}
+
+/**
+ * @brief Parses the startup options from the command line.
+ *
+ * @param argc Argument count from main().
+ * @param argv Argument vector from main().
+ */
+void options_initialize(int argc, char** argv)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        const char* value = NULL;
+
+        if ((value = option_value(argv[i], "--render-path")) != NULL)
+        {
+            parse_render_path(value);
+        }
+        else if ((value = option_value(argv[i], "--backend")) != NULL)
+        {
+            parse_backend(value);
+        }
+        else if ((value = option_value(argv[i], "--stream-mode")) != NULL)
+        {
+            parse_stream_mode(value);
+        }
+        else if ((value = option_value(argv[i], "--headless")) != NULL)
+        {
+            parse_headless_frames(value);
+        }
+        else if ((value = option_value(argv[i], "--size")) != NULL)
+        {
+            parse_size(value);
+        }
+        else if ((value = option_value(argv[i], "--dump-frames")) != NULL)
+        {
+            parse_dump_frames(value);
+        }
+        else if ((value = option_value(argv[i], "--dynamic-resolution")) != NULL)
+        {
+            parse_dynamic_resolution(value);
+        }
+        else if ((value = option_value(argv[i], "--fps")) != NULL)
+        {
+            parse_target_fps(value);
+        }
+        else if ((value = option_value(argv[i], "--vsync")) != NULL)
+        {
+            parse_vsync(value);
+        }
+        else if ((value = option_value(argv[i], "--idle")) != NULL)
+        {
+            parse_idle(value);
+        }
+        else if ((value = option_value(argv[i], "--capture")) != NULL)
+        {
+            parse_capture(value);
+        }
+        else if ((value = option_value(argv[i], "--gl-trace")) != NULL)
+        {
+            main_options.gl_trace_file = value;
+        }
+        else if ((value = option_value(argv[i], "--record-threads")) != NULL)
+        {
+            parse_record_threads(value);
+        }
+        else if ((value = option_value(argv[i], "--impostor-distance")) != NULL)
+        {
+            parse_impostor_distance(value);
+        }
+        else if ((value = option_value(argv[i], "--benchmark")) != NULL)
+        {
+            main_options.benchmark_file = value;
+        }
+        else if ((value = option_value(argv[i], "--benchmark-json")) != NULL)
+        {
+            main_options.benchmark_json_file = value;
+        }
+        else if ((value = option_value(argv[i], "--point-lights")) != NULL)
+        {
+            parse_point_lights(value);
+        }
+        else if ((value = option_value(argv[i], "--raster-threads")) != NULL)
+        {
+            parse_raster_threads(value);
+        }
+        else if ((value = option_value(argv[i], "--draw-order")) != NULL)
+        {
+            parse_draw_order(value);
+        }
+        else if ((value = option_value(argv[i], "--texture-budget")) != NULL)
+        {
+            parse_texture_budget(value);
+        }
+    }
+}
+
+/**
+ * @brief Prints the supported command line options to the console.
+ */
+void options_print_usage(void)
+{
+    printf("Options\n");
+    printf("-------------------\n");
+    printf("--render-path=<path>\tmesh submission path: ");
+    for (int i = 0; i < RENDER_PATH_COUNT; ++i)
+    {
+        printf(i == 0 ? "%s" : ", %s", renderer_path_name((render_path)i));
+    }
+    printf(" (default %s)\n", renderer_path_name(DEFAULT_OPTIONS_RENDER_PATH));
+    printf("--backend=<backend>\trender backend: ");
+    for (int i = 0; i < RENDER_BACKEND_COUNT; ++i)
+    {
+        printf(i == 0 ? "%s" : ", %s", renderer_backend_name((render_backend_type)i));
+    }
+    printf(" (default %s)\n", renderer_backend_name(DEFAULT_OPTIONS_BACKEND));
+    printf("--stream-mode=<mode>\tstreamed buffer updates: ");
+    for (int i = 0; i < STREAM_MODE_COUNT; ++i)
+    {
+        printf(i == 0 ? "%s" : ", %s", stream_buffer_mode_name((stream_mode)i));
+    }
+    printf(" (default %s)\n", stream_buffer_mode_name(DEFAULT_OPTIONS_STREAM_MODE));
+    printf("--headless=<frames>\trender frames offscreen and print frame time percentiles\n");
+    printf(
+        "--size=<w>x<h>\t\twindow or offscreen framebuffer size (default %dx%d)\n",
+        DEFAULT_WINDOW_WIDTH,
+        DEFAULT_WINDOW_HEIGHT
+    );
+    printf("--dump-frames=<n,...>\theadless frames saved as PNG, counted from 1\n");
+    printf("--dynamic-resolution=<ms>\tscale the drawn resolution between 50%% and 100%% to hold a frame time\n");
+    printf("--fps=<n>\t\twindow frame rate limit, 0 for none (default %.0f)\n", DEFAULT_OPTIONS_TARGET_FPS);
+    printf("--vsync=<mode>\t\tvertical sync: on, off or driver (default driver)\n");
+    printf("--idle=<mode>\t\tskip frames while nothing changes: on (default) or off\n");
+    printf("--capture=<format>\tcapture every frame from the start: ");
+    for (int i = 0; i < CAPTURE_FORMAT_COUNT; ++i)
+    {
+        printf(i == 0 ? "%s" : ", %s", capture_format_name((capture_format)i));
+    }
+    printf("\n");
+    printf("--gl-trace=<file>\twrite the OpenGL calls of every render pass and frame to a CSV file\n");
+    printf(
+        "--record-threads=<n>\tthreads recording the draw list, the render thread included (default %d)\n",
+        DEFAULT_OPTIONS_RECORD_THREADS
+    );
+    printf(
+        "--impostor-distance=<d>\tview depth beyond which boids are drawn as impostors, 0 for never (default %.1f)\n",
+        DEFAULT_OPTIONS_IMPOSTOR_DIST
+    );
+    printf("--benchmark=<file>\tfly along the path in the file and report frame time percentiles\n");
+    printf("--benchmark-json=<file>\tfile receiving the benchmark results (default %s)\n", BENCHMARK_JSON_FILE);
+    printf(
+        "--point-lights=<n>\tbioluminescent point lights shaded by the core backend, up to %d (default %d)\n",
+        LIGHT_CLUSTERS_MAX_LIGHTS,
+        DEFAULT_OPTIONS_POINT_LIGHTS
+    );
+    printf(
+        "--raster-threads=<n>\tthreads drawing the tiles of the software backend, the render thread included (default %d)\n",
+        DEFAULT_OPTIONS_RASTER_THREADS
+    );
+    printf("--draw-order=<order>\tdraw submission order: ");
+    for (int i = 0; i < DRAW_ORDER_COUNT; ++i)
+    {
+        printf(i == 0 ? "%s" : ", %s", renderer_draw_order_name((draw_order)i));
+    }
+    printf(" (default %s)\n", renderer_draw_order_name(DEFAULT_OPTIONS_DRAW_ORDER));
+    printf(
+        "--texture-budget=<MB>\tmemory budget of the streamed textures in megabytes (default %.0f)\n\n",
+        DEFAULT_OPTIONS_TEXTURE_BUDGET
+    );
+}
@@ -0,0 +1,222 @@
+/**
+ * @file png.c
+ * @brief Implements the minimal PNG writer.
+ */
+
+
+#include "png.h"
+
+#include <stdio.h>
+
+
+#define PNG_STORED_BLOCK_MAX 65535  // largest payload of an uncompressed deflate block
+#define PNG_ADLER_MODULUS    65521  // modulus of the zlib Adler-32 checksum
+
+
+/**
+ * @brief Output file together with the CRC of the chunk being written.
+ */
+typedef struct {
+    FILE*        file;   // file being written
+    unsigned int crc;    // running CRC-32 of the current chunk
+    unsigned int adler;  // running Adler-32 of the uncompressed image data
+} png_writer;
+
+
+static unsigned int crc_table[256];       // CRC-32 of every byte value
+static int          crc_table_ready = 0;  // 1 once crc_table was computed
+
+
+/**
+ * @brief Computes the CRC-32 lookup table once.
+ */
+static void prepare_crc_table(void)
+{
+    if (crc_table_ready)
+    {
+        return;
+    }
+
+    for (unsigned int n = 0; n < 256; ++n)
+    {
+        unsigned int c = n;
+        for (int k = 0; k < 8; ++k)
+        {
+            c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+        }
+        crc_table[n] = c;
+    }
+    crc_table_ready = 1;
+}
+
+/**
+ * @brief Writes bytes to the file and adds them to the chunk CRC.
+ */
+static void write_bytes(png_writer* writer, const unsigned char* bytes, size_t count)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        writer->crc = crc_table[(writer->crc ^ bytes[i]) & 0xFF] ^ (writer->crc >> 8);
+    }
+    (void)fwrite(bytes, 1, count, writer->file);
+}
+
+/**
+ * @brief Writes a big-endian 32-bit value and adds it to the chunk CRC.
+ */
+static void write_uint32(png_writer* writer, unsigned int value)
+{
+    const unsigned char bytes[4] = {
+        (unsigned char)(value >> 24),
+        (unsigned char)(value >> 16),
+        (unsigned char)(value >> 8),
+        (unsigned char)value
+    };
+    write_bytes(writer, bytes, 4);
+}
+
+/**
+ * @brief Starts a chunk with its length and type.
+ */
+static void begin_chunk(png_writer* writer, unsigned int length, const char* type)
+{
+    write_uint32(writer, length);  // the length is not part of the CRC.
+    writer->crc = 0xFFFFFFFFu;
+    write_bytes(writer, (const unsigned char*)type, 4);
+}
+
+/**
+ * @brief Ends a chunk by writing its CRC.
+ */
+static void end_chunk(png_writer* writer)
+{
+    write_uint32(writer, writer->crc ^ 0xFFFFFFFFu);
+}
+
+/**
+ * @brief Writes image data bytes and adds them to the Adler-32 checksum.
+ */
+static void write_image_bytes(png_writer* writer, const unsigned char* bytes, size_t count)
+{
+    unsigned int a = writer->adler & 0xFFFF;
+    unsigned int b = writer->adler >> 16;
+    for (size_t i = 0; i < count; ++i)
+    {
+        a = (a + bytes[i]) % PNG_ADLER_MODULUS;
+        b = (b + a) % PNG_ADLER_MODULUS;
+    }
+    writer->adler = (b << 16) | a;
+
+    write_bytes(writer, bytes, count);
+}
+
+/**
+ * @brief Prepares the lookup tables shared by all writes.
+ */
+void png_initialize(void)
+{
+    prepare_crc_table();
+}
+
+/**
+ * @brief Writes an 8-bit RGB image to a PNG file.
+ *
+ * Every row starts with filter type 0 and the rows are split into
+ * stored deflate blocks, so the data stream has a known size up front.
+ *
+ * @param local_file_path Path of the file to write.
+ * @param width           Width of the image in pixels.
+ * @param height          Height of the image in pixels.
+ * @param pixels          Tightly packed RGB rows, width * height * 3 bytes.
+ * @param bottom_up       1 if the first row is the bottom one, as read by glReadPixels.
+ * @return int Returns 1 on success, 0 if the file could not be written.
+ */
+int png_write_rgb(
+    const char* local_file_path,
+    int width,
+    int height,
+    const unsigned char* pixels,
+    int bottom_up
+)
+{
+    const unsigned char signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    const unsigned char zlib_header[2] = { 0x78, 0x01 };  // deflate, 32K window, no preset dictionary.
+    const unsigned char filter_none = 0;
+
+    const size_t row_size    = (size_t)width * 3;
+    const size_t raw_size    = (size_t)height * (row_size + 1);
+    const size_t block_count = (raw_size + PNG_STORED_BLOCK_MAX - 1) / PNG_STORED_BLOCK_MAX;
+    const size_t data_size   = sizeof(zlib_header) + raw_size + block_count * 5 + 4;
+
+    png_writer writer = { NULL, 0, 1 };
+    if (fopen_s(&writer.file, local_file_path, "wb") != 0 || writer.file == NULL)
+    {
+        printf("Could not write %s.\n", local_file_path);
+        return 0;
+    }
+
+    prepare_crc_table();
+    (void)fwrite(signature, 1, sizeof(signature), writer.file);
+
+    // Header - 8-bit RGB, no interlacing.
+    const unsigned char header_tail[5] = { 8, 2, 0, 0, 0 };
+    begin_chunk(&writer, 13, "IHDR");
+    write_uint32(&writer, (unsigned int)width);
+    write_uint32(&writer, (unsigned int)height);
+    write_bytes(&writer, header_tail, sizeof(header_tail));
+    end_chunk(&writer);
+
+    // Image data - one zlib stream of stored blocks.
+    begin_chunk(&writer, (unsigned int)data_size, "IDAT");
+    write_bytes(&writer, zlib_header, sizeof(zlib_header));
+
+    size_t block_left = 0;         // bytes left in the current block
+    size_t raw_left   = raw_size;  // bytes left in the whole stream
+    for (int y = 0; y < height; ++y)
+    {
+        const int            row   = bottom_up ? height - 1 - y : y;
+        const unsigned char* bytes = pixels + (size_t)row * row_size;
+        size_t               left  = row_size + 1;
+
+        while (left > 0)
+        {
+            if (block_left == 0)
+            {
+                block_left = raw_left < PNG_STORED_BLOCK_MAX ? raw_left : PNG_STORED_BLOCK_MAX;
+                const unsigned char block_header[5] = {
+                    raw_left == block_left,  // final block flag, stored type.
+                    (unsigned char)block_left,
+                    (unsigned char)(block_left >> 8),
+                    (unsigned char)~block_left,
+                    (unsigned char)(~block_left >> 8)
+                };
+                write_bytes(&writer, block_header, sizeof(block_header));
+            }
+
+            size_t count = left < block_left ? left : block_left;
+            if (left == row_size + 1)
+            {
+                write_image_bytes(&writer, &filter_none, 1);
+                count = 1;
+            }
+            else
+            {
+                write_image_bytes(&writer, bytes, count);
+                bytes += count;
+            }
+            left       -= count;
+            block_left -= count;
+            raw_left   -= count;
+        }
+    }
+
+    write_uint32(&writer, writer.adler);
+    end_chunk(&writer);
+
+    begin_chunk(&writer, 0, "IEND");
+    end_chunk(&writer);
+
+    const int written = !ferror(writer.file);
+    (void)fclose(writer.file);
+    return written;
+}
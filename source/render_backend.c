@@ -0,0 +1,62 @@
+/**
+ * @file render_backend.c
+ * @brief Implements the helpers shared by the render backends.
+ */
+
+
+#include "render_backend.h"
+
+
+/**
+ * @brief Lists the water grid as a single triangle strip.
+ *
+ * The rows of the grid are joined by repeating the last vertex of a row
+ * and the first vertex of the next one. Each row has an even number of
+ * vertices, so the winding is kept across joins.
+ *
+ * @param indices Output indices into the vertices of the water grid.
+ */
+void render_backend_list_water_strip(GLushort indices[WATER_INDEX_COUNT])
+{
+    int index_count = 0;
+
+    for (int i = 0; i < WATER_GRID_SIZE; ++i)
+    {
+        if (i > 0)
+        {
+            indices[index_count] = indices[index_count - 1];
+            ++index_count;
+            indices[index_count++] = (GLushort)(i * (WATER_GRID_SIZE + 1));
+        }
+        for (int j = 0; j <= WATER_GRID_SIZE; ++j)
+        {
+            indices[index_count++] = (GLushort)(i       * (WATER_GRID_SIZE + 1) + j);
+            indices[index_count++] = (GLushort)((i + 1) * (WATER_GRID_SIZE + 1) + j);
+        }
+    }
+}
+
+/**
+ * @brief Copies the water grid of a snapshot into buffer vertices.
+ *
+ * @param snapshot Simulation state holding the water grid.
+ * @param vertices Output vertices, row by row.
+ */
+void render_backend_copy_water_vertices(
+    const simulation_snapshot* snapshot,
+          mesh_vertex          vertices[WATER_VERTEX_COUNT]
+)
+{
+    for (int i = 0; i <= WATER_GRID_SIZE; ++i)
+    {
+        for (int j = 0; j <= WATER_GRID_SIZE; ++j)
+        {
+            mesh_vertex* vertex = &vertices[i * (WATER_GRID_SIZE + 1) + j];
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                vertex->position[axis] = snapshot->water_vertices[i][j][axis];
+                vertex->normal[axis]   = snapshot->water_normals[i][j][axis];
+            }
+        }
+    }
+}
@@ -0,0 +1,1050 @@
+/**
+ * @file render_backend_core.c
+ * @brief Implements the OpenGL 3.3 core profile backend drawing the draw list.
+ *
+ * Everything is drawn by one shader program replicating the fixed-function
+ * lighting of GL_LIGHT0, GL_MODULATE texturing and the GL_EXP fog. Data
+ * that changes once per frame, the matrices, the light and the fog, is
+ * uploaded into a uniform buffer. Each draw only sets its model matrix
+ * and the material uniforms that changed. Meshes, surfaces, the water,
+ * the boids, the boid impostors and the lines each keep their attribute
+ * setup in a vertex array object.
+ *
+ * Point lights sorted into clusters by the renderer are uploaded into
+ * three buffer textures: the lights, the range of every cluster and the
+ * light lists. Each fragment finds its cluster from its window position
+ * and view depth and adds the diffuse light of the listed lights.
+ */
+
+
+#include "render_backend.h"
+
+#include "frame_stats.h"
+#include "gl_extensions.h"
+#include "gl_trace.h"
+#include "lighting.h"
+#include "options.h"
+#include "renderer.h"
+#include "shader.h"
+#include "stream_buffer.h"
+
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+
+#define FRAME_DATA_BINDING   0       // uniform buffer binding point of the per-frame data
+#define LIGHT_DATA_UNIT      1       // texture unit of the point light buffer texture
+#define CLUSTER_DATA_UNIT    2       // texture unit of the cluster range buffer texture
+#define LIGHT_INDEX_UNIT     3       // texture unit of the cluster light list buffer texture
+#define MATERIAL_COLOR_COUNT 4       // ambient, diffuse, specular and emission
+#define MAX_SHININESS        128.0f  // largest specular exponent the fixed-function backend accepts
+
+#define SHADER_STRING(value)   #value                // quotes a value for the shader sources
+#define SHADER_CONSTANT(value) SHADER_STRING(value)  // quotes the expansion of a macro
+
+
+// Attribute indices, bound in this order when linking.
+enum {
+    ATTRIBUTE_VERTEX_POSITION,
+    ATTRIBUTE_VERTEX_NORMAL,
+    ATTRIBUTE_VERTEX_TEXCOORD,
+    ATTRIBUTE_INSTANCE_POSITION,
+    ATTRIBUTE_INSTANCE_RIGHT,
+    ATTRIBUTE_INSTANCE_UP,
+    ATTRIBUTE_INSTANCE_FORWARD,
+    ATTRIBUTE_VERTEX_COLOR,
+    ATTRIBUTE_COUNT
+};
+
+static const char* const attribute_names[ATTRIBUTE_COUNT] = {
+    "vertex_position",
+    "vertex_normal",
+    "vertex_texcoord",
+    "instance_position",
+    "instance_right",
+    "instance_up",
+    "instance_forward",
+    "vertex_color"
+};
+
+/**
+ * @brief Per-frame data in the std140 layout of the frame_data block.
+ */
+typedef struct {
+    GLfloat view[16];           // column-major view matrix
+    GLfloat projection[16];     // column-major projection matrix
+    GLfloat light_position[4];  // eye-space direction towards the light, w = 0
+    color   light_ambient;      // ambient color of the light
+    color   light_diffuse;      // diffuse color of the light
+    color   light_specular;     // specular color of the light
+    color   scene_ambient;      // global ambient light
+    color   fog_color;          // color the fog fades to
+    GLfloat fog[4];             // { density, 1 if enabled, unused, unused }
+    GLfloat clusters[4];        // { tiles per pixel along x, along y, slice scale, slice bias }
+    GLfloat point_lights[4];    // { number of point lights, unused, unused, unused }
+} frame_data;
+
+// Declared identically by both stages, layout matches frame_data.
+#define FRAME_DATA_BLOCK                 \
+    "layout(std140) uniform frame_data\n" \
+    "{\n"                                 \
+    "    mat4 view;\n"                    \
+    "    mat4 projection;\n"              \
+    "    vec4 light_position;\n"          \
+    "    vec4 light_ambient;\n"           \
+    "    vec4 light_diffuse;\n"           \
+    "    vec4 light_specular;\n"          \
+    "    vec4 scene_ambient;\n"           \
+    "    vec4 fog_color;\n"               \
+    "    vec4 fog;\n"                     \
+    "    vec4 clusters;\n"                \
+    "    vec4 point_lights;\n"            \
+    "};\n"
+
+// Transforms by the model matrix or the instance basis and lights the
+// vertex like GL_LIGHT0 in fixed function: infinite viewer, directional
+// light, clamped color. Colored debug lines take their vertex color unlit.
+static const char* const vertex_shader_source =
+    "#version 330 core\n"
+    FRAME_DATA_BLOCK
+    "uniform mat4  model;\n"
+    "uniform int   instanced;\n"
+    "uniform int   colored;\n"
+    "uniform vec4  material_ambient;\n"
+    "uniform vec4  material_diffuse;\n"
+    "uniform vec4  material_specular;\n"
+    "uniform vec4  material_emission;\n"
+    "uniform float material_shininess;\n"
+    "in vec3 vertex_position;\n"
+    "in vec3 vertex_normal;\n"
+    "in vec2 vertex_texcoord;\n"
+    "in vec3 instance_position;\n"
+    "in vec3 instance_right;\n"
+    "in vec3 instance_up;\n"
+    "in vec3 instance_forward;\n"
+    "in vec4 vertex_color;\n"
+    "out vec4  lit_color;\n"
+    "out vec2  texcoord;\n"
+    "out float fog_distance;\n"
+    "out vec3  view_position;\n"
+    "out vec3  view_normal;\n"
+    "void main()\n"
+    "{\n"
+    "    mat4 model_matrix = model;\n"
+    "    if (instanced != 0)\n"
+    "    {\n"
+    "        model_matrix = mat4(\n"
+    "            vec4(instance_right, 0.0), vec4(instance_up, 0.0),\n"
+    "            vec4(instance_forward, 0.0), vec4(instance_position, 1.0));\n"
+    "    }\n"
+    "    mat4 model_view   = view * model_matrix;\n"
+    "    vec4 eye_position = model_view * vec4(vertex_position, 1.0);\n"
+    "    vec3 normal       = normalize(mat3(model_view) * vertex_normal);\n"
+    "\n"
+    "    vec3  light   = normalize(light_position.xyz);\n"
+    "    float diffuse = max(dot(normal, light), 0.0);\n"
+    "\n"
+    "    vec4 color = material_emission +\n"
+    "                 (scene_ambient + light_ambient) * material_ambient +\n"
+    "                 light_diffuse * material_diffuse * diffuse;\n"
+    "    if (diffuse > 0.0)\n"
+    "    {\n"
+    "        vec3 half_vector = normalize(light + vec3(0.0, 0.0, 1.0));\n"
+    "        color += light_specular * material_specular * pow(\n"
+    "            max(dot(normal, half_vector), 0.0), material_shininess);\n"
+    "    }\n"
+    "    lit_color   = clamp(color, 0.0, 1.0);\n"
+    "    lit_color.a = material_diffuse.a;\n"
+    "    if (colored != 0)\n"
+    "    {\n"
+    "        lit_color = vertex_color;\n"
+    "    }\n"
+    "\n"
+    "    texcoord      = vertex_texcoord;\n"
+    "    fog_distance  = abs(eye_position.z);\n"
+    "    view_position = eye_position.xyz;\n"
+    "    view_normal   = normal;\n"
+    "    gl_Position   = projection * eye_position;\n"
+    "}\n";
+
+// Adds the diffuse light of the point lights of the fragment's cluster,
+// which fades to zero at the light radius, modulates the lit color by the
+// texture, discards the outside of cut out impostors and applies GL_EXP
+// fog when it is enabled.
+static const char* const fragment_shader_source =
+    "#version 330 core\n"
+    FRAME_DATA_BLOCK
+    "const int clusters_x = " SHADER_CONSTANT(LIGHT_CLUSTERS_X) ";\n"
+    "const int clusters_y = " SHADER_CONSTANT(LIGHT_CLUSTERS_Y) ";\n"
+    "const int clusters_z = " SHADER_CONSTANT(LIGHT_CLUSTERS_Z) ";\n"
+    "uniform int            textured;\n"
+    "uniform int            cutout;\n"
+    "uniform int            colored;\n"
+    "uniform float          cutout_alpha;\n"
+    "uniform vec4           material_diffuse;\n"
+    "uniform sampler2D      texture_unit;\n"
+    "uniform samplerBuffer  light_data;\n"
+    "uniform usamplerBuffer cluster_data;\n"
+    "uniform usamplerBuffer light_indices;\n"
+    "in vec4  lit_color;\n"
+    "in vec2  texcoord;\n"
+    "in float fog_distance;\n"
+    "in vec3  view_position;\n"
+    "in vec3  view_normal;\n"
+    "out vec4 fragment_color;\n"
+    "vec3 shade_point_lights()\n"
+    "{\n"
+    "    ivec2 tile   = min(ivec2(gl_FragCoord.xy * clusters.xy), ivec2(clusters_x - 1, clusters_y - 1));\n"
+    "    float depth  = max(-view_position.z, 1.0e-4);\n"
+    "    int   slice  = clamp(int(floor(log(depth) * clusters.z + clusters.w)), 0, clusters_z - 1);\n"
+    "    uvec2 range  = texelFetch(cluster_data, tile.x + clusters_x * (tile.y + clusters_y * slice)).xy;\n"
+    "    vec3  normal = normalize(view_normal);\n"
+    "    vec3  light  = vec3(0.0);\n"
+    "    for (uint i = 0u; i < range.y; ++i)\n"
+    "    {\n"
+    "        int   index    = int(texelFetch(light_indices, int(range.x + i)).x);\n"
+    "        vec4  sphere   = texelFetch(light_data, 2 * index);\n"
+    "        vec3  to_light = sphere.xyz - view_position;\n"
+    "        float distance = length(to_light);\n"
+    "        float falloff  = clamp(1.0 - distance / sphere.w, 0.0, 1.0);\n"
+    "        float diffuse  = max(dot(normal, to_light / max(distance, 1.0e-4)), 0.0);\n"
+    "        light += texelFetch(light_data, 2 * index + 1).rgb * (falloff * falloff * diffuse);\n"
+    "    }\n"
+    "    return light;\n"
+    "}\n"
+    "void main()\n"
+    "{\n"
+    "    vec4 color = lit_color;\n"
+    "    if (point_lights.x > 0.0 && colored == 0)\n"
+    "    {\n"
+    "        color.rgb = min(color.rgb + shade_point_lights() * material_diffuse.rgb, 1.0);\n"
+    "    }\n"
+    "    if (textured != 0)\n"
+    "    {\n"
+    "        color *= texture(texture_unit, texcoord);\n"
+    "    }\n"
+    "    if (cutout != 0 && color.a <= cutout_alpha)\n"
+    "    {\n"
+    "        discard;\n"
+    "    }\n"
+    "    if (fog.y != 0.0)\n"
+    "    {\n"
+    "        float factor = clamp(exp(-fog.x * fog_distance), 0.0, 1.0);\n"
+    "        color.rgb = mix(fog_color.rgb, color.rgb, factor);\n"
+    "    }\n"
+    "    fragment_color = color;\n"
+    "}\n";
+
+/**
+ * @brief Locations of the per-draw uniforms.
+ */
+typedef struct {
+    GLint model;                                  // model matrix
+    GLint instanced;                              // 1 to use the instance basis
+    GLint material_colors[MATERIAL_COLOR_COUNT];  // ambient, diffuse, specular and emission
+    GLint material_shininess;                     // specular exponent
+    GLint textured;                               // 1 to sample the bound texture
+    GLint cutout;                                 // 1 to discard fragments below the cutout alpha
+    GLint colored;                                // 1 to use the vertex color unlit
+} uniform_locations;
+
+/**
+ * @brief Last value set of every cached per-draw uniform.
+ */
+typedef struct {
+    color   material_colors[MATERIAL_COLOR_COUNT];  // current material colors
+    GLfloat material_shininess;                     // current specular exponent
+    int     instanced;                              // current instance switch
+    int     textured;                               // current texture switch
+    int     cutout;                                 // current cutout switch
+    int     colored;                                // current vertex color switch
+    int     known;                                  // 1 once the values were set
+} uniform_cache;
+
+
+static GLuint            program         = 0;  // shader program, 0 until created
+static uniform_locations uniforms;             // per-draw uniform locations
+static uniform_cache     uniform_values;       // last per-draw uniform values
+static GLuint            frame_buffer    = 0;  // uniform buffer of the per-frame data, 0 until created
+
+static GLuint        water_vertex_array = 0;      // water attribute setup, 0 until created
+static GLuint        water_index_buffer = 0;      // static triangle strip over the water grid
+static stream_buffer water_vertex_stream = { 0 };  // water vertices and normals, rewritten every frame
+
+static GLuint boid_vertex_array    = 0;  // boid pyramid and instance attribute setup, 0 until created
+static GLuint boid_vertex_buffer   = 0;  // static triangle list of the pyramid
+static GLuint boid_instance_buffer = 0;  // instance transforms, orphaned every frame
+
+static GLuint impostor_vertex_array  = 0;  // impostor attribute setup, 0 until created
+static GLuint impostor_vertex_buffer = 0;  // impostor quads, orphaned every frame
+
+static GLuint debug_vertex_array  = 0;  // debug line attribute setup, 0 until created
+static GLuint debug_vertex_buffer = 0;  // debug line vertices, orphaned for every weight
+
+static GLuint light_data_buffer    = 0;  // point lights in view space, orphaned every frame, 0 without buffer textures
+static GLuint cluster_data_buffer  = 0;  // light list range of every cluster, orphaned every frame
+static GLuint light_index_buffer   = 0;  // light lists of all clusters, orphaned every frame
+static GLuint light_data_texture   = 0;  // buffer texture reading light_data_buffer
+static GLuint cluster_data_texture = 0;  // buffer texture reading cluster_data_buffer
+static GLuint light_index_texture  = 0;  // buffer texture reading light_index_buffer
+
+
+/**
+ * @brief Counts draw calls issued to OpenGL in the frame statistics.
+ */
+static void count_draw_call(void)
+{
+    ++current_frame_stats.draw_calls;
+}
+
+/**
+ * @brief Points a three component float attribute into the bound array buffer.
+ *
+ * @param attribute Attribute index.
+ * @param stride    Bytes between consecutive vertices.
+ * @param offset    Offset of the attribute in the buffer.
+ */
+static void set_vector_attribute(GLuint attribute, GLsizei stride, size_t offset)
+{
+    glEnableVertexAttribArray(attribute);
+    glVertexAttribPointer(attribute, 3, GL_FLOAT, GL_FALSE, stride, (const GLvoid*)offset);
+}
+
+/**
+ * @brief Creates a buffer and a buffer texture reading it on a texture unit.
+ *
+ * @param unit    Texture unit the texture stays bound to.
+ * @param format  Internal format of the texels.
+ * @param size    Initial size of the buffer in bytes.
+ * @param buffer  Output buffer name.
+ * @param texture Output texture name.
+ */
+static void create_buffer_texture(GLuint unit, GLenum format, size_t size, GLuint* buffer, GLuint* texture)
+{
+    glGenBuffers(1, buffer);
+    glBindBuffer(GL_TEXTURE_BUFFER, *buffer);
+    glBufferData(GL_TEXTURE_BUFFER, (gl_size_pointer)size, NULL, GL_STREAM_DRAW);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+    glGenTextures(1, texture);
+    glActiveTexture(GL_TEXTURE0 + unit);
+    glBindTexture(GL_TEXTURE_BUFFER, *texture);
+    glTexBuffer(GL_TEXTURE_BUFFER, format, *buffer);
+    glActiveTexture(GL_TEXTURE0);
+}
+
+/**
+ * @brief Creates the buffer textures of the point lights.
+ *
+ * The textures stay bound to their units, which nothing else uses,
+ * so drawing never rebinds them.
+ */
+static void create_light_buffers(void)
+{
+    create_buffer_texture(
+        LIGHT_DATA_UNIT, GL_RGBA32F,
+        sizeof(((light_cluster_grid*)0)->lights),
+        &light_data_buffer, &light_data_texture
+    );
+    create_buffer_texture(
+        CLUSTER_DATA_UNIT, GL_RG32UI,
+        sizeof(((light_cluster_grid*)0)->clusters),
+        &cluster_data_buffer, &cluster_data_texture
+    );
+    create_buffer_texture(
+        LIGHT_INDEX_UNIT, GL_R16UI,
+        sizeof(((light_cluster_grid*)0)->indices),
+        &light_index_buffer, &light_index_texture
+    );
+
+    glUniform1i(glGetUniformLocation(program, "light_data"),    LIGHT_DATA_UNIT);
+    glUniform1i(glGetUniformLocation(program, "cluster_data"),  CLUSTER_DATA_UNIT);
+    glUniform1i(glGetUniformLocation(program, "light_indices"), LIGHT_INDEX_UNIT);
+}
+
+/**
+ * @brief Compiles the program and creates the uniform buffer.
+ *
+ * @return int Returns 1 if the context supports the backend, 0 otherwise.
+ */
+static int core_initialize(void)
+{
+    if (!gl_extensions.vertex_array_objects ||
+        !gl_extensions.uniform_buffers ||
+        !gl_extensions.instanced_arrays)
+    {
+        return 0;
+    }
+
+    program = shader_create_program(
+        vertex_shader_source,
+        fragment_shader_source,
+        attribute_names,
+        ATTRIBUTE_COUNT
+    );
+    if (program == 0)
+    {
+        return 0;
+    }
+
+    const char* const material_names[MATERIAL_COLOR_COUNT] = {
+        "material_ambient",
+        "material_diffuse",
+        "material_specular",
+        "material_emission"
+    };
+    uniforms.model     = glGetUniformLocation(program, "model");
+    uniforms.instanced = glGetUniformLocation(program, "instanced");
+    for (int i = 0; i < MATERIAL_COLOR_COUNT; ++i)
+    {
+        uniforms.material_colors[i] = glGetUniformLocation(program, material_names[i]);
+    }
+    uniforms.material_shininess = glGetUniformLocation(program, "material_shininess");
+    uniforms.textured           = glGetUniformLocation(program, "textured");
+    uniforms.cutout             = glGetUniformLocation(program, "cutout");
+    uniforms.colored            = glGetUniformLocation(program, "colored");
+    uniform_values.known        = 0;
+
+    const GLuint block_index = glGetUniformBlockIndex(program, "frame_data");
+    if (block_index == GL_INVALID_INDEX)
+    {
+        glDeleteProgram(program);
+        program = 0;
+        return 0;
+    }
+    glUniformBlockBinding(program, block_index, FRAME_DATA_BINDING);
+
+    glGenBuffers(1, &frame_buffer);
+    glBindBuffer(GL_UNIFORM_BUFFER, frame_buffer);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(frame_data), NULL, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    glBindBufferBase(GL_UNIFORM_BUFFER, FRAME_DATA_BINDING, frame_buffer);
+
+    glUseProgram(program);
+    glUniform1i(glGetUniformLocation(program, "texture_unit"), 0);
+    glUniform1f(glGetUniformLocation(program, "cutout_alpha"), IMPOSTOR_ALPHA_CUTOFF);
+
+    // Without buffer textures the point lights are left out.
+    if (gl_extensions.texture_buffers)
+    {
+        create_light_buffers();
+    }
+
+    return 1;
+}
+
+/**
+ * @brief Creates the vertex array of an uploaded mesh.
+ *
+ * @param mesh The loaded mesh, uploaded into buffer objects.
+ */
+static void core_upload_mesh(mesh* mesh)
+{
+    if (mesh->vertex_buffer == 0)
+    {
+        mesh_upload(mesh);
+    }
+    if (mesh->vertex_buffer == 0 || mesh->vertex_array != 0)
+    {
+        return;
+    }
+
+    glGenVertexArrays(1, &mesh->vertex_array);
+    glBindVertexArray(mesh->vertex_array);
+
+    glBindBuffer(GL_ARRAY_BUFFER, mesh->vertex_buffer);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh->index_buffer);
+    set_vector_attribute(ATTRIBUTE_VERTEX_POSITION, sizeof(mesh_vertex), offsetof(mesh_vertex, position));
+    set_vector_attribute(ATTRIBUTE_VERTEX_NORMAL,   sizeof(mesh_vertex), offsetof(mesh_vertex, normal));
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+/**
+ * @brief Creates the vertex array of an environment surface.
+ *
+ * @param surface The surface, uploaded into buffer objects.
+ */
+static void create_surface_vertex_array(environment_surface* surface)
+{
+    glGenVertexArrays(1, &surface->vertex_array);
+    glBindVertexArray(surface->vertex_array);
+
+    glBindBuffer(GL_ARRAY_BUFFER, surface->vertex_buffer);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, surface->index_buffer);
+    set_vector_attribute(
+        ATTRIBUTE_VERTEX_POSITION, sizeof(environment_vertex), offsetof(environment_vertex, position)
+    );
+    set_vector_attribute(
+        ATTRIBUTE_VERTEX_NORMAL, sizeof(environment_vertex), offsetof(environment_vertex, normal)
+    );
+    glEnableVertexAttribArray(ATTRIBUTE_VERTEX_TEXCOORD);
+    glVertexAttribPointer(
+        ATTRIBUTE_VERTEX_TEXCOORD, 2, GL_FLOAT, GL_FALSE,
+        sizeof(environment_vertex),
+        (const GLvoid*)offsetof(environment_vertex, texcoord)
+    );
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+/**
+ * @brief Creates the water index buffer, vertex stream and vertex array.
+ */
+static void create_water_vertex_array(void)
+{
+    GLushort indices[WATER_INDEX_COUNT];
+    render_backend_list_water_strip(indices);
+
+    glGenVertexArrays(1, &water_vertex_array);
+    glBindVertexArray(water_vertex_array);
+
+    glGenBuffers(1, &water_index_buffer);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, water_index_buffer);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+
+    glBindVertexArray(0);
+
+    stream_buffer_create(
+        &water_vertex_stream,
+        WATER_VERTEX_COUNT * sizeof(mesh_vertex),
+        main_options.stream_mode
+    );
+}
+
+/**
+ * @brief Creates the boid buffers and their vertex array.
+ *
+ * @param pyramid Triangle list of one boid.
+ */
+static void create_boid_vertex_array(const mesh_vertex* pyramid)
+{
+    glGenVertexArrays(1, &boid_vertex_array);
+    glBindVertexArray(boid_vertex_array);
+
+    glGenBuffers(1, &boid_vertex_buffer);
+    glBindBuffer(GL_ARRAY_BUFFER, boid_vertex_buffer);
+    glBufferData(
+        GL_ARRAY_BUFFER,
+        BOID_PYRAMID_VERTEX_COUNT * sizeof(mesh_vertex),
+        pyramid,
+        GL_STATIC_DRAW
+    );
+    set_vector_attribute(ATTRIBUTE_VERTEX_POSITION, sizeof(mesh_vertex), offsetof(mesh_vertex, position));
+    set_vector_attribute(ATTRIBUTE_VERTEX_NORMAL,   sizeof(mesh_vertex), offsetof(mesh_vertex, normal));
+
+    const size_t instance_offsets[] = {
+        offsetof(instance_transform, position),
+        offsetof(instance_transform, right),
+        offsetof(instance_transform, up),
+        offsetof(instance_transform, forward)
+    };
+    glGenBuffers(1, &boid_instance_buffer);
+    glBindBuffer(GL_ARRAY_BUFFER, boid_instance_buffer);
+    for (GLuint i = 0; i < 4; ++i)
+    {
+        set_vector_attribute(ATTRIBUTE_INSTANCE_POSITION + i, sizeof(instance_transform), instance_offsets[i]);
+        glVertexAttribDivisor(ATTRIBUTE_INSTANCE_POSITION + i, 1);
+    }
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+/**
+ * @brief Creates the impostor vertex buffer and its vertex array.
+ */
+static void create_impostor_vertex_array(void)
+{
+    glGenVertexArrays(1, &impostor_vertex_array);
+    glBindVertexArray(impostor_vertex_array);
+
+    glGenBuffers(1, &impostor_vertex_buffer);
+    glBindBuffer(GL_ARRAY_BUFFER, impostor_vertex_buffer);
+    set_vector_attribute(
+        ATTRIBUTE_VERTEX_POSITION, sizeof(impostor_vertex), offsetof(impostor_vertex, position)
+    );
+    set_vector_attribute(
+        ATTRIBUTE_VERTEX_NORMAL, sizeof(impostor_vertex), offsetof(impostor_vertex, normal)
+    );
+    glEnableVertexAttribArray(ATTRIBUTE_VERTEX_TEXCOORD);
+    glVertexAttribPointer(
+        ATTRIBUTE_VERTEX_TEXCOORD, 2, GL_FLOAT, GL_FALSE,
+        sizeof(impostor_vertex),
+        (const GLvoid*)offsetof(impostor_vertex, texcoord)
+    );
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+/**
+ * @brief Creates the debug line vertex buffer and its vertex array.
+ *
+ * The normal attribute stays disabled, the colored lines are not lit.
+ */
+static void create_debug_vertex_array(void)
+{
+    glGenVertexArrays(1, &debug_vertex_array);
+    glBindVertexArray(debug_vertex_array);
+
+    glGenBuffers(1, &debug_vertex_buffer);
+    glBindBuffer(GL_ARRAY_BUFFER, debug_vertex_buffer);
+    set_vector_attribute(ATTRIBUTE_VERTEX_POSITION, sizeof(debug_vertex), offsetof(debug_vertex, position));
+    glEnableVertexAttribArray(ATTRIBUTE_VERTEX_COLOR);
+    glVertexAttribPointer(
+        ATTRIBUTE_VERTEX_COLOR, 4, GL_UNSIGNED_BYTE, GL_TRUE,
+        sizeof(debug_vertex),
+        (const GLvoid*)offsetof(debug_vertex, color)
+    );
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+/**
+ * @brief Uploads the per-frame data into the uniform buffer.
+ *
+ * The light direction is transformed into eye space here once,
+ * as glLightfv does for the fixed-function backend.
+ *
+ * @param list The draw list of the frame.
+ */
+static void upload_frame_data(const draw_list* list)
+{
+    const GLfloat light_position[4] = LIGHT_POSITION;
+    const color   light_ambient     = LIGHT_AMBIENT;
+    const color   light_diffuse     = LIGHT_DIFFUSE;
+    const color   light_specular    = LIGHT_SPECULAR;
+    const color   scene_ambient     = LIGHT_AMBIENT_GLOBAL;
+    const color   fog_color         = FOG_COLOR;
+
+    frame_data data;
+    memcpy(data.view,           list->view,       sizeof(data.view));
+    memcpy(data.projection,     list->projection, sizeof(data.projection));
+    memcpy(data.light_ambient,  light_ambient,    sizeof(color));
+    memcpy(data.light_diffuse,  light_diffuse,    sizeof(color));
+    memcpy(data.light_specular, light_specular,   sizeof(color));
+    memcpy(data.scene_ambient,  scene_ambient,    sizeof(color));
+    memcpy(data.fog_color,      fog_color,        sizeof(color));
+
+    for (int row = 0; row < 4; ++row)
+    {
+        data.light_position[row] = 0.0f;
+        for (int column = 0; column < 4; ++column)
+        {
+            data.light_position[row] += list->view[column * 4 + row] * light_position[column];
+        }
+    }
+
+    data.fog[0] = list->fog_density;
+    data.fog[1] = list->fog_enabled ? 1.0f : 0.0f;
+    data.fog[2] = 0.0f;
+    data.fog[3] = 0.0f;
+
+    const light_cluster_grid* lights = light_data_buffer != 0 ? list->lights : NULL;
+    data.clusters[0]     = lights != NULL ? lights->tile_scale[0] : 0.0f;
+    data.clusters[1]     = lights != NULL ? lights->tile_scale[1] : 0.0f;
+    data.clusters[2]     = lights != NULL ? lights->slice_scale   : 0.0f;
+    data.clusters[3]     = lights != NULL ? lights->slice_bias    : 0.0f;
+    data.point_lights[0] = lights != NULL ? (GLfloat)lights->light_count : 0.0f;
+    data.point_lights[1] = 0.0f;
+    data.point_lights[2] = 0.0f;
+    data.point_lights[3] = 0.0f;
+
+    glBindBuffer(GL_UNIFORM_BUFFER, frame_buffer);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(frame_data), &data);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+/**
+ * @brief Orphans a light buffer and fills the used part of it.
+ *
+ * @param buffer   The buffer.
+ * @param capacity Size of the buffer in bytes.
+ * @param used     Bytes to upload.
+ * @param data     The data.
+ */
+static void upload_light_buffer(GLuint buffer, size_t capacity, size_t used, const void* data)
+{
+    glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+    glBufferData(GL_TEXTURE_BUFFER, (gl_size_pointer)capacity, NULL, GL_STREAM_DRAW);
+    if (used > 0)
+    {
+        glBufferSubData(GL_TEXTURE_BUFFER, 0, (gl_size_pointer)used, data);
+    }
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+/**
+ * @brief Uploads the point lights and cluster lists of the frame.
+ *
+ * @param lights The lights sorted into clusters.
+ */
+static void upload_point_lights(const light_cluster_grid* lights)
+{
+    upload_light_buffer(
+        light_data_buffer, sizeof(lights->lights),
+        (size_t)lights->light_count * sizeof(lights->lights[0]), lights->lights
+    );
+    upload_light_buffer(
+        cluster_data_buffer, sizeof(lights->clusters),
+        sizeof(lights->clusters), lights->clusters
+    );
+    upload_light_buffer(
+        light_index_buffer, sizeof(lights->indices),
+        (size_t)lights->index_count * sizeof(lights->indices[0]), lights->indices
+    );
+}
+
+/**
+ * @brief Sets an integer switch uniform unless it already has the value.
+ *
+ * @param location Location of the uniform.
+ * @param current  Last value set.
+ * @param value    The new value.
+ */
+static void set_switch_uniform(GLint location, int* current, int value)
+{
+    if (uniform_values.known && *current == value)
+    {
+        gl_state_count_call(0);
+        return;
+    }
+
+    glUniform1i(location, value);
+    *current = value;
+    gl_state_count_call(1);
+}
+
+/**
+ * @brief Sets the material uniforms, issuing only the changed ones.
+ *
+ * Like the fixed-function backend, exponents beyond the range OpenGL
+ * accepts for glMaterial keep the current one.
+ *
+ * @param material The material of the following draws.
+ */
+static void set_material(const gl_material* material)
+{
+    const GLfloat* values[MATERIAL_COLOR_COUNT] = {
+        material->ambient,
+        material->diffuse,
+        material->specular,
+        material->emission
+    };
+
+    for (int i = 0; i < MATERIAL_COLOR_COUNT; ++i)
+    {
+        if (uniform_values.known &&
+            memcmp(uniform_values.material_colors[i], values[i], sizeof(color)) == 0)
+        {
+            gl_state_count_call(0);
+            continue;
+        }
+
+        glUniform4fv(uniforms.material_colors[i], 1, values[i]);
+        memcpy(uniform_values.material_colors[i], values[i], sizeof(color));
+        gl_state_count_call(1);
+    }
+
+    if ((uniform_values.known && uniform_values.material_shininess == material->shininess) ||
+        material->shininess < 0.0f || material->shininess > MAX_SHININESS)
+    {
+        gl_state_count_call(0);
+        return;
+    }
+
+    glUniform1f(uniforms.material_shininess, material->shininess);
+    uniform_values.material_shininess = material->shininess;
+    gl_state_count_call(1);
+}
+
+/**
+ * @brief Streams the water grid and draws it as one strip.
+ *
+ * The stream offset changes between frames, so the vertex
+ * attributes are pointed at the current region every time.
+ *
+ * @param snapshot Simulation state holding the water grid.
+ */
+static void draw_water(const simulation_snapshot* snapshot)
+{
+    if (water_vertex_array == 0)
+    {
+        create_water_vertex_array();
+    }
+
+    size_t       offset   = 0;
+    mesh_vertex* vertices = (mesh_vertex*)stream_buffer_begin(&water_vertex_stream, &offset);
+    if (vertices == NULL)
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        return;
+    }
+    render_backend_copy_water_vertices(snapshot, vertices);
+    stream_buffer_end(&water_vertex_stream);
+
+    glBindVertexArray(water_vertex_array);
+    set_vector_attribute(ATTRIBUTE_VERTEX_POSITION, sizeof(mesh_vertex), offset + offsetof(mesh_vertex, position));
+    set_vector_attribute(ATTRIBUTE_VERTEX_NORMAL,   sizeof(mesh_vertex), offset + offsetof(mesh_vertex, normal));
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    glDrawElements(GL_TRIANGLE_STRIP, WATER_INDEX_COUNT, GL_UNSIGNED_SHORT, (const GLvoid*)0);
+    count_draw_call();
+
+    stream_buffer_fence(&water_vertex_stream);
+}
+
+/**
+ * @brief Streams the boid transforms and draws the flock in one instanced call.
+ *
+ * @param list The draw list holding the boid transforms.
+ */
+static void draw_boids(const draw_list* list)
+{
+    if (list->boid_count == 0)
+    {
+        return;
+    }
+    if (boid_vertex_array == 0)
+    {
+        create_boid_vertex_array(list->boid_pyramid);
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, boid_instance_buffer);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(list->boids), NULL, GL_STREAM_DRAW);
+    glBufferSubData(
+        GL_ARRAY_BUFFER, 0,
+        (gl_size_pointer)(list->boid_count * sizeof(instance_transform)),
+        list->boids
+    );
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    glBindVertexArray(boid_vertex_array);
+    glDrawArraysInstanced(GL_TRIANGLES, 0, BOID_PYRAMID_VERTEX_COUNT, list->boid_count);
+    count_draw_call();
+}
+
+/**
+ * @brief Streams the impostor quads and draws them in one call.
+ *
+ * @param list The draw list holding the impostor vertices.
+ */
+static void draw_impostors(const draw_list* list)
+{
+    if (impostor_vertex_array == 0)
+    {
+        create_impostor_vertex_array();
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, impostor_vertex_buffer);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(list->impostor_vertices), NULL, GL_STREAM_DRAW);
+    glBufferSubData(
+        GL_ARRAY_BUFFER, 0,
+        (gl_size_pointer)(list->impostor_vertex_count * sizeof(impostor_vertex)),
+        list->impostor_vertices
+    );
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    glBindVertexArray(impostor_vertex_array);
+    glDrawArrays(GL_TRIANGLES, 0, list->impostor_vertex_count);
+    count_draw_call();
+}
+
+/**
+ * @brief Streams one weight of the debug lines and draws them in one call.
+ *
+ * @param list The draw list holding the debug lines.
+ * @param item The debug item.
+ */
+static void draw_debug_lines(const draw_list* list, const draw_item* item)
+{
+    if (debug_vertex_array == 0)
+    {
+        create_debug_vertex_array();
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, debug_vertex_buffer);
+    glBufferData(GL_ARRAY_BUFFER, DEBUG_DRAW_CAPACITY * sizeof(debug_vertex), NULL, GL_STREAM_DRAW);
+    glBufferSubData(
+        GL_ARRAY_BUFFER, 0,
+        (gl_size_pointer)(item->count * sizeof(debug_vertex)),
+        &list->debug->vertices[item->first]
+    );
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    glBindVertexArray(debug_vertex_array);
+    glDrawArrays(GL_LINES, 0, item->count);
+    count_draw_call();
+}
+
+/**
+ * @brief Draws one item of the draw list.
+ *
+ * @param list The draw list.
+ * @param item The item to draw.
+ */
+static void draw_item_core(const draw_list* list, const draw_item* item)
+{
+    gl_trace_set_pass(item->pass);
+    gl_state_bind_texture(item->texture_id);
+    set_switch_uniform(uniforms.textured, &uniform_values.textured, item->texture_id != 0);
+    set_switch_uniform(uniforms.instanced, &uniform_values.instanced, item->type == DRAW_ITEM_BOIDS);
+    set_switch_uniform(uniforms.cutout, &uniform_values.cutout, item->type == DRAW_ITEM_IMPOSTORS);
+    set_switch_uniform(uniforms.colored, &uniform_values.colored, item->type == DRAW_ITEM_DEBUG);
+    set_material(&item->material);
+    uniform_values.known = 1;
+    gl_state_line_width(item->line_width);
+
+    switch (item->type)
+    {
+    case DRAW_ITEM_MESH:
+        if (item->mesh->vertex_array == 0)
+        {
+            core_upload_mesh(item->mesh);
+        }
+        if (item->mesh->vertex_array != 0)
+        {
+            glUniformMatrix4fv(uniforms.model, 1, GL_FALSE, item->model);
+            glBindVertexArray(item->mesh->vertex_array);
+            glDrawElements(GL_TRIANGLES, item->mesh->index_count, GL_UNSIGNED_INT, (const GLvoid*)0);
+            count_draw_call();
+        }
+        break;
+
+    case DRAW_ITEM_SURFACE:
+        if (item->surface->vertex_buffer == 0)
+        {
+            break;
+        }
+        if (item->surface->vertex_array == 0)
+        {
+            create_surface_vertex_array(item->surface);
+        }
+        glUniformMatrix4fv(uniforms.model, 1, GL_FALSE, item->model);
+        glBindVertexArray(item->surface->vertex_array);
+        glDrawElements(GL_TRIANGLES, item->surface->index_count, GL_UNSIGNED_SHORT, (const GLvoid*)0);
+        count_draw_call();
+        break;
+
+    case DRAW_ITEM_WATER:
+        glUniformMatrix4fv(uniforms.model, 1, GL_FALSE, item->model);
+        draw_water(list->snapshot);
+        break;
+
+    case DRAW_ITEM_BOIDS:
+        draw_boids(list);
+        break;
+
+    case DRAW_ITEM_IMPOSTORS:
+        glUniformMatrix4fv(uniforms.model, 1, GL_FALSE, item->model);
+        draw_impostors(list);
+        break;
+
+    case DRAW_ITEM_DEBUG:
+        glUniformMatrix4fv(uniforms.model, 1, GL_FALSE, item->model);
+        draw_debug_lines(list, item);
+        break;
+    }
+}
+
+/**
+ * @brief Uploads the per-frame data and draws the draw list.
+ *
+ * @param list The draw list of the frame.
+ */
+static void core_submit(const draw_list* list)
+{
+    // Clear color and depth buffers to prepare for new frame rendering.
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    glUseProgram(program);
+    upload_frame_data(list);
+    if (list->lights != NULL && list->lights->light_count > 0 && light_data_buffer != 0)
+    {
+        upload_point_lights(list->lights);
+    }
+
+    for (int i = 0; i < list->item_count; ++i)
+    {
+        draw_item_core(list, &list->items[i]);
+    }
+    gl_trace_set_pass(RENDER_PASS_OTHER);
+
+    glBindVertexArray(0);
+}
+
+/**
+ * @brief Swaps the buffers of the GLUT window.
+ */
+static void core_present(void)
+{
+    glutSwapBuffers();
+}
+
+/**
+ * @brief Frees the program, buffers and vertex arrays of the backend.
+ *
+ * The vertex arrays of meshes and surfaces are freed with them.
+ */
+static void core_clean_up(void)
+{
+    stream_buffer_destroy(&water_vertex_stream);
+
+    GLuint* buffers[] = {
+        &frame_buffer, &water_index_buffer, &boid_vertex_buffer,
+        &boid_instance_buffer, &impostor_vertex_buffer, &debug_vertex_buffer,
+        &light_data_buffer, &cluster_data_buffer, &light_index_buffer
+    };
+    for (int i = 0; i < (int)(sizeof(buffers) / sizeof(buffers[0])); ++i)
+    {
+        if (*buffers[i] != 0)
+        {
+            glDeleteBuffers(1, buffers[i]);
+            *buffers[i] = 0;
+        }
+    }
+
+    GLuint* vertex_arrays[] = {
+        &water_vertex_array, &boid_vertex_array, &impostor_vertex_array, &debug_vertex_array
+    };
+    for (int i = 0; i < (int)(sizeof(vertex_arrays) / sizeof(vertex_arrays[0])); ++i)
+    {
+        if (*vertex_arrays[i] != 0)
+        {
+            glDeleteVertexArrays(1, vertex_arrays[i]);
+            *vertex_arrays[i] = 0;
+        }
+    }
+
+    GLuint* textures[] = { &light_data_texture, &cluster_data_texture, &light_index_texture };
+    for (int i = 0; i < (int)(sizeof(textures) / sizeof(textures[0])); ++i)
+    {
+        if (*textures[i] != 0)
+        {
+            glDeleteTextures(1, textures[i]);
+            *textures[i] = 0;
+        }
+    }
+
+    if (program != 0)
+    {
+        glUseProgram(0);
+        glDeleteProgram(program);
+        program = 0;
+    }
+}
+
+
+const render_backend render_backend_core = {
+    "core",
+    core_initialize,
+    core_upload_mesh,
+    core_submit,
+    core_present,
+    core_clean_up
+};
@@ -0,0 +1,590 @@
+/**
+ * @file render_backend_fixed.c
+ * @brief Implements the fixed-function backend drawing the draw list.
+ *
+ * Matrices are loaded into the OpenGL matrix stack, materials are set
+ * with glMaterial and GL_LIGHT0 lights the scene. Meshes are submitted
+ * through the render path selected at startup.
+ */
+
+
+#include "render_backend.h"
+
+#include "frame_stats.h"
+#include "gl_extensions.h"
+#include "gl_trace.h"
+#include "lighting.h"
+#include "options.h"
+#include "renderer.h"
+#include "stream_buffer.h"
+#include "water.h"
+
+#include <stddef.h>
+#include <stdio.h>
+
+
+static GLuint display_list_boid = 0;  // boid pyramid, 0 until compiled.
+
+static instanced_shape boid_shape = { 0 };  // boid pyramid for instanced drawing, 0 until created.
+
+static stream_buffer water_vertex_stream = { 0 };  // water vertices and normals, rewritten every frame.
+static GLuint        water_index_buffer  = 0;      // static triangle strip over the water grid, 0 until created.
+
+static GLfloat applied_fog_density = -1.0f;  // fog density last passed to OpenGL, negative until set.
+
+
+/**
+ * @brief Counts draw calls issued to OpenGL in the frame statistics.
+ *
+ * @param count Number of draw calls, glBegin/glEnd blocks or replayed display lists.
+ */
+static void count_draw_calls(int count)
+{
+    current_frame_stats.draw_calls += count;
+}
+
+/**
+ * @brief Selects the render path and sets up the fixed-function state.
+ *
+ * @return int Always 1, every context supports the immediate path.
+ */
+static int fixed_initialize(void)
+{
+    // Use the path chosen at startup, falling back to older paths if unsupported.
+    mesh_render_path = main_options.render_path;
+    while (!renderer_path_supported(mesh_render_path))
+    {
+        mesh_render_path = (render_path)(mesh_render_path - 1);
+    }
+    if (mesh_render_path != main_options.render_path)
+    {
+        printf(
+            "Render path %s is not supported, using %s.\n\n",
+            renderer_path_name(main_options.render_path),
+            renderer_path_name(mesh_render_path)
+        );
+    }
+
+    lighting_initialize();
+
+    // Enable texture mapping.
+    gl_state_enable(GL_TEXTURE_2D, 1);
+    // Enable texture mode.
+    glTexEnvf(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
+    // Enable the unit vector normals.
+    gl_state_enable(GL_NORMALIZE, 1);
+    // Enable smooth lighting.
+    glShadeModel(GL_SMOOTH);
+
+    // Initialize fog for underwater appearance.
+    const GLfloat fog_color[] = FOG_COLOR;
+    glFogfv(GL_FOG_COLOR, fog_color);
+    glFogf(GL_FOG_MODE, GL_EXP);
+
+    // Cut impostor quads out along the outline baked into the atlas.
+    glAlphaFunc(GL_GREATER, IMPOSTOR_ALPHA_CUTOFF);
+
+    return 1;
+}
+
+/**
+ * @brief Submits the faces of a mesh, each in its own glBegin/glEnd block.
+ *
+ * @param mesh The mesh object to draw.
+ */
+static void draw_mesh_immediate(const mesh* mesh)
+{
+    for (int i = 0; i < mesh->face_count; ++i)
+    {
+        const mesh_face face = mesh->faces[i];
+
+        glBegin(GL_TRIANGLES);  // draw face of 3 normals, 3 vertices.
+        for (int corner = 0; corner < 3; ++corner)
+        {
+            glNormal3fv(mesh->normals[face.normal_numbers[corner] - 1]);
+            glVertex3fv(mesh->vertices[face.vertex_numbers[corner] - 1]);
+        }
+        glEnd();
+    }
+}
+
+/**
+ * @brief Compiles the faces of a mesh into its display list.
+ *
+ * The list is only rebuilt when the mesh was reloaded since it was compiled.
+ *
+ * @param mesh The mesh to compile.
+ */
+static void compile_mesh_display_list(mesh* mesh)
+{
+    if (mesh->display_list != 0 &&
+        mesh->display_list_revision == mesh->revision)
+    {
+        return;
+    }
+
+    if (mesh->display_list == 0)
+    {
+        mesh->display_list = glGenLists(1);
+    }
+
+    glNewList(mesh->display_list, GL_COMPILE);
+        draw_mesh_immediate(mesh);
+    glEndList();
+
+    mesh->display_list_revision = mesh->revision;
+}
+
+/**
+ * @brief Compiles the mesh into a display list on the display list path.
+ *
+ * The buffer objects of the other paths are created when the mesh is
+ * loaded, so the first frame does not pay for either.
+ *
+ * @param mesh The loaded mesh.
+ */
+static void fixed_upload_mesh(mesh* mesh)
+{
+    if (mesh_render_path == RENDER_PATH_DISPLAY_LIST)
+    {
+        compile_mesh_display_list(mesh);
+    }
+}
+
+/**
+ * @brief Renders a mesh from its buffer objects with a single draw call.
+ *
+ * @param mesh The uploaded mesh to draw.
+ */
+static void draw_mesh_buffers(const mesh* mesh)
+{
+    glBindBuffer(GL_ARRAY_BUFFER, mesh->vertex_buffer);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh->index_buffer);
+
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_NORMAL_ARRAY);
+    glVertexPointer(3, GL_FLOAT, sizeof(mesh_vertex), (const GLvoid*)0);
+    glNormalPointer(GL_FLOAT, sizeof(mesh_vertex), (const GLvoid*)sizeof(point_3d));
+
+    glDrawElements(GL_TRIANGLES, mesh->index_count, GL_UNSIGNED_INT, (const GLvoid*)0);
+
+    glDisableClientState(GL_NORMAL_ARRAY);
+    glDisableClientState(GL_VERTEX_ARRAY);
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+/**
+ * @brief Renders a mesh through the current render path.
+ *
+ * Uses the buffer objects of the mesh on the VBO and instanced paths
+ * and its display list on the display list path, otherwise submits
+ * every face in its own glBegin/glEnd block.
+ *
+ * @param mesh The mesh object to draw.
+ */
+static void draw_mesh(mesh* mesh)
+{
+    switch (mesh_render_path)
+    {
+    case RENDER_PATH_VBO:
+    case RENDER_PATH_INSTANCED:
+        if (mesh->vertex_buffer != 0)
+        {
+            draw_mesh_buffers(mesh);
+            count_draw_calls(1);
+            return;
+        }
+        break;
+
+    case RENDER_PATH_DISPLAY_LIST:
+        compile_mesh_display_list(mesh);
+        glCallList(mesh->display_list);
+        count_draw_calls(1);
+        return;
+
+    default:
+        break;
+    }
+
+    draw_mesh_immediate(mesh);
+    count_draw_calls(mesh->face_count);
+}
+
+/**
+ * @brief Creates the static index buffer and the vertex stream of the water grid.
+ */
+static void create_water_buffers(void)
+{
+    GLushort indices[WATER_INDEX_COUNT];
+    render_backend_list_water_strip(indices);
+
+    glGenBuffers(1, &water_index_buffer);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, water_index_buffer);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+    stream_buffer_create(
+        &water_vertex_stream,
+        WATER_VERTEX_COUNT * sizeof(mesh_vertex),
+        main_options.stream_mode
+    );
+}
+
+/**
+ * @brief Streams the water grid into its vertex buffer and draws it as one strip.
+ *
+ * @param snapshot Simulation state holding the water grid.
+ */
+static void draw_water_buffers(const simulation_snapshot* snapshot)
+{
+    if (water_index_buffer == 0)
+    {
+        create_water_buffers();
+    }
+
+    size_t       offset   = 0;
+    mesh_vertex* vertices = (mesh_vertex*)stream_buffer_begin(&water_vertex_stream, &offset);
+    if (vertices == NULL)
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        return;
+    }
+
+    render_backend_copy_water_vertices(snapshot, vertices);
+    stream_buffer_end(&water_vertex_stream);
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, water_index_buffer);
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_NORMAL_ARRAY);
+    glVertexPointer(3, GL_FLOAT, sizeof(mesh_vertex), (const GLvoid*)offset);
+    glNormalPointer(GL_FLOAT, sizeof(mesh_vertex), (const GLvoid*)(offset + sizeof(point_3d)));
+
+    glDrawElements(GL_TRIANGLE_STRIP, WATER_INDEX_COUNT, GL_UNSIGNED_SHORT, (const GLvoid*)0);
+    count_draw_calls(1);
+
+    glDisableClientState(GL_NORMAL_ARRAY);
+    glDisableClientState(GL_VERTEX_ARRAY);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    stream_buffer_fence(&water_vertex_stream);
+}
+
+/**
+ * @brief Draws the water grid of the snapshot.
+ *
+ * Buffer object paths stream the grid into a vertex buffer, other
+ * paths submit one quad strip per row.
+ *
+ * @param snapshot Simulation state holding the water grid.
+ */
+static void draw_water(const simulation_snapshot* snapshot)
+{
+    if (mesh_render_path >= RENDER_PATH_VBO)
+    {
+        draw_water_buffers(snapshot);
+        return;
+    }
+
+    for (int i = 0; i < WATER_GRID_SIZE; ++i)
+    {
+        glBegin(GL_QUAD_STRIP);
+        for (int j = 0; j <= WATER_GRID_SIZE; ++j)
+        {
+            glNormal3fv(snapshot->water_normals[i][j]);
+            glVertex3fv(snapshot->water_vertices[i][j]);
+            glNormal3fv(snapshot->water_normals[i + 1][j]);
+            glVertex3fv(snapshot->water_vertices[i + 1][j]);
+        }
+        glEnd();
+    }
+    count_draw_calls(WATER_GRID_SIZE);
+}
+
+/**
+ * @brief Submits the boid pyramid in immediate mode.
+ *
+ * @param vertices Triangle list of the pyramid.
+ */
+static void submit_boid_pyramid(const mesh_vertex* vertices)
+{
+    glBegin(GL_TRIANGLES);
+    for (int i = 0; i < BOID_PYRAMID_VERTEX_COUNT; ++i)
+    {
+        glNormal3fv(vertices[i].normal);
+        glVertex3fv(vertices[i].position);
+    }
+    glEnd();
+}
+
+/**
+ * @brief Draws every boid with its own transform and pyramid submission.
+ *
+ * The display list path compiles the pyramid once and replays it.
+ *
+ * @param list The draw list holding the boid transforms.
+ */
+static void draw_boids_individually(const draw_list* list)
+{
+    if (mesh_render_path == RENDER_PATH_DISPLAY_LIST && display_list_boid == 0)
+    {
+        display_list_boid = glGenLists(1);
+        glNewList(display_list_boid, GL_COMPILE);
+            submit_boid_pyramid(list->boid_pyramid);
+        glEndList();
+    }
+
+    for (int i = 0; i < list->boid_count; ++i)
+    {
+        const instance_transform* instance = &list->boids[i];
+        const GLfloat matrix[16] = {
+            instance->right[0],    instance->right[1],    instance->right[2],    0.0f,
+            instance->up[0],       instance->up[1],       instance->up[2],       0.0f,
+            instance->forward[0],  instance->forward[1],  instance->forward[2],  0.0f,
+            instance->position[0], instance->position[1], instance->position[2], 1.0f
+        };
+
+        glPushMatrix();
+            glMultMatrixf(matrix);
+            if (mesh_render_path == RENDER_PATH_DISPLAY_LIST)
+            {
+                glCallList(display_list_boid);
+            }
+            else
+            {
+                submit_boid_pyramid(list->boid_pyramid);
+            }
+        glPopMatrix();
+    }
+    count_draw_calls(list->boid_count);
+}
+
+/**
+ * @brief Draws all visible boids, in one instanced draw on the instanced path.
+ *
+ * @param list The draw list holding the boid transforms.
+ */
+static void draw_boids(const draw_list* list)
+{
+    if (mesh_render_path != RENDER_PATH_INSTANCED)
+    {
+        draw_boids_individually(list);
+        return;
+    }
+
+    if (boid_shape.vertex_buffer == 0)
+    {
+        instancing_create_shape(&boid_shape, list->boid_pyramid, BOID_PYRAMID_VERTEX_COUNT);
+    }
+    instancing_draw(&boid_shape, list->boids, list->boid_count, list->fog_enabled);
+    count_draw_calls(1);
+}
+
+/**
+ * @brief Draws the impostor quads of all distant boids with one draw call.
+ *
+ * The quads are submitted from client memory on every path, they
+ * change every frame and are few. The alpha test cuts out the pyramid
+ * outline baked into the atlas.
+ *
+ * @param list The draw list holding the impostor vertices.
+ */
+static void draw_impostors(const draw_list* list)
+{
+    const char* vertices = (const char*)list->impostor_vertices;
+
+    gl_state_enable(GL_ALPHA_TEST, 1);
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_NORMAL_ARRAY);
+    glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+    glVertexPointer(3, GL_FLOAT, sizeof(impostor_vertex), vertices + offsetof(impostor_vertex, position));
+    glNormalPointer(GL_FLOAT, sizeof(impostor_vertex), vertices + offsetof(impostor_vertex, normal));
+    glTexCoordPointer(2, GL_FLOAT, sizeof(impostor_vertex), vertices + offsetof(impostor_vertex, texcoord));
+
+    glDrawArrays(GL_TRIANGLES, 0, list->impostor_vertex_count);
+    count_draw_calls(1);
+
+    glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+    glDisableClientState(GL_NORMAL_ARRAY);
+    glDisableClientState(GL_VERTEX_ARRAY);
+    gl_state_enable(GL_ALPHA_TEST, 0);
+}
+
+/**
+ * @brief Draws a range of the debug vertices as unlit lines with one draw call.
+ *
+ * @param list The draw list holding the debug lines.
+ * @param item The debug item.
+ */
+static void draw_debug_lines(const draw_list* list, const draw_item* item)
+{
+    const char* vertices = (const char*)&list->debug->vertices[item->first];
+
+    gl_state_enable(GL_LIGHTING, 0);
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_COLOR_ARRAY);
+    glVertexPointer(3, GL_FLOAT, sizeof(debug_vertex), vertices + offsetof(debug_vertex, position));
+    glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(debug_vertex), vertices + offsetof(debug_vertex, color));
+
+    glDrawArrays(GL_LINES, 0, item->count);
+    count_draw_calls(1);
+
+    glDisableClientState(GL_COLOR_ARRAY);
+    glDisableClientState(GL_VERTEX_ARRAY);
+    gl_state_enable(GL_LIGHTING, 1);
+}
+
+/**
+ * @brief Draws an environment surface with one draw call.
+ *
+ * The display list path compiles the surface into its display list
+ * once and replays it, the buffer object paths draw from its buffers.
+ *
+ * @param surface The tessellated surface.
+ */
+static void draw_surface(environment_surface* surface)
+{
+    if (mesh_render_path == RENDER_PATH_DISPLAY_LIST)
+    {
+        if (surface->display_list == 0)
+        {
+            surface->display_list = glGenLists(1);
+            glNewList(surface->display_list, GL_COMPILE);
+                environment_draw_surface(surface, 0);
+            glEndList();
+        }
+        glCallList(surface->display_list);
+    }
+    else
+    {
+        environment_draw_surface(surface, mesh_render_path >= RENDER_PATH_VBO);
+    }
+    count_draw_calls(1);
+}
+
+/**
+ * @brief Draws one item of the draw list.
+ *
+ * @param list The draw list.
+ * @param item The item to draw.
+ */
+static void draw_item_fixed(const draw_list* list, const draw_item* item)
+{
+    gl_trace_set_pass(item->pass);
+    gl_state_bind_texture(item->texture_id);
+    gl_state_set_material(&item->material);
+    gl_state_line_width(item->line_width);
+
+    switch (item->type)
+    {
+    case DRAW_ITEM_MESH:
+        glPushMatrix();
+            glMultMatrixf(item->model);
+            draw_mesh(item->mesh);
+        glPopMatrix();
+        break;
+
+    case DRAW_ITEM_SURFACE:
+        glPushMatrix();
+            glMultMatrixf(item->model);
+            draw_surface(item->surface);
+        glPopMatrix();
+        break;
+
+    case DRAW_ITEM_WATER:
+        glPushMatrix();
+            glMultMatrixf(item->model);
+            draw_water(list->snapshot);
+        glPopMatrix();
+        break;
+
+    case DRAW_ITEM_BOIDS:
+        draw_boids(list);
+        break;
+
+    case DRAW_ITEM_IMPOSTORS:
+        draw_impostors(list);
+        break;
+
+    case DRAW_ITEM_DEBUG:
+        draw_debug_lines(list, item);
+        break;
+    }
+}
+
+/**
+ * @brief Loads the camera into the matrix stack and draws the draw list.
+ *
+ * The light position is set while the view matrix is current,
+ * so OpenGL keeps it fixed in world space.
+ *
+ * @param list The draw list of the frame.
+ */
+static void fixed_submit(const draw_list* list)
+{
+    // Clear color and depth buffers to prepare for new frame rendering.
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    glMatrixMode(GL_PROJECTION);
+    glLoadMatrixf(list->projection);
+    glMatrixMode(GL_MODELVIEW);
+    glLoadMatrixf(list->view);
+
+    const GLfloat light_position[4] = LIGHT_POSITION;
+    glLightfv(GL_LIGHT0, GL_POSITION, light_position);
+
+    gl_state_enable(GL_FOG, list->fog_enabled);
+    if (applied_fog_density != list->fog_density)
+    {
+        glFogf(GL_FOG_DENSITY, list->fog_density);
+        applied_fog_density = list->fog_density;
+    }
+
+    for (int i = 0; i < list->item_count; ++i)
+    {
+        draw_item_fixed(list, &list->items[i]);
+    }
+    gl_trace_set_pass(RENDER_PASS_OTHER);
+}
+
+/**
+ * @brief Swaps the buffers of the GLUT window.
+ */
+static void fixed_present(void)
+{
+    glutSwapBuffers();
+}
+
+/**
+ * @brief Frees the buffers, shapes and display lists of the backend.
+ */
+static void fixed_clean_up(void)
+{
+    instancing_destroy_shape(&boid_shape);
+    instancing_cleanup();
+
+    stream_buffer_destroy(&water_vertex_stream);
+    if (water_index_buffer != 0)
+    {
+        glDeleteBuffers(1, &water_index_buffer);
+        water_index_buffer = 0;
+    }
+
+    if (display_list_boid != 0)
+    {
+        glDeleteLists(display_list_boid, 1);
+        display_list_boid = 0;
+    }
+}
+
+
+const render_backend render_backend_fixed = {
+    "fixed",
+    fixed_initialize,
+    fixed_upload_mesh,
+    fixed_submit,
+    fixed_present,
+    fixed_clean_up
+};
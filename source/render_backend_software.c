@@ -0,0 +1,607 @@
+/**
+ * @file render_backend_software.c
+ * @brief Implements the software backend drawing the draw list on the CPU.
+ *
+ * Vertices are transformed and lit on the render thread with the same
+ * GL_LIGHT0 lighting as the vertex shader of the core backend, then
+ * clipped, binned into tiles and rasterized by software_raster on a pool
+ * of threads. The finished frame is copied into the framebuffer with
+ * glDrawPixels, so it shows on any compatibility context. Textures are
+ * sampled from the CPU copy of their full mip chain, whichever levels
+ * are resident. Point lights and wireframes are not drawn.
+ */
+
+
+#include "render_backend.h"
+
+#include "frame_stats.h"
+#include "gl_trace.h"
+#include "lighting.h"
+#include "options.h"
+#include "renderer.h"
+#include "software_raster.h"
+#include "texture.h"
+#include "timer.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+#define MAX_SHININESS 128.0f  // largest specular exponent the other backends accept
+
+
+/**
+ * @brief Transform and lighting terms shared by the vertices of a draw.
+ */
+typedef struct {
+    GLfloat model_view[16];  // column-major view * model matrix
+    color   base;            // emission plus the ambient light reflected by the material
+    color   diffuse;         // diffuse light reflected by the material at full intensity
+    color   specular;        // specular light reflected by the material at full intensity
+} vertex_lighting;
+
+
+static GLushort       water_indices[WATER_INDEX_COUNT];    // triangle strip over the water grid
+static mesh_vertex    water_grid[WATER_VERTEX_COUNT];      // water grid of the frame
+static raster_texture item_textures[DRAW_LIST_CAPACITY];   // texels of the items of the frame, sampled until it is drawn
+static raster_vertex* transformed          = NULL;         // scratch space of the indexed vertices being drawn
+static int            transformed_capacity = 0;            // vertices transformed can hold
+
+static GLfloat projection[16];      // column-major projection matrix of the frame
+static GLfloat view[16];            // column-major view matrix of the frame
+static GLfloat light_direction[3];  // eye-space direction towards GL_LIGHT0
+static GLfloat half_vector[3];      // halfway between the light and the infinite viewer
+static GLfloat shininess = 0.0f;    // current specular exponent, kept over out of range materials
+
+
+/**
+ * @brief Normalizes a vector, leaving zero vectors unchanged.
+ *
+ * @param vector The vector.
+ */
+static void normalize_vector(GLfloat vector[3])
+{
+    const GLfloat length = sqrtf(vector[0] * vector[0] + vector[1] * vector[1] + vector[2] * vector[2]);
+    if (length > 0.0f)
+    {
+        vector[0] /= length;
+        vector[1] /= length;
+        vector[2] /= length;
+    }
+}
+
+/**
+ * @brief Makes sure the scratch space holds enough vertices.
+ *
+ * @param count Number of vertices.
+ * @return int Returns 1 if the space is available, 0 otherwise.
+ */
+static int reserve_transformed(int count)
+{
+    if (count <= transformed_capacity)
+    {
+        return 1;
+    }
+
+    raster_vertex* grown = (raster_vertex*)realloc(transformed, (size_t)count * sizeof(raster_vertex));
+    if (grown == NULL)
+    {
+        return 0;
+    }
+    transformed          = grown;
+    transformed_capacity = count;
+    return 1;
+}
+
+/**
+ * @brief Sets up the transform and lighting terms of a draw.
+ *
+ * Like the other backends, exponents beyond the range OpenGL accepts
+ * for glMaterial keep the current one.
+ *
+ * @param model    Column-major model matrix.
+ * @param material Material of the draw.
+ * @param lighting Output terms.
+ */
+static void prepare_lighting(const GLfloat model[16], const gl_material* material, vertex_lighting* lighting)
+{
+    const color light_ambient  = LIGHT_AMBIENT;
+    const color light_diffuse  = LIGHT_DIFFUSE;
+    const color light_specular = LIGHT_SPECULAR;
+    const color scene_ambient  = LIGHT_AMBIENT_GLOBAL;
+
+    geometry_multiply_matrices(view, model, lighting->model_view);
+    for (int c = 0; c < 4; ++c)
+    {
+        lighting->base[c]     = material->emission[c] + (scene_ambient[c] + light_ambient[c]) * material->ambient[c];
+        lighting->diffuse[c]  = light_diffuse[c] * material->diffuse[c];
+        lighting->specular[c] = light_specular[c] * material->specular[c];
+    }
+    // The lit alpha is the material's diffuse alpha.
+    lighting->base[3]     = material->diffuse[3];
+    lighting->diffuse[3]  = 0.0f;
+    lighting->specular[3] = 0.0f;
+
+    if (material->shininess >= 0.0f && material->shininess <= MAX_SHININESS)
+    {
+        shininess = material->shininess;
+    }
+}
+
+/**
+ * @brief Transforms a vertex into clip space and lights it.
+ *
+ * @param lighting Transform and lighting terms of the draw.
+ * @param position Model-space position.
+ * @param normal   Model-space normal.
+ * @param texcoord Texture coordinates, NULL for none.
+ * @param vertex   Output vertex.
+ */
+static void light_vertex(
+    const vertex_lighting* lighting,
+    const GLfloat          position[3],
+    const GLfloat          normal[3],
+    const GLfloat*         texcoord,
+          raster_vertex*   vertex
+)
+{
+    const GLfloat* m = lighting->model_view;
+
+    GLfloat eye[4];
+    GLfloat eye_normal[3];
+    for (int row = 0; row < 4; ++row)
+    {
+        eye[row] = m[row] * position[0] + m[4 + row] * position[1] + m[8 + row] * position[2] + m[12 + row];
+    }
+    for (int row = 0; row < 3; ++row)
+    {
+        eye_normal[row] = m[row] * normal[0] + m[4 + row] * normal[1] + m[8 + row] * normal[2];
+    }
+    normalize_vector(eye_normal);
+
+    GLfloat diffuse = eye_normal[0] * light_direction[0] +
+                      eye_normal[1] * light_direction[1] +
+                      eye_normal[2] * light_direction[2];
+    diffuse = diffuse > 0.0f ? diffuse : 0.0f;
+
+    GLfloat specular = 0.0f;
+    if (diffuse > 0.0f)
+    {
+        const GLfloat facing = eye_normal[0] * half_vector[0] +
+                               eye_normal[1] * half_vector[1] +
+                               eye_normal[2] * half_vector[2];
+        specular = powf(facing > 0.0f ? facing : 0.0f, shininess);
+    }
+
+    for (int c = 0; c < 4; ++c)
+    {
+        const GLfloat value = lighting->base[c] + lighting->diffuse[c] * diffuse + lighting->specular[c] * specular;
+        vertex->color[c] = value < 0.0f ? 0.0f : (value > 1.0f ? 1.0f : value);
+    }
+
+    for (int row = 0; row < 4; ++row)
+    {
+        vertex->position[row] = projection[row]      * eye[0] + projection[4 + row]  * eye[1] +
+                                projection[8 + row]  * eye[2] + projection[12 + row] * eye[3];
+    }
+    vertex->texcoord[0] = texcoord != NULL ? texcoord[0] : 0.0f;
+    vertex->texcoord[1] = texcoord != NULL ? texcoord[1] : 0.0f;
+    vertex->fog         = fabsf(eye[2]);
+}
+
+/**
+ * @brief Points the rasterizer texture of an item at the CPU texels of its texture.
+ *
+ * @param item    The item.
+ * @param texture Output texture.
+ * @return const raster_texture* The texture, NULL if the item is untextured or the texels are unknown.
+ */
+static const raster_texture* find_item_texture(const draw_item* item, raster_texture* texture)
+{
+    if (item->texture_id == 0)
+    {
+        return NULL;
+    }
+
+    if (item->type == DRAW_ITEM_IMPOSTORS)
+    {
+        texture->levels[0]   = impostor_get_atlas_texels(&texture->widths[0], &texture->heights[0]);
+        texture->level_count = 1;
+        texture->channels    = 4;
+        return texture;
+    }
+
+    texture->level_count = 0;
+    texture->channels    = 3;
+    while (texture->level_count < TEXTURE_MAX_MIP_LEVELS)
+    {
+        GLint width  = 0;
+        GLint height = 0;
+        const GLubyte* texels = texture_get_level(item->texture_id, texture->level_count, &width, &height);
+        if (texels == NULL)
+        {
+            break;
+        }
+        texture->levels[texture->level_count]  = texels;
+        texture->widths[texture->level_count]  = width;
+        texture->heights[texture->level_count] = height;
+        ++texture->level_count;
+    }
+    return texture->level_count > 0 ? texture : NULL;
+}
+
+/**
+ * @brief Lights the corners of every face of a mesh and adds the triangles.
+ *
+ * @param item  The mesh item.
+ * @param state Texture and cutout of the item.
+ */
+static void draw_mesh(const draw_item* item, const raster_state* state)
+{
+    const mesh* mesh = item->mesh;
+
+    vertex_lighting lighting;
+    prepare_lighting(item->model, &item->material, &lighting);
+
+    for (int i = 0; i < mesh->face_count; ++i)
+    {
+        const mesh_face* face = &mesh->faces[i];
+
+        raster_vertex corners[3];
+        for (int j = 0; j < 3; ++j)
+        {
+            // 1-based, as in the OBJ file.
+            light_vertex(
+                &lighting,
+                mesh->vertices[face->vertex_numbers[j] - 1],
+                mesh->normals[face->normal_numbers[j] - 1],
+                NULL,
+                &corners[j]
+            );
+        }
+        software_raster_triangle(&corners[0], &corners[1], &corners[2], state);
+    }
+}
+
+/**
+ * @brief Lights the vertices of an environment surface once and adds its triangles.
+ *
+ * @param item  The surface item.
+ * @param state Texture and cutout of the item.
+ */
+static void draw_surface(const draw_item* item, const raster_state* state)
+{
+    const environment_surface* surface = item->surface;
+    if (surface->vertices == NULL || !reserve_transformed(surface->vertex_count))
+    {
+        return;
+    }
+
+    vertex_lighting lighting;
+    prepare_lighting(item->model, &item->material, &lighting);
+
+    for (int i = 0; i < surface->vertex_count; ++i)
+    {
+        const environment_vertex* vertex = &surface->vertices[i];
+        light_vertex(&lighting, vertex->position, vertex->normal, vertex->texcoord, &transformed[i]);
+    }
+    for (int i = 0; i + 2 < surface->index_count; i += 3)
+    {
+        software_raster_triangle(
+            &transformed[surface->indices[i]],
+            &transformed[surface->indices[i + 1]],
+            &transformed[surface->indices[i + 2]],
+            state
+        );
+    }
+}
+
+/**
+ * @brief Lights the water grid of the snapshot and adds the triangles of its strip.
+ *
+ * @param list  The draw list holding the snapshot.
+ * @param item  The water item.
+ * @param state Texture and cutout of the item.
+ */
+static void draw_water(const draw_list* list, const draw_item* item, const raster_state* state)
+{
+    if (!reserve_transformed(WATER_VERTEX_COUNT))
+    {
+        return;
+    }
+
+    render_backend_copy_water_vertices(list->snapshot, water_grid);
+
+    vertex_lighting lighting;
+    prepare_lighting(item->model, &item->material, &lighting);
+
+    for (int i = 0; i < WATER_VERTEX_COUNT; ++i)
+    {
+        light_vertex(&lighting, water_grid[i].position, water_grid[i].normal, NULL, &transformed[i]);
+    }
+
+    // Both windings are drawn, so the alternating order of the strip does not matter.
+    for (int i = 2; i < WATER_INDEX_COUNT; ++i)
+    {
+        const GLushort a = water_indices[i - 2];
+        const GLushort b = water_indices[i - 1];
+        const GLushort c = water_indices[i];
+        if (a == b || b == c || a == c)
+        {
+            continue;
+        }
+        software_raster_triangle(&transformed[a], &transformed[b], &transformed[c], state);
+    }
+}
+
+/**
+ * @brief Lights the pyramid of every boid in its own basis and adds the triangles.
+ *
+ * @param list  The draw list holding the boid transforms.
+ * @param item  The boids item.
+ * @param state Texture and cutout of the item.
+ */
+static void draw_boids(const draw_list* list, const draw_item* item, const raster_state* state)
+{
+    for (int i = 0; i < list->boid_count; ++i)
+    {
+        const instance_transform* boid = &list->boids[i];
+        const GLfloat model[16] = {
+            boid->right[0],    boid->right[1],    boid->right[2],    0.0f,
+            boid->up[0],       boid->up[1],       boid->up[2],       0.0f,
+            boid->forward[0],  boid->forward[1],  boid->forward[2],  0.0f,
+            boid->position[0], boid->position[1], boid->position[2], 1.0f
+        };
+
+        vertex_lighting lighting;
+        prepare_lighting(model, &item->material, &lighting);
+
+        for (int j = 0; j + 2 < BOID_PYRAMID_VERTEX_COUNT; j += 3)
+        {
+            raster_vertex corners[3];
+            for (int k = 0; k < 3; ++k)
+            {
+                const mesh_vertex* vertex = &list->boid_pyramid[j + k];
+                light_vertex(&lighting, vertex->position, vertex->normal, NULL, &corners[k]);
+            }
+            software_raster_triangle(&corners[0], &corners[1], &corners[2], state);
+        }
+    }
+}
+
+/**
+ * @brief Lights the impostor quads and adds their triangles.
+ *
+ * @param list  The draw list holding the impostor vertices.
+ * @param item  The impostors item.
+ * @param state Texture and cutout of the item.
+ */
+static void draw_impostors(const draw_list* list, const draw_item* item, const raster_state* state)
+{
+    if (!reserve_transformed(list->impostor_vertex_count))
+    {
+        return;
+    }
+
+    vertex_lighting lighting;
+    prepare_lighting(item->model, &item->material, &lighting);
+
+    for (int i = 0; i < list->impostor_vertex_count; ++i)
+    {
+        const impostor_vertex* vertex = &list->impostor_vertices[i];
+        light_vertex(&lighting, vertex->position, vertex->normal, vertex->texcoord, &transformed[i]);
+    }
+    for (int i = 0; i + 2 < list->impostor_vertex_count; i += 3)
+    {
+        software_raster_triangle(&transformed[i], &transformed[i + 1], &transformed[i + 2], state);
+    }
+}
+
+/**
+ * @brief Adds one weight of the debug lines, unlit in their vertex colors.
+ *
+ * @param list The draw list holding the debug lines.
+ * @param item The debug item.
+ */
+static void draw_debug_lines(const draw_list* list, const draw_item* item)
+{
+    vertex_lighting lighting;
+    prepare_lighting(item->model, &item->material, &lighting);
+
+    const GLfloat no_normal[3] = { 0.0f, 0.0f, 0.0f };
+    for (int i = 0; i + 1 < item->count; i += 2)
+    {
+        raster_vertex ends[2];
+        for (int j = 0; j < 2; ++j)
+        {
+            const debug_vertex* vertex = &list->debug->vertices[item->first + i + j];
+            light_vertex(&lighting, vertex->position, no_normal, NULL, &ends[j]);
+            for (int c = 0; c < 4; ++c)
+            {
+                ends[j].color[c] = (GLfloat)vertex->color[c] / 255.0f;
+            }
+        }
+        software_raster_line(&ends[0], &ends[1], item->line_width);
+    }
+}
+
+/**
+ * @brief Adds the triangles of one item of the draw list.
+ *
+ * @param list  The draw list.
+ * @param index Index of the item.
+ */
+static void draw_item_software(const draw_list* list, int index)
+{
+    const draw_item* item = &list->items[index];
+
+    raster_state state;
+    state.texture = find_item_texture(item, &item_textures[index]);
+    state.cutout  = item->type == DRAW_ITEM_IMPOSTORS ? IMPOSTOR_ALPHA_CUTOFF : -1.0f;
+
+    switch (item->type)
+    {
+    case DRAW_ITEM_MESH:
+        draw_mesh(item, &state);
+        break;
+
+    case DRAW_ITEM_SURFACE:
+        draw_surface(item, &state);
+        break;
+
+    case DRAW_ITEM_WATER:
+        draw_water(list, item, &state);
+        break;
+
+    case DRAW_ITEM_BOIDS:
+        draw_boids(list, item, &state);
+        break;
+
+    case DRAW_ITEM_IMPOSTORS:
+        draw_impostors(list, item, &state);
+        break;
+
+    case DRAW_ITEM_DEBUG:
+        draw_debug_lines(list, item);
+        break;
+    }
+}
+
+/**
+ * @brief Copies the drawn frame into the bottom left of the viewport.
+ *
+ * @param pixels RGBA pixels from the bottom row.
+ * @param width  Width of the frame in pixels.
+ * @param height Height of the frame in pixels.
+ */
+static void show_frame(const GLubyte* pixels, int width, int height)
+{
+    // Pixels are written as they are, without depth test, blending or fog.
+    gl_state_enable(GL_DEPTH_TEST, 0);
+    gl_state_enable(GL_BLEND, 0);
+    gl_state_enable(GL_TEXTURE_2D, 0);
+    gl_state_enable(GL_FOG, 0);
+
+    glMatrixMode(GL_PROJECTION);
+    glLoadIdentity();
+    glMatrixMode(GL_MODELVIEW);
+    glLoadIdentity();
+    glRasterPos2f(-1.0f, -1.0f);
+
+    glDrawPixels(width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+    current_frame_stats.draw_calls += 1;
+}
+
+/**
+ * @brief Builds the water strip and starts the rasterizer threads.
+ *
+ * @return int Always 1, every compatibility context can show the frames.
+ */
+static int software_initialize(void)
+{
+    render_backend_list_water_strip(water_indices);
+    (void)software_raster_initialize(main_options.raster_threads);
+    return 1;
+}
+
+/**
+ * @brief Keeps meshes on the CPU, they are drawn from their faces.
+ *
+ * @param mesh The loaded mesh.
+ */
+static void software_upload_mesh(mesh* mesh)
+{
+    (void)mesh;
+}
+
+/**
+ * @brief Rasterizes the draw list and copies the frame into the framebuffer.
+ *
+ * The frame is drawn at the size of the viewport, which dynamic
+ * resolution may have scaled down.
+ *
+ * @param list The draw list of the frame.
+ */
+static void software_submit(const draw_list* list)
+{
+    const double start_ms = timer_now_ms();
+
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+
+    const color fog_color = FOG_COLOR;
+    if (!software_raster_begin_frame(
+            viewport[2],
+            viewport[3],
+            list->fog_enabled ? list->fog_density : 0.0f,
+            fog_color
+        ))
+    {
+        return;
+    }
+
+    memcpy(projection, list->projection, sizeof(projection));
+    memcpy(view,       list->view,       sizeof(view));
+
+    const GLfloat light_position[4] = LIGHT_POSITION;
+    for (int row = 0; row < 3; ++row)
+    {
+        light_direction[row] = 0.0f;
+        for (int column = 0; column < 4; ++column)
+        {
+            light_direction[row] += view[column * 4 + row] * light_position[column];
+        }
+    }
+    normalize_vector(light_direction);
+    half_vector[0] = light_direction[0];
+    half_vector[1] = light_direction[1];
+    half_vector[2] = light_direction[2] + 1.0f;
+    normalize_vector(half_vector);
+
+    for (int i = 0; i < list->item_count; ++i)
+    {
+        gl_trace_set_pass(list->items[i].pass);
+        draw_item_software(list, i);
+    }
+    gl_trace_set_pass(RENDER_PASS_OTHER);
+
+    raster_stats stats;
+    software_raster_end_frame(&stats);
+    show_frame(software_raster_pixels(), viewport[2], viewport[3]);
+
+    current_frame_stats.raster_triangles = stats.triangles;
+    current_frame_stats.raster_fragments = stats.fragments;
+    current_frame_stats.raster_threads   = stats.threads;
+    current_frame_stats.raster_time_ms   = timer_now_ms() - start_ms;
+}
+
+/**
+ * @brief Swaps the buffers of the GLUT window.
+ */
+static void software_present(void)
+{
+    glutSwapBuffers();
+}
+
+/**
+ * @brief Stops the rasterizer threads and frees the scratch space.
+ */
+static void software_clean_up(void)
+{
+    software_raster_clean_up();
+
+    free(transformed);
+    transformed          = NULL;
+    transformed_capacity = 0;
+}
+
+
+const render_backend render_backend_software = {
+    "software",
+    software_initialize,
+    software_upload_mesh,
+    software_submit,
+    software_present,
+    software_clean_up
+};
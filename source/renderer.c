@@ -1,6 +1,15 @@
 /**
  * @file renderer.c
  * @brief Implementation of rendering logic, scene setup, and object drawing.
+ *
+ * The renderer is the frontend of the render backends. It culls the
+ * scene, selects levels of detail and requests texture detail, then
+ * records the frame into a draw list sorted by draw keys, which the
+ * backend selected at startup submits to OpenGL. The scene objects and
+ * boids are recorded in partitions by a pool of threads, only the
+ * backend on the render thread makes OpenGL calls. Boids beyond the
+ * impostor distance are recorded as camera-facing quads textured from
+ * an atlas of the pyramid and drawn together in one batch.
  */
 
 
@@ -9,64 +18,237 @@
 #include "boids/boids.h"
 #include "camera.h"
 #include "coral.h"
+#include "debug_draw.h"
+#include "dynamic_resolution.h"
 #include "environment.h"
+#include "frame_stats.h"
+#include "frustum.h"
+#include "gl_extensions.h"
+#include "gl_state.h"
+#include "gl_trace.h"
+#include "impostor.h"
+#include "instancing.h"
 #include "GL/freeglut.h"
+#include "light_clusters.h"
 #include "window.h"
-#include "lighting.h"
+#include "occlusion.h"
+#include "options.h"
+#include "render_backend.h"
 #include "submarine.h"
+#include "texture.h"
+#include "timer.h"
+#include "worker_pool.h"
 #include "water.h"
 
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+#define ORIGIN_SIZE        1.0f  // length of the origin axis lines
+#define ORIGIN_SPHERE_SIZE 0.1f  // radius of the sphere marking the origin
+#define LINE_WIDTH         1.0f  // width of all other lines, including wireframes
+
+#define COLOR_ZERO { 0.0f, 0.0f, 0.0f, 0.0f }  // material color that contributes nothing
+
+#define FOG_INVISIBLE_FACTOR (1.0f / 510.0f)  // fog factor below which every color rounds to the fog color at 8 bits
+#define FOG_LOD_FACTOR_STEP  0.25f            // each coarser level is used once the fog factor drops by another step
+
+#define CULL_INDEX_SUBMARINE 0                                 // bounds of the submarine
+#define CULL_INDEX_CORAL     (CULL_INDEX_SUBMARINE + 1)        // bounds of the first coral
+#define CULL_INDEX_BOIDS     (CULL_INDEX_CORAL + CORAL_COUNT)  // bounds of the first boid
+#define CULL_OBJECT_COUNT    (CULL_INDEX_BOIDS + BOID_COUNT)   // number of culled objects
+
+#define SCENE_OBJECT_COUNT (1 + CORAL_COUNT)  // submarine and coral
+
+#define OCCLUDER_MIN_SIZE      16.0f  // projected diameter in occlusion buffer pixels an object needs to hide others
+#define BOID_CLUSTER_CELL_SIZE  4.0f  // side of the grid cells grouping boids into clusters
+
+// Radius of the unscaled boid pyramid, which reaches from the apex to the base corners.
+#define BOID_PYRAMID_RADIUS sqrtf(2.0f * BOID_BASE * BOID_BASE + BOID_APEX * BOID_APEX)
+
+#define RECORD_MAX_PARTITIONS (WORKER_POOL_MAX_THREADS + 1)  // the render thread and every recording thread
+
+#define DEPTH_LAYER_DEBUG    0  // debug lines, first as in the state order
+#define DEPTH_LAYER_OPAQUE   1  // scene objects and boid pyramids, front to back
+#define DEPTH_LAYER_SURFACES 2  // water, floor and walls, mostly hidden by the opaque layer
+#define DEPTH_LAYER_BLENDED  3  // boid impostors, whose edges blend over the surfaces
+
+#define LAMP_COUNT          2                            // lamps at the front of the submarine
+#define LAMP_OFFSET         0.6f                         // distance of the lamps ahead of the submarine position
+#define LAMP_SPREAD         0.3f                         // distance of each lamp from the submarine axis
+#define LAMP_RADIUS         5.0f                         // range of a submarine lamp
+#define LAMP_COLOR          { 1.0f, 0.85f, 0.6f, 1.0f }  // warm light of the lamps
+#define BOID_GLOW_RADIUS    1.2f                         // range of the glow around a boid
+#define BOID_GLOW_COLOR     { 0.1f, 0.7f, 0.9f, 1.0f }   // blue glow of the boids
+#define PLANKTON_RADIUS     1.5f                         // range of the glow of a plankton swarm
+#define PLANKTON_TOP        4.0f                         // plankton float between the floor and this height
+#define PLANKTON_PULSE_RATE 0.03f                        // radians of the plankton pulse per simulation step
+#define PLANKTON_COLOR      { 0.2f, 0.9f, 0.4f, 1.0f }   // green glow of the plankton
+
+
+int                 fog_on           = 0;                      // starts as zero until fog is initialized.
+GLfloat             fog_density      = DEFAULT_FOG_DENSITY;    // density of the GL_EXP fog.
+int                 wire_frame_on    = 0;                      // starts as zero until wire_frame is turned on by user.
+render_path         mesh_render_path = RENDER_PATH_IMMEDIATE;  // starts immediate until buffer objects are loaded.
+int                 culling_on       = 1;                      // starts as one until culling is turned off by user.
+int                 occlusion_on     = 1;                      // starts as one until occlusion culling is turned off by user.
+render_backend_type renderer_backend = RENDER_BACKEND_FIXED;   // starts fixed until the chosen backend is initialized.
+
+static const render_backend* const backends[RENDER_BACKEND_COUNT] = {
+	&render_backend_fixed,
+	&render_backend_core,
+	&render_backend_software
+};
+
+/**
+ * @brief Bounding spheres of all culled objects, one array per coordinate.
+ */
+typedef struct {
+	GLfloat       center_x[CULL_OBJECT_COUNT];
+	GLfloat       center_y[CULL_OBJECT_COUNT];
+	GLfloat       center_z[CULL_OBJECT_COUNT];
+	GLfloat       radius[CULL_OBJECT_COUNT];
+	GLfloat       depth[CULL_OBJECT_COUNT];    // nearest view depth
+	unsigned char visible[CULL_OBJECT_COUNT];  // 1 if the object is drawn this frame
+	unsigned char lod[CULL_OBJECT_COUNT];      // level of detail the object is drawn with
+} cull_bounds;
+
+
+static cull_bounds scene_bounds;             // bounds and visibility of the current frame.
+static GLfloat     fog_cutoff_depth = 0.0f;  // view depth beyond which the fog hides everything.
+
+static const simulation_snapshot* frame_snapshot = NULL;  // simulation state drawn in the current frame.
+
+static GLfloat coral_models[CORAL_COUNT][16];  // model matrices of the coral, which never move.
+
+static draw_list   frame_list;                                       // draws of the current frame.
+static mesh_vertex boid_pyramid_vertices[BOID_PYRAMID_VERTEX_COUNT];  // triangle list shared by all boids.
+static GLuint      impostor_atlas = 0;                               // views of the boid pyramid, 0 until created.
+
+static point_light        scene_lights[LIGHT_CLUSTERS_MAX_LIGHTS];  // point lights of the scene in world space.
+static light_cluster_grid light_grid;                               // point lights of the current frame sorted into clusters.
+
+/**
+ * @brief Draws of the scene objects and boids recorded by one task.
+ *
+ * Every task records its share of the objects and boids into its own
+ * partition, so the tasks run in parallel without locking.
+ */
+typedef struct {
+	draw_item          items[SCENE_OBJECT_COUNT];          // scene object draws
+	int                item_count;                         // used entries of items
+	instance_transform boids[BOID_COUNT];                  // transforms of the visible boids drawn as pyramids
+	int                boid_count;                         // used entries of boids
+	impostor_vertex    impostors[IMPOSTOR_LIST_CAPACITY];  // quads of the visible boids beyond the impostor distance
+	int                impostor_vertex_count;              // used entries of impostors
+} record_partition;
+
+static worker_pool      record_pool;                                // threads recording partitions besides the render thread
+static record_partition record_partitions[RECORD_MAX_PARTITIONS];  // one partition per recording thread
+static int              record_partition_count = 1;                // partitions recorded per frame
+
+static gl_material scene_materials[SCENE_OBJECT_COUNT];     // distinct materials of the scene objects
+static int         scene_material_count = 0;                // used entries of scene_materials
+static int         scene_material_ids[SCENE_OBJECT_COUNT];  // index into scene_materials of each scene object
+
+// Submission layer of each render pass, the submarine and the coral are sorted together.
+static const unsigned char pass_layers[RENDER_PASS_COUNT] = {
+	0,  // debug
+	1,  // environment
+	2,  // water
+	3,  // submarine
+	3,  // coral
+	4,  // boids
+	5   // other
+};
+
+/**
+ * @brief A draw key with the index of the entry it orders.
+ */
+typedef struct {
+	draw_key key;    // sort key
+	int      index;  // entry the key belongs to
+} sort_entry;
+
+static draw_item sorted_items[DRAW_LIST_CAPACITY];  // draw items being reordered by sort_draw_items.
+
+/**
+ * @brief Triangle pyramid geometry shared by all boids.
+ */
+typedef struct {
+	point_3d  apex;               // tip of the pyramid, facing forward
+	point_3d  top_left;           // base corners
+	point_3d  top_right;
+	point_3d  bottom_left;
+	point_3d  bottom_right;
+	vector_3d normal_top;         // face normals
+	vector_3d normal_left;
+	vector_3d normal_bottom;
+	vector_3d normal_right;
+	vector_3d normal_base_left;
+	vector_3d normal_base_right;
+} boid_pyramid;
 
-int fog_on        = 0;  // starts as zero until fog is initialized.
-int wire_frame_on = 0;  // starts as zero until wire_frame is turned on by user.
+
+static void list_boid_pyramid(mesh_vertex vertices[BOID_PYRAMID_VERTEX_COUNT]);  // forward declaration.
+static void upload_scene_object(scene_object* object);                           // forward declaration.
+static void intern_scene_materials(void);                                        // forward declaration.
+static void place_plankton_lights(void);                                         // forward declaration.
 
 
 /**
- * @brief Initializes OpenGL state and all scene components.
+ * @brief Initializes the render backend, OpenGL state and all scene components.
+ *
+ * The backend chosen at startup falls back to the fixed-function
+ * backend if the context does not support it.
+ *
+ * @return int Returns 1 on success, 0 if no backend could be initialized.
  */
-void renderer_initialize(void)
+int renderer_initialize(void)
 {
+	// Load entry points newer than OpenGL 1.1.
+	gl_extensions_initialize();
+
+	renderer_backend = main_options.backend;
+	if (!backends[renderer_backend]->initialize())
+	{
+		if (renderer_backend == RENDER_BACKEND_FIXED)
+		{
+			printf("Render backend %s is not supported.\n\n", renderer_backend_name(renderer_backend));
+			return 0;
+		}
+
+		printf(
+			"Render backend %s is not supported, using %s.\n\n",
+			renderer_backend_name(renderer_backend),
+			renderer_backend_name(RENDER_BACKEND_FIXED)
+		);
+		renderer_backend = RENDER_BACKEND_FIXED;
+		if (!backends[renderer_backend]->initialize())
+		{
+			printf("Render backend %s is not supported either.\n\n", renderer_backend_name(renderer_backend));
+			return 0;
+		}
+	}
+
 	// Enable depth testing.
-	glEnable(GL_DEPTH_TEST);
-	// Enable texture mapping.
-	glEnable(GL_TEXTURE_2D);
-	// Enable texture mode.
-	glTexEnvf(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
-	// Enable the unit vector normals.
-	glEnable(GL_NORMALIZE);
+	gl_state_enable(GL_DEPTH_TEST, 1);
 	// Enable alpha blending.
-    glEnable(GL_BLEND);
+	gl_state_enable(GL_BLEND, 1);
 	// Use alpha blending.
 	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-	// Enable smooth lighting.
-	glShadeModel(GL_SMOOTH);
 
 	// Initialize fog for underwater appearance.
-	glEnable(GL_FOG);
-	fog_on = 1;
-	const GLfloat fog_color[] = { 0.0f, 0.0f, 1.0f, 1.0f };
-	glFogfv(GL_FOG_COLOR, fog_color);
-	glFogf(GL_FOG_MODE, GL_EXP);
-	glFogf(GL_FOG_DENSITY, 0.1f);
-
-	// Change into projection mode so that we can change the camera properties.
-	glMatrixMode(GL_PROJECTION);
+	renderer_set_fog(1, DEFAULT_FOG_DENSITY);
 
-	// Load the identity matrix into projection matrix.
-	glLoadIdentity();
-
-    const GLdouble aspect = 
-		(double)main_window.width / (double)main_window.height;
-
-	gluPerspective(
-		DEFAULT_CAMERA_FOV, 
-		aspect, 
-		DEFAULT_CAMERA_NEAR_PLANE, 
-		DEFAULT_CAMERA_FAR_PLANE
-    );
+	if (main_options.dynamic_resolution_ms > 0.0)
+	{
+		dynamic_resolution_enable(1, main_options.dynamic_resolution_ms);
+	}
 
-	// Change into model-view mode so that we can change the object positions
-	glMatrixMode(GL_MODELVIEW);
+	texture_set_memory_budget((size_t)(main_options.texture_budget_mb * 1024.0 * 1024.0));
 
 	environment_initialize();
 
@@ -76,375 +258,1543 @@ void renderer_initialize(void)
 	submarine_initialize();
 
 	coral_initialize();
+	for (int i = 0; i < CORAL_COUNT; ++i)
+	{
+		scene_object_calculate_matrix(
+			&objects_coral[i],
+			objects_coral[i].position,
+			objects_coral[i].direction,
+			coral_models[i]
+		);
+	}
 
 	boids_initialize();
+
+	// Hand the loaded meshes to the backend, so the first frame does not prepare them.
+	upload_scene_object(&object_submarine);
+	for (int i = 0; i < CORAL_COUNT; ++i)
+	{
+		upload_scene_object(&objects_coral[i]);
+	}
+
+	list_boid_pyramid(boid_pyramid_vertices);
+	impostor_atlas = impostor_create_atlas(
+		boid_pyramid_vertices, BOID_PYRAMID_VERTEX_COUNT, BOID_PYRAMID_RADIUS
+	);
+	intern_scene_materials();
+	place_plankton_lights();
+
+	// The render thread records a partition itself, the pool records the others.
+	record_partition_count = 1 + worker_pool_create(&record_pool, main_options.record_threads - 1);
+
+	return 1;
 }
 
 /**
- * @brief Draws 3D origin axis lines and a small sphere at the origin.
+ * @brief Prepares the mesh and all levels of detail of an object for the backend.
+ *
+ * @param object The loaded scene object.
  */
-void draw_origin(void)
+static void upload_scene_object(scene_object* object)
 {
-	const color diffuse_red   = { 1.0f, 0.0f, 0.0f, 1.0f };  // x-axis
-	const color diffuse_green = { 0.0f, 1.0f, 0.0f, 1.0f };  // y-axis
-	const color diffuse_blue  = { 0.0f, 0.0f, 1.0f, 1.0f };  // z-axis
-	const color diffuse_white = { 1.0f, 1.0f, 1.0f, 1.0f };  // centre-sphere quadric.
+	backends[renderer_backend]->upload_mesh(&object->mesh);
+	for (int i = 0; i < MESH_LOD_COUNT - 1; ++i)
+	{
+		if (object->lods[i].face_count > 0)
+		{
+			backends[renderer_backend]->upload_mesh(&object->lods[i]);
+		}
+	}
+}
 
-	const color emission_red   = { 1.0f, 0.0f, 0.0f, 0.5f };
-	const color emission_green = { 0.0f, 1.0f, 0.0f, 0.5f };
-	const color emission_blue  = { 0.0f, 0.0f, 1.0f, 0.5f };
-	const color emission_white = { 1.0f, 1.0f, 1.0f, 0.5f };
+/**
+ * @brief Calculates the view and projection matrices of the frame.
+ *
+ * The view is built from the snapshot camera, the projection from the
+ * camera field of view and the window aspect ratio.
+ *
+ * @param list The draw list receiving the matrices.
+ */
+static void calculate_camera_matrices(draw_list* list)
+{
+	const vector_3d up     = { 0.0f, 1.0f, 0.0f };
+	const GLdouble  aspect = 
+		(double)main_window.width / (double)(main_window.height > 0 ? main_window.height : 1);
 
-	const point_3d point_center = { 0.0f, 0.0f, 0.0f };
-	const GLfloat  origin_size  = 1.0f;
-
-	const GLfloat axis_width = 5.0f;
-	glLineWidth(axis_width);
-
-	glPushMatrix();
-	    glBegin(GL_LINES);  // x-axis - red.
-            glMaterialfv(GL_FRONT, GL_DIFFUSE, diffuse_red);
-			glMaterialfv(GL_FRONT, GL_EMISSION, emission_red);
-		    glVertex3fv(point_center);
-		    glVertex3f(origin_size, 0.0f, 0.0f);
-	    glEnd();
-		glBegin(GL_LINES);  // y-axis - green.
-		    glMaterialfv(GL_FRONT, GL_DIFFUSE, diffuse_green);
-			glMaterialfv(GL_FRONT, GL_EMISSION, emission_green);
-		    glVertex3fv(point_center);
-		    glVertex3f(0.0f, origin_size, 0.0f);
-		glEnd();
-		glBegin(GL_LINES);  // z-axis - blue.
-		    glMaterialfv(GL_FRONT, GL_DIFFUSE, diffuse_blue);
-			glMaterialfv(GL_FRONT, GL_EMISSION, emission_blue);
-		    glVertex3fv(point_center);
-			glVertex3f(0.0f, 0.0f, origin_size);
-		glEnd();
-        // Origin sphere.
-		glMaterialfv(GL_FRONT, GL_DIFFUSE, diffuse_white);
-		glMaterialfv(GL_FRONT, GL_EMISSION, emission_white);
-		gluSphere(quadric_origin_sphere, origin_size / 10, 20, 20);
-	glPopMatrix();
-
-	const color emission_zero = { 0.0f, 0.0f, 0.0f, 0.0f };
-	glMaterialfv(GL_FRONT, GL_EMISSION, emission_zero);
-	const GLfloat default_line_width = 1.0f;
-	glLineWidth(default_line_width);
-}
-
-/**
- * @brief Draws the floor and cylindrical wall environment.
- */
-void draw_environment(void)
-{
-	// Floor.
-	const color diffuse_disk      = { 0.9f, 0.6f, 0.3f, 1.0f };
-	const color emission_disk     = { 0.3f, 0.2f, 0.1f, 1.0f };
-	// Walls.
-	const color diffuse_cylinder  = { 0.5f, 0.5f, 0.5f, 1.0f };
-	const color emission_cylinder = { 1.0f, 1.0f, 1.0f, 1.0f };
-	// Default.
-	const color emission_zero     = { 0.0f, 0.0f, 0.0f, 0.0f };
-
-	glBindTexture(GL_TEXTURE_2D, texture_id_environment);
-
-	glPushMatrix();
-	    glTranslatef(0.0f, -1.0f, 0.0f);
-	    glRotatef(-90.0f, 1.0f, 0.0f, 0.0f);
-		// Floor - disk.
-	    glMaterialfv(GL_FRONT, GL_DIFFUSE, diffuse_disk);
-	    glMaterialfv(GL_FRONT, GL_EMISSION, emission_disk);
-	    gluDisk(quadric_environment, 0.0, ENVIRONMENT_RADIUS_XZ + 1, 20, 20);
-		// Walls - cylinder.
-		glTranslatef(0.0f, -1.0f, 0.0f);
-		glMaterialfv(GL_FRONT, GL_DIFFUSE, diffuse_cylinder);
-		glMaterialfv(GL_FRONT, GL_EMISSION, emission_cylinder);
-		gluCylinder(
-			quadric_environment, 
-			ENVIRONMENT_RADIUS_XZ, 
-			ENVIRONMENT_RADIUS_XZ, 
-			ENVIRONMENT_HEIGHT + 1, 
-			20, 
-			20
-		);
-	glPopMatrix();
+	geometry_calculate_look_at_matrix(
+		frame_snapshot->camera_position,
+		frame_snapshot->camera_look_at,
+		up,
+		list->view
+	);
+	geometry_calculate_perspective_matrix(
+		main_camera.fov,
+		aspect,
+		DEFAULT_CAMERA_NEAR_PLANE,
+		DEFAULT_CAMERA_FAR_PLANE,
+		list->projection
+	);
+}
+
+/**
+ * @brief Stores the world-space bounding sphere of a scene object.
+ *
+ * The sphere is centered on the object position and encloses the mesh
+ * sphere under any rotation, so the orientation does not have to be built.
+ *
+ * @param index    Index of the object in scene_bounds.
+ * @param object   The scene object.
+ * @param position Position the object is drawn at.
+ */
+static void set_scene_object_bounds(
+	int index, 
+	const scene_object* object, 
+	const point_3d position
+)
+{
+	const GLfloat* center = object->mesh.bounds_center;
+
+	scene_bounds.center_x[index] = position[0];
+	scene_bounds.center_y[index] = position[1];
+	scene_bounds.center_z[index] = position[2];
+	scene_bounds.radius[index]   = object->scale * (
+		sqrtf(center[0] * center[0] + center[1] * center[1] + center[2] * center[2]) +
+		object->mesh.bounds_radius
+	);
+}
+
+/**
+ * @brief Selects the level of detail of an object from its fog factor.
+ *
+ * @param depth Nearest view depth of the object.
+ * @return int Level of detail, 0 for the full mesh.
+ */
+static int select_fog_lod(GLfloat depth)
+{
+	if (!fog_on || depth <= 0.0f)
+	{
+		return 0;
+	}
+
+	const GLfloat fog_factor = expf(-fog_density * depth);
+
+	int     level     = 0;
+	GLfloat threshold = FOG_LOD_FACTOR_STEP;
+	while (level < MESH_LOD_COUNT - 1 && fog_factor < threshold)
+	{
+		++level;
+		threshold *= FOG_LOD_FACTOR_STEP;
+	}
+	return level;
+}
+
+/**
+ * @brief Returns the scene object at an index of the culled bounds.
+ *
+ * The submarine moves, so it is placed as recorded in the frame
+ * snapshot. The coral never move and are placed by their own state
+ * and the matrices calculated when the renderer was initialized.
+ *
+ * @param cull_index Index of the object, below CULL_INDEX_BOIDS.
+ * @param position   Output position the object is drawn at.
+ * @param model      Output column-major model matrix.
+ * @return scene_object* The scene object.
+ */
+static scene_object* get_scene_object(
+	int cull_index, 
+	const GLfloat** position, 
+	const GLfloat** model
+)
+{
+	if (cull_index == CULL_INDEX_SUBMARINE)
+	{
+		*position = frame_snapshot->submarine_position;
+		*model    = frame_snapshot->submarine_model;
+		return &object_submarine;
+	}
 
-	glMaterialfv(GL_FRONT, GL_EMISSION, emission_zero);  // reset emission.
-	glBindTexture(GL_TEXTURE_2D, 0);                     // unbind current texture to avoid re-use.
+	scene_object* coral = &objects_coral[cull_index - CULL_INDEX_CORAL];
+	*position = coral->position;
+	*model    = coral_models[cull_index - CULL_INDEX_CORAL];
+	return coral;
 }
 
 /**
- * @brief Draws a grid of water vertices at the water surface.
+ * @brief Culls scene objects and boid clusters hidden behind large occluders.
+ *
+ * Objects that passed the earlier tests and cover at least
+ * OCCLUDER_MIN_SIZE pixels of the occlusion buffer are rasterized with
+ * their coarsest level of detail. The bounding boxes of the scene objects
+ * and of the boids grouped by grid cell are then tested against the
+ * pyramid. Records the counts and the rasterization time in
+ * current_frame_stats.
+ *
+ * @param boid_radius Radius of the bounding sphere of one boid.
+ * @return int Number of objects and boids culled.
  */
-void draw_water(void)
+static int cull_occluded(GLfloat boid_radius)
 {
-	const point_3d water_position = { 0.0f, 10.0f, 0.0f };
+	const double start_ms = timer_now_ms();
+
+	// Pixels of the occlusion buffer covered by one world unit at unit depth.
+	const GLfloat pixels_per_unit = (GLfloat)OCCLUSION_HEIGHT / 
+		(2.0f * tanf(geometry_degree_to_radian((GLfloat)main_camera.fov) / 2.0f));
+
+	occlusion_begin(frame_list.projection, frame_list.view);
+
+	int occluder_count     = 0;
+	int occluder_triangles = 0;
+	for (int i = 0; i < CULL_INDEX_BOIDS; ++i)
+	{
+		if (!scene_bounds.visible[i])
+		{
+			continue;
+		}
+
+		const GLfloat depth = scene_bounds.depth[i];
+		if (depth > 0.0f &&
+			2.0f * scene_bounds.radius[i] * pixels_per_unit / depth < OCCLUDER_MIN_SIZE)
+		{
+			continue;
+		}
+
+		const GLfloat* position;
+		const GLfloat* model;
+		scene_object*  object   = get_scene_object(i, &position, &model);
+		const mesh*    occluder = &object->lods[MESH_LOD_COUNT - 2];  // coarsest level.
+		if (occluder->face_count == 0)
+		{
+			occluder = &object->mesh;
+		}
+
+		occluder_triangles += occlusion_rasterize_mesh(occluder, model);
+		++occluder_count;
+	}
+
+	occlusion_build_pyramid();
+	current_frame_stats.occlusion_raster_time_ms = timer_now_ms() - start_ms;
+	current_frame_stats.occluders_rasterized     = occluder_count;
+	current_frame_stats.occluder_triangles       = occluder_triangles;
 
-	glPushMatrix();
-	glTranslatef(water_position[0], water_position[1], water_position[2]);
-	for (int i = 0; i < WATER_GRID_SIZE; ++i)
+	int occluded_count = 0;
+	for (int i = 0; i < CULL_INDEX_BOIDS; ++i)
 	{
-		glBegin(GL_QUAD_STRIP);
-		for (int j = 0; j <= WATER_GRID_SIZE; ++j)
+		if (!scene_bounds.visible[i])
 		{
-			glVertex3fv(water_vertices[i][j]);
-			glVertex3fv(water_vertices[i + 1][j]);
+			continue;
+		}
+
+		const GLfloat  radius  = scene_bounds.radius[i];
+		const point_3d minimum = {
+			scene_bounds.center_x[i] - radius,
+			scene_bounds.center_y[i] - radius,
+			scene_bounds.center_z[i] - radius
+		};
+		const point_3d maximum = {
+			scene_bounds.center_x[i] + radius,
+			scene_bounds.center_y[i] + radius,
+			scene_bounds.center_z[i] + radius
+		};
+		if (!occlusion_test_box(minimum, maximum))
+		{
+			scene_bounds.visible[i] = 0;
+			++occluded_count;
+		}
+	}
+
+	// Boids are tested in clusters of the grid cells they fall into.
+	int      cluster_cells[BOID_COUNT][3];
+	point_3d cluster_minimum[BOID_COUNT];
+	point_3d cluster_maximum[BOID_COUNT];
+	int      boid_clusters[BOID_COUNT];
+	int      cluster_count = 0;
+	for (int i = 0; i < BOID_COUNT; ++i)
+	{
+		const int index = CULL_INDEX_BOIDS + i;
+		if (!scene_bounds.visible[index])
+		{
+			continue;
+		}
+
+		const GLfloat center[3] = {
+			scene_bounds.center_x[index],
+			scene_bounds.center_y[index],
+			scene_bounds.center_z[index]
+		};
+		int cell[3];
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			cell[axis] = (int)floorf(center[axis] / BOID_CLUSTER_CELL_SIZE);
+		}
+
+		int cluster = 0;
+		while (cluster < cluster_count && 
+			   memcmp(cluster_cells[cluster], cell, sizeof(cell)) != 0)
+		{
+			++cluster;
+		}
+		if (cluster == cluster_count)
+		{
+			memcpy(cluster_cells[cluster], cell, sizeof(cell));
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				cluster_minimum[cluster][axis] = center[axis];
+				cluster_maximum[cluster][axis] = center[axis];
+			}
+			++cluster_count;
+		}
+
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			cluster_minimum[cluster][axis] = fminf(cluster_minimum[cluster][axis], center[axis] - boid_radius);
+			cluster_maximum[cluster][axis] = fmaxf(cluster_maximum[cluster][axis], center[axis] + boid_radius);
+		}
+		boid_clusters[i] = cluster;
+	}
+
+	unsigned char cluster_visible[BOID_COUNT];
+	for (int cluster = 0; cluster < cluster_count; ++cluster)
+	{
+		cluster_visible[cluster] = 
+			(unsigned char)occlusion_test_box(cluster_minimum[cluster], cluster_maximum[cluster]);
+	}
+	for (int i = 0; i < BOID_COUNT; ++i)
+	{
+		const int index = CULL_INDEX_BOIDS + i;
+		if (scene_bounds.visible[index] && !cluster_visible[boid_clusters[i]])
+		{
+			scene_bounds.visible[index] = 0;
+			++occluded_count;
 		}
-		glEnd();
 	}
-	glPopMatrix();
+
+	current_frame_stats.objects_occluded = occluded_count;
+	return occluded_count;
 }
 
 /**
- * @brief Renders a mesh using its faces, vertices, and normals.
+ * @brief Culls the submarine, coral and boids and selects their detail.
  *
- * @param mesh The mesh object to draw.
+ * Objects are tested against the view frustum, then objects beyond the
+ * fog cutoff are culled as well, and the fog factor at the remaining
+ * objects selects their level of detail. Objects hidden behind large
+ * occluders are culled last. Must be called once the camera matrices
+ * of the frame are calculated. Records the counts and the test time in
+ * current_frame_stats.
  */
-void draw_mesh(const mesh mesh)
+static void cull_scene(void)
 {
-	for (int i = 0; i < mesh.face_count; ++i)
+	const double start_ms = timer_now_ms();
+
+	const GLfloat boid_radius = BOID_SCALE * BOID_PYRAMID_RADIUS;
+
+	for (int i = 0; i < CULL_INDEX_BOIDS; ++i)
+	{
+		const GLfloat* position;
+		const GLfloat* model;
+		const scene_object* object = get_scene_object(i, &position, &model);
+		set_scene_object_bounds(i, object, position);
+	}
+	for (int i = 0; i < BOID_COUNT; ++i)
+	{
+		scene_bounds.center_x[CULL_INDEX_BOIDS + i] = frame_snapshot->boids[i].position[0];
+		scene_bounds.center_y[CULL_INDEX_BOIDS + i] = frame_snapshot->boids[i].position[1];
+		scene_bounds.center_z[CULL_INDEX_BOIDS + i] = frame_snapshot->boids[i].position[2];
+		scene_bounds.radius[CULL_INDEX_BOIDS + i]   = boid_radius;
+	}
+
+	frustum view_frustum;
+	frustum_extract(&view_frustum, frame_list.projection, frame_list.view);
+
+	int visible_count = CULL_OBJECT_COUNT;
+	if (culling_on)
+	{
+		visible_count = frustum_test_spheres(
+			&view_frustum,
+			scene_bounds.center_x,
+			scene_bounds.center_y,
+			scene_bounds.center_z,
+			scene_bounds.radius,
+			CULL_OBJECT_COUNT,
+			scene_bounds.visible
+		);
+	}
+	else
+	{
+		memset(scene_bounds.visible, 1, sizeof(scene_bounds.visible));
+	}
+	const int frustum_culled_count = CULL_OBJECT_COUNT - visible_count;
+
+	frustum_nearest_depths(
+		&view_frustum,
+		frame_snapshot->camera_position,
+		scene_bounds.center_x,
+		scene_bounds.center_y,
+		scene_bounds.center_z,
+		scene_bounds.radius,
+		CULL_OBJECT_COUNT,
+		scene_bounds.depth
+	);
+
+	int fog_culled_count = 0;
+	int simplified_count = 0;
+	for (int i = 0; i < CULL_OBJECT_COUNT; ++i)
 	{
-		const mesh_face face = mesh.faces[i];
+		if (!scene_bounds.visible[i])
+		{
+			continue;
+		}
+
+		if (culling_on && fog_on && scene_bounds.depth[i] > fog_cutoff_depth)
+		{
+			scene_bounds.visible[i] = 0;
+			++fog_culled_count;
+			continue;
+		}
 
-		glBegin(GL_TRIANGLES);  // draw face of 3 normals, 3 vertices.
-		    glNormal3f(
-			    mesh.normals[face.normal_numbers[0] - 1][0],
-			    mesh.normals[face.normal_numbers[0] - 1][1],
-			    mesh.normals[face.normal_numbers[0] - 1][2]
-			);
-		    glVertex3f(
-			    mesh.vertices[face.vertex_numbers[0] - 1][0],
-			    mesh.vertices[face.vertex_numbers[0] - 1][1],
-			    mesh.vertices[face.vertex_numbers[0] - 1][2]
-			);
-		    glNormal3f(
-			    mesh.normals[face.normal_numbers[1] - 1][0],
-			    mesh.normals[face.normal_numbers[1] - 1][1],
-			    mesh.normals[face.normal_numbers[1] - 1][2]
-			);
-		    glVertex3f(
-			    mesh.vertices[face.vertex_numbers[1] - 1][0],
-			    mesh.vertices[face.vertex_numbers[1] - 1][1],
-			    mesh.vertices[face.vertex_numbers[1] - 1][2]
-			);
-		    glNormal3f(
-			    mesh.normals[face.normal_numbers[2] - 1][0],
-			    mesh.normals[face.normal_numbers[2] - 1][1],
-			    mesh.normals[face.normal_numbers[2] - 1][2]
-			);
-		    glVertex3f(
-			    mesh.vertices[face.vertex_numbers[2] - 1][0],
-			    mesh.vertices[face.vertex_numbers[2] - 1][1],
-			    mesh.vertices[face.vertex_numbers[2] - 1][2]
-			);
-		glEnd();
+		scene_bounds.lod[i] = (unsigned char)select_fog_lod(scene_bounds.depth[i]);
+		if (scene_bounds.lod[i] > 0 && i < CULL_INDEX_BOIDS)
+		{
+			++simplified_count;
+		}
+	}
+
+	int occluded_count = 0;
+	if (culling_on && occlusion_on)
+	{
+		occluded_count = cull_occluded(boid_radius);
+	}
+	else
+	{
+		current_frame_stats.objects_occluded         = 0;
+		current_frame_stats.occluders_rasterized     = 0;
+		current_frame_stats.occluder_triangles       = 0;
+		current_frame_stats.occlusion_raster_time_ms = 0.0;
 	}
-}
 
+	current_frame_stats.objects_visible    = visible_count - fog_culled_count - occluded_count;
+	current_frame_stats.objects_culled     = frustum_culled_count;
+	current_frame_stats.objects_fog_culled = fog_culled_count;
+	current_frame_stats.objects_simplified = simplified_count;
+	current_frame_stats.culling_time_ms    = timer_now_ms() - start_ms;
+}
 
 /**
- * @brief Draws a scene object with transformation and lighting applied.
+ * @brief Requests environment texture detail for a surface.
+ *
+ * Estimates how many base level texels fall into one pixel at the
+ * surface point nearest to the camera. Under GL_EXP fog the texture
+ * contrast is scaled by the fog factor, so fine detail that the fog
+ * hides is not requested.
  *
- * @param object The scene object to render.
+ * @param distance     Distance from the camera to the nearest surface point.
+ * @param texture_span World units covered by the whole texture on the surface.
  */
-void draw_scene_object(const scene_object object)
+static void request_environment_texture_detail(
+	GLfloat distance, 
+	GLfloat texture_span
+)
 {
-	glMaterialfv(GL_FRONT, GL_AMBIENT, object.ambient);
-	glMaterialfv(GL_FRONT, GL_DIFFUSE, object.diffuse);
-	glMaterialfv(GL_FRONT, GL_SPECULAR, object.specular);
-	glMaterialf(GL_FRONT, GL_SHININESS, object.shine);
+	texture_stats stats;
+	if (!texture_get_stats(texture_id_environment, &stats))
+	{
+		return;
+	}
 
-	geometry_normalize_vector(object.direction);  // forward vector.
+	if (distance < DEFAULT_CAMERA_NEAR_PLANE)
+	{
+		distance = (GLfloat)DEFAULT_CAMERA_NEAR_PLANE;
+	}
 
-	glPushMatrix();
-	    glTranslatef(
-			object.position[0], 
-			object.position[1], 
-			object.position[2]
-		);
-		glRotatef(
-			geometry_calculate_yaw_degree(object.direction), 
-			0.0f, 
-			1.0f, 
-			0.0f
-		);
-	    glRotatef(
-			-geometry_calculate_pitch_degree(object.direction), 
-			1.0f, 
-			0.0f, 
-			0.0f
-		);
-		glRotatef(object.rotation, 0.0f, 1.0f, 0.0f);  // used when object is facing improper direction (specifically the submarine).
+	const GLfloat half_fov_tangent = 
+		tanf(geometry_degree_to_radian((GLfloat)main_camera.fov) / 2.0f);
+	// Fewer pixels are drawn below full dynamic resolution, so less detail is needed.
+	const GLfloat drawn_height = (GLfloat)main_window.height * dynamic_resolution_scale();
+	const GLfloat pixels_per_unit = 
+		drawn_height / (2.0f * distance * half_fov_tangent);
+	const GLfloat texels_per_unit = (GLfloat)stats.width / texture_span;
+
+	GLfloat texels_per_pixel = texels_per_unit / pixels_per_unit;
+	if (fog_on)
+	{
+		texels_per_pixel /= expf(-fog_density * distance);
+	}
 
-	    glScalef(object.scale, object.scale, object.scale);
+	texture_request_density(texture_id_environment, texels_per_pixel);
+}
 
-		draw_mesh(object.mesh);
-	glPopMatrix();
+/**
+ * @brief Quantizes a view depth between the camera and the far plane.
+ *
+ * @param depth View depth, clamped to the far plane.
+ * @return draw_key The depth in DRAW_KEY_FIELD_MASK steps, 0 at the camera.
+ */
+static draw_key quantize_depth(GLfloat depth)
+{
+	const GLfloat far_plane = (GLfloat)DEFAULT_CAMERA_FAR_PLANE;
 
-	const color color_zero = { 0.0f, 0.0f, 0.0f, 0.0f };
-	glMaterialfv(GL_FRONT, GL_AMBIENT,   color_zero);
-	glMaterialfv(GL_FRONT, GL_DIFFUSE,   color_zero);
-	glMaterialfv(GL_FRONT, GL_SPECULAR,  color_zero);
-	glMaterialfv(GL_FRONT, GL_SHININESS, color_zero);
+	if (depth <= 0.0f)
+	{
+		return 0;
+	}
+	if (depth >= far_plane)
+	{
+		return DRAW_KEY_FIELD_MASK;
+	}
+	return (draw_key)(depth / far_plane * (GLfloat)DRAW_KEY_FIELD_MASK);
 }
 
 /**
- * @brief Draws the submarine model.
+ * @brief Returns the submission layer of a draw item in the depth order.
+ *
+ * The large surfaces are drawn after the objects in front of them, so
+ * most of their fragments fail the depth test before they are shaded.
+ * The impostors blend their edges over whatever is behind them and come
+ * last.
+ *
+ * @param item The draw item.
+ * @return int The layer, one of the DEPTH_LAYER values.
  */
-void draw_submarine(void)
+static int get_depth_layer(const draw_item* item)
 {
-	draw_scene_object(object_submarine);
+	if (item->type == DRAW_ITEM_IMPOSTORS)
+	{
+		return DEPTH_LAYER_BLENDED;
+	}
+
+	switch (item->pass)
+	{
+	case RENDER_PASS_DEBUG:
+		return DEPTH_LAYER_DEBUG;
+
+	case RENDER_PASS_ENVIRONMENT:
+	case RENDER_PASS_WATER:
+		return DEPTH_LAYER_SURFACES;
+
+	default:
+		return DEPTH_LAYER_OPAQUE;
+	}
 }
 
 /**
- * @brief Draws all coral scene objects.
+ * @brief Builds the sort key of a draw item.
+ *
+ * In the state order the key groups the items of each pass by texture
+ * and material. In the depth order the quantized view depth takes the
+ * place of the texture, so the opaque items are drawn front to back.
+ *
+ * @param item     The draw item, with its pass, type and texture set.
+ * @param material Interned material, 0 for draws that are not sorted by material.
+ * @param depth    Nearest view depth of the item, 0 for draws that are not sorted by depth.
+ * @param sequence Order the item was recorded in within its layer.
+ * @return draw_key The key, ordered by layer, texture or depth, material and sequence.
  */
-void draw_coral(void)
+static draw_key make_draw_key(const draw_item* item, int material, GLfloat depth, int sequence)
 {
-    for (int i = 0; i < CORAL_COUNT; ++i)
-    {
-		draw_scene_object(objects_coral[i]);
-    }
+	draw_key layer = pass_layers[item->pass];
+	draw_key order = (draw_key)item->texture_id & DRAW_KEY_FIELD_MASK;
+	if (main_options.draw_order == DRAW_ORDER_DEPTH)
+	{
+		layer = (draw_key)get_depth_layer(item);
+		order = quantize_depth(depth);
+	}
+
+	return (layer << DRAW_KEY_LAYER_SHIFT) |
+		(order << DRAW_KEY_TEXTURE_SHIFT) |
+		(((draw_key)material & DRAW_KEY_FIELD_MASK) << DRAW_KEY_MATERIAL_SHIFT) |
+		((draw_key)sequence & DRAW_KEY_SEQUENCE_MASK);
 }
 
+/**
+ * @brief Resets a draw item to an identity model matrix and the default line width.
+ *
+ * @param item       The item to reset.
+ * @param pass       Part of the scene the item belongs to.
+ * @param type       What the item draws.
+ * @param texture_id Bound texture, 0 for none.
+ * @param material   Material of the draw.
+ */
+static void initialize_draw_item(
+	draw_item* item, 
+	render_pass pass, 
+	draw_item_type type, 
+	GLuint texture_id, 
+	const gl_material* material
+)
+{
+	const draw_item empty = { 0 };
+
+	*item = empty;
+	item->type       = type;
+	item->pass       = pass;
+	item->texture_id = texture_id;
+	item->material   = *material;
+	item->line_width = LINE_WIDTH;
+	for (int i = 0; i < 4; ++i)
+	{
+		item->model[i * 5] = 1.0f;
+	}
+}
 
 /**
- * @brief Draws all boid entities as simple triangular 3D shapes.
+ * @brief Appends a draw item to the draw list of the frame.
+ *
+ * The item keeps its place among the items of its layer.
+ *
+ * @param pass       Part of the scene the item belongs to.
+ * @param type       What the item draws.
+ * @param texture_id Bound texture, 0 for none.
+ * @param material   Material of the draw.
+ * @return draw_item* The item, drawn with an identity model matrix and the default line width.
  */
-void draw_boids(void)
+static draw_item* add_draw_item(
+	render_pass pass, 
+	draw_item_type type, 
+	GLuint texture_id, 
+	const gl_material* material
+)
 {
-	point_3d apex         = {  0.0f,       0.0f,       BOID_APEX };
-	point_3d top_left     = {  BOID_BASE,  BOID_BASE, -BOID_APEX };
-	point_3d top_right    = { -BOID_BASE,  BOID_BASE, -BOID_APEX };
-	point_3d bottom_left  = {  BOID_BASE, -BOID_BASE, -BOID_APEX };
-	point_3d bottom_right = { -BOID_BASE, -BOID_BASE, -BOID_APEX };
+	draw_item* item = &frame_list.items[frame_list.item_count];
+	initialize_draw_item(item, pass, type, texture_id, material);
+	item->key = make_draw_key(item, 0, 0.0f, frame_list.item_count);
 
-	vector_3d normal_top        = { 0.0f, 0.0f, 0.0f };
-    geometry_calculate_normal(apex, top_left, top_right, normal_top);
+	++frame_list.item_count;
+	return item;
+}
 
-	vector_3d normal_left       = { 0.0f, 0.0f, 0.0f };
-	geometry_calculate_normal(apex, bottom_left, top_left, normal_left);
+/**
+ * @brief Adds 3D origin axis lines and a small sphere at the origin to the debug lines.
+ */
+static void record_origin(void)
+{
+	const color color_red   = { 1.0f, 0.0f, 0.0f, 1.0f };  // x-axis
+	const color color_green = { 0.0f, 1.0f, 0.0f, 1.0f };  // y-axis
+	const color color_blue  = { 0.0f, 0.0f, 1.0f, 1.0f };  // z-axis
+	const color color_white = { 1.0f, 1.0f, 1.0f, 1.0f };  // centre sphere.
 
-	vector_3d normal_bottom     = { 0.0f, 0.0f, 0.0f };
-	geometry_calculate_normal(apex, bottom_right, bottom_left, normal_bottom);
+	const point_3d point_center = { 0.0f, 0.0f, 0.0f };
+	const point_3d axis_x       = { ORIGIN_SIZE, 0.0f, 0.0f };
+	const point_3d axis_y       = { 0.0f, ORIGIN_SIZE, 0.0f };
+	const point_3d axis_z       = { 0.0f, 0.0f, ORIGIN_SIZE };
 
-	vector_3d normal_right      = { 0.0f, 0.0f, 0.0f };
-	geometry_calculate_normal(apex, bottom_right, top_right, normal_right);
+	debug_draw_line(DEBUG_DRAW_BOLD, point_center, axis_x, color_red);
+	debug_draw_line(DEBUG_DRAW_BOLD, point_center, axis_y, color_green);
+	debug_draw_line(DEBUG_DRAW_BOLD, point_center, axis_z, color_blue);
+	debug_draw_sphere(DEBUG_DRAW_BOLD, point_center, ORIGIN_SPHERE_SIZE, color_white);
+}
 
-	vector_3d normal_base_left  = { 0.0f, 0.0f, 0.0f };
-	geometry_calculate_normal(
-		top_left, 
-		bottom_left, 
-		top_right, 
-		normal_base_left
-	);
+/**
+ * @brief Records the debug lines of the frame, one draw item per line width.
+ *
+ * Must run after everything adding debug lines has been recorded.
+ */
+static void record_debug(void)
+{
+	const gl_material material_unlit = { COLOR_ZERO, COLOR_ZERO, COLOR_ZERO, COLOR_ZERO, 0.0f };
 
-	vector_3d normal_base_right = { 0.0f, 0.0f, 0.0f };
-	geometry_calculate_normal(
-		top_right, 
-		bottom_left, 
-		bottom_right, 
-		normal_base_right
-	);
+	frame_list.debug = debug_draw_get_batch();
+	if (frame_list.debug == NULL || !debug_draw_on)
+	{
+		return;
+	}
+
+	for (int weight = 0; weight < DEBUG_DRAW_WEIGHT_COUNT; ++weight)
+	{
+		if (frame_list.debug->counts[weight] == 0)
+		{
+			continue;
+		}
 
-	color ambient  = { BOID_AMBIENT,  BOID_AMBIENT,  BOID_AMBIENT,  1.0f };
-	color diffuse  = { 0.0f,          BOID_DIFFUSE,  BOID_DIFFUSE,  1.0f };
-	color specular = { BOID_SPECULAR, BOID_SPECULAR, BOID_SPECULAR, 1.0f };
-
-	glMaterialfv(GL_FRONT, GL_AMBIENT,   ambient);
-	glMaterialfv(GL_FRONT, GL_DIFFUSE,   diffuse);
-	glMaterialfv(GL_FRONT, GL_SPECULAR,  specular);
-	glMaterialf (GL_FRONT, GL_SHININESS, BOID_SHINE);
-
-    for (int i = 0; i < BOID_COUNT; ++i)
-    {
-		const boid subject_boid = array_boids_current[i];
-
-        glPushMatrix();
-		    glTranslatef(
-				subject_boid.position[0], 
-				subject_boid.position[1], 
-				subject_boid.position[2]
-			);
-			glRotatef(
-				geometry_calculate_yaw_degree(subject_boid.direction), 
-				0.0f, 
-				1.0f, 
-				0.0f
-			);
-			glRotatef(
-				-geometry_calculate_pitch_degree(subject_boid.direction), 
-				1.0f, 
-				0.0f, 
-				0.0f
-			);
-			glScalef(BOID_SCALE, BOID_SCALE, BOID_SCALE);
-
-			glBegin(GL_TRIANGLES);
-			    // Top face
-			    glNormal3fv(normal_top);
-			    glVertex3fv(apex);
-			    glVertex3fv(top_left);
-			    glVertex3fv(top_right);
-
-			    // Left face
-			    glNormal3fv(normal_left);
-			    glVertex3fv(apex);
-			    glVertex3fv(bottom_left);
-			    glVertex3fv(top_left);
-
-			    // Bottom face
-			    glNormal3fv(normal_bottom);
-			    glVertex3fv(apex);
-			    glVertex3fv(bottom_left);
-			    glVertex3fv(bottom_right);
-
-			    // Right face
-			    glNormal3fv(normal_right);
-			    glVertex3fv(apex);
-			    glVertex3fv(bottom_right);
-			    glVertex3fv(top_right);
-
-			    // Base left face
-			    glNormal3fv(normal_base_left);
-			    glVertex3fv(top_left);
-			    glVertex3fv(bottom_left);
-			    glVertex3fv(top_right);
-
-			    // Base right face
-			    glNormal3fv(normal_base_right);
-			    glVertex3fv(top_right);
-			    glVertex3fv(bottom_left);
-			    glVertex3fv(bottom_right);
-			glEnd();
-		glPopMatrix();
-    }
-
-	const color color_zero = { 0.0f, 0.0f, 0.0f, 0.0f };
-	glMaterialfv(GL_FRONT, GL_AMBIENT, color_zero);
-	glMaterialfv(GL_FRONT, GL_DIFFUSE, color_zero);
-	glMaterialfv(GL_FRONT, GL_SPECULAR, color_zero);
-	glMaterialfv(GL_FRONT, GL_SHININESS, color_zero);
-}
-
-/**
- * @brief Calls all drawing functions to render the full scene.
- */
-void renderer_draw(void)
-{
-	draw_origin();
-	draw_environment();
-	draw_water();
-	draw_submarine();
-	draw_coral();
-	draw_boids();
+		draw_item* item = add_draw_item(RENDER_PASS_DEBUG, DRAW_ITEM_DEBUG, 0, &material_unlit);
+		item->line_width = debug_draw_weight_width((debug_draw_weight)weight);
+		item->first      = weight * DEBUG_DRAW_CAPACITY;
+		item->count      = frame_list.debug->counts[weight];
+	}
 }
 
 /**
- * @brief Frees renderer resources.
+ * @brief Records the floor and cylindrical wall environment.
+ *
+ * The surfaces are tessellated about their z axis, which the model
+ * matrix turns upwards. The walls are moved one unit further along
+ * the turned y axis than the floor.
  */
-void renderer_clean_up(void)
+static void record_environment(void)
 {
-	submarine_cleanup();
-	coral_cleanup();
+	const GLfloat* eye = frame_snapshot->camera_position;
+
+	// Floor - the disk diameter maps to the texture once.
+	request_environment_texture_detail(
+		eye[1] - ENVIRONMENT_FLOOR_Y,
+		2.0f * ((GLfloat)ENVIRONMENT_RADIUS_XZ + 1.0f)
+	);
+	// Walls - the wall height maps to the texture once.
+	request_environment_texture_detail(
+		(GLfloat)ENVIRONMENT_RADIUS_XZ - sqrtf(eye[0] * eye[0] + eye[2] * eye[2]),
+		(GLfloat)ENVIRONMENT_HEIGHT + 1.0f
+	);
+
+	const gl_material material_disk = {      // floor.
+		COLOR_ZERO, { 0.9f, 0.6f, 0.3f, 1.0f }, COLOR_ZERO, { 0.3f, 0.2f, 0.1f, 1.0f }, 0.0f
+	};
+	const gl_material material_cylinder = {  // walls.
+		COLOR_ZERO, { 0.5f, 0.5f, 0.5f, 1.0f }, COLOR_ZERO, { 1.0f, 1.0f, 1.0f, 1.0f }, 0.0f
+	};
+
+	// Translation by -1 along y, then rotation by -90 degrees about x.
+	const GLfloat floor_model[16] = {
+		1.0f,  0.0f,  0.0f, 0.0f,
+		0.0f,  0.0f, -1.0f, 0.0f,
+		0.0f,  1.0f,  0.0f, 0.0f,
+		0.0f, -1.0f,  0.0f, 1.0f
+	};
+
+	// Floor - disk.
+	draw_item* floor = add_draw_item(RENDER_PASS_ENVIRONMENT, DRAW_ITEM_SURFACE, texture_id_environment, &material_disk);
+	floor->surface = &environment_floor;
+	memcpy(floor->model, floor_model, sizeof(floor_model));
+
+	// Walls - cylinder, translated by -1 along the rotated y axis.
+	draw_item* walls = add_draw_item(RENDER_PASS_ENVIRONMENT, DRAW_ITEM_SURFACE, texture_id_environment, &material_cylinder);
+	walls->surface = &environment_walls;
+	memcpy(walls->model, floor_model, sizeof(floor_model));
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		walls->model[12 + axis] -= floor_model[4 + axis];
+	}
+}
+
+/**
+ * @brief Records the water grid at the water surface.
+ */
+static void record_water(void)
+{
+	const point_3d    water_position = { 0.0f, 10.0f, 0.0f };
+	const gl_material material_water = {
+		COLOR_ZERO, { 0.5f, 0.5f, 0.5f, 1.0f }, COLOR_ZERO, COLOR_ZERO, 0.0f
+	};
+
+	draw_item* water = add_draw_item(RENDER_PASS_WATER, DRAW_ITEM_WATER, 0, &material_water);
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		water->model[12 + axis] = water_position[axis];
+	}
+}
+
+/**
+ * @brief Builds the material a scene object is drawn with.
+ *
+ * @param object   The scene object.
+ * @param material Output material, without emission.
+ */
+static void get_scene_object_material(const scene_object* object, gl_material* material)
+{
+	const color emission_zero = COLOR_ZERO;
+
+	memcpy(material->ambient,  object->ambient,  sizeof(color));
+	memcpy(material->diffuse,  object->diffuse,  sizeof(color));
+	memcpy(material->specular, object->specular, sizeof(color));
+	memcpy(material->emission, emission_zero,    sizeof(color));
+	material->shininess = object->shine;
+}
+
+/**
+ * @brief Assigns every distinct material of the scene objects an index.
+ *
+ * Scene objects with equal materials get equal indices, so sorting the
+ * draw keys lets them follow each other and the backend skips their
+ * state changes. The materials of the loaded objects never change.
+ */
+static void intern_scene_materials(void)
+{
+	scene_material_count = 0;
+	for (int i = 0; i < SCENE_OBJECT_COUNT; ++i)
+	{
+		const scene_object* object = 
+			i == CULL_INDEX_SUBMARINE ? &object_submarine : &objects_coral[i - CULL_INDEX_CORAL];
+
+		gl_material material;
+		get_scene_object_material(object, &material);
+
+		int id = 0;
+		while (id < scene_material_count &&
+			   memcmp(&scene_materials[id], &material, sizeof(gl_material)) != 0)
+		{
+			++id;
+		}
+		if (id == scene_material_count)
+		{
+			scene_materials[scene_material_count++] = material;
+		}
+		scene_material_ids[i] = id;
+	}
+}
+
+/**
+ * @brief Records a scene object into a partition if it passed culling.
+ *
+ * Picks the level of detail selected while culling and copies the
+ * model matrix. Only reads the frame state, so tasks recording other
+ * objects can run at the same time.
+ *
+ * @param partition  The partition of the recording task.
+ * @param cull_index Index of the object in the culled bounds.
+ */
+static void record_scene_object(record_partition* partition, int cull_index)
+{
+	if (!scene_bounds.visible[cull_index])
+	{
+		return;
+	}
+
+	const GLfloat* position;
+	const GLfloat* model;
+	scene_object*  object = get_scene_object(cull_index, &position, &model);
+	mesh*          detail = &object->mesh;
+	const int      level  = scene_bounds.lod[cull_index];
+	if (level > 0 && object->lods[level - 1].face_count > 0)
+	{
+		detail = &object->lods[level - 1];
+	}
+
+	const render_pass pass = 
+		cull_index == CULL_INDEX_SUBMARINE ? RENDER_PASS_SUBMARINE : RENDER_PASS_CORAL;
+
+	gl_material material;
+	get_scene_object_material(object, &material);
+
+	draw_item* item = &partition->items[partition->item_count++];
+	initialize_draw_item(item, pass, DRAW_ITEM_MESH, 0, &material);
+	item->key  = make_draw_key(item, scene_material_ids[cull_index], scene_bounds.depth[cull_index], cull_index);
+	item->mesh = detail;
+	memcpy(item->model, model, sizeof(item->model));
+}
+
+/**
+ * @brief Calculates the corners and face normals of the boid pyramid.
+ *
+ * @param pyramid Output pyramid geometry.
+ */
+static void calculate_boid_pyramid(boid_pyramid* pyramid)
+{
+	const point_3d corners[5] = {
+		{  0.0f,       0.0f,       BOID_APEX },  // apex
+		{  BOID_BASE,  BOID_BASE, -BOID_APEX },  // top left
+		{ -BOID_BASE,  BOID_BASE, -BOID_APEX },  // top right
+		{  BOID_BASE, -BOID_BASE, -BOID_APEX },  // bottom left
+		{ -BOID_BASE, -BOID_BASE, -BOID_APEX }   // bottom right
+	};
+	memcpy(pyramid->apex,         corners[0], sizeof(point_3d));
+	memcpy(pyramid->top_left,     corners[1], sizeof(point_3d));
+	memcpy(pyramid->top_right,    corners[2], sizeof(point_3d));
+	memcpy(pyramid->bottom_left,  corners[3], sizeof(point_3d));
+	memcpy(pyramid->bottom_right, corners[4], sizeof(point_3d));
+
+	geometry_calculate_normal(
+		pyramid->apex, 
+		pyramid->top_left, 
+		pyramid->top_right, 
+		pyramid->normal_top
+	);
+	geometry_calculate_normal(
+		pyramid->apex, 
+		pyramid->bottom_left, 
+		pyramid->top_left, 
+		pyramid->normal_left
+	);
+	geometry_calculate_normal(
+		pyramid->apex, 
+		pyramid->bottom_right, 
+		pyramid->bottom_left, 
+		pyramid->normal_bottom
+	);
+	geometry_calculate_normal(
+		pyramid->apex, 
+		pyramid->bottom_right, 
+		pyramid->top_right, 
+		pyramid->normal_right
+	);
+	geometry_calculate_normal(
+		pyramid->top_left, 
+		pyramid->bottom_left, 
+		pyramid->top_right, 
+		pyramid->normal_base_left
+	);
+	geometry_calculate_normal(
+		pyramid->top_right, 
+		pyramid->bottom_left, 
+		pyramid->bottom_right, 
+		pyramid->normal_base_right
+	);
+}
+
+/**
+ * @brief Lists the six faces of the boid pyramid as a triangle list.
+ *
+ * @param pyramid  The pyramid geometry.
+ * @param vertices Output triangle list with face normals.
+ */
+static void list_boid_pyramid_triangles(
+	const boid_pyramid* pyramid,
+	      mesh_vertex   vertices[BOID_PYRAMID_VERTEX_COUNT]
+)
+{
+	const GLfloat* const faces[BOID_PYRAMID_VERTEX_COUNT / 3][4] = {
+		// face normal,               corners
+		{ pyramid->normal_top,        pyramid->apex,      pyramid->top_left,     pyramid->top_right    },  // top
+		{ pyramid->normal_left,       pyramid->apex,      pyramid->bottom_left,  pyramid->top_left     },  // left
+		{ pyramid->normal_bottom,     pyramid->apex,      pyramid->bottom_left,  pyramid->bottom_right },  // bottom
+		{ pyramid->normal_right,      pyramid->apex,      pyramid->bottom_right, pyramid->top_right    },  // right
+		{ pyramid->normal_base_left,  pyramid->top_left,  pyramid->bottom_left,  pyramid->top_right    },  // base left
+		{ pyramid->normal_base_right, pyramid->top_right, pyramid->bottom_left,  pyramid->bottom_right }   // base right
+	};
+
+	for (int face = 0; face < BOID_PYRAMID_VERTEX_COUNT / 3; ++face)
+	{
+		for (int corner = 0; corner < 3; ++corner)
+		{
+			mesh_vertex* vertex = &vertices[face * 3 + corner];
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				vertex->position[axis] = faces[face][corner + 1][axis];
+				vertex->normal[axis]   = faces[face][0][axis];
+			}
+		}
+	}
+}
+
+/**
+ * @brief Calculates the boid pyramid and lists it as a triangle list.
+ *
+ * @param vertices Output triangle list with face normals.
+ */
+static void list_boid_pyramid(mesh_vertex vertices[BOID_PYRAMID_VERTEX_COUNT])
+{
+	boid_pyramid pyramid;
+	calculate_boid_pyramid(&pyramid);
+	list_boid_pyramid_triangles(&pyramid, vertices);
+}
+
+/**
+ * @brief Records a visible boid into a partition.
+ *
+ * Boids nearer than the impostor distance get the position and the
+ * orientation basis of the snapshot scaled to their pyramid, the
+ * others an impostor quad.
+ *
+ * @param partition The partition of the recording task.
+ * @param index     Index of the boid in the snapshot.
+ */
+static void record_boid(record_partition* partition, int index)
+{
+	const int cull_index = CULL_INDEX_BOIDS + index;
+	if (!scene_bounds.visible[cull_index])
+	{
+		return;
+	}
+
+	const boid* subject_boid = &frame_snapshot->boids[index];
+
+	if (main_options.impostor_distance > 0.0 &&
+		scene_bounds.depth[cull_index] >= (GLfloat)main_options.impostor_distance)
+	{
+		impostor_list_quad(
+			subject_boid->position,
+			subject_boid->direction,
+			frame_snapshot->camera_position,
+			BOID_SCALE * BOID_PYRAMID_RADIUS,
+			&partition->impostors[partition->impostor_vertex_count]
+		);
+		partition->impostor_vertex_count += IMPOSTOR_VERTEX_COUNT;
+		return;
+	}
+
+	instance_transform* instance = &partition->boids[partition->boid_count++];
+
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		instance->position[axis] = subject_boid->position[axis];
+		instance->right[axis]    = frame_snapshot->boid_right[index][axis] * BOID_SCALE;
+		instance->up[axis]       = frame_snapshot->boid_up[index][axis] * BOID_SCALE;
+		instance->forward[axis]  = subject_boid->direction[axis] * BOID_SCALE;
+	}
+}
+
+/**
+ * @brief Records one partition of the scene objects and boids.
+ *
+ * Task i of n records the i-th contiguous n-th of the scene objects
+ * and of the boids.
+ *
+ * @param argument Unused.
+ * @param task     Index of the partition.
+ */
+static void record_partition_task(void* argument, int task)
+{
+	(void)argument;
+
+	record_partition* partition = &record_partitions[task];
+	partition->item_count            = 0;
+	partition->boid_count            = 0;
+	partition->impostor_vertex_count = 0;
+
+	const int object_end = SCENE_OBJECT_COUNT * (task + 1) / record_partition_count;
+	for (int i = SCENE_OBJECT_COUNT * task / record_partition_count; i < object_end; ++i)
+	{
+		record_scene_object(partition, i);
+	}
+
+	const int boid_end = BOID_COUNT * (task + 1) / record_partition_count;
+	for (int i = BOID_COUNT * task / record_partition_count; i < boid_end; ++i)
+	{
+		record_boid(partition, i);
+	}
+}
+
+/**
+ * @brief Sorts entries by their keys with a least significant digit radix sort.
+ *
+ * Every byte of the keys takes one stable counting pass. Bytes that are
+ * equal in all keys, like the fields the draw order leaves empty, are
+ * skipped.
+ *
+ * @param entries The entries to sort.
+ * @param scratch Room for as many entries.
+ * @param count   Number of entries.
+ * @return sort_entry* The sorted entries, in either entries or scratch.
+ */
+static sort_entry* radix_sort_keys(sort_entry* entries, sort_entry* scratch, int count)
+{
+	draw_key all_set = ~(draw_key)0;
+	draw_key any_set = 0;
+	for (int i = 0; i < count; ++i)
+	{
+		all_set &= entries[i].key;
+		any_set |= entries[i].key;
+	}
+	const draw_key varying = all_set ^ any_set;
+
+	for (int shift = 0; shift < 64; shift += 8)
+	{
+		if (((varying >> shift) & 0xFF) == 0)
+		{
+			continue;
+		}
+
+		int offsets[256] = { 0 };
+		for (int i = 0; i < count; ++i)
+		{
+			++offsets[(entries[i].key >> shift) & 0xFF];
+		}
+		int total = 0;
+		for (int digit = 0; digit < 256; ++digit)
+		{
+			const int digit_count = offsets[digit];
+			offsets[digit] = total;
+			total += digit_count;
+		}
+		for (int i = 0; i < count; ++i)
+		{
+			scratch[offsets[(entries[i].key >> shift) & 0xFF]++] = entries[i];
+		}
+
+		sort_entry* sorted = scratch;
+		scratch = entries;
+		entries = sorted;
+	}
+	return entries;
+}
+
+/**
+ * @brief Sorts the draw list of the frame by the keys of its items.
+ */
+static void sort_draw_items(void)
+{
+	sort_entry entries[DRAW_LIST_CAPACITY];
+	sort_entry scratch[DRAW_LIST_CAPACITY];
+	for (int i = 0; i < frame_list.item_count; ++i)
+	{
+		entries[i].key   = frame_list.items[i].key;
+		entries[i].index = i;
+	}
+
+	const sort_entry* sorted = radix_sort_keys(entries, scratch, frame_list.item_count);
+	for (int i = 0; i < frame_list.item_count; ++i)
+	{
+		sorted_items[i] = frame_list.items[sorted[i].index];
+	}
+	memcpy(frame_list.items, sorted_items, (size_t)frame_list.item_count * sizeof(draw_item));
+}
+
+/**
+ * @brief Orders the boid pyramids of the frame front to back.
+ *
+ * The pyramids are drawn in list order within their draw, so the
+ * nearest boids hide the pyramids behind them before they are shaded.
+ *
+ * @return GLfloat View depth of the nearest pyramid, 0 without pyramids.
+ */
+static GLfloat sort_boids_front_to_back(void)
+{
+	const GLfloat* view = frame_list.view;
+
+	sort_entry entries[BOID_COUNT];
+	sort_entry scratch[BOID_COUNT];
+	GLfloat    nearest_depth = 0.0f;
+	for (int i = 0; i < frame_list.boid_count; ++i)
+	{
+		const GLfloat* position = frame_list.boids[i].position;
+		const GLfloat  depth    = 
+			-(view[2] * position[0] + view[6] * position[1] + view[10] * position[2] + view[14]);
+
+		entries[i].key   = (quantize_depth(depth) << DRAW_KEY_TEXTURE_SHIFT) | (draw_key)i;
+		entries[i].index = i;
+		if (i == 0 || depth < nearest_depth)
+		{
+			nearest_depth = depth;
+		}
+	}
+
+	instance_transform sorted_boids[BOID_COUNT];
+	const sort_entry*  sorted = radix_sort_keys(entries, scratch, frame_list.boid_count);
+	for (int i = 0; i < frame_list.boid_count; ++i)
+	{
+		sorted_boids[i] = frame_list.boids[sorted[i].index];
+	}
+	memcpy(frame_list.boids, sorted_boids, (size_t)frame_list.boid_count * sizeof(instance_transform));
+
+	return nearest_depth;
+}
+
+/**
+ * @brief Records the scene objects and boids in parallel and sorts the draw list.
+ *
+ * The partitions are recorded by the render thread and the recording
+ * threads, then appended in partition order, so the boids keep the
+ * order of the snapshot. In the state order, sorting by key groups the
+ * scene objects by texture and material, so the backend skips their
+ * state changes. In the depth order the scene objects and the boid
+ * pyramids are drawn front to back, so fewer of the fragments behind
+ * them are shaded.
+ * Records the recording time in current_frame_stats.
+ */
+static void record_scene(void)
+{
+	const double start_ms = timer_now_ms();
+
+	const gl_material material_boid = {
+		{ BOID_AMBIENT,  BOID_AMBIENT,  BOID_AMBIENT,  1.0f },  // ambient
+		{ 0.0f,          BOID_DIFFUSE,  BOID_DIFFUSE,  1.0f },  // diffuse
+		{ BOID_SPECULAR, BOID_SPECULAR, BOID_SPECULAR, 1.0f },  // specular
+		COLOR_ZERO,                                             // emission
+		BOID_SHINE
+	};
+
+	worker_pool_run(&record_pool, record_partition_task, NULL, record_partition_count);
+
+	for (int i = 0; i < record_partition_count; ++i)
+	{
+		const record_partition* partition = &record_partitions[i];
+
+		memcpy(
+			&frame_list.items[frame_list.item_count],
+			partition->items,
+			(size_t)partition->item_count * sizeof(draw_item)
+		);
+		frame_list.item_count += partition->item_count;
+
+		memcpy(
+			&frame_list.boids[frame_list.boid_count],
+			partition->boids,
+			(size_t)partition->boid_count * sizeof(instance_transform)
+		);
+		frame_list.boid_count += partition->boid_count;
+
+		memcpy(
+			&frame_list.impostor_vertices[frame_list.impostor_vertex_count],
+			partition->impostors,
+			(size_t)partition->impostor_vertex_count * sizeof(impostor_vertex)
+		);
+		frame_list.impostor_vertex_count += partition->impostor_vertex_count;
+	}
+
+	draw_item* pyramids = add_draw_item(RENDER_PASS_BOIDS, DRAW_ITEM_BOIDS, 0, &material_boid);
+	if (main_options.draw_order == DRAW_ORDER_DEPTH)
+	{
+		pyramids->key = make_draw_key(pyramids, 0, sort_boids_front_to_back(), frame_list.item_count - 1);
+	}
+	if (frame_list.impostor_vertex_count > 0)
+	{
+		add_draw_item(RENDER_PASS_BOIDS, DRAW_ITEM_IMPOSTORS, impostor_atlas, &material_boid);
+	}
+
+	sort_draw_items();
+
+	current_frame_stats.record_time_ms = timer_now_ms() - start_ms;
+	current_frame_stats.record_threads = record_partition_count;
+	current_frame_stats.boid_pyramids  = frame_list.boid_count;
+	current_frame_stats.boid_impostors = frame_list.impostor_vertex_count / IMPOSTOR_VERTEX_COUNT;
+}
+
+/**
+ * @brief Returns a pseudo-random number from a light index.
+ *
+ * The plankton are placed without rand(), so enabling them does not
+ * change the random numbers the boids are placed with.
+ *
+ * @param index Index of the light.
+ * @param salt  Selects one of several numbers of the same light.
+ * @return GLfloat Number in [0, 1).
+ */
+static GLfloat hash_light(unsigned index, unsigned salt)
+{
+	unsigned hash = index * 0x9E3779B1u ^ salt * 0x85EBCA77u;
+	hash ^= hash >> 15;
+	hash *= 0x2C1B3C6Du;
+	hash ^= hash >> 12;
+	return (GLfloat)(hash & 0xFFFFFFu) / 16777216.0f;
+}
+
+/**
+ * @brief Scatters the plankton lights through the lower part of the environment.
+ *
+ * The plankton take every light after the submarine lamps and the boids.
+ */
+static void place_plankton_lights(void)
+{
+	for (int i = LAMP_COUNT + BOID_COUNT; i < LIGHT_CLUSTERS_MAX_LIGHTS; ++i)
+	{
+		// The square root spreads the swarms evenly over the floor disk.
+		const GLfloat distance = (GLfloat)(ENVIRONMENT_RADIUS_XZ - 1) * sqrtf(hash_light((unsigned)i, 0));
+		const GLfloat angle    = 2.0f * PI * hash_light((unsigned)i, 1);
+		const GLfloat height   = (GLfloat)ENVIRONMENT_FLOOR_Y +
+			(PLANKTON_TOP - (GLfloat)ENVIRONMENT_FLOOR_Y) * hash_light((unsigned)i, 2);
+
+		scene_lights[i].position[0] = distance * cosf(angle);
+		scene_lights[i].position[1] = height;
+		scene_lights[i].position[2] = distance * sinf(angle);
+		scene_lights[i].radius      = PLANKTON_RADIUS;
+	}
+}
+
+/**
+ * @brief Places the point lights of the frame and sorts them into the clusters.
+ *
+ * The first lights are the submarine lamps, then one glow per boid,
+ * then the pulsing plankton, as many as --point-lights asks for.
+ * Records the light count and assignment time in current_frame_stats.
+ *
+ * @param width  Width of the drawn viewport in pixels.
+ * @param height Height of the drawn viewport in pixels.
+ */
+static void record_point_lights(int width, int height)
+{
+	const int light_count = main_options.point_lights;
+
+	frame_list.lights = NULL;
+	current_frame_stats.point_lights         = 0;
+	current_frame_stats.light_cluster_refs   = 0;
+	current_frame_stats.light_assign_time_ms = 0.0;
+	if (light_count == 0)
+	{
+		return;
+	}
+
+	const double    start_ms   = timer_now_ms();
+	const color     lamp_color = LAMP_COLOR;
+	const color     glow_color = BOID_GLOW_COLOR;
+	const color     plankton   = PLANKTON_COLOR;
+	const vector_3d up         = { 0.0f, 1.0f, 0.0f };
+	const GLfloat*  direction  = frame_snapshot->submarine_direction;
+
+	vector_3d side;
+	geometry_cross_product(direction, up, side);
+	if (geometry_is_zero_vector(side))
+	{
+		side[0] = 1.0f;
+	}
+	geometry_normalize_vector(side);
+
+	for (int i = 0; i < light_count; ++i)
+	{
+		point_light* light = &scene_lights[i];
+
+		if (i < LAMP_COUNT)
+		{
+			const GLfloat spread = i == 0 ? -LAMP_SPREAD : LAMP_SPREAD;
+			for (int k = 0; k < 3; ++k)
+			{
+				light->position[k] =
+					frame_snapshot->submarine_position[k] + direction[k] * LAMP_OFFSET + side[k] * spread;
+				light->light_color[k] = lamp_color[k];
+			}
+			light->radius = LAMP_RADIUS;
+		}
+		else if (i < LAMP_COUNT + BOID_COUNT)
+		{
+			for (int k = 0; k < 3; ++k)
+			{
+				light->position[k]    = frame_snapshot->boids[i - LAMP_COUNT].position[k];
+				light->light_color[k] = glow_color[k];
+			}
+			light->radius = BOID_GLOW_RADIUS;
+		}
+		else
+		{
+			// Every swarm pulses with its own phase between 20% and 100% brightness.
+			const GLfloat phase = 2.0f * PI * hash_light((unsigned)i, 3);
+			const GLfloat pulse = 0.6f + 0.4f * sinf((GLfloat)frame_snapshot->step * PLANKTON_PULSE_RATE + phase);
+			for (int k = 0; k < 3; ++k)
+			{
+				light->light_color[k] = plankton[k] * pulse;
+			}
+		}
+	}
+
+	light_clusters_set_projection(
+		(GLfloat)main_camera.fov,
+		width,
+		height,
+		(GLfloat)DEFAULT_CAMERA_NEAR_PLANE,
+		(GLfloat)DEFAULT_CAMERA_FAR_PLANE
+	);
+	light_clusters_assign(&light_grid, frame_list.view, scene_lights, light_count);
+	frame_list.lights = &light_grid;
+
+	current_frame_stats.point_lights         = light_grid.light_count;
+	current_frame_stats.light_cluster_refs   = light_grid.index_count;
+	current_frame_stats.light_assign_time_ms = timer_now_ms() - start_ms;
+}
+
+/**
+ * @brief Enables or disables the fog and sets its density.
+ *
+ * Under GL_EXP fog a color c becomes f * c + (1 - f) * fog_color with
+ * f = exp(-density * depth). The difference to the fog color is at most
+ * f, which rounds away at 8 bits once f < 1/510, so everything beyond
+ * ln(510) / density is hidden. The backend applies the fog with the
+ * next frame.
+ *
+ * @param enabled 1 to enable the fog, 0 to disable it.
+ * @param density Density of the GL_EXP fog.
+ */
+void renderer_set_fog(int enabled, GLfloat density)
+{
+	fog_on      = enabled;
+	fog_density = density;
+
+	fog_cutoff_depth = -logf(FOG_INVISIBLE_FACTOR) / fog_density;
+}
+
+/**
+ * @brief Records the full scene into the draw list and submits it to the backend.
+ *
+ * Moving objects are drawn as recorded in the snapshot, never from the
+ * live simulation state. Objects and boids outside the view frustum are
+ * skipped. State changes and draw calls of the backend are counted in
+ * the frame statistics, OpenGL calls per render pass by gl_trace. With
+ * dynamic resolution the frame is drawn at the current scale and
+ * upscaled into the window.
+ *
+ * @param snapshot Simulation state to draw, must stay unchanged until the call returns.
+ */
+void renderer_draw(const simulation_snapshot* snapshot)
+{
+	frame_snapshot = snapshot;
+
+	gl_trace_begin_frame();
+	dynamic_resolution_begin_frame(main_window.width, main_window.height);
+
+	gl_state_reset_stats();
+	current_frame_stats.draw_calls = 0;
+
+	dynamic_resolution_status resolution;
+	dynamic_resolution_get_status(&resolution);
+	current_frame_stats.resolution_width  = resolution.width;
+	current_frame_stats.resolution_height = resolution.height;
+
+	frame_list.snapshot              = snapshot;
+	frame_list.fog_enabled           = fog_on;
+	frame_list.fog_density           = fog_density;
+	frame_list.boid_pyramid          = boid_pyramid_vertices;
+	frame_list.item_count            = 0;
+	frame_list.boid_count            = 0;
+	frame_list.impostor_vertex_count = 0;
+	frame_list.debug                 = NULL;
+	calculate_camera_matrices(&frame_list);
+
+	cull_scene();
+	record_point_lights(resolution.width, resolution.height);
+
+	debug_draw_begin_frame();
+	record_origin();
+	record_environment();
+	record_water();
+	record_scene();
+	record_debug();
+
+	backends[renderer_backend]->submit(&frame_list);
+
+	dynamic_resolution_end_frame();
+
+	// Stream in texture levels requested while recording.
+	texture_streaming_update();
+
+	gl_state_stats stats;
+	gl_state_get_stats(&stats);
+	current_frame_stats.state_calls_issued  = stats.calls_issued;
+	current_frame_stats.state_calls_skipped = stats.calls_skipped;
+
+	gl_trace_end_frame();
+}
+
+/**
+ * @brief Shows the frame drawn last through the backend.
+ */
+void renderer_present(void)
+{
+	backends[renderer_backend]->present();
+}
+
+/**
+ * @brief Checks if a render path is supported by the current context.
+ *
+ * @param path The render path to check.
+ * @return int Returns 1 if the path can be used, 0 otherwise.
+ */
+int renderer_path_supported(render_path path)
+{
+	switch (path)
+	{
+	case RENDER_PATH_IMMEDIATE:
+	case RENDER_PATH_DISPLAY_LIST:
+		return 1;
+
+	case RENDER_PATH_VBO:
+		return gl_extensions.vertex_buffer_objects;
+
+	case RENDER_PATH_INSTANCED:
+		return gl_extensions.vertex_buffer_objects && instancing_supported();
+
+	default:
+		return 0;
+	}
+}
+
+/**
+ * @brief Returns a readable name of a render path.
+ *
+ * @param path The render path.
+ * @return const char* Name of the path.
+ */
+const char* renderer_path_name(render_path path)
+{
+	switch (path)
+	{
+	case RENDER_PATH_IMMEDIATE:
+		return "immediate";
+
+	case RENDER_PATH_DISPLAY_LIST:
+		return "display-list";
+
+	case RENDER_PATH_VBO:
+		return "vbo";
+
+	case RENDER_PATH_INSTANCED:
+		return "instanced";
+
+	default:
+		return "unknown";
+	}
+}
+
+/**
+ * @brief Returns a readable name of a render backend.
+ *
+ * @param backend The render backend.
+ * @return const char* Name of the backend.
+ */
+const char* renderer_backend_name(render_backend_type backend)
+{
+	if (backend < 0 || backend >= RENDER_BACKEND_COUNT)
+	{
+		return "unknown";
+	}
+	return backends[backend]->name;
+}
+
+/**
+ * @brief Returns a readable name of a draw order.
+ *
+ * @param order The draw order.
+ * @return const char* Name of the order.
+ */
+const char* renderer_draw_order_name(draw_order order)
+{
+	switch (order)
+	{
+	case DRAW_ORDER_STATE:
+		return "state";
+
+	case DRAW_ORDER_DEPTH:
+		return "depth";
+
+	default:
+		return "unknown";
+	}
+}
+
+/**
+ * @brief Returns a readable name of a render pass.
+ *
+ * @param pass The render pass.
+ * @return const char* Name of the pass.
+ */
+const char* renderer_pass_name(render_pass pass)
+{
+	switch (pass)
+	{
+	case RENDER_PASS_DEBUG:
+		return "debug";
+
+	case RENDER_PASS_ENVIRONMENT:
+		return "environment";
+
+	case RENDER_PASS_WATER:
+		return "water";
+
+	case RENDER_PASS_SUBMARINE:
+		return "submarine";
+
+	case RENDER_PASS_CORAL:
+		return "coral";
+
+	case RENDER_PASS_BOIDS:
+		return "boids";
+
+	case RENDER_PASS_OTHER:
+		return "other";
+
+	default:
+		return "unknown";
+	}
+}
+
+/**
+ * @brief Frees renderer resources.
+ */
+void renderer_clean_up(void)
+{
+	backends[renderer_backend]->clean_up();
+	worker_pool_destroy(&record_pool);
+	impostor_destroy_atlas(&impostor_atlas);
+
+	submarine_cleanup();
+	coral_cleanup();
+	texture_cleanup();
+
+	occlusion_cleanup();
+	dynamic_resolution_cleanup();
+
+	environment_cleanup();
 }
@@ -6,6 +6,8 @@
 
 #include "scene_object.h"
 
+#include <math.h>
+
 
  /**
   * @brief Frees memory associated with a scene object's mesh.
@@ -18,13 +20,18 @@
 void scene_object_cleanup(scene_object* object)
 {
     mesh_cleanup(&object->mesh);
+    for (int i = 0; i < MESH_LOD_COUNT - 1; ++i)
+    {
+        mesh_cleanup(&object->lods[i]);
+    }
 }
 
 /**
  * @brief Initializes a scene object using data from a .obj file.
  *
- * This sets up the mesh, position, direction, colors, and other
- * default values necessary for rendering or simulation.
+ * This loads and uploads the mesh and its simplified levels of detail,
+ * sets up the position, direction, colors, and other default values
+ * necessary for rendering or simulation.
  *
  * @param object Pointer to the scene object to initialize.
  * @param local_file_path Path to the local .obj file used to load mesh data.
@@ -32,6 +39,15 @@ void scene_object_cleanup(scene_object* object)
 void scene_object_initialize(scene_object* object, const char* local_file_path)
 {
     mesh_initialize(&object->mesh, local_file_path);
+    mesh_upload(&object->mesh);
+
+    int resolution = SCENE_OBJECT_LOD_RESOLUTION;
+    for (int i = 0; i < MESH_LOD_COUNT - 1; ++i)
+    {
+        mesh_simplify(&object->mesh, &object->lods[i], resolution);
+        mesh_upload(&object->lods[i]);
+        resolution /= 2;
+    }
 
     for (int i = 0; i < 4; ++i)
     {
@@ -51,3 +67,67 @@ void scene_object_initialize(scene_object* object, const char* local_file_path)
     object->scale = 1.0f;
     object->shine = 0.0f;
 }
+
+/**
+ * @brief Normalizes the direction a scene object faces.
+ *
+ * Objects without a facing, like the coral, keep the orientation
+ * of their model instead of a rotation by undefined angles.
+ *
+ * @param facing    Direction the object faces, not necessarily normalized.
+ * @param direction Output normalized direction.
+ */
+static void calculate_facing_direction(const vector_3d facing, vector_3d direction)
+{
+    direction[0] = facing[0];
+    direction[1] = facing[1];
+    direction[2] = facing[2];
+
+    if (geometry_is_zero_vector(direction))
+    {
+        direction[2] = 1.0f;
+        return;
+    }
+    geometry_normalize_vector(direction);
+}
+
+/**
+ * @brief Calculates the model matrix a scene object is drawn with.
+ *
+ * The yaw and pitch rotation is the basis of the facing direction,
+ * followed by the model rotation about the y axis and the scale.
+ *
+ * @param object   The scene object.
+ * @param position Position the object is drawn at.
+ * @param facing   Direction the object faces, not necessarily normalized.
+ * @param matrix   Output column-major model matrix.
+ */
+void scene_object_calculate_matrix(
+    const scene_object* object, 
+    const point_3d      position, 
+    const vector_3d     facing, 
+          GLfloat       matrix[16]
+)
+{
+    vector_3d forward;
+    vector_3d right;
+    vector_3d up;
+    calculate_facing_direction(facing, forward);
+    geometry_calculate_basis(forward, right, up);
+
+    const GLfloat angle     = geometry_degree_to_radian(object->rotation);
+    const GLfloat sin_angle = sinf(angle) * object->scale;
+    const GLfloat cos_angle = cosf(angle) * object->scale;
+
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        matrix[0 + axis]  = cos_angle * right[axis] - sin_angle * forward[axis];
+        matrix[4 + axis]  = object->scale * up[axis];
+        matrix[8 + axis]  = sin_angle * right[axis] + cos_angle * forward[axis];
+        matrix[12 + axis] = position[axis];
+    }
+    matrix[3]  = 0.0f;
+    matrix[7]  = 0.0f;
+    matrix[11] = 0.0f;
+    matrix[15] = 1.0f;
+}
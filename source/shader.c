@@ -0,0 +1,115 @@
+/**
+ * @file shader.c
+ * @brief Implements compiling and linking of GLSL shader programs.
+ */
+
+
+#include "shader.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+
+/**
+ * @brief Compiles a single shader stage.
+ *
+ * @param type   GL_VERTEX_SHADER or GL_FRAGMENT_SHADER.
+ * @param source GLSL source of the shader.
+ * @return GLuint The compiled shader, or 0 on failure.
+ */
+static GLuint compile_shader(GLenum type, const char* source)
+{
+    GLuint shader = glCreateShader(type);
+    glShaderSource(shader, 1, &source, NULL);
+    glCompileShader(shader);
+
+    GLint compiled = GL_FALSE;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
+    if (compiled)
+    {
+        return shader;
+    }
+
+    GLint log_length = 0;
+    glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &log_length);
+    gl_char* log = (gl_char*)malloc(log_length > 0 ? log_length : 1);
+    if (log != NULL)
+    {
+        log[0] = '\0';
+        glGetShaderInfoLog(shader, log_length, NULL, log);
+        printf(
+            "Failed to compile %s shader:\n%s\n",
+            type == GL_VERTEX_SHADER ? "vertex" : "fragment",
+            log
+        );
+        free(log);
+    }
+
+    glDeleteShader(shader);
+    return 0;
+}
+
+/**
+ * @brief Compiles a vertex and a fragment shader and links them into a program.
+ *
+ * @param vertex_source   GLSL source of the vertex shader.
+ * @param fragment_source GLSL source of the fragment shader.
+ * @param attributes      Attribute names in index order, or NULL.
+ * @param attribute_count Number of attribute names.
+ * @return GLuint The linked program, or 0 on failure.
+ */
+GLuint shader_create_program(
+    const char*        vertex_source,
+    const char*        fragment_source,
+    const char* const* attributes,
+    int                attribute_count
+)
+{
+    if (!gl_extensions.shaders)
+    {
+        return 0;
+    }
+
+    GLuint vertex_shader   = compile_shader(GL_VERTEX_SHADER, vertex_source);
+    GLuint fragment_shader = compile_shader(GL_FRAGMENT_SHADER, fragment_source);
+    if (vertex_shader == 0 || fragment_shader == 0)
+    {
+        if (vertex_shader != 0)   glDeleteShader(vertex_shader);
+        if (fragment_shader != 0) glDeleteShader(fragment_shader);
+        return 0;
+    }
+
+    GLuint program = glCreateProgram();
+    glAttachShader(program, vertex_shader);
+    glAttachShader(program, fragment_shader);
+    for (int i = 0; i < attribute_count; ++i)
+    {
+        glBindAttribLocation(program, (GLuint)i, attributes[i]);
+    }
+    glLinkProgram(program);
+
+    // The program keeps the shaders alive until it is deleted.
+    glDeleteShader(vertex_shader);
+    glDeleteShader(fragment_shader);
+
+    GLint linked = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    if (linked)
+    {
+        return program;
+    }
+
+    GLint log_length = 0;
+    glGetProgramiv(program, GL_INFO_LOG_LENGTH, &log_length);
+    gl_char* log = (gl_char*)malloc(log_length > 0 ? log_length : 1);
+    if (log != NULL)
+    {
+        log[0] = '\0';
+        glGetProgramInfoLog(program, log_length, NULL, log);
+        printf("Failed to link shader program:\n%s\n", log);
+        free(log);
+    }
+
+    glDeleteProgram(program);
+    return 0;
+}
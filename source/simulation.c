@@ -0,0 +1,270 @@
+/**
+ * @file simulation.c
+ * @brief Implements the fixed-step simulation and its snapshot triple buffer.
+ *
+ * Of the three snapshots one is written by the simulation, one is read
+ * by the renderer and one holds the latest complete step. Publishing and
+ * acquiring only swap indices with the ready snapshot under a lock, so
+ * neither side waits for the other to finish copying or drawing.
+ */
+
+
+#include "simulation.h"
+
+#include "benchmark.h"
+#include "camera.h"
+#include "submarine.h"
+#include "thread.h"
+#include "timer.h"
+
+#include <string.h>
+
+
+static simulation_snapshot snapshots[SIMULATION_SNAPSHOT_COUNT];  // triple buffer of published states
+
+static int write_index = 0;  // snapshot being filled, owned by the stepping thread
+static int ready_index = 1;  // latest complete snapshot, not owned by either side
+static int read_index  = 2;  // snapshot being drawn, owned by the rendering thread
+static int ready_fresh = 0;  // 1 if the ready snapshot was not acquired yet
+
+static unsigned step_count = 0;  // steps taken since initialization
+
+static thread_mutex  state_mutex;         // guards the simulated scene state
+static thread_mutex  swap_mutex;          // guards the snapshot indices and the stop request
+static thread_handle simulation_thread;   // thread stepping the simulation, valid while running
+static int           thread_running = 0;  // 1 while simulation_thread runs
+static int           stop_requested = 0;  // 1 once the thread was asked to return
+static int           initialized    = 0;  // 1 once the mutexes were initialized
+
+
+/**
+ * @brief Copies the current scene state into a snapshot.
+ *
+ * Also calculates the model matrix of the submarine and the orientation
+ * bases of all boids in one batch, so frames repeating the snapshot do
+ * not calculate them again.
+ *
+ * @param snapshot The snapshot to fill.
+ */
+static void capture_snapshot(simulation_snapshot* snapshot)
+{
+    snapshot->step = step_count;
+
+    memcpy(snapshot->submarine_position,  object_submarine.position,  sizeof(point_3d));
+    memcpy(snapshot->submarine_direction, object_submarine.direction, sizeof(vector_3d));
+    memcpy(snapshot->camera_position,     main_camera.position,       sizeof(point_3d));
+    memcpy(snapshot->camera_look_at,      main_camera.look_at,        sizeof(point_3d));
+
+    memcpy(snapshot->boids,          array_boids_current, sizeof(snapshot->boids));
+    memcpy(snapshot->water_vertices, water_vertices,      sizeof(snapshot->water_vertices));
+    memcpy(snapshot->water_normals,  water_normals,       sizeof(snapshot->water_normals));
+
+    scene_object_calculate_matrix(
+        &object_submarine,
+        snapshot->submarine_position,
+        snapshot->submarine_direction,
+        snapshot->submarine_model
+    );
+    geometry_calculate_bases(
+        snapshot->boids[0].direction,
+        (int)(sizeof(boid) / sizeof(GLfloat)),
+        BOID_COUNT,
+        snapshot->boid_right,
+        snapshot->boid_up
+    );
+}
+
+/**
+ * @brief Makes the written snapshot the ready one.
+ *
+ * The previous ready snapshot, if never acquired, is overwritten next.
+ */
+static void publish_snapshot(void)
+{
+    thread_mutex_lock(&swap_mutex);
+
+    const int published = write_index;
+    write_index = ready_index;
+    ready_index = published;
+    ready_fresh = 1;
+
+    thread_mutex_unlock(&swap_mutex);
+}
+
+/**
+ * @brief Checks if the simulation thread was asked to return.
+ */
+static int is_stop_requested(void)
+{
+    thread_mutex_lock(&swap_mutex);
+    const int stop = stop_requested;
+    thread_mutex_unlock(&swap_mutex);
+
+    return stop;
+}
+
+/**
+ * @brief Steps the simulation in real time until asked to stop.
+ *
+ * Steps are scheduled on the monotonic clock and the thread sleeps until
+ * the next one is due. A thread that falls far behind, for example after
+ * the process was suspended, skips the missed steps instead of running
+ * them all at once.
+ */
+static void run_simulation(void* argument)
+{
+    (void)argument;
+
+    double next_step_ms = timer_now_ms();
+    while (!is_stop_requested())
+    {
+        simulation_step();
+        next_step_ms += SIMULATION_STEP_MS;
+
+        const double now_ms = timer_now_ms();
+        if (now_ms - next_step_ms > SIMULATION_MAX_LAG_MS)
+        {
+            next_step_ms = now_ms;
+        }
+        timer_sleep_until_ms(next_step_ms);
+    }
+}
+
+/**
+ * @brief Prepares the snapshot buffers and publishes the initial state.
+ */
+void simulation_initialize(void)
+{
+    if (!initialized)
+    {
+        thread_mutex_initialize(&state_mutex);
+        thread_mutex_initialize(&swap_mutex);
+        initialized = 1;
+    }
+
+    step_count = 0;
+    capture_snapshot(&snapshots[write_index]);
+    publish_snapshot();
+}
+
+/**
+ * @brief Advances the simulation by one step and publishes a snapshot.
+ *
+ * The water is driven by the simulated time, so every run with the same
+ * input produces the same states regardless of the frame rate. A
+ * benchmark path replaces the input that moves the submarine and camera.
+ */
+void simulation_step(void)
+{
+    thread_mutex_lock(&state_mutex);
+
+    ++step_count;
+    water_update((GLfloat)(step_count * SIMULATION_STEP_MS));
+    if (benchmark_active())
+    {
+        benchmark_drive(step_count);
+    }
+    submarine_update();
+    camera_update();
+    boids_update();
+
+    capture_snapshot(&snapshots[write_index]);
+
+    thread_mutex_unlock(&state_mutex);
+
+    publish_snapshot();
+}
+
+/**
+ * @brief Starts stepping the simulation on its own thread in real time.
+ *
+ * @return int Returns 1 if the thread was started, 0 otherwise.
+ */
+int simulation_start_thread(void)
+{
+    if (thread_running)
+    {
+        return 1;
+    }
+
+    stop_requested = 0;
+    thread_running = thread_create(&simulation_thread, run_simulation, NULL);
+    return thread_running;
+}
+
+/**
+ * @brief Checks if the simulation is stepped by its own thread.
+ *
+ * @return int Returns 1 if the thread is running, 0 otherwise.
+ */
+int simulation_thread_running(void)
+{
+    return thread_running;
+}
+
+/**
+ * @brief Returns the latest complete snapshot.
+ *
+ * Swaps the read snapshot with the ready one if a newer step was
+ * published since the last call, otherwise keeps the current one.
+ *
+ * @return const simulation_snapshot* The latest published snapshot.
+ */
+const simulation_snapshot* simulation_acquire_snapshot(void)
+{
+    thread_mutex_lock(&swap_mutex);
+
+    if (ready_fresh)
+    {
+        const int acquired = ready_index;
+        ready_index = read_index;
+        read_index  = acquired;
+        ready_fresh = 0;
+    }
+    const int index = read_index;
+
+    thread_mutex_unlock(&swap_mutex);
+
+    return &snapshots[index];
+}
+
+/**
+ * @brief Locks the simulation state against concurrent steps.
+ */
+void simulation_lock(void)
+{
+    thread_mutex_lock(&state_mutex);
+}
+
+/**
+ * @brief Unlocks the simulation state.
+ */
+void simulation_unlock(void)
+{
+    thread_mutex_unlock(&state_mutex);
+}
+
+/**
+ * @brief Stops the simulation thread if running and frees its resources.
+ */
+void simulation_clean_up(void)
+{
+    if (!initialized)
+    {
+        return;
+    }
+
+    if (thread_running)
+    {
+        thread_mutex_lock(&swap_mutex);
+        stop_requested = 1;
+        thread_mutex_unlock(&swap_mutex);
+
+        thread_join(&simulation_thread);
+        thread_running = 0;
+    }
+
+    thread_mutex_destroy(&swap_mutex);
+    thread_mutex_destroy(&state_mutex);
+    initialized = 0;
+}
@@ -0,0 +1,1054 @@
+/**
+ * @file software_raster.c
+ * @brief Implements the tile rasterizer.
+ */
+
+
+#include "software_raster.h"
+
+#include "worker_pool.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SOFTWARE_RASTER_SSE 1
+#include <emmintrin.h>
+#else
+#define SOFTWARE_RASTER_SSE 0
+#endif
+
+
+#define CLIP_PLANE_COUNT    6                                 // near, far and the four guard band planes
+#define CLIP_VERTEX_COUNT   (3 + CLIP_PLANE_COUNT)            // corners of a clipped triangle at most
+#define SUBPIXEL_HALF       (SOFTWARE_RASTER_SUBPIXELS / 2)   // offset of a pixel center in subpixels
+#define INITIAL_TRIANGLES   4096                              // triangles allocated for the first frame
+#define INITIAL_BIN_ENTRIES 256                               // entries allocated for a tile at first
+#define CLEAR_DEPTH         1.0f                              // depth of pixels nothing was drawn on
+
+
+// Values interpolated across a triangle. All but the depth are divided
+// by w, so they can be interpolated linearly in screen space.
+enum {
+    PLANE_DEPTH,
+    PLANE_INVERSE_W,
+    PLANE_RED,
+    PLANE_GREEN,
+    PLANE_BLUE,
+    PLANE_ALPHA,
+    PLANE_S,
+    PLANE_T,
+    PLANE_FOG,
+    PLANE_COUNT
+};
+
+/**
+ * @brief A vertex projected to the window and snapped to subpixels.
+ */
+typedef struct {
+    int     x;                    // horizontal position in subpixels
+    int     y;                    // vertical position in subpixels, up from the bottom row
+    GLfloat values[PLANE_COUNT];  // interpolated values, see the plane enum
+} screen_vertex;
+
+/**
+ * @brief A triangle set up for drawing.
+ *
+ * The edge function of edge i is edge_x[i] * x + edge_y[i] * y + edge_0[i]
+ * for a pixel center at subpixel position { x, y }. It is not negative
+ * inside the triangle, the fill rule is folded into edge_0.
+ */
+typedef struct {
+    int          bounds[4];               // { min x, min y, max x, max y } of the covered pixels, max exclusive
+    int          edge_x[3];               // change of each edge function per subpixel along x
+    int          edge_y[3];               // change of each edge function per subpixel along y
+    long long    edge_0[3];               // value of each edge function at the subpixel origin
+    GLfloat      origin[2];               // pixel position the planes are relative to
+    GLfloat      planes[PLANE_COUNT][3];  // { value at origin, change per pixel along x, along y }
+    raster_state state;                   // texture and cutout
+} raster_triangle;
+
+/**
+ * @brief Triangles touching a tile, in the order they were added.
+ */
+typedef struct {
+    int* entries;    // indices into triangles
+    int  count;      // used entries
+    int  capacity;   // entries allocated
+    int  fragments;  // fragments shaded when the tile was drawn
+} raster_bin;
+
+
+// Clip planes as { x, y, z, w } factors, a vertex is inside where the dot product is not negative.
+static const GLfloat clip_planes[CLIP_PLANE_COUNT][4] = {
+    {  0.0f,  0.0f,  1.0f, 1.0f                       },
+    {  0.0f,  0.0f, -1.0f, 1.0f                       },
+    { -1.0f,  0.0f,  0.0f, SOFTWARE_RASTER_GUARD_BAND },
+    {  1.0f,  0.0f,  0.0f, SOFTWARE_RASTER_GUARD_BAND },
+    {  0.0f, -1.0f,  0.0f, SOFTWARE_RASTER_GUARD_BAND },
+    {  0.0f,  1.0f,  0.0f, SOFTWARE_RASTER_GUARD_BAND }
+};
+
+// The same planes at the edges of the viewport, triangles outside one of them are not drawn.
+static const GLfloat view_planes[CLIP_PLANE_COUNT][4] = {
+    {  0.0f,  0.0f,  1.0f, 1.0f },
+    {  0.0f,  0.0f, -1.0f, 1.0f },
+    { -1.0f,  0.0f,  0.0f, 1.0f },
+    {  1.0f,  0.0f,  0.0f, 1.0f },
+    {  0.0f, -1.0f,  0.0f, 1.0f },
+    {  0.0f,  1.0f,  0.0f, 1.0f }
+};
+
+static worker_pool pool;              // threads drawing tiles besides the calling thread
+static int         thread_total = 1;  // threads drawing tiles, the calling thread included
+
+static int      frame_width     = 0;     // width of the buffers in pixels
+static int      frame_height    = 0;     // height of the buffers in pixels
+static int      frame_ready     = 0;     // 1 while the buffers of the frame are allocated
+static GLubyte* color_buffer    = NULL;  // RGBA pixels row by row from the bottom row
+static GLfloat* depth_buffer    = NULL;  // depth of every pixel, four spare entries for the last group of pixels
+static GLfloat  frame_fog       = 0.0f;  // density of the fog, 0 for none
+static color    frame_fog_color;         // color the fog fades to
+
+static raster_triangle* triangles         = NULL;  // triangles of the frame
+static int              triangle_count    = 0;     // used entries of triangles
+static int              triangle_capacity = 0;     // entries allocated for triangles
+
+static raster_bin* bins         = NULL;  // triangle lists of the tiles, row by row from the bottom
+static int         tiles_x      = 0;     // tiles across the frame
+static int         tiles_y      = 0;     // tiles up the frame
+static int         bin_capacity = 0;     // bins allocated
+
+
+/**
+ * @brief Divides rounding towards negative infinity.
+ *
+ * @param value   Dividend.
+ * @param divisor Positive divisor.
+ * @return int The quotient.
+ */
+static int floor_divide(int value, int divisor)
+{
+    const int quotient = value / divisor;
+    return (value % divisor != 0 && value < 0) ? quotient - 1 : quotient;
+}
+
+/**
+ * @brief Wraps a texel coordinate into a texture like GL_REPEAT.
+ *
+ * @param coordinate Texel coordinate.
+ * @param size       Texels along the axis.
+ * @return int Coordinate between 0 and size - 1.
+ */
+static int wrap_texel(int coordinate, int size)
+{
+    const int wrapped = coordinate % size;
+    return wrapped < 0 ? wrapped + size : wrapped;
+}
+
+/**
+ * @brief Measures how far a vertex lies inside a plane.
+ *
+ * @param plane  Plane as { x, y, z, w } factors.
+ * @param vertex The vertex.
+ * @return GLfloat Signed distance, negative outside.
+ */
+static GLfloat plane_distance(const GLfloat plane[4], const raster_vertex* vertex)
+{
+    return plane[0] * vertex->position[0] +
+           plane[1] * vertex->position[1] +
+           plane[2] * vertex->position[2] +
+           plane[3] * vertex->position[3];
+}
+
+/**
+ * @brief Interpolates every value of two vertices.
+ *
+ * @param from   Vertex at amount 0.
+ * @param to     Vertex at amount 1.
+ * @param amount Position between the vertices.
+ * @param result Output vertex.
+ */
+static void mix_vertices(const raster_vertex* from, const raster_vertex* to, GLfloat amount, raster_vertex* result)
+{
+    for (int i = 0; i < 4; ++i)
+    {
+        result->position[i] = from->position[i] + (to->position[i] - from->position[i]) * amount;
+        result->color[i]    = from->color[i]    + (to->color[i]    - from->color[i])    * amount;
+    }
+    for (int i = 0; i < 2; ++i)
+    {
+        result->texcoord[i] = from->texcoord[i] + (to->texcoord[i] - from->texcoord[i]) * amount;
+    }
+    result->fog = from->fog + (to->fog - from->fog) * amount;
+}
+
+/**
+ * @brief Clips a convex polygon against all clip planes.
+ *
+ * New corners are always interpolated from the inside corner, so an
+ * edge shared by two polygons is cut at the same point in both.
+ *
+ * @param polygon Corners, replaced by the clipped corners.
+ * @param count   Number of corners.
+ * @return int Number of corners left, below 3 if nothing is left.
+ */
+static int clip_polygon(raster_vertex polygon[CLIP_VERTEX_COUNT], int count)
+{
+    raster_vertex clipped[CLIP_VERTEX_COUNT];
+
+    for (int plane = 0; plane < CLIP_PLANE_COUNT && count >= 3; ++plane)
+    {
+        GLfloat distances[CLIP_VERTEX_COUNT];
+        int     outside = 0;
+        for (int i = 0; i < count; ++i)
+        {
+            distances[i] = plane_distance(clip_planes[plane], &polygon[i]);
+            outside     += distances[i] < 0.0f;
+        }
+        if (outside == 0)
+        {
+            continue;
+        }
+
+        int clipped_count = 0;
+        for (int i = 0; i < count; ++i)
+        {
+            const int     next          = (i + 1) % count;
+            const GLfloat distance      = distances[i];
+            const GLfloat next_distance = distances[next];
+
+            if (distance >= 0.0f)
+            {
+                clipped[clipped_count++] = polygon[i];
+            }
+            if ((distance >= 0.0f) != (next_distance >= 0.0f))
+            {
+                const int     inside   = distance >= 0.0f ? i : next;
+                const int     beyond   = distance >= 0.0f ? next : i;
+                const GLfloat amount   = distances[inside] / (distances[inside] - distances[beyond]);
+                mix_vertices(&polygon[inside], &polygon[beyond], amount, &clipped[clipped_count++]);
+            }
+        }
+
+        memcpy(polygon, clipped, (size_t)clipped_count * sizeof(raster_vertex));
+        count = clipped_count;
+    }
+
+    return count;
+}
+
+/**
+ * @brief Projects a clipped vertex to the window and snaps it to subpixels.
+ *
+ * @param vertex   Vertex in front of the near plane.
+ * @param offset_x Pixels added to the window position along x.
+ * @param offset_y Pixels added to the window position along y.
+ * @param screen   Output screen vertex.
+ */
+static void project_vertex(const raster_vertex* vertex, GLfloat offset_x, GLfloat offset_y, screen_vertex* screen)
+{
+    const GLfloat inverse_w = 1.0f / vertex->position[3];
+    const GLfloat x = (vertex->position[0] * inverse_w * 0.5f + 0.5f) * (GLfloat)frame_width  + offset_x;
+    const GLfloat y = (vertex->position[1] * inverse_w * 0.5f + 0.5f) * (GLfloat)frame_height + offset_y;
+
+    screen->x = (int)floorf(x * SOFTWARE_RASTER_SUBPIXELS + 0.5f);
+    screen->y = (int)floorf(y * SOFTWARE_RASTER_SUBPIXELS + 0.5f);
+
+    screen->values[PLANE_DEPTH]     = vertex->position[2] * inverse_w * 0.5f + 0.5f;
+    screen->values[PLANE_INVERSE_W] = inverse_w;
+    screen->values[PLANE_RED]       = vertex->color[0] * inverse_w;
+    screen->values[PLANE_GREEN]     = vertex->color[1] * inverse_w;
+    screen->values[PLANE_BLUE]      = vertex->color[2] * inverse_w;
+    screen->values[PLANE_ALPHA]     = vertex->color[3] * inverse_w;
+    screen->values[PLANE_S]         = vertex->texcoord[0] * inverse_w;
+    screen->values[PLANE_T]         = vertex->texcoord[1] * inverse_w;
+    screen->values[PLANE_FOG]       = vertex->fog * inverse_w;
+}
+
+/**
+ * @brief Adds a triangle to the list of a tile.
+ *
+ * @param bin      The list of the tile.
+ * @param triangle Index of the triangle.
+ */
+static void add_bin_entry(raster_bin* bin, int triangle)
+{
+    if (bin->count == bin->capacity)
+    {
+        const int capacity = bin->capacity > 0 ? bin->capacity * 2 : INITIAL_BIN_ENTRIES;
+        int*      entries  = (int*)realloc(bin->entries, (size_t)capacity * sizeof(int));
+        if (entries == NULL)
+        {
+            return;
+        }
+        bin->entries  = entries;
+        bin->capacity = capacity;
+    }
+
+    bin->entries[bin->count++] = triangle;
+}
+
+/**
+ * @brief Sets up the edge functions and planes of a triangle and bins it.
+ *
+ * @param v0    First corner.
+ * @param v1    Second corner.
+ * @param v2    Third corner.
+ * @param state Texture and cutout of the triangle.
+ */
+static void setup_triangle(
+    const screen_vertex* v0,
+    const screen_vertex* v1,
+    const screen_vertex* v2,
+    const raster_state*  state
+)
+{
+    long long area = (long long)(v1->x - v0->x) * (v2->y - v0->y) -
+                     (long long)(v1->y - v0->y) * (v2->x - v0->x);
+    if (area == 0)
+    {
+        return;
+    }
+    if (area < 0)
+    {
+        // Clockwise, swap two corners so the inside is positive.
+        const screen_vertex* swap = v1;
+        v1   = v2;
+        v2   = swap;
+        area = -area;
+    }
+
+    // Pixels whose centers fall into the bounds of the triangle, clamped to the frame.
+    const int min_subpixel_x = v0->x < v1->x ? (v0->x < v2->x ? v0->x : v2->x) : (v1->x < v2->x ? v1->x : v2->x);
+    const int max_subpixel_x = v0->x > v1->x ? (v0->x > v2->x ? v0->x : v2->x) : (v1->x > v2->x ? v1->x : v2->x);
+    const int min_subpixel_y = v0->y < v1->y ? (v0->y < v2->y ? v0->y : v2->y) : (v1->y < v2->y ? v1->y : v2->y);
+    const int max_subpixel_y = v0->y > v1->y ? (v0->y > v2->y ? v0->y : v2->y) : (v1->y > v2->y ? v1->y : v2->y);
+    int min_x = -floor_divide(SUBPIXEL_HALF - min_subpixel_x, SOFTWARE_RASTER_SUBPIXELS);
+    int min_y = -floor_divide(SUBPIXEL_HALF - min_subpixel_y, SOFTWARE_RASTER_SUBPIXELS);
+    int max_x = floor_divide(max_subpixel_x - SUBPIXEL_HALF, SOFTWARE_RASTER_SUBPIXELS) + 1;
+    int max_y = floor_divide(max_subpixel_y - SUBPIXEL_HALF, SOFTWARE_RASTER_SUBPIXELS) + 1;
+    if (min_x < 0)            min_x = 0;
+    if (min_y < 0)            min_y = 0;
+    if (max_x > frame_width)  max_x = frame_width;
+    if (max_y > frame_height) max_y = frame_height;
+    if (min_x >= max_x || min_y >= max_y)
+    {
+        return;
+    }
+
+    if (triangle_count == triangle_capacity)
+    {
+        const int        capacity = triangle_capacity > 0 ? triangle_capacity * 2 : INITIAL_TRIANGLES;
+        raster_triangle* grown    = (raster_triangle*)realloc(triangles, (size_t)capacity * sizeof(raster_triangle));
+        if (grown == NULL)
+        {
+            return;
+        }
+        triangles         = grown;
+        triangle_capacity = capacity;
+    }
+
+    raster_triangle* triangle = &triangles[triangle_count];
+    triangle->bounds[0] = min_x;
+    triangle->bounds[1] = min_y;
+    triangle->bounds[2] = max_x;
+    triangle->bounds[3] = max_y;
+    triangle->state     = *state;
+
+    // Edge function of the edge from a to b, positive on the side of the
+    // third corner. Pixel centers exactly on an edge belong to the
+    // triangle only if the edge is a left or bottom edge, so of two
+    // triangles sharing the edge exactly one covers them.
+    const screen_vertex* corners[3] = { v0, v1, v2 };
+    for (int i = 0; i < 3; ++i)
+    {
+        const screen_vertex* a = corners[i];
+        const screen_vertex* b = corners[(i + 1) % 3];
+        triangle->edge_x[i] = a->y - b->y;
+        triangle->edge_y[i] = b->x - a->x;
+        triangle->edge_0[i] = -((long long)triangle->edge_x[i] * a->x + (long long)triangle->edge_y[i] * a->y);
+
+        const int owns_edge = triangle->edge_x[i] > 0 || (triangle->edge_x[i] == 0 && triangle->edge_y[i] < 0);
+        if (!owns_edge)
+        {
+            triangle->edge_0[i] -= 1;
+        }
+    }
+
+    // Every value is a plane v = v0 + vx * (x - x0) + vy * (y - y0) through the first corner.
+    const GLfloat inverse_subpixels = 1.0f / SOFTWARE_RASTER_SUBPIXELS;
+    const GLfloat dx1 = (GLfloat)(v1->x - v0->x) * inverse_subpixels;
+    const GLfloat dy1 = (GLfloat)(v1->y - v0->y) * inverse_subpixels;
+    const GLfloat dx2 = (GLfloat)(v2->x - v0->x) * inverse_subpixels;
+    const GLfloat dy2 = (GLfloat)(v2->y - v0->y) * inverse_subpixels;
+    const GLfloat inverse_area = 1.0f / (dx1 * dy2 - dx2 * dy1);
+
+    triangle->origin[0] = (GLfloat)v0->x * inverse_subpixels;
+    triangle->origin[1] = (GLfloat)v0->y * inverse_subpixels;
+    for (int plane = 0; plane < PLANE_COUNT; ++plane)
+    {
+        const GLfloat d1 = v1->values[plane] - v0->values[plane];
+        const GLfloat d2 = v2->values[plane] - v0->values[plane];
+        triangle->planes[plane][0] = v0->values[plane];
+        triangle->planes[plane][1] = (d1 * dy2 - d2 * dy1) * inverse_area;
+        triangle->planes[plane][2] = (d2 * dx1 - d1 * dx2) * inverse_area;
+    }
+
+    for (int tile_y = min_y / SOFTWARE_RASTER_TILE_SIZE; tile_y <= (max_y - 1) / SOFTWARE_RASTER_TILE_SIZE; ++tile_y)
+    {
+        for (int tile_x = min_x / SOFTWARE_RASTER_TILE_SIZE; tile_x <= (max_x - 1) / SOFTWARE_RASTER_TILE_SIZE; ++tile_x)
+        {
+            add_bin_entry(&bins[tile_y * tiles_x + tile_x], triangle_count);
+        }
+    }
+    ++triangle_count;
+}
+
+/**
+ * @brief Samples one mip level bilinearly.
+ *
+ * @param texture The texture.
+ * @param level   The level.
+ * @param s       Horizontal texture coordinate.
+ * @param t       Vertical texture coordinate.
+ * @param texel   Output color { r, g, b, a } between 0 and 1.
+ */
+static void sample_level(const raster_texture* texture, int level, GLfloat s, GLfloat t, GLfloat texel[4])
+{
+    const int      width    = texture->widths[level];
+    const int      height   = texture->heights[level];
+    const int      channels = texture->channels;
+    const GLubyte* texels   = texture->levels[level];
+
+    const GLfloat u       = s * (GLfloat)width  - 0.5f;
+    const GLfloat v       = t * (GLfloat)height - 0.5f;
+    const GLfloat u_floor = floorf(u);
+    const GLfloat v_floor = floorf(v);
+    const GLfloat u_part  = u - u_floor;
+    const GLfloat v_part  = v - v_floor;
+
+    const int x0 = wrap_texel((int)u_floor, width);
+    const int y0 = wrap_texel((int)v_floor, height);
+    const int x1 = x0 + 1 < width  ? x0 + 1 : 0;
+    const int y1 = y0 + 1 < height ? y0 + 1 : 0;
+
+    const GLubyte* t00 = texels + ((size_t)y0 * width + x0) * channels;
+    const GLubyte* t10 = texels + ((size_t)y0 * width + x1) * channels;
+    const GLubyte* t01 = texels + ((size_t)y1 * width + x0) * channels;
+    const GLubyte* t11 = texels + ((size_t)y1 * width + x1) * channels;
+
+    texel[3] = 1.0f;
+    for (int c = 0; c < channels; ++c)
+    {
+        const GLfloat bottom = (GLfloat)t00[c] + ((GLfloat)t10[c] - (GLfloat)t00[c]) * u_part;
+        const GLfloat top    = (GLfloat)t01[c] + ((GLfloat)t11[c] - (GLfloat)t01[c]) * u_part;
+        texel[c] = (bottom + (top - bottom) * v_part) * (1.0f / 255.0f);
+    }
+}
+
+/**
+ * @brief Samples a texture like GL_LINEAR_MIPMAP_LINEAR, or GL_LINEAR without mip levels.
+ *
+ * @param texture     The texture.
+ * @param s           Horizontal texture coordinate.
+ * @param t           Vertical texture coordinate.
+ * @param derivatives Changes of { s, t } per pixel along x and along y.
+ * @param texel       Output color { r, g, b, a } between 0 and 1.
+ */
+static void sample_texture(const raster_texture* texture, GLfloat s, GLfloat t, const GLfloat derivatives[4], GLfloat texel[4])
+{
+    if (texture->level_count == 1)
+    {
+        sample_level(texture, 0, s, t, texel);
+        return;
+    }
+
+    // Level of detail from the larger footprint of a pixel in base level texels.
+    const GLfloat width     = (GLfloat)texture->widths[0];
+    const GLfloat height    = (GLfloat)texture->heights[0];
+    const GLfloat along_x   = sqrtf(
+        derivatives[0] * derivatives[0] * width * width + derivatives[1] * derivatives[1] * height * height
+    );
+    const GLfloat along_y   = sqrtf(
+        derivatives[2] * derivatives[2] * width * width + derivatives[3] * derivatives[3] * height * height
+    );
+    const GLfloat footprint = along_x > along_y ? along_x : along_y;
+    const GLfloat lod       = footprint > 1.0f ? log2f(footprint) : 0.0f;
+
+    const int finest = (int)lod;
+    if (lod <= 0.0f || finest >= texture->level_count - 1)
+    {
+        sample_level(texture, lod <= 0.0f ? 0 : texture->level_count - 1, s, t, texel);
+        return;
+    }
+
+    GLfloat coarse[4];
+    sample_level(texture, finest, s, t, texel);
+    sample_level(texture, finest + 1, s, t, coarse);
+
+    const GLfloat blend = lod - (GLfloat)finest;
+    for (int c = 0; c < 4; ++c)
+    {
+        texel[c] += (coarse[c] - texel[c]) * blend;
+    }
+}
+
+/**
+ * @brief Shades a fragment that passed the depth test and blends it into its pixel.
+ *
+ * @param triangle The triangle.
+ * @param x        Column of the pixel.
+ * @param y        Row of the pixel.
+ * @param depth    Depth of the fragment.
+ * @param pixel    RGBA color of the pixel.
+ * @param stored   Depth of the pixel.
+ */
+static void shade_fragment(
+    const raster_triangle* triangle,
+          int              x,
+          int              y,
+          GLfloat          depth,
+          GLubyte*         pixel,
+          GLfloat*         stored
+)
+{
+    const GLfloat dx = ((GLfloat)x + 0.5f) - triangle->origin[0];
+    const GLfloat dy = ((GLfloat)y + 0.5f) - triangle->origin[1];
+
+    GLfloat values[PLANE_COUNT];
+    for (int plane = PLANE_INVERSE_W; plane < PLANE_COUNT; ++plane)
+    {
+        values[plane] = triangle->planes[plane][0] + triangle->planes[plane][1] * dx + triangle->planes[plane][2] * dy;
+    }
+    const GLfloat w = 1.0f / values[PLANE_INVERSE_W];
+
+    GLfloat fragment[4] = {
+        values[PLANE_RED]   * w,
+        values[PLANE_GREEN] * w,
+        values[PLANE_BLUE]  * w,
+        values[PLANE_ALPHA] * w
+    };
+
+    const raster_texture* texture = triangle->state.texture;
+    if (texture != NULL)
+    {
+        // Derivatives of s = S / Q along an axis are (dS - s dQ) / Q.
+        const GLfloat s = values[PLANE_S] * w;
+        const GLfloat t = values[PLANE_T] * w;
+        const GLfloat derivatives[4] = {
+            (triangle->planes[PLANE_S][1] - s * triangle->planes[PLANE_INVERSE_W][1]) * w,
+            (triangle->planes[PLANE_T][1] - t * triangle->planes[PLANE_INVERSE_W][1]) * w,
+            (triangle->planes[PLANE_S][2] - s * triangle->planes[PLANE_INVERSE_W][2]) * w,
+            (triangle->planes[PLANE_T][2] - t * triangle->planes[PLANE_INVERSE_W][2]) * w
+        };
+
+        GLfloat texel[4];
+        sample_texture(texture, s, t, derivatives, texel);
+        for (int c = 0; c < 4; ++c)
+        {
+            fragment[c] *= texel[c];
+        }
+    }
+
+    if (fragment[3] <= triangle->state.cutout)
+    {
+        return;
+    }
+
+    if (frame_fog > 0.0f)
+    {
+        GLfloat factor = expf(-frame_fog * values[PLANE_FOG] * w);
+        factor = factor < 0.0f ? 0.0f : (factor > 1.0f ? 1.0f : factor);
+        for (int c = 0; c < 3; ++c)
+        {
+            fragment[c] = frame_fog_color[c] * (1.0f - factor) + fragment[c] * factor;
+        }
+    }
+
+    // Blended like glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA).
+    GLfloat alpha = fragment[3];
+    alpha = alpha < 0.0f ? 0.0f : (alpha > 1.0f ? 1.0f : alpha);
+    for (int c = 0; c < 4; ++c)
+    {
+        GLfloat value = fragment[c] < 0.0f ? 0.0f : (fragment[c] > 1.0f ? 1.0f : fragment[c]);
+        value = value * alpha + (GLfloat)pixel[c] * (1.0f / 255.0f) * (1.0f - alpha);
+        pixel[c] = (GLubyte)(value * 255.0f + 0.5f);
+    }
+    *stored = depth;
+}
+
+/**
+ * @brief Draws the part of a triangle inside a tile.
+ *
+ * The edge functions are evaluated in 64 bits at the first pixel. An
+ * edge that covers the whole tile is left out, any other edge changes
+ * by less than 2^31 across the tile, so the pixels are stepped in 32
+ * bits, four at a time with SSE2.
+ *
+ * @param triangle The triangle.
+ * @param tile     Pixels of the tile { min x, min y, max x, max y }, max exclusive.
+ * @return int Number of fragments shaded.
+ */
+static int draw_triangle(const raster_triangle* triangle, const int tile[4])
+{
+    const int min_x = triangle->bounds[0] > tile[0] ? triangle->bounds[0] : tile[0];
+    const int min_y = triangle->bounds[1] > tile[1] ? triangle->bounds[1] : tile[1];
+    const int max_x = triangle->bounds[2] < tile[2] ? triangle->bounds[2] : tile[2];
+    const int max_y = triangle->bounds[3] < tile[3] ? triangle->bounds[3] : tile[3];
+    if (min_x >= max_x || min_y >= max_y)
+    {
+        return 0;
+    }
+
+    int edge_row[3];
+    int step_x[3];
+    int step_y[3];
+    for (int i = 0; i < 3; ++i)
+    {
+        const long long value = (long long)triangle->edge_x[i] * (min_x * SOFTWARE_RASTER_SUBPIXELS + SUBPIXEL_HALF) +
+                                (long long)triangle->edge_y[i] * (min_y * SOFTWARE_RASTER_SUBPIXELS + SUBPIXEL_HALF) +
+                                triangle->edge_0[i];
+        const long long span_x = (long long)triangle->edge_x[i] * SOFTWARE_RASTER_SUBPIXELS * (max_x - 1 - min_x);
+        const long long span_y = (long long)triangle->edge_y[i] * SOFTWARE_RASTER_SUBPIXELS * (max_y - 1 - min_y);
+        const long long lowest  = value + (span_x < 0 ? span_x : 0) + (span_y < 0 ? span_y : 0);
+        const long long highest = value + (span_x > 0 ? span_x : 0) + (span_y > 0 ? span_y : 0);
+        if (highest < 0)
+        {
+            return 0;
+        }
+        if (lowest >= 0)
+        {
+            edge_row[i] = 0;
+            step_x[i]   = 0;
+            step_y[i]   = 0;
+            continue;
+        }
+        edge_row[i] = (int)value;
+        step_x[i]   = triangle->edge_x[i] * SOFTWARE_RASTER_SUBPIXELS;
+        step_y[i]   = triangle->edge_y[i] * SOFTWARE_RASTER_SUBPIXELS;
+    }
+
+    const GLfloat* depth_plane = triangle->planes[PLANE_DEPTH];
+    int            fragments   = 0;
+
+#if SOFTWARE_RASTER_SSE
+    const __m128i lanes    = _mm_set_epi32(3, 2, 1, 0);
+    const __m128  depth_x  = _mm_set1_ps(depth_plane[1]);
+    const __m128  center   = _mm_set1_ps(0.5f);
+    const __m128  origin_x = _mm_set1_ps(triangle->origin[0]);
+    __m128i       lane_steps[3];
+    __m128i       group_steps[3];
+    for (int i = 0; i < 3; ++i)
+    {
+        lane_steps[i]  = _mm_set_epi32(3 * step_x[i], 2 * step_x[i], step_x[i], 0);
+        group_steps[i] = _mm_set1_epi32(4 * step_x[i]);
+    }
+
+    for (int y = min_y; y < max_y; ++y)
+    {
+        GLubyte*      colors    = color_buffer + (size_t)y * frame_width * 4;
+        GLfloat*      depths    = depth_buffer + (size_t)y * frame_width;
+        const GLfloat row_y     = ((GLfloat)y + 0.5f) - triangle->origin[1];
+        const __m128  depth_row = _mm_set1_ps(depth_plane[0] + depth_plane[2] * row_y);
+
+        __m128i edges[3];
+        for (int i = 0; i < 3; ++i)
+        {
+            edges[i] = _mm_add_epi32(_mm_set1_epi32(edge_row[i]), lane_steps[i]);
+        }
+
+        for (int x = min_x; x < max_x; x += 4)
+        {
+            // A lane is inside when no edge function has its sign bit set.
+            const __m128i signs = _mm_or_si128(_mm_or_si128(edges[0], edges[1]), edges[2]);
+            int inside = ~_mm_movemask_ps(_mm_castsi128_ps(signs)) & 0xF;
+            if (max_x - x < 4)
+            {
+                inside &= (1 << (max_x - x)) - 1;
+            }
+
+            if (inside != 0)
+            {
+                const __m128 center_x = _mm_sub_ps(
+                    _mm_add_ps(_mm_cvtepi32_ps(_mm_add_epi32(_mm_set1_epi32(x), lanes)), center),
+                    origin_x
+                );
+                const __m128 depth  = _mm_add_ps(depth_row, _mm_mul_ps(depth_x, center_x));
+                const __m128 nearer = _mm_cmplt_ps(depth, _mm_loadu_ps(depths + x));
+                inside &= _mm_movemask_ps(nearer);
+
+                if (inside != 0)
+                {
+                    GLfloat lane_depths[4];
+                    _mm_storeu_ps(lane_depths, depth);
+                    for (int lane = 0; lane < 4; ++lane)
+                    {
+                        if (inside & (1 << lane))
+                        {
+                            shade_fragment(
+                                triangle,
+                                x + lane,
+                                y,
+                                lane_depths[lane],
+                                colors + (size_t)(x + lane) * 4,
+                                depths + x + lane
+                            );
+                            ++fragments;
+                        }
+                    }
+                }
+            }
+
+            for (int i = 0; i < 3; ++i)
+            {
+                edges[i] = _mm_add_epi32(edges[i], group_steps[i]);
+            }
+        }
+
+        for (int i = 0; i < 3; ++i)
+        {
+            edge_row[i] += step_y[i];
+        }
+    }
+#else
+    for (int y = min_y; y < max_y; ++y)
+    {
+        GLubyte*      colors    = color_buffer + (size_t)y * frame_width * 4;
+        GLfloat*      depths    = depth_buffer + (size_t)y * frame_width;
+        const GLfloat row_y     = ((GLfloat)y + 0.5f) - triangle->origin[1];
+        const GLfloat depth_row = depth_plane[0] + depth_plane[2] * row_y;
+
+        int edges[3] = { edge_row[0], edge_row[1], edge_row[2] };
+        for (int x = min_x; x < max_x; ++x)
+        {
+            if ((edges[0] | edges[1] | edges[2]) >= 0)
+            {
+                const GLfloat center_x = ((GLfloat)x + 0.5f) - triangle->origin[0];
+                const GLfloat depth    = depth_row + depth_plane[1] * center_x;
+                if (depth < depths[x])
+                {
+                    shade_fragment(triangle, x, y, depth, colors + (size_t)x * 4, depths + x);
+                    ++fragments;
+                }
+            }
+
+            for (int i = 0; i < 3; ++i)
+            {
+                edges[i] += step_x[i];
+            }
+        }
+
+        for (int i = 0; i < 3; ++i)
+        {
+            edge_row[i] += step_y[i];
+        }
+    }
+#endif
+
+    return fragments;
+}
+
+/**
+ * @brief Clears a tile and draws its triangles, one task of the frame job.
+ *
+ * @param argument Unused.
+ * @param task     Index of the tile.
+ */
+static void draw_tile(void* argument, int task)
+{
+    (void)argument;
+
+    raster_bin* bin = &bins[task];
+    int tile[4];
+    tile[0] = (task % tiles_x) * SOFTWARE_RASTER_TILE_SIZE;
+    tile[1] = (task / tiles_x) * SOFTWARE_RASTER_TILE_SIZE;
+    tile[2] = tile[0] + SOFTWARE_RASTER_TILE_SIZE < frame_width  ? tile[0] + SOFTWARE_RASTER_TILE_SIZE : frame_width;
+    tile[3] = tile[1] + SOFTWARE_RASTER_TILE_SIZE < frame_height ? tile[1] + SOFTWARE_RASTER_TILE_SIZE : frame_height;
+
+    for (int y = tile[1]; y < tile[3]; ++y)
+    {
+        memset(
+            color_buffer + ((size_t)y * frame_width + tile[0]) * 4,
+            0,
+            (size_t)(tile[2] - tile[0]) * 4
+        );
+        GLfloat* depths = depth_buffer + (size_t)y * frame_width;
+        for (int x = tile[0]; x < tile[2]; ++x)
+        {
+            depths[x] = CLEAR_DEPTH;
+        }
+    }
+
+    bin->fragments = 0;
+    for (int i = 0; i < bin->count; ++i)
+    {
+        bin->fragments += draw_triangle(&triangles[bin->entries[i]], tile);
+    }
+}
+
+/**
+ * @brief Starts the worker threads of the rasterizer.
+ *
+ * @param thread_count Threads drawing the tiles, the calling thread included.
+ * @return int Threads that draw the tiles.
+ */
+int software_raster_initialize(int thread_count)
+{
+    thread_total = 1 + worker_pool_create(&pool, thread_count - 1);
+    return thread_total;
+}
+
+/**
+ * @brief Empties the tiles for a new frame, resizing the buffers if needed.
+ *
+ * @param width       Width of the frame in pixels.
+ * @param height      Height of the frame in pixels.
+ * @param fog_density Density of the GL_EXP fog, 0 for none.
+ * @param fog_color   Color the fog fades to.
+ * @return int Returns 1 if the buffers are ready, 0 otherwise.
+ */
+int software_raster_begin_frame(int width, int height, GLfloat fog_density, const color fog_color)
+{
+    frame_ready    = 0;
+    triangle_count = 0;
+    if (width <= 0 || height <= 0)
+    {
+        return 0;
+    }
+
+    if (width != frame_width || height != frame_height)
+    {
+        free(color_buffer);
+        free(depth_buffer);
+        color_buffer = (GLubyte*)malloc((size_t)width * height * 4);
+        depth_buffer = (GLfloat*)malloc(((size_t)width * height + 4) * sizeof(GLfloat));
+        frame_width  = color_buffer != NULL && depth_buffer != NULL ? width  : 0;
+        frame_height = color_buffer != NULL && depth_buffer != NULL ? height : 0;
+        if (frame_width == 0)
+        {
+            return 0;
+        }
+
+        tiles_x = (width  + SOFTWARE_RASTER_TILE_SIZE - 1) / SOFTWARE_RASTER_TILE_SIZE;
+        tiles_y = (height + SOFTWARE_RASTER_TILE_SIZE - 1) / SOFTWARE_RASTER_TILE_SIZE;
+        if (tiles_x * tiles_y > bin_capacity)
+        {
+            raster_bin* grown = (raster_bin*)realloc(bins, (size_t)tiles_x * tiles_y * sizeof(raster_bin));
+            if (grown == NULL)
+            {
+                frame_width  = 0;
+                frame_height = 0;
+                return 0;
+            }
+            memset(grown + bin_capacity, 0, (size_t)(tiles_x * tiles_y - bin_capacity) * sizeof(raster_bin));
+            bins         = grown;
+            bin_capacity = tiles_x * tiles_y;
+        }
+    }
+
+    for (int i = 0; i < tiles_x * tiles_y; ++i)
+    {
+        bins[i].count = 0;
+    }
+
+    frame_fog = fog_density;
+    memcpy(frame_fog_color, fog_color, sizeof(color));
+    frame_ready = 1;
+    return 1;
+}
+
+/**
+ * @brief Clips a triangle and bins the pieces into the tiles they touch.
+ *
+ * @param a     First corner.
+ * @param b     Second corner.
+ * @param c     Third corner.
+ * @param state Texture and cutout of the triangle.
+ */
+void software_raster_triangle(
+    const raster_vertex* a,
+    const raster_vertex* b,
+    const raster_vertex* c,
+    const raster_state*  state
+)
+{
+    if (!frame_ready)
+    {
+        return;
+    }
+
+    // Triangles beyond one edge of the viewport are never drawn, triangles
+    // inside the guard band need no clipping.
+    int clipped = 0;
+    for (int plane = 0; plane < CLIP_PLANE_COUNT; ++plane)
+    {
+        if (plane_distance(view_planes[plane], a) < 0.0f &&
+            plane_distance(view_planes[plane], b) < 0.0f &&
+            plane_distance(view_planes[plane], c) < 0.0f)
+        {
+            return;
+        }
+        clipped |= plane_distance(clip_planes[plane], a) < 0.0f ||
+                   plane_distance(clip_planes[plane], b) < 0.0f ||
+                   plane_distance(clip_planes[plane], c) < 0.0f;
+    }
+
+    screen_vertex screen[CLIP_VERTEX_COUNT];
+    if (!clipped)
+    {
+        project_vertex(a, 0.0f, 0.0f, &screen[0]);
+        project_vertex(b, 0.0f, 0.0f, &screen[1]);
+        project_vertex(c, 0.0f, 0.0f, &screen[2]);
+        setup_triangle(&screen[0], &screen[1], &screen[2], state);
+        return;
+    }
+
+    raster_vertex polygon[CLIP_VERTEX_COUNT];
+    polygon[0] = *a;
+    polygon[1] = *b;
+    polygon[2] = *c;
+    const int count = clip_polygon(polygon, 3);
+    for (int i = 0; i < count; ++i)
+    {
+        project_vertex(&polygon[i], 0.0f, 0.0f, &screen[i]);
+    }
+    for (int i = 2; i < count; ++i)
+    {
+        setup_triangle(&screen[0], &screen[i - 1], &screen[i], state);
+    }
+}
+
+/**
+ * @brief Clips a line and bins it as a quad of the given width.
+ *
+ * @param a     Start point.
+ * @param b     End point.
+ * @param width Width of the line in pixels.
+ */
+void software_raster_line(const raster_vertex* a, const raster_vertex* b, GLfloat width)
+{
+    if (!frame_ready)
+    {
+        return;
+    }
+
+    // Parts of the line outside a plane are cut off from the end that is outside.
+    GLfloat start = 0.0f;
+    GLfloat end   = 1.0f;
+    for (int plane = 0; plane < CLIP_PLANE_COUNT; ++plane)
+    {
+        const GLfloat distance_a = plane_distance(clip_planes[plane], a);
+        const GLfloat distance_b = plane_distance(clip_planes[plane], b);
+        if (distance_a < 0.0f && distance_b < 0.0f)
+        {
+            return;
+        }
+        if (distance_a < 0.0f)
+        {
+            const GLfloat cut = distance_a / (distance_a - distance_b);
+            start = cut > start ? cut : start;
+        }
+        else if (distance_b < 0.0f)
+        {
+            const GLfloat cut = distance_a / (distance_a - distance_b);
+            end = cut < end ? cut : end;
+        }
+    }
+    if (start >= end)
+    {
+        return;
+    }
+
+    raster_vertex ends[2];
+    mix_vertices(a, b, start, &ends[0]);
+    mix_vertices(a, b, end, &ends[1]);
+
+    // Offset both ends by half the width across the line in window space.
+    const GLfloat dx = (ends[1].position[0] / ends[1].position[3] - ends[0].position[0] / ends[0].position[3]) *
+                       (GLfloat)frame_width * 0.5f;
+    const GLfloat dy = (ends[1].position[1] / ends[1].position[3] - ends[0].position[1] / ends[0].position[3]) *
+                       (GLfloat)frame_height * 0.5f;
+    const GLfloat length = sqrtf(dx * dx + dy * dy);
+    if (length <= 0.0f)
+    {
+        return;
+    }
+    const GLfloat across_x = -dy / length * width * 0.5f;
+    const GLfloat across_y =  dx / length * width * 0.5f;
+
+    screen_vertex corners[4];
+    project_vertex(&ends[0],  across_x,  across_y, &corners[0]);
+    project_vertex(&ends[0], -across_x, -across_y, &corners[1]);
+    project_vertex(&ends[1], -across_x, -across_y, &corners[2]);
+    project_vertex(&ends[1],  across_x,  across_y, &corners[3]);
+
+    const raster_state state = { NULL, -1.0f };
+    setup_triangle(&corners[0], &corners[1], &corners[2], &state);
+    setup_triangle(&corners[0], &corners[2], &corners[3], &state);
+}
+
+/**
+ * @brief Clears and draws all tiles on the worker threads.
+ *
+ * @param stats Output work done for the frame.
+ */
+void software_raster_end_frame(raster_stats* stats)
+{
+    stats->triangles   = triangle_count;
+    stats->bin_entries = 0;
+    stats->fragments   = 0;
+    stats->threads     = thread_total;
+    if (!frame_ready)
+    {
+        return;
+    }
+
+    worker_pool_run(&pool, draw_tile, NULL, tiles_x * tiles_y);
+
+    for (int i = 0; i < tiles_x * tiles_y; ++i)
+    {
+        stats->bin_entries += bins[i].count;
+        stats->fragments   += bins[i].fragments;
+    }
+}
+
+/**
+ * @brief Returns the drawn frame.
+ *
+ * @return const GLubyte* RGBA pixels from the bottom row, NULL before the first frame.
+ */
+const GLubyte* software_raster_pixels(void)
+{
+    return frame_ready ? color_buffer : NULL;
+}
+
+/**
+ * @brief Stops the worker threads and frees the buffers and tiles.
+ */
+void software_raster_clean_up(void)
+{
+    worker_pool_destroy(&pool);
+    thread_total = 1;
+
+    for (int i = 0; i < bin_capacity; ++i)
+    {
+        free(bins[i].entries);
+    }
+    free(bins);
+    free(triangles);
+    free(color_buffer);
+    free(depth_buffer);
+
+    bins              = NULL;
+    bin_capacity      = 0;
+    triangles         = NULL;
+    triangle_count    = 0;
+    triangle_capacity = 0;
+    color_buffer      = NULL;
+    depth_buffer      = NULL;
+    frame_width       = 0;
+    frame_height      = 0;
+    frame_ready       = 0;
+}
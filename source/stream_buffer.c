@@ -0,0 +1,197 @@
+/**
+ * @file stream_buffer.c
+ * @brief Implements vertex buffers streamed by orphaning or a persistent ring.
+ */
+
+
+#include "stream_buffer.h"
+
+#include "gl_trace.h"
+
+#include <stdio.h>
+
+
+#define STREAM_BUFFER_WAIT_TIMEOUT 1000000000ull  // nanoseconds to wait for a region, one second
+
+
+/**
+ * @brief Creates a stream buffer.
+ *
+ * @param stream      Output stream buffer.
+ * @param region_size Bytes written per update.
+ * @param mode        Preferred update strategy.
+ */
+void stream_buffer_create(stream_buffer* stream, size_t region_size, stream_mode mode)
+{
+    stream->buffer      = 0;
+    stream->region_size = region_size;
+    stream->region      = 0;
+    stream->mapping     = NULL;
+    for (int i = 0; i < STREAM_BUFFER_REGIONS; ++i)
+    {
+        stream->fences[i] = NULL;
+    }
+
+    if (mode == STREAM_MODE_PERSISTENT && !gl_extensions.persistent_mapping)
+    {
+        mode = STREAM_MODE_ORPHAN;
+    }
+    stream->mode = mode;
+
+    glGenBuffers(1, &stream->buffer);
+    glBindBuffer(GL_ARRAY_BUFFER, stream->buffer);
+
+    if (stream->mode == STREAM_MODE_PERSISTENT)
+    {
+        const GLbitfield flags = 
+            GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        const gl_size_pointer size = 
+            (gl_size_pointer)(region_size * STREAM_BUFFER_REGIONS);
+
+        glBufferStorage(GL_ARRAY_BUFFER, size, NULL, flags);
+        stream->mapping = (GLubyte*)glMapBufferRange(GL_ARRAY_BUFFER, 0, size, flags);
+        if (stream->mapping == NULL)
+        {
+            // Immutable storage cannot be reallocated, start over with a new buffer.
+            printf("Failed to map stream buffer persistently, using orphaning.\n");
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+            glDeleteBuffers(1, &stream->buffer);
+            glGenBuffers(1, &stream->buffer);
+            glBindBuffer(GL_ARRAY_BUFFER, stream->buffer);
+            stream->mode = STREAM_MODE_ORPHAN;
+        }
+    }
+
+    if (stream->mode == STREAM_MODE_ORPHAN)
+    {
+        glBufferData(GL_ARRAY_BUFFER, (gl_size_pointer)region_size, NULL, GL_STREAM_DRAW);
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+/**
+ * @brief Starts an update and binds the buffer to GL_ARRAY_BUFFER.
+ *
+ * Orphaning always writes at offset 0 of freshly allocated storage. The
+ * persistent ring advances to the next region and only blocks if the GPU
+ * has not finished the draws of STREAM_BUFFER_REGIONS updates ago.
+ *
+ * @param stream The stream buffer.
+ * @param offset Output byte offset of the written region in the buffer.
+ * @return void* Memory to write region_size bytes to, or NULL on failure.
+ */
+void* stream_buffer_begin(stream_buffer* stream, size_t* offset)
+{
+    glBindBuffer(GL_ARRAY_BUFFER, stream->buffer);
+
+    if (stream->mode == STREAM_MODE_ORPHAN)
+    {
+        *offset = 0;
+        glBufferData(GL_ARRAY_BUFFER, (gl_size_pointer)stream->region_size, NULL, GL_STREAM_DRAW);
+        return glMapBuffer(GL_ARRAY_BUFFER, GL_WRITE_ONLY);
+    }
+
+    stream->region = (stream->region + 1) % STREAM_BUFFER_REGIONS;
+
+    gl_sync fence = stream->fences[stream->region];
+    if (fence != NULL)
+    {
+        const GLenum result = glClientWaitSync(
+            fence, 
+            GL_SYNC_FLUSH_COMMANDS_BIT, 
+            STREAM_BUFFER_WAIT_TIMEOUT
+        );
+        if (result == GL_TIMEOUT_EXPIRED || result == GL_WAIT_FAILED)
+        {
+            printf("Stream buffer region %d was not released in time.\n", stream->region);
+        }
+        glDeleteSync(fence);
+        stream->fences[stream->region] = NULL;
+    }
+
+    *offset = (size_t)stream->region * stream->region_size;
+    return stream->mapping + *offset;
+}
+
+/**
+ * @brief Finishes writing the region started by stream_buffer_begin.
+ *
+ * The coherent persistent mapping needs no flush, an orphaned
+ * buffer is unmapped so it can be drawn from.
+ *
+ * @param stream The stream buffer.
+ */
+void stream_buffer_end(stream_buffer* stream)
+{
+    if (stream->mode == STREAM_MODE_ORPHAN)
+    {
+        glUnmapBuffer(GL_ARRAY_BUFFER);
+    }
+}
+
+/**
+ * @brief Marks the end of all draws reading the current region.
+ *
+ * @param stream The stream buffer.
+ */
+void stream_buffer_fence(stream_buffer* stream)
+{
+    if (stream->mode == STREAM_MODE_PERSISTENT)
+    {
+        stream->fences[stream->region] = 
+            glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+}
+
+/**
+ * @brief Frees the buffer object and its fences.
+ *
+ * @param stream The stream buffer.
+ */
+void stream_buffer_destroy(stream_buffer* stream)
+{
+    for (int i = 0; i < STREAM_BUFFER_REGIONS; ++i)
+    {
+        if (stream->fences[i] != NULL)
+        {
+            glDeleteSync(stream->fences[i]);
+            stream->fences[i] = NULL;
+        }
+    }
+
+    if (stream->buffer != 0)
+    {
+        if (stream->mapping != NULL)
+        {
+            glBindBuffer(GL_ARRAY_BUFFER, stream->buffer);
+            glUnmapBuffer(GL_ARRAY_BUFFER);
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+        }
+        glDeleteBuffers(1, &stream->buffer);
+    }
+
+    stream->buffer  = 0;
+    stream->mapping = NULL;
+}
+
+/**
+ * @brief Returns a readable name of a stream mode.
+ *
+ * @param mode The stream mode.
+ * @return const char* Name of the mode.
+ */
+const char* stream_buffer_mode_name(stream_mode mode)
+{
+    switch (mode)
+    {
+    case STREAM_MODE_ORPHAN:
+        return "orphan";
+
+    case STREAM_MODE_PERSISTENT:
+        return "persistent";
+
+    default:
+        return "unknown";
+    }
+}
@@ -1,22 +1,292 @@
 /**
  * @file texture.c
- * @brief Implements texture loading functionality using stb_image.
+ * @brief Implements texture loading and mip streaming using stb_image.
  *
- * Uses stb_image to load image files and OpenGL functions
- * to create and configure textures with mipmapping.
+ * Uses stb_image to load image files and builds the full mip chain on
+ * the CPU. Only the smallest levels are uploaded at load; finer levels
+ * are streamed in when the renderer requests them and evicted again
+ * when they are unused and the memory budget is exceeded.
  */
 
 
 #include "texture.h"
 
+#include "gl_state.h"
+#include "gl_trace.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <stb/stb_image.h>
 
 
+// OpenGL 1.2 tokens missing from the Windows OpenGL 1.1 headers.
+#ifndef GL_TEXTURE_BASE_LEVEL
+#define GL_TEXTURE_BASE_LEVEL 0x813C
+#endif
+#ifndef GL_TEXTURE_MAX_LEVEL
+#define GL_TEXTURE_MAX_LEVEL  0x813D
+#endif
+
+#define TEXTURE_CHANNEL_COUNT 3  // textures are stored as RGB
+
+
+/**
+ * @brief A texture with its CPU mip chain and GPU residency state.
+ */
+typedef struct {
+    GLuint   id;                                    // OpenGL texture ID
+    GLint    level_count;                           // levels in the full mip chain
+    GLint    initial_base_level;                    // finest level always kept resident
+    GLint    resident_base_level;                   // finest level currently uploaded
+    GLint    requested_base_level;                  // finest level requested so far this frame
+    GLint    last_requested_base_level;             // finest level requested last frame
+    GLint    widths[TEXTURE_MAX_MIP_LEVELS];        // width of each level
+    GLint    heights[TEXTURE_MAX_MIP_LEVELS];       // height of each level
+    GLubyte* levels[TEXTURE_MAX_MIP_LEVELS];        // CPU copy of each level
+} streamed_texture;
+
+
+static streamed_texture streamed_textures[TEXTURE_MAX_COUNT];
+static int              streamed_texture_count = 0;
+static size_t           memory_budget          = DEFAULT_TEXTURE_MEMORY_BUDGET;
+static int              levels_streamed        = 0;  // finer levels uploaded while streaming
+static int              levels_evicted         = 0;  // levels evicted to stay within the budget
+
+
+/**
+ * @brief Rounds a texture dimension to the nearest power of two,
+ *        matching the rescaling done by gluBuild2DMipmaps.
+ *
+ * @param value Dimension in texels.
+ * @return GLint Nearest power of two.
+ */
+static GLint nearest_power_of_two(const GLint value)
+{
+    GLint power = 1;
+    while (power * 2 <= value)
+    {
+        power *= 2;
+    }
+    return (value - power > power / 2) ? power * 2 : power;
+}
+
+/**
+ * @brief Returns the size in bytes of a single mip level.
+ */
+static size_t level_bytes(const streamed_texture* texture, const GLint level)
+{
+    return (size_t)texture->widths[level] *
+           (size_t)texture->heights[level] *
+           TEXTURE_CHANNEL_COUNT;
+}
+
+/**
+ * @brief Returns the bytes used by all uploaded levels of a texture.
+ */
+static size_t resident_bytes(const streamed_texture* texture)
+{
+    size_t total = 0;
+    for (GLint level = texture->resident_base_level; level < texture->level_count; ++level)
+    {
+        total += level_bytes(texture, level);
+    }
+    return total;
+}
+
 /**
- * @brief Loads an image from a file and creates an OpenGL texture.
+ * @brief Returns the bytes used by all uploaded levels of all textures.
+ */
+static size_t total_resident_bytes(void)
+{
+    size_t total = 0;
+    for (int i = 0; i < streamed_texture_count; ++i)
+    {
+        total += resident_bytes(&streamed_textures[i]);
+    }
+    return total;
+}
+
+/**
+ * @brief Finds the streamed texture owning an OpenGL texture ID.
  *
- * Loads the image data using stb_image, generates a texture ID,
- * binds the texture, builds mipmaps, sets min/mag filters, frees image data,
+ * @return streamed_texture* The texture, or NULL if unknown.
+ */
+static streamed_texture* find_texture(const GLuint texture_id)
+{
+    for (int i = 0; i < streamed_texture_count; ++i)
+    {
+        if (streamed_textures[i].id == texture_id)
+        {
+            return &streamed_textures[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Builds the CPU mip chain from the loaded image.
+ *
+ * The image is rescaled to power-of-two dimensions, then each
+ * level is box filtered from the previous one down to 1x1.
+ */
+static void build_mip_chain(
+          streamed_texture* texture,
+    const GLubyte*          image_data,
+    const GLint             width,
+    const GLint             height
+)
+{
+    GLint level_width  = nearest_power_of_two(width);
+    GLint level_height = nearest_power_of_two(height);
+
+    texture->levels[0] = malloc((size_t)level_width * level_height * TEXTURE_CHANNEL_COUNT);
+    gluScaleImage(
+        GL_RGB,
+        width,
+        height,
+        GL_UNSIGNED_BYTE,
+        image_data,
+        level_width,
+        level_height,
+        GL_UNSIGNED_BYTE,
+        texture->levels[0]
+    );
+    texture->widths[0]  = level_width;
+    texture->heights[0] = level_height;
+
+    GLint level = 0;
+    while ((level_width > 1 || level_height > 1) && level + 1 < TEXTURE_MAX_MIP_LEVELS)
+    {
+        const GLubyte* source        = texture->levels[level];
+        const GLint    source_width  = level_width;
+        const GLint    source_height = level_height;
+
+        level_width  = level_width  > 1 ? level_width  / 2 : 1;
+        level_height = level_height > 1 ? level_height / 2 : 1;
+        ++level;
+
+        GLubyte* destination = malloc((size_t)level_width * level_height * TEXTURE_CHANNEL_COUNT);
+        for (GLint y = 0; y < level_height; ++y)
+        {
+            const GLint y0 = (2 * y)     < source_height ? 2 * y     : source_height - 1;
+            const GLint y1 = (2 * y + 1) < source_height ? 2 * y + 1 : source_height - 1;
+
+            for (GLint x = 0; x < level_width; ++x)
+            {
+                const GLint x0 = (2 * x)     < source_width ? 2 * x     : source_width - 1;
+                const GLint x1 = (2 * x + 1) < source_width ? 2 * x + 1 : source_width - 1;
+
+                for (int c = 0; c < TEXTURE_CHANNEL_COUNT; ++c)
+                {
+                    const int sum =
+                        source[(y0 * source_width + x0) * TEXTURE_CHANNEL_COUNT + c] +
+                        source[(y0 * source_width + x1) * TEXTURE_CHANNEL_COUNT + c] +
+                        source[(y1 * source_width + x0) * TEXTURE_CHANNEL_COUNT + c] +
+                        source[(y1 * source_width + x1) * TEXTURE_CHANNEL_COUNT + c];
+
+                    destination[(y * level_width + x) * TEXTURE_CHANNEL_COUNT + c] =
+                        (GLubyte)((sum + 2) / 4);
+                }
+            }
+        }
+
+        texture->levels[level]  = destination;
+        texture->widths[level]  = level_width;
+        texture->heights[level] = level_height;
+    }
+
+    texture->level_count = level + 1;
+}
+
+/**
+ * @brief Uploads the next finer level and makes it the base level.
+ */
+static void upload_finer_level(streamed_texture* texture)
+{
+    const GLint level = texture->resident_base_level - 1;
+
+    gl_state_bind_texture(texture->id);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(
+        GL_TEXTURE_2D,
+        level,
+        GL_RGB,
+        texture->widths[level],
+        texture->heights[level],
+        0,
+        GL_RGB,
+        GL_UNSIGNED_BYTE,
+        texture->levels[level]
+    );
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level);
+
+    texture->resident_base_level = level;
+}
+
+/**
+ * @brief Frees the finest uploaded level and raises the base level.
+ */
+static void evict_finest_level(streamed_texture* texture)
+{
+    const GLint level = texture->resident_base_level;
+
+    gl_state_bind_texture(texture->id);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level + 1);
+    // A zero-sized image releases the storage of the level.
+    glTexImage2D(GL_TEXTURE_2D, level, GL_RGB, 0, 0, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
+
+    texture->resident_base_level = level + 1;
+}
+
+/**
+ * @brief Evicts one unused fine level from the texture holding the largest one.
+ *
+ * A level is unused when it is finer than the last request for its
+ * texture. The smallest levels of each texture are never evicted.
+ *
+ * @param keep Texture that must not be evicted from, or NULL.
+ * @return int Returns 1 if a level was evicted, 0 if none was evictable.
+ */
+static int evict_unused_level(const streamed_texture* keep)
+{
+    streamed_texture* victim       = NULL;
+    size_t            victim_bytes = 0;
+
+    for (int i = 0; i < streamed_texture_count; ++i)
+    {
+        streamed_texture* texture = &streamed_textures[i];
+        if (texture == keep ||
+            texture->resident_base_level >= texture->initial_base_level ||
+            texture->resident_base_level >= texture->requested_base_level)
+        {
+            continue;
+        }
+
+        const size_t bytes = level_bytes(texture, texture->resident_base_level);
+        if (bytes > victim_bytes)
+        {
+            victim       = texture;
+            victim_bytes = bytes;
+        }
+    }
+
+    if (victim == NULL)
+    {
+        return 0;
+    }
+
+    evict_finest_level(victim);
+    ++levels_evicted;
+    return 1;
+}
+
+/**
+ * @brief Loads an image from a file and creates a streamed OpenGL texture.
+ *
+ * Loads the image data using stb_image, builds the full mip chain on the
+ * CPU, generates a texture ID and uploads the smallest levels, starting
+ * at 1x1, up to TEXTURE_INITIAL_RESIDENT_SIZE. Sets min/mag filters
  * and returns the texture ID.
  *
  * @param local_file_path Path to the image file.
@@ -28,48 +298,276 @@ GLuint texture_create_from_file(const char* local_file_path)
     GLint height;
     GLint color_channel_count;
 
-    // Load image data from file using stb_image
-    GLubyte* image_data = 
+    // Load image data from file using stb_image, forced to RGB.
+    GLubyte* image_data =
         stbi_load(
-            local_file_path, 
-            &width, 
-            &height, 
-            &color_channel_count, 
-            0
+            local_file_path,
+            &width,
+            &height,
+            &color_channel_count,
+            TEXTURE_CHANNEL_COUNT
         );
 
     GLuint texture_id;
     glGenTextures(1, &texture_id);
-    glBindTexture(GL_TEXTURE_2D, texture_id);
 
-    // Upload texture data and generate mipmaps
-    gluBuild2DMipmaps(
-        GL_TEXTURE_2D,
-        GL_RGB,
-        width,
-        height,
-        GL_RGB,
-        GL_UNSIGNED_BYTE,
-        image_data
-    );
+    if (image_data == NULL || streamed_texture_count == TEXTURE_MAX_COUNT)
+    {
+        stbi_image_free(image_data);
+        return texture_id;
+    }
+
+    streamed_texture* texture = &streamed_textures[streamed_texture_count++];
+    texture->id = texture_id;
+    build_mip_chain(texture, image_data, width, height);
+
+    // Free loaded image data, the mip chain keeps its own copy.
+    stbi_image_free(image_data);
+
+    // Smallest levels first, from 1x1 up to the initial resident size.
+    texture->initial_base_level = texture->level_count - 1;
+    while (texture->initial_base_level > 0 &&
+           texture->widths[texture->initial_base_level - 1]  <= TEXTURE_INITIAL_RESIDENT_SIZE &&
+           texture->heights[texture->initial_base_level - 1] <= TEXTURE_INITIAL_RESIDENT_SIZE)
+    {
+        --texture->initial_base_level;
+    }
+
+    gl_state_bind_texture(texture_id);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, texture->level_count - 1);
 
     // Set texture filtering parameters for minification and magnification
     glTexParameteri(
-        GL_TEXTURE_2D, 
-        GL_TEXTURE_MIN_FILTER, 
+        GL_TEXTURE_2D,
+        GL_TEXTURE_MIN_FILTER,
         GL_LINEAR_MIPMAP_LINEAR
     );
     glTexParameteri(
-        GL_TEXTURE_2D, 
-        GL_TEXTURE_MAG_FILTER, 
-        GL_LINEAR_MIPMAP_LINEAR
+        GL_TEXTURE_2D,
+        GL_TEXTURE_MAG_FILTER,
+        GL_LINEAR
     );
 
-    // Free loaded image data from CPU memory
-    stbi_image_free(image_data);
+    texture->resident_base_level = texture->level_count;
+    while (texture->resident_base_level > texture->initial_base_level)
+    {
+        upload_finer_level(texture);
+    }
 
-    // Unbind texture
-    glBindTexture(GL_TEXTURE_2D, 0);
+    texture->requested_base_level      = texture->initial_base_level;
+    texture->last_requested_base_level = texture->initial_base_level;
 
     return texture_id;
 }
+
+/**
+ * @brief Records the finest level needed for a texture this frame.
+ *
+ * One texel per pixel needs level 0, two texels per pixel level 1 and so on.
+ *
+ * @param texture_id       OpenGL texture ID.
+ * @param texels_per_pixel Base level texels covered by one screen pixel.
+ */
+void texture_request_density(GLuint texture_id, GLfloat texels_per_pixel)
+{
+    streamed_texture* texture = find_texture(texture_id);
+    if (texture == NULL)
+    {
+        return;
+    }
+
+    GLint level = 0;
+    if (texels_per_pixel > 1.0f)
+    {
+        level = (GLint)floorf(log2f(texels_per_pixel));
+    }
+    if (level > texture->level_count - 1)
+    {
+        level = texture->level_count - 1;
+    }
+
+    if (level < texture->requested_base_level)
+    {
+        texture->requested_base_level = level;
+    }
+}
+
+/**
+ * @brief Streams requested levels in and evicts unused levels over budget.
+ *
+ * Finer levels are uploaded one step at a time, so a texture sharpens over
+ * a few frames instead of stalling a single frame. If a level does not fit
+ * in the budget, unused levels of other textures are evicted to make room.
+ * Requests are reset afterwards, so levels that are not requested again
+ * next frame become candidates for eviction.
+ */
+void texture_streaming_update(void)
+{
+    for (int i = 0; i < streamed_texture_count; ++i)
+    {
+        streamed_texture* texture = &streamed_textures[i];
+
+        for (int step = 0; step < TEXTURE_LEVELS_PER_UPDATE; ++step)
+        {
+            if (texture->requested_base_level >= texture->resident_base_level)
+            {
+                break;
+            }
+
+            const size_t needed_bytes =
+                level_bytes(texture, texture->resident_base_level - 1);
+
+            int has_room = 1;
+            while (total_resident_bytes() + needed_bytes > memory_budget)
+            {
+                if (!evict_unused_level(texture))
+                {
+                    has_room = 0;
+                    break;
+                }
+            }
+
+            if (!has_room)
+            {
+                break;
+            }
+            upload_finer_level(texture);
+            ++levels_streamed;
+        }
+    }
+
+    // Shrink back under budget, e.g. after the budget was lowered.
+    while (total_resident_bytes() > memory_budget && evict_unused_level(NULL))
+    {
+    }
+
+    for (int i = 0; i < streamed_texture_count; ++i)
+    {
+        streamed_texture* texture = &streamed_textures[i];
+        texture->last_requested_base_level = texture->requested_base_level;
+        texture->requested_base_level      = texture->initial_base_level;
+    }
+}
+
+/**
+ * @brief Sets the memory budget shared by all streamed textures.
+ *
+ * @param budget_bytes Budget in bytes.
+ */
+void texture_set_memory_budget(size_t budget_bytes)
+{
+    memory_budget = budget_bytes;
+}
+
+/**
+ * @brief Copies the residency statistics of a streamed texture.
+ *
+ * @param texture_id OpenGL texture ID.
+ * @param stats      Output statistics.
+ * @return int Returns 1 if the texture is known, 0 otherwise.
+ */
+int texture_get_stats(GLuint texture_id, texture_stats* stats)
+{
+    const streamed_texture* texture = find_texture(texture_id);
+    if (texture == NULL)
+    {
+        return 0;
+    }
+
+    stats->id                   = texture->id;
+    stats->width                = texture->widths[0];
+    stats->height               = texture->heights[0];
+    stats->level_count          = texture->level_count;
+    stats->resident_base_level  = texture->resident_base_level;
+    stats->requested_base_level = texture->last_requested_base_level;
+    stats->resident_bytes       = resident_bytes(texture);
+    return 1;
+}
+
+/**
+ * @brief Copies the residency of all textures and the streaming counts.
+ *
+ * @param stats Output statistics.
+ */
+void texture_get_streaming_stats(texture_streaming_stats* stats)
+{
+    stats->resident_levels = 0;
+    for (int i = 0; i < streamed_texture_count; ++i)
+    {
+        const streamed_texture* texture = &streamed_textures[i];
+        stats->resident_levels += texture->level_count - texture->resident_base_level;
+    }
+    stats->resident_bytes  = total_resident_bytes();
+    stats->budget_bytes    = memory_budget;
+    stats->levels_streamed = levels_streamed;
+    stats->levels_evicted  = levels_evicted;
+}
+
+/**
+ * @brief Returns the CPU copy of one level of a texture's mip chain.
+ *
+ * @param texture_id OpenGL texture ID.
+ * @param level      Mip level, 0 for the base level.
+ * @param width      Output width of the level in texels.
+ * @param height     Output height of the level in texels.
+ * @return const GLubyte* RGB texels row by row, NULL if the texture or level is unknown.
+ */
+const GLubyte* texture_get_level(GLuint texture_id, GLint level, GLint* width, GLint* height)
+{
+    const streamed_texture* texture = find_texture(texture_id);
+    if (texture == NULL || level < 0 || level >= texture->level_count)
+    {
+        return NULL;
+    }
+
+    *width  = texture->widths[level];
+    *height = texture->heights[level];
+    return texture->levels[level];
+}
+
+/**
+ * @brief Prints the residency statistics of all textures to the console.
+ */
+void texture_print_stats(void)
+{
+    printf("Texture Streaming (budget %zu bytes)\n", memory_budget);
+    printf("-------------------\n");
+
+    for (int i = 0; i < streamed_texture_count; ++i)
+    {
+        texture_stats stats;
+        (void)texture_get_stats(streamed_textures[i].id, &stats);
+
+        printf(
+            "texture %u:\t%dx%d, levels %d-%d of %d resident, level %d requested, %zu bytes\n",
+            stats.id,
+            stats.width,
+            stats.height,
+            stats.resident_base_level,
+            stats.level_count - 1,
+            stats.level_count,
+            stats.requested_base_level,
+            stats.resident_bytes
+        );
+    }
+    printf("\n");
+}
+
+/**
+ * @brief Frees the CPU mip chains and deletes all streamed textures.
+ */
+void texture_cleanup(void)
+{
+    for (int i = 0; i < streamed_texture_count; ++i)
+    {
+        streamed_texture* texture = &streamed_textures[i];
+
+        for (GLint level = 0; level < texture->level_count; ++level)
+        {
+            free(texture->levels[level]);
+            texture->levels[level] = NULL;
+        }
+        glDeleteTextures(1, &texture->id);
+    }
+    streamed_texture_count = 0;
+}
@@ -0,0 +1,215 @@
+/**
+ * @file thread.c
+ * @brief Implements threads, mutexes and condition variables on Windows and POSIX systems.
+ */
+
+
+#include "thread.h"
+
+#include <stdlib.h>
+
+
+/**
+ * @brief Entry point and argument handed to a new thread.
+ */
+typedef struct {
+    thread_function function;  // entry point of the thread
+    void*           argument;  // argument passed to the entry point
+} thread_start;
+
+
+/**
+ * @brief Runs the entry point of a new thread and frees its start data.
+ */
+#ifdef _WIN32
+static DWORD WINAPI run_thread(LPVOID data)
+#else
+static void* run_thread(void* data)
+#endif
+{
+    const thread_start start = *(thread_start*)data;
+    free(data);
+
+    start.function(start.argument);
+
+#ifdef _WIN32
+    return 0;
+#else
+    return NULL;
+#endif
+}
+
+/**
+ * @brief Starts a thread.
+ *
+ * @param thread   Output handle of the started thread.
+ * @param function Entry point of the thread.
+ * @param argument Argument passed to the entry point.
+ * @return int Returns 1 if the thread was started, 0 otherwise.
+ */
+int thread_create(thread_handle* thread, thread_function function, void* argument)
+{
+    thread_start* start = malloc(sizeof(thread_start));
+    if (start == NULL)
+    {
+        return 0;
+    }
+    start->function = function;
+    start->argument = argument;
+
+#ifdef _WIN32
+    *thread = CreateThread(NULL, 0, run_thread, start, 0, NULL);
+    if (*thread == NULL)
+#else
+    if (pthread_create(thread, NULL, run_thread, start) != 0)
+#endif
+    {
+        free(start);
+        return 0;
+    }
+    return 1;
+}
+
+/**
+ * @brief Waits until a thread has returned and releases its handle.
+ *
+ * @param thread The thread to wait for.
+ */
+void thread_join(thread_handle* thread)
+{
+#ifdef _WIN32
+    (void)WaitForSingleObject(*thread, INFINITE);
+    (void)CloseHandle(*thread);
+#else
+    (void)pthread_join(*thread, NULL);
+#endif
+}
+
+/**
+ * @brief Initializes a mutex.
+ *
+ * @param mutex The mutex to initialize.
+ */
+void thread_mutex_initialize(thread_mutex* mutex)
+{
+#ifdef _WIN32
+    InitializeCriticalSection(mutex);
+#else
+    (void)pthread_mutex_init(mutex, NULL);
+#endif
+}
+
+/**
+ * @brief Releases the resources of a mutex that is no longer locked.
+ *
+ * @param mutex The mutex to destroy.
+ */
+void thread_mutex_destroy(thread_mutex* mutex)
+{
+#ifdef _WIN32
+    DeleteCriticalSection(mutex);
+#else
+    (void)pthread_mutex_destroy(mutex);
+#endif
+}
+
+/**
+ * @brief Blocks until the mutex is owned by the calling thread.
+ *
+ * @param mutex The mutex to lock.
+ */
+void thread_mutex_lock(thread_mutex* mutex)
+{
+#ifdef _WIN32
+    EnterCriticalSection(mutex);
+#else
+    (void)pthread_mutex_lock(mutex);
+#endif
+}
+
+/**
+ * @brief Releases a mutex owned by the calling thread.
+ *
+ * @param mutex The mutex to unlock.
+ */
+void thread_mutex_unlock(thread_mutex* mutex)
+{
+#ifdef _WIN32
+    LeaveCriticalSection(mutex);
+#else
+    (void)pthread_mutex_unlock(mutex);
+#endif
+}
+
+/**
+ * @brief Initializes a condition variable.
+ *
+ * @param condition The condition variable to initialize.
+ */
+void thread_condition_initialize(thread_condition* condition)
+{
+#ifdef _WIN32
+    InitializeConditionVariable(condition);
+#else
+    (void)pthread_cond_init(condition, NULL);
+#endif
+}
+
+/**
+ * @brief Releases the resources of a condition variable nobody waits on.
+ *
+ * Windows condition variables own no resources.
+ *
+ * @param condition The condition variable to destroy.
+ */
+void thread_condition_destroy(thread_condition* condition)
+{
+#ifdef _WIN32
+    (void)condition;
+#else
+    (void)pthread_cond_destroy(condition);
+#endif
+}
+
+/**
+ * @brief Unlocks the mutex, waits for a signal and locks the mutex again.
+ *
+ * @param condition The condition variable to wait on.
+ * @param mutex     The mutex owned by the calling thread.
+ */
+void thread_condition_wait(thread_condition* condition, thread_mutex* mutex)
+{
+#ifdef _WIN32
+    (void)SleepConditionVariableCS(condition, mutex, INFINITE);
+#else
+    (void)pthread_cond_wait(condition, mutex);
+#endif
+}
+
+/**
+ * @brief Wakes up one thread waiting on the condition variable.
+ *
+ * @param condition The condition variable to signal.
+ */
+void thread_condition_signal(thread_condition* condition)
+{
+#ifdef _WIN32
+    WakeConditionVariable(condition);
+#else
+    (void)pthread_cond_signal(condition);
+#endif
+}
+
+/**
+ * @brief Wakes up all threads waiting on the condition variable.
+ *
+ * @param condition The condition variable to signal.
+ */
+void thread_condition_broadcast(thread_condition* condition)
+{
+#ifdef _WIN32
+    WakeAllConditionVariable(condition);
+#else
+    (void)pthread_cond_broadcast(condition);
+#endif
+}
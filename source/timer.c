@@ -0,0 +1,100 @@
+/**
+ * @file timer.c
+ * @brief Implements the monotonic clock on Windows and POSIX systems.
+ */
+
+
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 199309L  // clock_gettime in strict C modes
+#endif
+
+#include "timer.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <errno.h>
+#include <sched.h>
+#include <time.h>
+#endif
+
+
+#ifdef _WIN32
+#define TIMER_YIELD_MS 2.0   // time before a deadline spent yielding, Sleep has millisecond granularity
+#else
+#define TIMER_YIELD_MS 0.25  // time before a deadline spent yielding, covers the wake-up latency of nanosleep
+#endif
+
+
+/**
+ * @brief Returns the time of a monotonic clock in milliseconds.
+ *
+ * Uses the performance counter on Windows and CLOCK_MONOTONIC elsewhere.
+ *
+ * @return double Current time in milliseconds.
+ */
+double timer_now_ms(void)
+{
+#ifdef _WIN32
+    static LARGE_INTEGER frequency = { 0 };
+    if (frequency.QuadPart == 0)
+    {
+        QueryPerformanceFrequency(&frequency);
+    }
+
+    LARGE_INTEGER counter;
+    QueryPerformanceCounter(&counter);
+    return (double)counter.QuadPart * 1000.0 / (double)frequency.QuadPart;
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec * 1000.0 + (double)now.tv_nsec / 1000000.0;
+#endif
+}
+
+/**
+ * @brief Suspends the calling thread for about the given time.
+ *
+ * Uses Sleep on Windows, which has millisecond granularity, and
+ * nanosleep elsewhere, resuming after interruptions by signals.
+ *
+ * @param milliseconds Time to sleep in milliseconds, nothing happens if not positive.
+ */
+void timer_sleep_ms(double milliseconds)
+{
+    if (milliseconds <= 0.0)
+    {
+        return;
+    }
+
+#ifdef _WIN32
+    Sleep((DWORD)milliseconds);
+#else
+    struct timespec remaining;
+    remaining.tv_sec  = (time_t)(milliseconds / 1000.0);
+    remaining.tv_nsec = (long)((milliseconds - (double)remaining.tv_sec * 1000.0) * 1000000.0);
+    while (nanosleep(&remaining, &remaining) != 0 && errno == EINTR)
+    {
+        // Interrupted by a signal, sleep for the time that is left.
+    }
+#endif
+}
+
+/**
+ * @brief Suspends the calling thread until the monotonic clock reaches a deadline.
+ *
+ * @param deadline_ms Time of timer_now_ms to wake up at, returns at once if it passed.
+ */
+void timer_sleep_until_ms(double deadline_ms)
+{
+    timer_sleep_ms(deadline_ms - timer_now_ms() - TIMER_YIELD_MS);
+
+    while (timer_now_ms() < deadline_ms)
+    {
+#ifdef _WIN32
+        SwitchToThread();
+#else
+        sched_yield();
+#endif
+    }
+}
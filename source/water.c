@@ -13,15 +13,20 @@
 #include <GL/freeglut.h>
 
 
-// Water grid vertex array.
-point_3d water_vertices[WATER_GRID_SIZE + 1][WATER_GRID_SIZE + 1];
+#define WATER_WAVE_AMPLITUDE 0.5f    // height of the wave crests
+#define WATER_WAVE_SPEED     0.001f  // wave phase advanced per millisecond
+
+
+// Water grid vertex and normal arrays.
+point_3d  water_vertices[WATER_GRID_SIZE + 1][WATER_GRID_SIZE + 1];
+vector_3d water_normals[WATER_GRID_SIZE + 1][WATER_GRID_SIZE + 1];
 
 
 /**
  * @brief Initializes the water grid vertices to a flat surface.
  *
  * Sets up the grid vertices evenly spaced over a fixed square region,
- * with initial height (Y) set to 0.
+ * with initial height (Y) set to 0 and normals pointing up.
  */
 void water_initialize(void)
 {
@@ -40,6 +45,10 @@ void water_initialize(void)
             water_vertices[i][j][0] = x;
             water_vertices[i][j][1] = 0.0f;
             water_vertices[i][j][2] = z;
+
+            water_normals[i][j][0] = 0.0f;
+            water_normals[i][j][1] = 1.0f;
+            water_normals[i][j][2] = 0.0f;
         }
     }
 }
@@ -49,17 +58,31 @@ void water_initialize(void)
  *
  * Modifies the Y coordinate of each vertex with a sine wave based on
  * vertex position and elapsed time to create an animated water effect.
+ * The wave only travels along Z, so each normal is the normalized
+ * (0, 1, -dy/dz) of the analytic slope.
+ *
+ * @param elapsed_ms Simulated time since the start in milliseconds.
  */
-void water_update(void)
+void water_update(GLfloat elapsed_ms)
 {
+    const GLfloat phase = elapsed_ms * WATER_WAVE_SPEED;
+
     for (int i = 0; i <= WATER_GRID_SIZE; i++)
     {
+        // All vertices of a row share their Z, so the wave is evaluated once per row.
+        const GLfloat angle  = water_vertices[i][0][2] + phase;
+        const GLfloat height = sinf(angle) * WATER_WAVE_AMPLITUDE;
+
+        vector_3d normal = { 0.0f, 1.0f, -cosf(angle) * WATER_WAVE_AMPLITUDE };
+        geometry_normalize_vector(normal);
+
         for (int j = 0; j <= WATER_GRID_SIZE; j++)
         {
-            water_vertices[i][j][1] = sinf(
-                water_vertices[i][j][2] +
-                glutGet(GLUT_ELAPSED_TIME) * 0.001f
-            ) * 0.5f;
+            water_vertices[i][j][1] = height;
+
+            water_normals[i][j][0] = normal[0];
+            water_normals[i][j][1] = normal[1];
+            water_normals[i][j][2] = normal[2];
         }
     }
 }
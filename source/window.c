@@ -6,6 +6,7 @@
 
 #include "window.h"
 #include "glut_callbacks.h"
+#include "options.h"
 
 
 // Global instance of the window settings.
@@ -31,6 +32,13 @@ void window_initialize(int argc, char** argv)
     // Initialize FreeGLUT toolkit.
     glutInit(&argc, argv);
 
+    // The core backend needs an OpenGL 3.3 core profile context.
+    if (main_options.backend == RENDER_BACKEND_CORE)
+    {
+        glutInitContextVersion(3, 3);
+        glutInitContextProfile(GLUT_CORE_PROFILE);
+    }
+
     // Initialize FreeGLUT window.
     glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGBA | GLUT_DEPTH);  // double buffering, RGBA colors, 3D.
     glutInitWindowSize(main_window.width, main_window.height);
@@ -40,6 +48,7 @@ void window_initialize(int argc, char** argv)
     glutDisplayFunc(callback_display);
     glutReshapeFunc(callback_reshape);
     glutIdleFunc(callback_idle);
+    glutWindowStatusFunc(callback_window_status);
     glutPassiveMotionFunc(callback_passive_motion);
     glutKeyboardUpFunc(callback_keyboard_up);
     glutKeyboardFunc(callback_keyboard);
@@ -0,0 +1,157 @@
+/**
+ * @file worker_pool.c
+ * @brief Implements the pool of threads running job tasks.
+ */
+
+
+#include "worker_pool.h"
+
+
+/**
+ * @brief Runs tasks of the current job until none are left.
+ *
+ * Must be called with the pool mutex locked, returns with it locked.
+ * Signals the waiting caller once the last task is done.
+ *
+ * @param pool The pool.
+ */
+static void run_tasks(worker_pool* pool)
+{
+    while (pool->next_task < pool->task_count)
+    {
+        const int         task     = pool->next_task++;
+        const worker_task function = pool->task;
+        void*             argument = pool->argument;
+
+        thread_mutex_unlock(&pool->mutex);
+        function(argument, task);
+        thread_mutex_lock(&pool->mutex);
+
+        if (++pool->tasks_done == pool->task_count)
+        {
+            thread_condition_broadcast(&pool->job_finished);
+        }
+    }
+}
+
+/**
+ * @brief Waits for jobs and runs their tasks until the pool stops.
+ *
+ * @param argument The pool.
+ */
+static void run_thread(void* argument)
+{
+    worker_pool* pool     = (worker_pool*)argument;
+    unsigned     last_job = 0;
+
+    thread_mutex_lock(&pool->mutex);
+    last_job = pool->job_number;
+    while (!pool->stopping)
+    {
+        if (pool->job_number == last_job)
+        {
+            thread_condition_wait(&pool->job_started, &pool->mutex);
+            continue;
+        }
+
+        last_job = pool->job_number;
+        run_tasks(pool);
+    }
+    thread_mutex_unlock(&pool->mutex);
+}
+
+/**
+ * @brief Starts the threads of a pool.
+ *
+ * @param pool         The pool to start.
+ * @param thread_count Threads besides the calling thread, at most WORKER_POOL_MAX_THREADS.
+ * @return int Number of threads started, fewer if the system refused some.
+ */
+int worker_pool_create(worker_pool* pool, int thread_count)
+{
+    if (thread_count > WORKER_POOL_MAX_THREADS)
+    {
+        thread_count = WORKER_POOL_MAX_THREADS;
+    }
+
+    thread_mutex_initialize(&pool->mutex);
+    thread_condition_initialize(&pool->job_started);
+    thread_condition_initialize(&pool->job_finished);
+    pool->task       = NULL;
+    pool->argument   = NULL;
+    pool->task_count = 0;
+    pool->next_task  = 0;
+    pool->tasks_done = 0;
+    pool->job_number = 0;
+    pool->stopping   = 0;
+
+    pool->thread_count = 0;
+    while (pool->thread_count < thread_count &&
+           thread_create(&pool->threads[pool->thread_count], run_thread, pool))
+    {
+        ++pool->thread_count;
+    }
+    return pool->thread_count;
+}
+
+/**
+ * @brief Runs every task of a job and waits until all are done.
+ *
+ * The calling thread runs tasks as well. Without threads, or for a
+ * single task, the tasks run on the caller without locking.
+ *
+ * @param pool       The pool.
+ * @param task       Function called once for every task index.
+ * @param argument   Argument passed to every call.
+ * @param task_count Number of tasks, indexed from 0.
+ */
+void worker_pool_run(worker_pool* pool, worker_task task, void* argument, int task_count)
+{
+    if (pool->thread_count == 0 || task_count <= 1)
+    {
+        for (int i = 0; i < task_count; ++i)
+        {
+            task(argument, i);
+        }
+        return;
+    }
+
+    thread_mutex_lock(&pool->mutex);
+    pool->task       = task;
+    pool->argument   = argument;
+    pool->task_count = task_count;
+    pool->next_task  = 0;
+    pool->tasks_done = 0;
+    ++pool->job_number;
+    thread_condition_broadcast(&pool->job_started);
+
+    run_tasks(pool);
+    while (pool->tasks_done < pool->task_count)
+    {
+        thread_condition_wait(&pool->job_finished, &pool->mutex);
+    }
+    thread_mutex_unlock(&pool->mutex);
+}
+
+/**
+ * @brief Stops and joins the threads of a pool.
+ *
+ * @param pool The pool to stop.
+ */
+void worker_pool_destroy(worker_pool* pool)
+{
+    thread_mutex_lock(&pool->mutex);
+    pool->stopping = 1;
+    thread_condition_broadcast(&pool->job_started);
+    thread_mutex_unlock(&pool->mutex);
+
+    for (int i = 0; i < pool->thread_count; ++i)
+    {
+        thread_join(&pool->threads[i]);
+    }
+    pool->thread_count = 0;
+
+    thread_condition_destroy(&pool->job_finished);
+    thread_condition_destroy(&pool->job_started);
+    thread_mutex_destroy(&pool->mutex);
+}